@@ -0,0 +1,65 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// eglext_swiftshader.h: SwiftShader specific EGL extensions.
+
+#ifndef __eglext_swiftshader_h_
+#define __eglext_swiftshader_h_ 1
+
+#include <EGL/egl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef EGL_SWIFTSHADER_headless_window
+#define EGL_SWIFTSHADER_headless_window 1
+
+// Native window of the EGL_PLATFORM_SURFACELESS_MESA display, passed by address to
+// eglCreatePlatformWindowSurfaceEXT. Frames are presented to memory, as rows of 4-byte
+// BGRX pixels from top to bottom. The size is read again after each swap, to resize the
+// surface. Windows are registered with eglRegisterHeadlessWindowSWIFTSHADER before their
+// surface is created, and unregistered after it is destroyed. The display is obtained with
+// eglGetPlatformDisplayEXT, or from eglGetDisplay when SWIFTSHADER_HEADLESS is set.
+typedef void (*EGLHeadlessPresentSWIFTSHADER)(void *userData, const void *pixels, EGLint width, EGLint height, EGLint stride);
+
+typedef struct EGLHeadlessWindowSWIFTSHADER
+{
+	EGLint width;
+	EGLint height;
+
+	// Memory receiving each frame, such as a shared memory segment of at least
+	// height * stride bytes, with a stride of at least width * 4 bytes
+	void *pixels;
+	EGLint stride;
+
+	// Optional callback, called after each frame was presented
+	EGLHeadlessPresentSWIFTSHADER present;
+	void *userData;
+} EGLHeadlessWindowSWIFTSHADER;
+
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLREGISTERHEADLESSWINDOWSWIFTSHADERPROC) (EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLUNREGISTERHEADLESSWINDOWSWIFTSHADERPROC) (EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
+#ifdef EGL_EGLEXT_PROTOTYPES
+EGLAPI EGLBoolean EGLAPIENTRY eglRegisterHeadlessWindowSWIFTSHADER (EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
+EGLAPI EGLBoolean EGLAPIENTRY eglUnregisterHeadlessWindowSWIFTSHADER (EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
+#endif
+
+#endif /* EGL_SWIFTSHADER_headless_window */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __eglext_swiftshader_h_ */
@@ -24,9 +24,12 @@ COMMON_SRC_FILES := \
 	Common/Half.cpp \
 	Common/Math.cpp \
 	Common/Memory.cpp \
+	Common/Metrics.cpp \
 	Common/Resource.cpp \
 	Common/Socket.cpp \
 	Common/Thread.cpp \
+	Common/ThreadPool.cpp \
+	Common/Trace.cpp \
 	Common/Timer.cpp
 
 COMMON_SRC_FILES += \
@@ -45,6 +48,7 @@ COMMON_SRC_FILES += \
 	Renderer/Blitter.cpp \
 	Renderer/Clipper.cpp \
 	Renderer/Color.cpp \
+	Renderer/CompileLog.cpp \
 	Renderer/Context.cpp \
 	Renderer/ETC_Decoder.cpp \
 	Renderer/Matrix.cpp \
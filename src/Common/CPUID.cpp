@@ -291,4 +291,18 @@ namespace sw
 	{
 		// Unimplemented
 	}
+
+	bool CPUID::getFlushToZero()
+	{
+		#if defined(_MSC_VER)
+			return (_controlfp(0, 0) & _MCW_DN) == _DN_FLUSH;
+		#else
+			return false;   // Unimplemented
+		#endif
+	}
+
+	bool CPUID::getDenormalsAreZero()
+	{
+		return false;   // Unimplemented
+	}
 }
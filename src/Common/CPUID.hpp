@@ -45,6 +45,8 @@ namespace sw
 
 		static void setFlushToZero(bool enable);        // Denormal results are written as zero
 		static void setDenormalsAreZero(bool enable);   // Denormal inputs are read as zero
+		static bool getFlushToZero();
+		static bool getDenormalsAreZero();
 
 	private:
 		static bool MMX;
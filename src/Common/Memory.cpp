@@ -16,6 +16,7 @@
 
 #include "Types.hpp"
 #include "Debug.hpp"
+#include "MutexLock.hpp"
 
 #if defined(_WIN32)
 	#ifndef WIN32_LEAN_AND_MEAN
@@ -24,10 +25,20 @@
 	#include <windows.h>
 #else
 	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
 	#include <unistd.h>
+	#if defined(__linux__)
+		#include <sys/syscall.h>
+	#endif
 #endif
 
 #include <memory.h>
+#include <stdio.h>
+
+#include <iterator>
+#include <map>
+#include <vector>
 
 #undef allocate
 #undef deallocate
@@ -100,15 +111,410 @@ void deallocate(void *memory)
 	}
 }
 
+namespace
+{
+// Executable memory is suballocated from large slabs, to avoid mapping memory for
+// every routine. Each slab is one shared memory object mapped twice: read+write,
+// where routines are written, and read+execute, where they run. No address is
+// ever writable and executable at once, and protections never change after a slab
+// is mapped, so routines are packed at cache line granularity and the slab's huge
+// pages are never split.
+class ExecutableArena
+{
+public:
+	void *allocate(size_t bytes);
+	void *executableAddress(void *memory);
+	void seal(void *memory);
+	void deallocate(void *memory);
+	ExecutableMemoryStatistics statistics();
+
+private:
+	struct Slab
+	{
+		unsigned char *writable;
+		unsigned char *executable;
+		size_t size;
+	};
+
+	static bool map(Slab &slab, size_t bytes);
+	static void unmap(const Slab &slab);
+	#if !defined(_WIN32)
+		static int createSharedMemory();
+		static unsigned char *mapAligned(int fd, size_t bytes, int protection);
+	#endif
+	const Slab *findSlab(const unsigned char *memory) const;
+	void releaseFreeSlabs();
+
+	enum {SLAB_SIZE = 2 * 1024 * 1024};   // Matches the x86 large page size
+	enum {ALIGNMENT = 64};                // Cache line size
+
+	sw::BackoffLock mutex;
+	std::vector<Slab> slabs;
+	std::map<unsigned char*, size_t> freeBlocks;   // Coalesced, keyed by writable address
+	std::map<unsigned char*, size_t> liveBlocks;
+};
+
+ExecutableArena &executableArena()
+{
+	// Never destroyed, as routines held by static objects are freed during static destruction
+	static ExecutableArena *arena = new ExecutableArena();
+
+	return *arena;
+}
+
+#if !defined(_WIN32)
+int ExecutableArena::createSharedMemory()
+{
+	int fd = -1;
+
+	#if defined(__linux__) && defined(SYS_memfd_create)
+		fd = static_cast<int>(syscall(SYS_memfd_create, "SwiftShader JIT", 1u /* MFD_CLOEXEC */));
+
+		if(fd >= 0)
+		{
+			return fd;
+		}
+	#endif
+
+	#if defined(__ANDROID__)
+		return -1;
+	#else
+		// Fall back to a POSIX shared memory object, unlinked right away so it
+		// lives only as long as its mappings. Slabs are created under the arena
+		// mutex, so the counter needs no synchronization.
+		static int counter = 0;
+		char name[64];
+		snprintf(name, sizeof(name), "/swiftshader-jit-%d-%d", static_cast<int>(getpid()), counter++);
+
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+		if(fd >= 0)
+		{
+			shm_unlink(name);
+		}
+
+		return fd;
+	#endif
+}
+
+unsigned char *ExecutableArena::mapAligned(int fd, size_t bytes, int protection)
+{
+	// Over-reserve so the view can be aligned for transparent huge pages
+	size_t reserved = bytes + SLAB_SIZE;
+	void *memory = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(memory == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	unsigned char *begin = (unsigned char*)memory;
+	unsigned char *aligned = (unsigned char*)(((uintptr_t)begin + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1));
+	unsigned char *end = begin + reserved;
+
+	if(mmap(aligned, bytes, protection, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(begin, reserved);
+		return nullptr;
+	}
+
+	if(aligned != begin)
+	{
+		munmap(begin, aligned - begin);
+	}
+
+	if(aligned + bytes != end)
+	{
+		munmap(aligned + bytes, end - (aligned + bytes));
+	}
+
+	#if defined(MADV_HUGEPAGE)
+		madvise(aligned, bytes, MADV_HUGEPAGE);
+	#endif
+
+	return aligned;
+}
+#endif
+
+bool ExecutableArena::map(Slab &slab, size_t bytes)
+{
+	slab.size = bytes;
+
+	#if defined(_WIN32)
+		HANDLE section = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_EXECUTE_READWRITE, (DWORD)((unsigned long long)bytes >> 32), (DWORD)bytes, NULL);
+
+		if(!section)
+		{
+			return false;
+		}
+
+		slab.writable = (unsigned char*)MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, bytes);
+		slab.executable = (unsigned char*)MapViewOfFile(section, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, bytes);
+		CloseHandle(section);   // The views keep the section alive
+	#else
+		int fd = createSharedMemory();
+
+		if(fd < 0)
+		{
+			return false;
+		}
+
+		if(ftruncate(fd, bytes) != 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		slab.writable = mapAligned(fd, bytes, PROT_READ | PROT_WRITE);
+		slab.executable = mapAligned(fd, bytes, PROT_READ | PROT_EXEC);
+		close(fd);   // The mappings keep the memory alive
+	#endif
+
+	if(!slab.writable || !slab.executable)
+	{
+		unmap(slab);
+		return false;
+	}
+
+	return true;
+}
+
+void ExecutableArena::unmap(const Slab &slab)
+{
+	#if defined(_WIN32)
+		if(slab.writable) UnmapViewOfFile(slab.writable);
+		if(slab.executable) UnmapViewOfFile(slab.executable);
+	#else
+		if(slab.writable) munmap(slab.writable, slab.size);
+		if(slab.executable) munmap(slab.executable, slab.size);
+	#endif
+}
+
+const ExecutableArena::Slab *ExecutableArena::findSlab(const unsigned char *memory) const
+{
+	for(const Slab &slab : slabs)
+	{
+		if(memory >= slab.writable && memory < slab.writable + slab.size)
+		{
+			return &slab;
+		}
+	}
+
+	return nullptr;
+}
+
+void *ExecutableArena::allocate(size_t bytes)
+{
+	bytes = ((bytes ? bytes : 1) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+	mutex.lock();
+
+	// First fit, in address order to keep routines at the start of slabs
+	auto block = freeBlocks.begin();
+	while(block != freeBlocks.end() && block->second < bytes)
+	{
+		++block;
+	}
+
+	if(block == freeBlocks.end())
+	{
+		Slab slab = {};
+
+		if(!map(slab, (bytes + SLAB_SIZE - 1) & ~(size_t)(SLAB_SIZE - 1)))
+		{
+			mutex.unlock();
+			return nullptr;
+		}
+
+		slabs.push_back(slab);
+		block = freeBlocks.insert({slab.writable, slab.size}).first;
+	}
+
+	unsigned char *memory = block->first;
+	size_t remaining = block->second - bytes;
+
+	freeBlocks.erase(block);
+
+	if(remaining > 0)
+	{
+		freeBlocks[memory + bytes] = remaining;
+	}
+
+	liveBlocks[memory] = bytes;
+
+	mutex.unlock();
+
+	return memory;
+}
+
+void *ExecutableArena::executableAddress(void *memory)
+{
+	unsigned char *writable = (unsigned char*)memory;
+
+	mutex.lock();
+
+	const Slab *slab = findSlab(writable);
+	ASSERT(slab);
+	unsigned char *executable = slab->executable + (writable - slab->writable);
+
+	mutex.unlock();
+
+	return executable;
+}
+
+void ExecutableArena::seal(void *memory)
+{
+	unsigned char *begin = (unsigned char*)memory;
+
+	mutex.lock();
+
+	auto live = liveBlocks.find(begin);
+	ASSERT(live != liveBlocks.end());
+
+	// Both views share the same physical memory, so the routine is already visible
+	// at its executable address. Only instruction caches which don't snoop data
+	// writes need to be told about it.
+	#if !defined(_WIN32) && !defined(__i386__) && !defined(__x86_64__)
+		const Slab *slab = findSlab(begin);
+		char *executable = (char*)slab->executable + (begin - slab->writable);
+		__builtin___clear_cache(executable, executable + live->second);
+	#endif
+
+	mutex.unlock();
+}
+
+void ExecutableArena::deallocate(void *memory)
+{
+	unsigned char *begin = (unsigned char*)memory;
+
+	mutex.lock();
+
+	auto live = liveBlocks.find(begin);
+	ASSERT(live != liveBlocks.end());
+	size_t bytes = live->second;
+	liveBlocks.erase(live);
+
+	// Fill freed code with breakpoints (int3), so stray calls into it trap
+	memset(begin, 0xCC, bytes);
+
+	// Return the block to the free list, merging it with its neighbors
+	auto next = freeBlocks.lower_bound(begin);
+
+	if(next != freeBlocks.end() && next->first == begin + bytes)
+	{
+		bytes += next->second;
+		next = freeBlocks.erase(next);
+	}
+
+	if(next != freeBlocks.begin())
+	{
+		auto previous = std::prev(next);
+
+		if(previous->first + previous->second == begin)
+		{
+			begin = previous->first;
+			bytes += previous->second;
+			freeBlocks.erase(previous);
+		}
+	}
+
+	freeBlocks[begin] = bytes;
+
+	releaseFreeSlabs();
+
+	mutex.unlock();
+}
+
+void ExecutableArena::releaseFreeSlabs()
+{
+	// Keep one slab around, to avoid repeatedly mapping and unmapping it
+	for(size_t i = 0; i < slabs.size() && slabs.size() > 1; i++)
+	{
+		auto block = freeBlocks.find(slabs[i].writable);
+
+		if(block != freeBlocks.end() && block->second == slabs[i].size)
+		{
+			freeBlocks.erase(block);
+			unmap(slabs[i]);
+
+			slabs[i] = slabs.back();
+			slabs.pop_back();
+			i--;
+		}
+	}
+}
+
+ExecutableMemoryStatistics ExecutableArena::statistics()
+{
+	ExecutableMemoryStatistics statistics = {};
+
+	mutex.lock();
+
+	for(const Slab &slab : slabs)
+	{
+		statistics.arenaBytes += slab.size;
+	}
+
+	for(const auto &block : freeBlocks)
+	{
+		statistics.freeBytes += block.second;
+		statistics.largestFreeBlock = block.second > statistics.largestFreeBlock ? block.second : statistics.largestFreeBlock;
+	}
+
+	for(const auto &block : liveBlocks)
+	{
+		statistics.liveBytes += block.second;
+	}
+
+	statistics.slabCount = static_cast<int>(slabs.size());
+	statistics.liveAllocations = static_cast<int>(liveBlocks.size());
+
+	mutex.unlock();
+
+	return statistics;
+}
+}
+
 void *allocateExecutable(size_t bytes)
+{
+	return executableArena().allocate(bytes);
+}
+
+void *executableAddress(void *memory)
+{
+	return executableArena().executableAddress(memory);
+}
+
+void markExecutable(void *memory)
+{
+	executableArena().seal(memory);
+}
+
+void deallocateExecutable(void *memory)
+{
+	if(memory)
+	{
+		executableArena().deallocate(memory);
+	}
+}
+
+ExecutableMemoryStatistics executableMemoryStatistics()
+{
+	return executableArena().statistics();
+}
+
+void *allocateExecutablePages(size_t bytes)
 {
 	size_t pageSize = memoryPageSize();
 
 	return allocate((bytes + pageSize - 1) & ~(pageSize - 1), pageSize);
 }
 
-void markExecutable(void *memory, size_t bytes)
+void markExecutablePages(void *memory, size_t bytes)
 {
+	size_t pageSize = memoryPageSize();
+	bytes = (bytes + pageSize - 1) & ~(pageSize - 1);
+
 	#if defined(_WIN32)
 		unsigned long oldProtection;
 		VirtualProtect(memory, bytes, PAGE_EXECUTE_READ, &oldProtection);
@@ -117,8 +523,11 @@ void markExecutable(void *memory, size_t bytes)
 	#endif
 }
 
-void deallocateExecutable(void *memory, size_t bytes)
+void deallocateExecutablePages(void *memory, size_t bytes)
 {
+	size_t pageSize = memoryPageSize();
+	bytes = (bytes + pageSize - 1) & ~(pageSize - 1);
+
 	#if defined(_WIN32)
 		unsigned long oldProtection;
 		VirtualProtect(memory, bytes, PAGE_READWRITE, &oldProtection);
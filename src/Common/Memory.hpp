@@ -25,9 +25,31 @@ void *allocate(size_t bytes, size_t alignment = 16);
 void *allocateZero(size_t bytes, size_t alignment = 16);
 void deallocate(void *memory);
 
-void *allocateExecutable(size_t bytes);   // Allocates memory that can be made executable using markExecutable()
-void markExecutable(void *memory, size_t bytes);
-void deallocateExecutable(void *memory, size_t bytes);
+// Routines are packed into slabs which are mapped twice, read+write and read+execute.
+// A routine is written through the address returned by allocateExecutable() and runs
+// from executableAddress(), so its code must not depend on where it was written.
+void *allocateExecutable(size_t bytes);
+void *executableAddress(void *memory);    // Also accepts addresses inside an allocation
+void markExecutable(void *memory);        // Call once the routine is written, before it runs
+void deallocateExecutable(void *memory);
+
+// Routines which must run where they were written occupy whole pages of their own,
+// made read+execute by markExecutablePages(). They can't be written afterwards.
+void *allocateExecutablePages(size_t bytes);
+void markExecutablePages(void *memory, size_t bytes);
+void deallocateExecutablePages(void *memory, size_t bytes);
+
+struct ExecutableMemoryStatistics
+{
+	size_t arenaBytes;         // Reserved for executable code
+	size_t liveBytes;          // Allocated to routines
+	size_t freeBytes;          // Available for reuse
+	size_t largestFreeBlock;   // Fragmentation is 1 - largestFreeBlock / freeBytes
+	int slabCount;
+	int liveAllocations;
+};
+
+ExecutableMemoryStatistics executableMemoryStatistics();
 }
 
 #endif   // Memory_hpp
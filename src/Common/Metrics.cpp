@@ -0,0 +1,363 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Metrics.hpp"
+
+#include "Thread.hpp"
+#include "ThreadPool.hpp"
+#include "MutexLock.hpp"
+#include "Socket.hpp"
+#include "Memory.hpp"
+#include "Timer.hpp"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#endif
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sw
+{
+	namespace
+	{
+		struct Description
+		{
+			const char *name;
+			const char *labels;
+			const char *type;
+			const char *help;
+		};
+
+		// Counters with the same name must be adjacent, so they share one HELP and TYPE line
+		const Description descriptions[Metrics::COUNTERS] =
+		{
+			{"swiftshader_frames_total", "", "counter", "Frames presented."},
+			{"swiftshader_draws_total", "", "counter", "Draw calls."},
+			{"swiftshader_primitives_total", "", "counter", "Primitives submitted."},
+			{"swiftshader_primitives_culled_total", "", "counter", "Primitives culled or clipped away by setup."},
+			{"swiftshader_primitives_clipped_total", "", "counter", "Primitives which went through the clipper."},
+			{"swiftshader_pixels_total", "", "counter", "Pixels covered by rasterized primitives."},
+			{"swiftshader_routine_cache_hits_total", "{cache=\"vertex\"}", "counter", "Routine lookups, made when the draw state changed, which found a cached routine."},
+			{"swiftshader_routine_cache_hits_total", "{cache=\"setup\"}", "counter", ""},
+			{"swiftshader_routine_cache_hits_total", "{cache=\"pixel\"}", "counter", ""},
+			{"swiftshader_routine_cache_misses_total", "{cache=\"vertex\"}", "counter", "Routine lookups which had to compile a routine."},
+			{"swiftshader_routine_cache_misses_total", "{cache=\"setup\"}", "counter", ""},
+			{"swiftshader_routine_cache_misses_total", "{cache=\"pixel\"}", "counter", ""},
+			{"swiftshader_routine_compiles_total", "{cache=\"vertex\"}", "counter", "Routines compiled, including background recompiles."},
+			{"swiftshader_routine_compiles_total", "{cache=\"setup\"}", "counter", ""},
+			{"swiftshader_routine_compiles_total", "{cache=\"pixel\"}", "counter", ""},
+			{"swiftshader_routine_compile_seconds_total", "{cache=\"vertex\"}", "counter", "Time spent compiling routines."},
+			{"swiftshader_routine_compile_seconds_total", "{cache=\"setup\"}", "counter", ""},
+			{"swiftshader_routine_compile_seconds_total", "{cache=\"pixel\"}", "counter", ""},
+			{"swiftshader_resource_lock_wait_seconds_total", "", "counter", "Time spent waiting for locked resources."},
+		};
+
+		const Metrics::Counter firstTimeCounter = Metrics::VERTEX_COMPILE_TIME;
+
+		const char *environment = getenv("SWIFTSHADER_METRICS");
+		std::string setting;   // Of the running exporter
+		const int64_t origin = Timer::counter();
+
+		std::atomic<int64_t> counters[Metrics::COUNTERS];
+		std::atomic<int64_t> threadTime[ThreadPool::MAX_THREADS];
+
+		BackoffLock exporterMutex;   // Guards the exporter and its users
+		Thread *exporter = nullptr;
+		int exporterUsers = 0;
+		volatile bool terminate = false;
+
+		double seconds(int64_t counter)
+		{
+			return (double)counter / (double)Timer::frequency();
+		}
+
+		bool isPort(const std::string &port)
+		{
+			if(port.empty())
+			{
+				return false;
+			}
+
+			for(const char *c = port.c_str(); *c; c++)
+			{
+				if(*c < '0' || *c > '9')
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Splits a setting of the form [address:]port. Other settings are file paths.
+		bool isEndpoint(const std::string &setting, std::string &address, std::string &port)
+		{
+			size_t colon = setting.rfind(':');
+
+			if(colon == std::string::npos)
+			{
+				address = "localhost";
+				port = setting;
+			}
+			else
+			{
+				address = setting.substr(0, colon);
+				port = setting.substr(colon + 1);
+			}
+
+			return !address.empty() && isPort(port);
+		}
+
+		void writeFile()
+		{
+			std::string text = Metrics::text();
+
+			// Write a copy and rename it over the file, so readers never see a partial or missing file
+			std::string temporary = setting + ".tmp";
+			FILE *file = fopen(temporary.c_str(), "w");
+
+			if(file)
+			{
+				fwrite(text.c_str(), 1, text.size(), file);
+				fclose(file);
+
+				#if defined(_WIN32)
+					MoveFileExA(temporary.c_str(), setting.c_str(), MOVEFILE_REPLACE_EXISTING);
+				#else
+					rename(temporary.c_str(), setting.c_str());   // Replaces the target atomically
+				#endif
+			}
+		}
+
+		void respond(Socket *client)
+		{
+			char request[1024];
+			int length = client->select(100000) ? client->receive(request, sizeof(request) - 1) : 0;
+
+			if(length <= 0)
+			{
+				return;
+			}
+
+			request[length] = 0;
+
+			std::string body;
+			const char *status;
+
+			if(strncmp(request, "GET /metrics ", 13) == 0)
+			{
+				status = "200 OK";
+				body = Metrics::text();
+			}
+			else
+			{
+				status = "404 Not Found";
+			}
+
+			char header[256];
+			snprintf(header, sizeof(header), "HTTP/1.1 %s\r\n"
+			                                 "Content-Type: text/plain; version=0.0.4\r\n"
+			                                 "Content-Length: %d\r\n"
+			                                 "Connection: close\r\n"
+			                                 "\r\n", status, (int)body.size());
+
+			std::string response = header + body;
+			client->send(response.c_str(), (int)response.size());
+		}
+
+		void serve(const std::string &address, const std::string &port)
+		{
+			Socket::startup();
+
+			Socket *listener = new Socket(address.c_str(), port.c_str());
+
+			if(!listener->isValid() || !listener->listen(4))
+			{
+				fprintf(stderr, "SwiftShader: cannot serve metrics on %s:%s\n", address.c_str(), port.c_str());
+
+				delete listener;
+				Socket::cleanup();
+				return;
+			}
+
+			while(!terminate)
+			{
+				if(listener->select(100000))
+				{
+					Socket *client = listener->accept();
+
+					if(client->isValid())
+					{
+						respond(client);
+					}
+
+					delete client;
+				}
+			}
+
+			delete listener;
+
+			Socket::cleanup();
+		}
+
+		void exporterFunction(void *parameters)
+		{
+			std::string address;
+			std::string port;
+
+			if(isEndpoint(setting, address, port))
+			{
+				serve(address, port);
+				return;
+			}
+
+			int64_t last = Timer::counter();
+
+			while(!terminate)
+			{
+				Thread::sleep(100);
+
+				if(Timer::counter() - last >= Timer::frequency())
+				{
+					writeFile();
+					last = Timer::counter();
+				}
+			}
+
+			writeFile();
+		}
+	}
+
+	bool Metrics::active = environment && *environment;
+
+	void Metrics::increment(Counter counter, int64_t value)
+	{
+		counters[counter].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	void Metrics::addTime(Counter counter, int64_t start)
+	{
+		if(active)
+		{
+			increment(counter, Timer::counter() - start);
+		}
+	}
+
+	void Metrics::addThreadTime(int thread, int64_t start)
+	{
+		if(active && thread < ThreadPool::MAX_THREADS)
+		{
+			threadTime[thread].fetch_add(Timer::counter() - start, std::memory_order_relaxed);
+		}
+	}
+
+	void Metrics::start()
+	{
+		start(environment);
+	}
+
+	void Metrics::start(const char *destination)
+	{
+		exporterMutex.lock();
+
+		if(!exporter && destination && *destination)
+		{
+			setting = destination;
+			active = true;
+			terminate = false;
+			exporter = new Thread(exporterFunction, nullptr);
+		}
+
+		exporterUsers++;
+
+		exporterMutex.unlock();
+	}
+
+	void Metrics::stop()
+	{
+		exporterMutex.lock();
+
+		if(exporterUsers > 0 && --exporterUsers == 0 && exporter)
+		{
+			terminate = true;
+			delete exporter;   // Joins it
+			exporter = nullptr;
+		}
+
+		exporterMutex.unlock();
+	}
+
+	std::string Metrics::text()
+	{
+		std::string text;
+		char line[256];
+
+		for(int i = 0; i < COUNTERS; i++)
+		{
+			const Description &description = descriptions[i];
+			int64_t value = counters[i].load(std::memory_order_relaxed);
+
+			if(i == 0 || strcmp(description.name, descriptions[i - 1].name) != 0)
+			{
+				snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", description.name, description.help, description.name, description.type);
+				text += line;
+			}
+
+			if(i >= firstTimeCounter)
+			{
+				snprintf(line, sizeof(line), "%s%s %.6f\n", description.name, description.labels, seconds(value));
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "%s%s %lld\n", description.name, description.labels, (long long)value);
+			}
+
+			text += line;
+		}
+
+		ExecutableMemoryStatistics jit = executableMemoryStatistics();
+
+		snprintf(line, sizeof(line), "# HELP swiftshader_jit_memory_bytes Executable memory reserved for routines, and in use by them.\n"
+		                             "# TYPE swiftshader_jit_memory_bytes gauge\n"
+		                             "swiftshader_jit_memory_bytes{state=\"reserved\"} %lld\n"
+		                             "swiftshader_jit_memory_bytes{state=\"live\"} %lld\n",
+		                             (long long)jit.arenaBytes, (long long)jit.liveBytes);
+		text += line;
+
+		// Utilization is the rate of busy time
+		text += "# HELP swiftshader_worker_busy_seconds_total Time each worker thread spent running jobs.\n";
+		text += "# TYPE swiftshader_worker_busy_seconds_total counter\n";
+
+		for(int i = 0; i < ThreadPool::MAX_THREADS; i++)
+		{
+			int64_t value = threadTime[i].load(std::memory_order_relaxed);
+
+			if(value != 0)
+			{
+				snprintf(line, sizeof(line), "swiftshader_worker_busy_seconds_total{thread=\"%d\"} %.6f\n", i, seconds(value));
+				text += line;
+			}
+		}
+
+		snprintf(line, sizeof(line), "# HELP swiftshader_uptime_seconds Time since the library was loaded.\n"
+		                             "# TYPE swiftshader_uptime_seconds gauge\n"
+		                             "swiftshader_uptime_seconds %.3f\n", seconds(Timer::counter() - origin));
+		text += line;
+
+		return text;
+	}
+}
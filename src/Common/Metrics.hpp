@@ -0,0 +1,92 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_Metrics_hpp
+#define sw_Metrics_hpp
+
+#include "Types.hpp"
+
+#include <string>
+
+namespace sw
+{
+	// Process-wide counters in the Prometheus text format. Counting is enabled by setting
+	// SWIFTSHADER_METRICS either to a port number, to serve them at http://localhost:<port>/metrics,
+	// to <address>:<port>, to listen on another interface, or to the path of a file which is
+	// rewritten every second. When disabled, adding to a counter only tests a flag.
+	class Metrics
+	{
+	public:
+		enum Counter
+		{
+			FRAMES,
+			DRAWS,
+			PRIMITIVES,
+			PRIMITIVES_CULLED,
+			PRIMITIVES_CLIPPED,
+			PIXELS,   // Covered by the primitive outlines
+
+			VERTEX_ROUTINE_HITS,
+			SETUP_ROUTINE_HITS,
+			PIXEL_ROUTINE_HITS,
+			VERTEX_ROUTINE_MISSES,
+			SETUP_ROUTINE_MISSES,
+			PIXEL_ROUTINE_MISSES,
+			VERTEX_ROUTINE_COMPILES,
+			SETUP_ROUTINE_COMPILES,
+			PIXEL_ROUTINE_COMPILES,
+
+			// Timer::counter() units
+			VERTEX_COMPILE_TIME,
+			SETUP_COMPILE_TIME,
+			PIXEL_COMPILE_TIME,
+			LOCK_WAIT_TIME,
+
+			COUNTERS
+		};
+
+		static bool enabled()
+		{
+			return active;
+		}
+
+		static void add(Counter counter, int64_t value = 1)
+		{
+			if(active)
+			{
+				increment(counter, value);
+			}
+		}
+
+		// Adds the time elapsed since a Timer::counter() value
+		static void addTime(Counter counter, int64_t start);
+		static void addThreadTime(int thread, int64_t start);
+
+		// Starts the exporter on first use. It runs once per process, until every start() has been
+		// matched by a stop(). The last stop() joins the exporter thread, so it must not be called
+		// from static destructors or DllMain, where that can deadlock.
+		static void start();
+		static void start(const char *setting);   // Enables counting, with a setting other than SWIFTSHADER_METRICS
+		static void stop();
+
+		static std::string text();
+
+	private:
+		static void increment(Counter counter, int64_t value);
+
+		static bool active;
+	};
+}
+
+#endif   // sw_Metrics_hpp
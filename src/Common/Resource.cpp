@@ -15,6 +15,9 @@
 #include "Resource.hpp"
 
 #include "Memory.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "Timer.hpp"
 
 namespace sw
 {
@@ -43,7 +46,14 @@ namespace sw
 			blocked++;
 			criticalSection.unlock();
 
-			unblock.wait();
+			{
+				TraceSpan span("Resource wait", "sync");
+				int64_t start = Metrics::enabled() ? Timer::counter() : 0;
+
+				unblock.wait();
+
+				Metrics::addTime(Metrics::LOCK_WAIT_TIME, start);
+			}
 
 			criticalSection.lock();
 			blocked--;
@@ -89,7 +99,14 @@ namespace sw
 			blocked++;
 			criticalSection.unlock();
 
-			unblock.wait();
+			{
+				TraceSpan span("Resource wait", "sync");
+				int64_t start = Metrics::enabled() ? Timer::counter() : 0;
+
+				unblock.wait();
+
+				Metrics::addTime(Metrics::LOCK_WAIT_TIME, start);
+			}
 
 			criticalSection.lock();
 			blocked--;
@@ -24,17 +24,31 @@
 
 namespace sw
 {
+	namespace
+	{
+		#if defined(_WIN32)
+			const SOCKET invalidSocket = INVALID_SOCKET;
+		#else
+			const SOCKET invalidSocket = -1;
+		#endif
+
+		void closeSocket(SOCKET socket)
+		{
+			#if defined(_WIN32)
+				closesocket(socket);
+			#else
+				close(socket);
+			#endif
+		}
+	}
+
 	Socket::Socket(SOCKET socket) : socket(socket)
 	{
 	}
 
 	Socket::Socket(const char *address, const char *port)
 	{
-		#if defined(_WIN32)
-			socket = INVALID_SOCKET;
-		#else
-			socket = -1;
-		#endif
+		socket = invalidSocket;
 
 		addrinfo hints = {};
 		hints.ai_family = AF_INET;
@@ -43,31 +57,84 @@ namespace sw
 		hints.ai_flags = AI_PASSIVE;
 
 		addrinfo *info = 0;
-		getaddrinfo(address, port, &hints, &info);
 
-		if(info)
+		if(getaddrinfo(address, port, &hints, &info) != 0 || !info)
+		{
+			return;
+		}
+
+		socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+
+		if(socket != invalidSocket)
+		{
+			#if !defined(_WIN32)
+				// Rebind while connections of a previous listener are in TIME_WAIT
+				int reuse = 1;
+				setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+			#endif
+
+			if(bind(socket, info->ai_addr, (int)info->ai_addrlen) != 0)
+			{
+				closeSocket(socket);
+				socket = invalidSocket;
+			}
+		}
+
+		freeaddrinfo(info);
+	}
+
+	Socket *Socket::connect(const char *address, const char *port)
+	{
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		addrinfo *info = 0;
+
+		if(getaddrinfo(address, port, &hints, &info) != 0 || !info)
 		{
-			socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
-			bind(socket, info->ai_addr, (int)info->ai_addrlen);
+			return new Socket(invalidSocket);
 		}
+
+		SOCKET socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+
+		if(socket != invalidSocket && ::connect(socket, info->ai_addr, (int)info->ai_addrlen) != 0)
+		{
+			closeSocket(socket);
+			socket = invalidSocket;
+		}
+
+		freeaddrinfo(info);
+
+		return new Socket(socket);
 	}
 
 	Socket::~Socket()
 	{
-		#if defined(_WIN32)
-			closesocket(socket);
-		#else
-			close(socket);
-		#endif
+		if(socket != invalidSocket)
+		{
+			closeSocket(socket);
+		}
 	}
 
-	void Socket::listen(int backlog)
+	bool Socket::isValid() const
 	{
-		::listen(socket, backlog);
+		return socket != invalidSocket;
+	}
+
+	bool Socket::listen(int backlog)
+	{
+		return socket != invalidSocket && ::listen(socket, backlog) == 0;
 	}
 
 	bool Socket::select(int us)
 	{
+		if(socket == invalidSocket)
+		{
+			return false;
+		}
+
 		fd_set sockets;
 		FD_ZERO(&sockets);
 		FD_SET(socket, &sockets);
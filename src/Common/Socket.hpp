@@ -28,10 +28,13 @@ namespace sw
 	{
 	public:
 		Socket(SOCKET socket);
-		Socket(const char *address, const char *port);
+		Socket(const char *address, const char *port);   // Bound to the address when isValid()
 		~Socket();
 
-		void listen(int backlog = 1);
+		static Socket *connect(const char *address, const char *port);   // Connected when isValid()
+
+		bool isValid() const;
+		bool listen(int backlog = 1);
 		bool select(int us);
 		Socket *accept();
 		
@@ -0,0 +1,280 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ThreadPool.hpp"
+
+#include "Thread.hpp"
+#include "MutexLock.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "Timer.hpp"
+#include "Debug.hpp"
+
+#include <list>
+
+namespace sw
+{
+	struct Job
+	{
+		void (*function)(void *parameters);
+		void *parameters;
+	};
+
+	class ThreadPool::Client
+	{
+	public:
+		int priority;
+		int running;     // Jobs taken by a thread which have not returned yet
+		bool closing;    // Set when destroyClient waits for the jobs to complete
+		Event drained;   // Signaled when the last job of a closing client returns
+		std::list<Job> jobs;
+	};
+
+	namespace
+	{
+		BackoffLock queueMutex;                 // Guards the clients' jobs and the idle threads
+		BackoffLock poolMutex;                  // Guards creating and terminating the threads
+		std::list<ThreadPool::Client*> ready;   // Clients with waiting jobs, in order of service
+		volatile int waitingJobs = 0;
+		int clientCount = 0;
+
+		int poolSize = 0;
+		Thread *worker[ThreadPool::MAX_THREADS];
+		Event *wakeup[ThreadPool::MAX_THREADS];
+		Event *idle[ThreadPool::MAX_THREADS];   // Wakeup events of the threads waiting for a job
+		int idleCount = 0;
+		volatile bool exitThreads = false;
+
+		// Takes the first client with the highest priority, and moves it to the back of the line
+		ThreadPool::Client *nextClient()
+		{
+			std::list<ThreadPool::Client*>::iterator next = ready.begin();
+
+			for(std::list<ThreadPool::Client*>::iterator i = ready.begin(); i != ready.end(); i++)
+			{
+				if((*i)->priority > (*next)->priority)
+				{
+					next = i;
+				}
+			}
+
+			ThreadPool::Client *client = *next;
+			ready.erase(next);
+
+			if(client->jobs.size() > 1)
+			{
+				ready.push_back(client);
+			}
+
+			return client;
+		}
+
+		void threadFunction(void *parameters)
+		{
+			int index = (int)(intptr_t)parameters;
+			Event *event = wakeup[index];
+			ThreadPool::Client *finished = nullptr;   // Client of the job which just returned
+
+			Trace::setThreadName("Worker");
+
+			while(true)
+			{
+				queueMutex.lock();
+
+				if(finished)
+				{
+					finished->running--;
+
+					if(finished->closing && finished->running == 0 && finished->jobs.empty())
+					{
+						finished->drained.signal();
+					}
+
+					finished = nullptr;
+				}
+
+				if(exitThreads)
+				{
+					queueMutex.unlock();
+					return;
+				}
+
+				if(ready.empty())
+				{
+					idle[idleCount++] = event;
+					queueMutex.unlock();
+
+					event->wait();
+					continue;
+				}
+
+				ThreadPool::Client *client = nextClient();
+				Job job = client->jobs.front();
+				client->jobs.pop_front();
+				client->running++;
+				waitingJobs--;
+
+				queueMutex.unlock();
+
+				int64_t start = Metrics::enabled() ? Timer::counter() : 0;
+
+				job.function(job.parameters);
+
+				Metrics::addThreadTime(index, start);
+
+				finished = client;
+			}
+		}
+
+		void terminateThreads()
+		{
+			queueMutex.lock();
+			exitThreads = true;
+			queueMutex.unlock();
+
+			for(int i = 0; i < poolSize; i++)
+			{
+				wakeup[i]->signal();
+			}
+
+			for(int i = 0; i < poolSize; i++)
+			{
+				worker[i]->join();
+
+				delete worker[i];
+				worker[i] = nullptr;
+				delete wakeup[i];
+				wakeup[i] = nullptr;
+			}
+
+			poolSize = 0;
+			idleCount = 0;
+			exitThreads = false;
+		}
+	}
+
+	ThreadPool::Client *ThreadPool::createClient(int priority)
+	{
+		Client *client = new Client();
+		client->priority = priority;
+		client->running = 0;
+		client->closing = false;
+
+		poolMutex.lock();
+		clientCount++;
+		poolMutex.unlock();
+
+		return client;
+	}
+
+	void ThreadPool::destroyClient(Client *client)
+	{
+		queueMutex.lock();
+		bool busy = !client->jobs.empty() || client->running != 0;
+		client->closing = true;
+		queueMutex.unlock();
+
+		if(busy)
+		{
+			client->drained.wait();
+
+			// The worker signals while holding the lock, so it is done with the client once we get it
+			queueMutex.lock();
+			queueMutex.unlock();
+		}
+
+		delete client;
+
+		poolMutex.lock();
+
+		if(--clientCount == 0)
+		{
+			terminateThreads();
+		}
+
+		poolMutex.unlock();
+	}
+
+	void ThreadPool::setPriority(Client *client, int priority)
+	{
+		queueMutex.lock();
+		client->priority = priority;
+		queueMutex.unlock();
+	}
+
+	void ThreadPool::reserve(int threadCount)
+	{
+		poolMutex.lock();
+
+		while(poolSize < threadCount && poolSize < MAX_THREADS)
+		{
+			wakeup[poolSize] = new Event();
+			worker[poolSize] = new Thread(threadFunction, (void*)(intptr_t)poolSize);
+			poolSize++;
+		}
+
+		poolMutex.unlock();
+	}
+
+	void ThreadPool::submit(Client *client, void (*function)(void *parameters), void *parameters)
+	{
+		ASSERT(poolSize > 0);
+
+		Job job = {function, parameters};
+
+		queueMutex.lock();
+
+		if(client->jobs.empty())
+		{
+			ready.push_back(client);
+		}
+
+		client->jobs.push_back(job);
+		waitingJobs++;
+
+		Event *event = idleCount > 0 ? idle[--idleCount] : nullptr;
+
+		queueMutex.unlock();
+
+		if(event)
+		{
+			event->signal();
+		}
+	}
+
+	bool ThreadPool::contended(const Client *client)
+	{
+		if(waitingJobs == 0)
+		{
+			return false;
+		}
+
+		queueMutex.lock();
+
+		bool contended = false;
+
+		for(const Client *other : ready)
+		{
+			if(other != client && other->priority >= client->priority)
+			{
+				contended = true;
+				break;
+			}
+		}
+
+		queueMutex.unlock();
+
+		return contended;
+	}
+}
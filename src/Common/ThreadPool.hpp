@@ -0,0 +1,46 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_ThreadPool_hpp
+#define sw_ThreadPool_hpp
+
+namespace sw
+{
+	// Worker threads shared by all renderers in the process. Each renderer is a
+	// client with its own job queue. Clients are served highest priority first,
+	// and round-robin among equal priorities, so the thread count does not grow
+	// with the number of contexts. The threads exit with the last client.
+	class ThreadPool
+	{
+	public:
+		class Client;
+
+		enum {MAX_THREADS = 16};
+
+		static Client *createClient(int priority = 0);
+		static void destroyClient(Client *client);   // Waits for its jobs to complete
+
+		static void setPriority(Client *client, int priority);
+
+		// Grows the pool to at least the given number of threads
+		static void reserve(int threadCount);
+
+		static void submit(Client *client, void (*function)(void *parameters), void *parameters);
+
+		// Returns true when another client of equal or higher priority has jobs waiting
+		static bool contended(const Client *client);
+	};
+}
+
+#endif   // sw_ThreadPool_hpp
@@ -0,0 +1,192 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Trace.hpp"
+
+#include "Thread.hpp"
+#include "MutexLock.hpp"
+#include "Timer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <process.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace sw
+{
+	namespace
+	{
+		struct TraceEvent
+		{
+			const char *name;
+			const char *category;
+			int64_t start;
+			int64_t end;
+		};
+
+		// Each thread only appends to its own events, so the lock is uncontended except while writing
+		struct ThreadEvents
+		{
+			int id;
+			const char *name;
+			BackoffLock mutex;
+			std::vector<TraceEvent> events;
+			int dropped;
+		};
+
+		enum {MAX_EVENTS = 1 << 20};   // Per thread, 32 MiB
+
+		const char *path = getenv("SWIFTSHADER_TRACE");
+		const int64_t origin = Timer::counter();
+		const Thread::LocalStorageKey threadKey = Thread::allocateLocalStorageKey();
+
+		BackoffLock threadsMutex;
+		std::vector<ThreadEvents*> threads;
+
+		ThreadEvents *currentThread()
+		{
+			ThreadEvents *thread = static_cast<ThreadEvents*>(Thread::getLocalStorage(threadKey));
+
+			if(!thread)
+			{
+				thread = new ThreadEvents();
+				thread->name = nullptr;
+				thread->dropped = 0;
+
+				threadsMutex.lock();
+				thread->id = (int)threads.size() + 1;
+				threads.push_back(thread);
+				threadsMutex.unlock();
+
+				Thread::setLocalStorage(threadKey, thread);
+			}
+
+			return thread;
+		}
+
+		double microseconds(int64_t counter)
+		{
+			return (double)(counter - origin) * 1.0e6 / (double)Timer::frequency();
+		}
+
+		// Writes the trace when the library is unloaded
+		struct Writer
+		{
+			~Writer()
+			{
+				Trace::write();
+			}
+		};
+
+		Writer writer;
+	}
+
+	bool Trace::active = path && *path;
+
+	int64_t Trace::timestamp()
+	{
+		return Timer::counter();
+	}
+
+	void Trace::record(const char *name, const char *category, int64_t start)
+	{
+		TraceEvent event = {name, category, start, Timer::counter()};
+		ThreadEvents *thread = currentThread();
+
+		thread->mutex.lock();
+
+		if(thread->events.size() < MAX_EVENTS)
+		{
+			thread->events.push_back(event);
+		}
+		else
+		{
+			thread->dropped++;
+		}
+
+		thread->mutex.unlock();
+	}
+
+	void Trace::setThreadName(const char *name)
+	{
+		if(active)
+		{
+			currentThread()->name = name;
+		}
+	}
+
+	void Trace::write()
+	{
+		if(!active)
+		{
+			return;
+		}
+
+		FILE *file = fopen(path, "w");
+
+		if(!file)
+		{
+			return;
+		}
+
+		#if defined(_WIN32)
+			int pid = _getpid();
+		#else
+			int pid = getpid();
+		#endif
+
+		int dropped = 0;
+		const char *separator = "";
+
+		fprintf(file, "{\"traceEvents\":[\n");
+
+		threadsMutex.lock();
+
+		for(ThreadEvents *thread : threads)
+		{
+			// Skip threads which were terminated while recording
+			if(!thread->mutex.attemptLock())
+			{
+				continue;
+			}
+
+			if(thread->name)
+			{
+				fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", separator, pid, thread->id, thread->name);
+				separator = ",\n";
+			}
+
+			for(const TraceEvent &event : thread->events)
+			{
+				fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+				        separator, event.name, event.category, microseconds(event.start), microseconds(event.end) - microseconds(event.start), pid, thread->id);
+				separator = ",\n";
+			}
+
+			dropped += thread->dropped;
+
+			thread->mutex.unlock();
+		}
+
+		threadsMutex.unlock();
+
+		fprintf(file, "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":%d}}\n", dropped);
+		fclose(file);
+	}
+}
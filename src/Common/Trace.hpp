@@ -0,0 +1,69 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_Trace_hpp
+#define sw_Trace_hpp
+
+#include "Types.hpp"
+
+namespace sw
+{
+	// Records spans of time on each thread, in the trace event JSON format read by Perfetto and
+	// chrome://tracing. Tracing is enabled by setting SWIFTSHADER_TRACE to the path of the file,
+	// which is written when the process exits. When disabled, a span only tests a flag.
+	class Trace
+	{
+	public:
+		static bool enabled()
+		{
+			return active;
+		}
+
+		static int64_t timestamp();
+
+		// Names and categories must be string literals, since only their addresses are recorded
+		static void record(const char *name, const char *category, int64_t start);
+		static void setThreadName(const char *name);
+
+		static void write();   // Writes all events recorded so far
+
+	private:
+		static bool active;
+	};
+
+	// Records a span from construction to destruction
+	class TraceSpan
+	{
+	public:
+		TraceSpan(const char *name, const char *category) : name(name), category(category)
+		{
+			start = Trace::enabled() ? Trace::timestamp() : 0;
+		}
+
+		~TraceSpan()
+		{
+			if(Trace::enabled())
+			{
+				Trace::record(name, category, start);
+			}
+		}
+
+	private:
+		const char *const name;
+		const char *const category;
+		int64_t start;
+	};
+}
+
+#endif   // sw_Trace_hpp
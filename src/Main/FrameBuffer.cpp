@@ -17,7 +17,9 @@
 #include "Timer.hpp"
 #include "Renderer/Surface.hpp"
 #include "Reactor/Reactor.hpp"
+#include "Common/Metrics.hpp"
 #include "Common/Debug.hpp"
+#include "Common/Trace.hpp"
 
 #include <stdio.h>
 #include <string.h>
@@ -137,6 +139,8 @@ namespace sw
 			return;
 		}
 
+		TraceSpan span("Present", "present");
+
 		if(!lock())
 		{
 			return;
@@ -169,6 +173,7 @@ namespace sw
 		unlock();
 
 		profiler.nextFrame();   // Assumes every copy() is a full frame
+		Metrics::add(Metrics::FRAMES);
 	}
 
 	void FrameBuffer::copyLocked()
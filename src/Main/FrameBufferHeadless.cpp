@@ -0,0 +1,66 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FrameBufferHeadless.hpp"
+
+namespace sw
+{
+	FrameBufferHeadless::FrameBufferHeadless(EGLHeadlessWindowSWIFTSHADER *window, int width, int height) : FrameBuffer(width, height, false, false), window(window)
+	{
+	}
+
+	FrameBufferHeadless::~FrameBufferHeadless()
+	{
+	}
+
+	void *FrameBufferHeadless::lock()
+	{
+		// The window may have shrunk its memory since the surface was last resized
+		if(!window->pixels || window->stride < width * 4)
+		{
+			return nullptr;
+		}
+
+		stride = window->stride;
+		locked = window->pixels;
+
+		return locked;
+	}
+
+	void FrameBufferHeadless::unlock()
+	{
+		locked = nullptr;
+	}
+
+	void FrameBufferHeadless::blit(void *source, const Rect *sourceRect, const Rect *destRect, Format sourceFormat, size_t sourceStride)
+	{
+		copy(source, sourceFormat, sourceStride);
+
+		if(window->present)
+		{
+			const void *pixels = lock();
+
+			if(pixels)
+			{
+				window->present(window->userData, pixels, width, height, stride);
+				unlock();
+			}
+		}
+	}
+}
+
+sw::FrameBuffer *createFrameBufferHeadless(void *window, int width, int height)
+{
+	return new sw::FrameBufferHeadless(static_cast<EGLHeadlessWindowSWIFTSHADER*>(window), width, height);
+}
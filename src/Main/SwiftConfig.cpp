@@ -16,6 +16,7 @@
 
 #include "Configurator.hpp"
 #include "Debug.hpp"
+#include "Metrics.hpp"
 #include "Config.hpp"
 #include "Version.h"
 
@@ -178,6 +179,10 @@ namespace sw
 					return send(clientSocket, OK, page());
 				}
 			}
+			else if(match(&request, "metrics "))
+			{
+				return send(clientSocket, OK, Metrics::text(), "text/plain; version=0.0.4");
+			}
 		}
 		else if(match(&request, "POST /"))
 		{
@@ -510,7 +515,7 @@ namespace sw
 		return html;
 	}
 
-	void SwiftConfig::send(Socket *clientSocket, Status code, std::string body)
+	void SwiftConfig::send(Socket *clientSocket, Status code, std::string body, const char *contentType)
 	{
 		std::string status;
 		char header[1024];
@@ -521,10 +526,10 @@ namespace sw
 		case NotFound: status += "HTTP/1.1 404 Not Found\r\n"; break;
 		}
 
-		sprintf(header, "Content-Type: text/html; charset=UTF-8\r\n"
+		sprintf(header, "Content-Type: %s\r\n"
 						"Content-Length: %zd\r\n"
 						"Host: localhost\r\n"
-						"\r\n", body.size());
+						"\r\n", contentType, body.size());
 
 		std::string message = status + header + body;
 		clientSocket->send(message.c_str(), (int)message.length());
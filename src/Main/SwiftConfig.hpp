@@ -91,7 +91,7 @@ namespace sw
 		void respond(Socket *clientSocket, const char *request);
 		std::string page();
 		std::string profile();
-		void send(Socket *clientSocket, Status code, std::string body = "");
+		void send(Socket *clientSocket, Status code, std::string body = "", const char *contentType = "text/html; charset=UTF-8");
 		void parsePost(const char *post);
 
 		void readConfiguration(bool disableServerOverride = false);
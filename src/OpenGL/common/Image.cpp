@@ -17,8 +17,9 @@
 #include "Renderer/Blitter.hpp"
 #include "../libEGL/Texture.hpp"
 #include "../common/debug.h"
+#include "Common/CPUID.hpp"
 #include "Common/Math.hpp"
-#include "Common/Thread.hpp"
+#include "Common/ThreadPool.hpp"
 
 #include <GLES3/gl3.h>
 
@@ -400,21 +401,154 @@ namespace
 		}
 	}
 
+	// Bytes per pixel of the DataTypes which are a plain copy, or 0
+	int CopyBytes(DataType dataType)
+	{
+		switch(dataType)
+		{
+		case Bytes_1:  return 1;
+		case Bytes_2:  return 2;
+		case Bytes_4:  return 4;
+		case Bytes_8:  return 8;
+		case Bytes_16: return 16;
+		case RGB565:   return 2;
+		default:       return 0;
+		}
+	}
+
+	typedef void (*LoadRowFunction)(const unsigned char *source, unsigned char *dest, GLint xoffset, GLsizei width);
+
+	struct LoadRows
+	{
+		LoadRowFunction loadRow;
+		LoadRowFunction loadStencilRow;   // Optional, for depth-stencil formats
+
+		GLint xoffset;
+		GLint yoffset;
+		GLint zoffset;
+		GLsizei width;
+		GLsizei height;
+		int inputPitch;
+		int inputHeight;
+		int destPitch;
+		GLsizei destHeight;
+		int stencilPitch;
+		const void *input;
+		void *buffer;
+		void *stencil;
+
+		int first;   // Range of rows, counted across all slices
+		int last;
+	};
+
+	void LoadImageRows(const LoadRows &rows)
+	{
+		const unsigned char *input = static_cast<const unsigned char*>(rows.input);
+		unsigned char *buffer = static_cast<unsigned char*>(rows.buffer);
+		unsigned char *stencil = static_cast<unsigned char*>(rows.stencil);
+
+		for(int row = rows.first; row < rows.last; row++)
+		{
+			int z = row / rows.height;
+			int y = row % rows.height;
+
+			const unsigned char *source = input + z * rows.inputPitch * rows.inputHeight + y * rows.inputPitch;
+			int destRow = (rows.zoffset + z) * rows.destHeight + rows.yoffset + y;
+
+			rows.loadRow(source, buffer + destRow * rows.destPitch, rows.xoffset, rows.width);
+
+			if(stencil)
+			{
+				rows.loadStencilRow(source, stencil + destRow * rows.stencilPitch, rows.xoffset, rows.width);
+			}
+		}
+	}
+
+	void LoadImageRowsThread(void *parameters)
+	{
+		LoadImageRows(*static_cast<const LoadRows*>(parameters));
+	}
+
+	enum
+	{
+		MAX_LOAD_BANDS = sw::ThreadPool::MAX_THREADS,
+		PARALLEL_LOAD_PIXELS = 256 * 256,   // Smaller uploads don't amortize handing out jobs
+		MIN_LOAD_ROWS = 16,                 // Per band
+	};
+
+	// Large uploads are split into bands of rows which are converted concurrently,
+	// by the calling thread and the renderers' worker threads
+	void LoadImageRows(LoadRows &rows, int pixelCount)
+	{
+		int rowCount = rows.last - rows.first;
+		int bandCount = 1;
+
+		if(pixelCount >= PARALLEL_LOAD_PIXELS)
+		{
+			bandCount = sw::min(sw::min(sw::CPUID::processAffinity(), (int)MAX_LOAD_BANDS), rowCount / MIN_LOAD_ROWS);
+		}
+
+		if(bandCount <= 1)
+		{
+			LoadImageRows(rows);
+			return;
+		}
+
+		sw::sRGB8toLinear8(0);   // Initialize the lookup table before sharing it
+
+		LoadRows band[MAX_LOAD_BANDS];
+
+		for(int i = 0; i < bandCount; i++)
+		{
+			band[i] = rows;
+			band[i].first = rows.first + rowCount * i / bandCount;
+			band[i].last = rows.first + rowCount * (i + 1) / bandCount;
+		}
+
+		sw::ThreadPool::Client *client = sw::ThreadPool::createClient();
+		sw::ThreadPool::reserve(bandCount - 1);
+
+		for(int i = 1; i < bandCount; i++)
+		{
+			sw::ThreadPool::submit(client, LoadImageRowsThread, &band[i]);
+		}
+
+		LoadImageRows(band[0]);
+
+		sw::ThreadPool::destroyClient(client);   // Waits for the other bands
+	}
+
 	template<DataType dataType>
 	void LoadImageData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, int destPitch, GLsizei destHeight, const void *input, void *buffer)
 	{
-		for(int z = 0; z < depth; ++z)
+		int copyBytes = CopyBytes(dataType);
+
+		// Identical row layouts are copied a slice at a time
+		if(copyBytes && xoffset == 0 && width * copyBytes == destPitch && inputPitch == destPitch)
 		{
-			const unsigned char *inputStart = static_cast<const unsigned char*>(input) + (z * inputPitch * inputHeight);
-			unsigned char *destStart = static_cast<unsigned char*>(buffer) + ((zoffset + z) * destPitch * destHeight);
-			for(int y = 0; y < height; ++y)
+			for(int z = 0; z < depth; ++z)
 			{
-				const unsigned char *source = inputStart + y * inputPitch;
-				unsigned char *dest = destStart + (y + yoffset) * destPitch;
+				const unsigned char *inputStart = static_cast<const unsigned char*>(input) + (z * inputPitch * inputHeight);
+				unsigned char *destStart = static_cast<unsigned char*>(buffer) + ((zoffset + z) * destHeight + yoffset) * destPitch;
 
-				LoadImageRow<dataType>(source, dest, xoffset, width);
+				memcpy(destStart, inputStart, height * destPitch);
 			}
+
+			return;
 		}
+
+		LoadRows rows = {LoadImageRow<dataType>, nullptr, xoffset, yoffset, zoffset, width, height, inputPitch, inputHeight, destPitch, destHeight, 0, input, buffer, nullptr, 0, depth * height};
+
+		LoadImageRows(rows, width * height * depth);
+	}
+
+	// Converts the depth and stencil components in a single pass over the input
+	template<DataType depthType, DataType stencilType>
+	void LoadDepthStencilData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, int destPitch, GLsizei destHeight, int stencilPitch, const void *input, void *buffer, void *stencil)
+	{
+		LoadRows rows = {LoadImageRow<depthType>, LoadImageRow<stencilType>, xoffset, yoffset, zoffset, width, height, inputPitch, inputHeight, destPitch, destHeight, stencilPitch, input, buffer, stencil, 0, depth * height};
+
+		LoadImageRows(rows, width * height * depth);
 	}
 }
 
@@ -1234,7 +1368,7 @@ namespace egl
 
 		if(selectedInternalFormat == internalFormat)
 		{
-			void *buffer = lock(0, 0, sw::LOCK_WRITEONLY);
+			void *buffer = lock(0, 0, sw::LOCK_WRITEONLY, sw::Region(xoffset, yoffset, zoffset, xoffset + width, yoffset + height, zoffset + depth));
 
 			if(buffer)
 			{
@@ -1625,28 +1759,24 @@ namespace egl
 
 	void Image::loadD24S8ImageData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, const void *input, void *buffer)
 	{
-		LoadImageData<D24>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getPitch(), getHeight(), input, buffer);
-
 		unsigned char *stencil = reinterpret_cast<unsigned char*>(lockStencil(0, 0, 0, sw::PUBLIC));
 
+		LoadDepthStencilData<D24, S8>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getPitch(), getHeight(), getStencilPitchB(), input, buffer, stencil);
+
 		if(stencil)
 		{
-			LoadImageData<S8>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getStencilPitchB(), getHeight(), input, stencil);
-
 			unlockStencil();
 		}
 	}
 
 	void Image::loadD32FS8ImageData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, const void *input, void *buffer)
 	{
-		LoadImageData<D32F>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getPitch(), getHeight(), input, buffer);
-
 		unsigned char *stencil = reinterpret_cast<unsigned char*>(lockStencil(0, 0, 0, sw::PUBLIC));
 
+		LoadDepthStencilData<D32F, S24_8>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getPitch(), getHeight(), getStencilPitchB(), input, buffer, stencil);
+
 		if(stencil)
 		{
-			LoadImageData<S24_8>(xoffset, yoffset, zoffset, width, height, depth, inputPitch, inputHeight, getStencilPitchB(), getHeight(), input, stencil);
-
 			unlockStencil();
 		}
 	}
@@ -138,6 +138,12 @@ public:
 		return lockExternal(left, top, 0, lock, sw::PUBLIC);
 	}
 
+	// Only the given region gets marked as modified
+	virtual void *lock(unsigned int left, unsigned int top, sw::Lock lock, const sw::Region &writeRegion)
+	{
+		return lockExternal(left, top, 0, lock, sw::PUBLIC, writeRegion);
+	}
+
 	unsigned int getPitch() const
 	{
 		return getExternalPitchB();
@@ -289,6 +295,12 @@ private:
 		return data;
 	}
 
+	virtual void *lockTiled(sw::Accessor client)
+	{
+		// The native buffer gets written without going through the surface
+		return nullptr;
+	}
+
 	virtual void unlockInternal()
 	{
 		if(nativeBuffer)   // Unlock the buffer from ANativeWindowBuffer
@@ -309,6 +321,14 @@ private:
 		return lockNativeBuffer(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN);
 	}
 
+	virtual void *lock(unsigned int left, unsigned int top, sw::Lock lock, const sw::Region &writeRegion)
+	{
+		LOGLOCK("image=%p op=%s lock=%d", this, __FUNCTION__, lock);
+		(void)sw::Surface::lockExternal(left, top, 0, lock, sw::PUBLIC, writeRegion);
+
+		return lockNativeBuffer(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN);
+	}
+
 	virtual void unlock()
 	{
 		LOGLOCK("image=%p op=%s.ani", this, __FUNCTION__);
@@ -21,6 +21,10 @@
 #include "ParseHelper.h"
 #include "ValidateLimitations.h"
 
+#include <string.h>
+#include <mutex>
+#include <vector>
+
 namespace
 {
 class TScopedPoolAllocator {
@@ -41,6 +45,96 @@ private:
 	TPoolAllocator* mAllocator;
 	bool mPushPopAllocator;
 };
+
+// Built-in symbols of one shader type and set of resources. They are only
+// read while compiling, so compilers on different threads share them.
+struct TBuiltInSymbols
+{
+	GLenum shaderType;
+	ShBuiltInResources resources;
+	TPoolAllocator allocator;
+	TSymbolTable symbolTable;
+};
+
+std::vector<TBuiltInSymbols*> builtInSymbols;
+std::mutex builtInSymbolsMutex;
+
+void InitBuiltInSymbolTable(GLenum shaderType, const ShBuiltInResources &resources, TSymbolTable &symbolTable)
+{
+	assert(symbolTable.isEmpty());
+	symbolTable.push();   // COMMON_BUILTINS
+	symbolTable.push();   // ESSL1_BUILTINS
+	symbolTable.push();   // ESSL3_BUILTINS
+
+	TPublicType integer;
+	integer.type = EbtInt;
+	integer.primarySize = 1;
+	integer.secondarySize = 1;
+	integer.array = false;
+
+	TPublicType floatingPoint;
+	floatingPoint.type = EbtFloat;
+	floatingPoint.primarySize = 1;
+	floatingPoint.secondarySize = 1;
+	floatingPoint.array = false;
+
+	switch(shaderType)
+	{
+	case GL_FRAGMENT_SHADER:
+		symbolTable.setDefaultPrecision(integer, EbpMedium);
+		break;
+	case GL_VERTEX_SHADER:
+		symbolTable.setDefaultPrecision(integer, EbpHigh);
+		symbolTable.setDefaultPrecision(floatingPoint, EbpHigh);
+		break;
+	default: assert(false && "Language not supported");
+	}
+
+	InsertBuiltInFunctions(shaderType, resources, symbolTable);
+
+	IdentifyBuiltIns(shaderType, resources, symbolTable);
+}
+
+const TSymbolTable *GetBuiltInSymbolTable(GLenum shaderType, const ShBuiltInResources &resources)
+{
+	std::lock_guard<std::mutex> lock(builtInSymbolsMutex);
+
+	for(TBuiltInSymbols *builtIns : builtInSymbols)
+	{
+		// The resources are all integers, so they compare bitwise
+		if(builtIns->shaderType == shaderType && memcmp(&builtIns->resources, &resources, sizeof(ShBuiltInResources)) == 0)
+		{
+			return &builtIns->symbolTable;
+		}
+	}
+
+	TBuiltInSymbols *builtIns = new TBuiltInSymbols();
+	builtIns->shaderType = shaderType;
+	builtIns->resources = resources;
+	builtIns->allocator.push();
+
+	{
+		TScopedPoolAllocator scopedAlloc(&builtIns->allocator, false);
+		InitBuiltInSymbolTable(shaderType, resources, builtIns->symbolTable);
+	}
+
+	builtInSymbols.push_back(builtIns);
+
+	return &builtIns->symbolTable;
+}
+
+void FreeBuiltInSymbolTables()
+{
+	std::lock_guard<std::mutex> lock(builtInSymbolsMutex);
+
+	for(TBuiltInSymbols *builtIns : builtInSymbols)
+	{
+		builtIns->allocator.popAll();
+		delete builtIns;
+	}
+
+	builtInSymbols.clear();
+}
 }  // namespace
 
 //
@@ -66,13 +160,15 @@ ShBuiltInResources::ShBuiltInResources()
 	OES_standard_derivatives = 0;
 	OES_fragment_precision_high = 0;
 	OES_EGL_image_external = 0;
+	EXT_draw_buffers = 0;
 
 	MaxCallStackDepth = UINT_MAX;
 }
 
 TCompiler::TCompiler(GLenum type)
 	: shaderType(type),
-	  maxCallStackDepth(UINT_MAX)
+	  maxCallStackDepth(UINT_MAX),
+	  builtInSymbolTable(nullptr)
 {
 	allocator.push();
 	SetGlobalPoolAllocator(&allocator);
@@ -88,11 +184,13 @@ bool TCompiler::Init(const ShBuiltInResources& resources)
 {
 	shaderVersion = 100;
 	maxCallStackDepth = resources.MaxCallStackDepth;
-	TScopedPoolAllocator scopedAlloc(&allocator, false);
 
-	// Generate built-in symbol table.
-	if (!InitBuiltInSymbolTable(resources))
+	// Generate built-in symbol table, or share an existing one.
+	builtInSymbolTable = GetBuiltInSymbolTable(shaderType, resources);
+	if (!builtInSymbolTable)
 		return false;
+
+	TScopedPoolAllocator scopedAlloc(&allocator, false);
 	InitExtensionBehavior(resources, extensionBehavior);
 
 	return true;
@@ -117,13 +215,20 @@ bool TCompiler::compile(const char* const shaderStrings[],
 		++firstSource;
 	}
 
+	// Extension directives only affect the shader being compiled, so that the
+	// compiler can be reused without reinitializing the built-in state.
+	TExtensionBehavior shaderExtensionBehavior(extensionBehavior);
+
+	// User-defined symbols are pushed on top of the shared built-in levels.
+	TSymbolTable symbolTable;
+	symbolTable.shareBuiltIns(*builtInSymbolTable);
+
 	TIntermediate intermediate(infoSink);
-	TParseContext parseContext(symbolTable, extensionBehavior, intermediate,
+	TParseContext parseContext(symbolTable, shaderExtensionBehavior, intermediate,
 	                           shaderType, compileOptions, true,
 	                           sourcePath, infoSink);
 	SetGlobalParseContext(&parseContext);
 
-	// We preserve symbols at the built-in level from compile-to-compile.
 	// Start pushing the user-defined symbols at global level.
 	symbolTable.push();
 	if (!symbolTable.atGlobalLevel())
@@ -161,44 +266,6 @@ bool TCompiler::compile(const char* const shaderStrings[],
 	return success;
 }
 
-bool TCompiler::InitBuiltInSymbolTable(const ShBuiltInResources &resources)
-{
-	assert(symbolTable.isEmpty());
-	symbolTable.push();   // COMMON_BUILTINS
-	symbolTable.push();   // ESSL1_BUILTINS
-	symbolTable.push();   // ESSL3_BUILTINS
-
-	TPublicType integer;
-	integer.type = EbtInt;
-	integer.primarySize = 1;
-	integer.secondarySize = 1;
-	integer.array = false;
-
-	TPublicType floatingPoint;
-	floatingPoint.type = EbtFloat;
-	floatingPoint.primarySize = 1;
-	floatingPoint.secondarySize = 1;
-	floatingPoint.array = false;
-
-	switch(shaderType)
-	{
-	case GL_FRAGMENT_SHADER:
-		symbolTable.setDefaultPrecision(integer, EbpMedium);
-		break;
-	case GL_VERTEX_SHADER:
-		symbolTable.setDefaultPrecision(integer, EbpHigh);
-		symbolTable.setDefaultPrecision(floatingPoint, EbpHigh);
-		break;
-	default: assert(false && "Language not supported");
-	}
-
-	InsertBuiltInFunctions(shaderType, resources, symbolTable);
-
-	IdentifyBuiltIns(shaderType, resources, symbolTable);
-
-	return true;
-}
-
 void TCompiler::clearResults()
 {
 	infoSink.info.erase();
@@ -264,6 +331,7 @@ bool InitCompilerGlobals()
 
 void FreeCompilerGlobals()
 {
+	FreeBuiltInSymbolTables();
 	FreeParseContextIndex();
 	FreePoolIndex();
 }
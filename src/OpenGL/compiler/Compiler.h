@@ -88,8 +88,6 @@ public:
 
 protected:
 	GLenum getShaderType() const { return shaderType; }
-	// Initialize symbol-table with built-in symbols.
-	bool InitBuiltInSymbolTable(const ShBuiltInResources& resources);
 	// Clears the results from the previous compilation.
 	void clearResults();
 	// Return true if function recursion is detected or call depth exceeded.
@@ -108,8 +106,8 @@ private:
 	unsigned int maxCallStackDepth;
 
 	// Built-in symbol table for the given language, spec, and resources.
-	// It is preserved from compile-to-compile.
-	TSymbolTable symbolTable;
+	// It is built once per process and shared by all compilers.
+	const TSymbolTable *builtInSymbolTable;
 	// Built-in extensions with default behavior.
 	TExtensionBehavior extensionBehavior;
 
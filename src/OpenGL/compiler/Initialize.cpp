@@ -426,6 +426,10 @@ void InsertBuiltInFunctions(GLenum type, const ShBuiltInResources &resources, TS
 	fields->push_back(far);
 	fields->push_back(diff);
 	TStructure *depthRangeStruct = new TStructure(NewPoolTString("gl_DepthRangeParameters"), fields);
+	// Computed now, because compilers on other threads share the built-in symbols
+	depthRangeStruct->mangledName();
+	depthRangeStruct->objectSize();
+	depthRangeStruct->deepestNesting();
 	TVariable *depthRangeParameters = new TVariable(&depthRangeStruct->name(), depthRangeStruct, true);
 	symbolTable.insert(COMMON_BUILTINS, *depthRangeParameters);
 	TVariable *depthRange = new TVariable(NewPoolTString("gl_DepthRange"), TType(depthRangeStruct));
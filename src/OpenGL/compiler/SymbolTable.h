@@ -46,6 +46,7 @@
 
 #include "InfoSink.h"
 #include "intermediate.h"
+#include <atomic>
 #include <set>
 
 //
@@ -235,7 +236,7 @@ public:
 
 protected:
 	tLevel level;
-	static int uniqueId;     // for unique identification in code generation
+	static std::atomic<int> uniqueId;     // for unique identification in code generation, across threads
 };
 
 enum ESymbolLevel
@@ -315,7 +316,7 @@ class TSymbolTable
 {
 public:
 	TSymbolTable()
-		: mGlobalInvariant(false)
+		: mBuiltIns(nullptr), mGlobalInvariant(false)
 	{
 		//
 		// The symbol table cannot be used until push() is called, but
@@ -332,6 +333,16 @@ public:
 		}
 	}
 
+	// Shares the built-in levels of a preloaded table, which must outlive this one.
+	// The built-ins are only read, so concurrent compiles can share them.
+	void shareBuiltIns(const TSymbolTable &builtIns)
+	{
+		assert(table.empty() && builtIns.table.size() == LAST_BUILTIN_LEVEL + 1);
+		table = builtIns.table;
+		precisionStack = builtIns.precisionStack;
+		mBuiltIns = &builtIns;
+	}
+
 	bool isEmpty() { return table.empty(); }
 	bool atBuiltInLevel() { return currentLevel() <= LAST_BUILTIN_LEVEL; }
 	bool atGlobalLevel() { return currentLevel() <= GLOBAL_LEVEL; }
@@ -527,7 +538,11 @@ public:
 	void setGlobalInvariant() { mGlobalInvariant = true; }
 	bool getGlobalInvariant() const { return mGlobalInvariant; }
 
-	bool hasUnmangledBuiltIn(const char *name) { return mUnmangledBuiltinNames.count(std::string(name)) > 0; }
+	bool hasUnmangledBuiltIn(const char *name) const
+	{
+		const TSymbolTable *builtIns = mBuiltIns ? mBuiltIns : this;
+		return builtIns->mUnmangledBuiltinNames.count(std::string(name)) > 0;
+	}
 
 private:
 	// Used to insert unmangled functions to check redeclaration of built-ins in ESSL 3.00.
@@ -541,6 +556,7 @@ protected:
 	std::vector< PrecisionStackLevel > precisionStack;
 
 	std::set<std::string> mUnmangledBuiltinNames;
+	const TSymbolTable *mBuiltIns;   // Owner of the shared built-in levels, if any
 
 	std::set<std::string> mInvariantVaryings;
 	bool mGlobalInvariant;
@@ -20,6 +20,11 @@ TranslatorASM::TranslatorASM(glsl::Shader *shaderObject, GLenum shaderType) : TC
 {
 }
 
+void TranslatorASM::setShaderObject(glsl::Shader *shaderObject)
+{
+	this->shaderObject = shaderObject;
+}
+
 bool TranslatorASM::translate(TIntermNode* root)
 {
     TParseContext& parseContext = *GetGlobalParseContext();
@@ -28,11 +28,14 @@ class TranslatorASM : public TCompiler
 public:
     TranslatorASM(glsl::Shader *shaderObject, GLenum type);
 
+    // Allows reusing the compiler, and its built-in symbol table, for other shader objects
+    void setShaderObject(glsl::Shader *shaderObject);
+
 protected:
     virtual bool translate(TIntermNode* root);
 
 private:
-	glsl::Shader *const shaderObject;
+	glsl::Shader *shaderObject;
 };
 
 #endif  // COMPILER_TRANSLATORASM_H_
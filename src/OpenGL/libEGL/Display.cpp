@@ -32,6 +32,7 @@
 #include <fcntl.h>
 #elif defined(__linux__)
 #include "Main/libX11.hpp"
+#include <EGL/eglext_swiftshader.h>
 #elif defined(__APPLE__)
 #include "OSXUtils.hpp"
 #endif
@@ -66,22 +67,32 @@ Display *Display::get(EGLDisplay dpy)
 		return nullptr;
 	}
 
+	#if defined(__linux__) && !defined(__ANDROID__)
+		// The headless display never loads X11
+		if(dpy == HEADLESS_DISPLAY)
+		{
+			static Display headlessDisplay(HEADLESS_DISPLAY, nullptr);
+
+			return &headlessDisplay;
+		}
+	#endif
+
 	static void *nativeDisplay = nullptr;
 
 	#if defined(__linux__) && !defined(__ANDROID__)
 		// Even if the application provides a native display handle, we open (and close) our own connection
-		if(!nativeDisplay && dpy != HEADLESS_DISPLAY && libX11 && libX11->XOpenDisplay)
+		if(!nativeDisplay && libX11 && libX11->XOpenDisplay)
 		{
 			nativeDisplay = libX11->XOpenDisplay(NULL);
 		}
 	#endif
 
-	static Display display(nativeDisplay);
+	static Display display(PRIMARY_DISPLAY, nativeDisplay);
 
 	return &display;
 }
 
-Display::Display(void *nativeDisplay) : nativeDisplay(nativeDisplay)
+Display::Display(EGLDisplay eglDisplay, void *nativeDisplay) : eglDisplay(eglDisplay), nativeDisplay(nativeDisplay)
 {
 	mMinSwapInterval = 1;
 	mMaxSwapInterval = 1;
@@ -218,6 +229,9 @@ void Display::terminate()
 	{
 		destroySharedImage(reinterpret_cast<EGLImageKHR>((intptr_t)mSharedImageNameSpace.firstName()));
 	}
+
+	Guard lk(&mHeadlessWindowSetMutex);
+	mHeadlessWindowSet.clear();
 }
 
 bool Display::getConfigs(EGLConfig *configs, const EGLint *attribList, EGLint configSize, EGLint *numConfig)
@@ -430,7 +444,7 @@ EGLSurface Display::createPBufferSurface(EGLConfig config, const EGLint *attribL
 	return success(surface);
 }
 
-EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion)
+EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion, int priority)
 {
 	const egl::Config *config = mConfigSet.get(configHandle);
 	egl::Context *context = nullptr;
@@ -460,6 +474,7 @@ EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *sh
 		return error(EGL_BAD_ALLOC, EGL_NO_CONTEXT);
 	}
 
+	context->setPriority(priority);
 	context->addRef();
 	mContextSet.insert(context);
 
@@ -549,7 +564,20 @@ bool Display::isValidWindow(EGLNativeWindowType window)
 		}
 		return true;
 	#elif defined(__linux__)
-		if(nativeDisplay)
+		if(isHeadless())
+		{
+			const EGLHeadlessWindowSWIFTSHADER *headlessWindow = reinterpret_cast<const EGLHeadlessWindowSWIFTSHADER*>(window);
+
+			// Anything else, such as an X11 window ID, is rejected before it is dereferenced
+			if(!isHeadlessWindow(headlessWindow))
+			{
+				return false;
+			}
+
+			return headlessWindow->width > 0 && headlessWindow->height > 0 &&
+			       headlessWindow->pixels && headlessWindow->stride >= headlessWindow->width * 4;
+		}
+		else if(nativeDisplay)
 		{
 			XWindowAttributes windowAttributes;
 			Status status = libX11->XGetWindowAttributes((::Display*)nativeDisplay, window, &windowAttributes);
@@ -581,6 +609,33 @@ bool Display::hasExistingWindowSurface(EGLNativeWindowType window)
 	return false;
 }
 
+bool Display::registerHeadlessWindow(const void *window)
+{
+	if(!isHeadless() || !window)
+	{
+		return false;
+	}
+
+	Guard lk(&mHeadlessWindowSetMutex);
+	mHeadlessWindowSet.insert(window);
+
+	return true;
+}
+
+bool Display::unregisterHeadlessWindow(const void *window)
+{
+	Guard lk(&mHeadlessWindowSetMutex);
+
+	return mHeadlessWindowSet.erase(window) != 0;
+}
+
+bool Display::isHeadlessWindow(const void *window) const
+{
+	Guard lk(&mHeadlessWindowSetMutex);
+
+	return mHeadlessWindowSet.find(window) != mHeadlessWindowSet.end();
+}
+
 bool Display::isValidSync(FenceSync *sync)
 {
 	Guard lk(&mSyncSetMutex);
@@ -602,6 +657,11 @@ void *Display::getNativeDisplay() const
 	return nativeDisplay;
 }
 
+bool Display::isHeadless() const
+{
+	return eglDisplay == HEADLESS_DISPLAY;
+}
+
 EGLImageKHR Display::createSharedImage(Image *image)
 {
 	return reinterpret_cast<EGLImageKHR>((intptr_t)mSharedImageNameSpace.allocate(image));
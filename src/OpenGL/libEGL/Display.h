@@ -48,7 +48,7 @@ namespace egl
 
 		EGLSurface createWindowSurface(EGLNativeWindowType window, EGLConfig config, const EGLint *attribList);
 		EGLSurface createPBufferSurface(EGLConfig config, const EGLint *attribList);
-		EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion);
+		EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion, int priority);
 		EGLSyncKHR createSync(Context *context);
 
 		void destroySurface(Surface *surface);
@@ -61,23 +61,28 @@ namespace egl
 		bool isValidSurface(Surface *surface);
 		bool isValidWindow(EGLNativeWindowType window);
 		bool hasExistingWindowSurface(EGLNativeWindowType window);
+		bool registerHeadlessWindow(const void *window);
+		bool unregisterHeadlessWindow(const void *window);
+		bool isHeadlessWindow(const void *window) const;
 		bool isValidSync(FenceSync *sync);
 
 		EGLint getMinSwapInterval() const;
 		EGLint getMaxSwapInterval() const;
 
 		void *getNativeDisplay() const;
+		bool isHeadless() const;   // Windows present to memory, see EGL/eglext_swiftshader.h
 
 		EGLImageKHR createSharedImage(Image *image);
 		bool destroySharedImage(EGLImageKHR);
 		virtual Image *getSharedImage(EGLImageKHR name);
 
 	private:
-		explicit Display(void *nativeDisplay);
+		Display(EGLDisplay eglDisplay, void *nativeDisplay);
 		~Display();
 
 		sw::Format getDisplayFormat() const;
 
+		const EGLDisplay eglDisplay;
 		void *const nativeDisplay;
 
 		EGLint mMaxSwapInterval;
@@ -95,6 +100,11 @@ namespace egl
 		sw::BackoffLock mSyncSetMutex;
 		SyncSet mSyncSet;
 
+		// Headless windows are only dereferenced once registered, so other handles can't be mistaken for them
+		typedef std::set<const void*> WindowSet;
+		mutable sw::BackoffLock mHeadlessWindowSetMutex;
+		WindowSet mHeadlessWindowSet;
+
 		gl::NameSpace<Image> mSharedImageNameSpace;
 	};
 }
@@ -28,6 +28,7 @@
 
 #if defined(__linux__) && !defined(__ANDROID__)
 #include "Main/libX11.hpp"
+#include <EGL/eglext_swiftshader.h>
 #elif defined(_WIN32)
 #include <tchar.h>
 #elif defined(__APPLE__)
@@ -278,11 +279,30 @@ bool WindowSurface::checkForResize()
 		int windowWidth;  window->query(window, NATIVE_WINDOW_WIDTH, &windowWidth);
 		int windowHeight; window->query(window, NATIVE_WINDOW_HEIGHT, &windowHeight);
 	#elif defined(__linux__)
-		XWindowAttributes windowAttributes;
-		libX11->XGetWindowAttributes((::Display*)display->getNativeDisplay(), window, &windowAttributes);
+		int windowWidth;
+		int windowHeight;
+
+		if(display->isHeadless())
+		{
+			const EGLHeadlessWindowSWIFTSHADER *headlessWindow = reinterpret_cast<const EGLHeadlessWindowSWIFTSHADER*>(window);
+
+			if(!display->isHeadlessWindow(headlessWindow))
+			{
+				ASSERT(false);   // Windows can't be unregistered while they have a surface
+				return false;
+			}
+
+			windowWidth = headlessWindow->width;
+			windowHeight = headlessWindow->height;
+		}
+		else
+		{
+			XWindowAttributes windowAttributes;
+			libX11->XGetWindowAttributes((::Display*)display->getNativeDisplay(), window, &windowAttributes);
 
-		int windowWidth = windowAttributes.width;
-		int windowHeight = windowAttributes.height;
+			windowWidth = windowAttributes.width;
+			windowHeight = windowAttributes.height;
+		}
 	#elif defined(__APPLE__)
 		int windowWidth;
 		int windowHeight;
@@ -314,6 +334,38 @@ void WindowSurface::deleteResources()
 	Surface::deleteResources();
 }
 
+sw::FrameBuffer *WindowSurface::createFrameBuffer()
+{
+	#if defined(__linux__) && !defined(__ANDROID__)
+		if(display->isHeadless())
+		{
+			void *headlessWindow = reinterpret_cast<void*>(window);
+
+			if(libGLES_CM)
+			{
+				return libGLES_CM->createFrameBufferHeadless(headlessWindow, width, height);
+			}
+			else if(libGLESv2)
+			{
+				return libGLESv2->createFrameBufferHeadless(headlessWindow, width, height);
+			}
+
+			return nullptr;
+		}
+	#endif
+
+	if(libGLES_CM)
+	{
+		return libGLES_CM->createFrameBuffer(display->getNativeDisplay(), window, width, height);
+	}
+	else if(libGLESv2)
+	{
+		return libGLESv2->createFrameBuffer(display->getNativeDisplay(), window, width, height);
+	}
+
+	return nullptr;
+}
+
 bool WindowSurface::reset(int backBufferWidth, int backBufferHeight)
 {
 	width = backBufferWidth;
@@ -323,14 +375,7 @@ bool WindowSurface::reset(int backBufferWidth, int backBufferHeight)
 
 	if(window)
 	{
-		if(libGLES_CM)
-		{
-			frameBuffer = libGLES_CM->createFrameBuffer(display->getNativeDisplay(), window, width, height);
-		}
-		else if(libGLESv2)
-		{
-			frameBuffer = libGLESv2->createFrameBuffer(display->getNativeDisplay(), window, width, height);
-		}
+		frameBuffer = createFrameBuffer();
 
 		if(!frameBuffer)
 		{
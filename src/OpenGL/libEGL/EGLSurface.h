@@ -113,6 +113,7 @@ private:
 	void deleteResources() override;
 	bool checkForResize();
 	bool reset(int backBufferWidth, int backBufferHeight);
+	sw::FrameBuffer *createFrameBuffer();
 
 	const EGLNativeWindowType window;
 	sw::FrameBuffer *frameBuffer;
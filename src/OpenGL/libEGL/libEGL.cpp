@@ -29,6 +29,9 @@
 #include "Main/libX11.hpp"
 #endif
 
+#include <EGL/eglext_swiftshader.h>
+
+#include <stdlib.h>
 #include <string.h>
 
 using namespace egl;
@@ -119,7 +122,11 @@ EGLDisplay GetDisplay(EGLNativeDisplayType display_id)
 	}
 
 	#if defined(__linux__) && !defined(__ANDROID__)
-		if(!libX11)
+		// Presenting to memory instead of to X11 windows is asked for explicitly, by setting
+		// SWIFTSHADER_HEADLESS or with EGL_PLATFORM_SURFACELESS_MESA
+		const char *headless = getenv("SWIFTSHADER_HEADLESS");
+
+		if(!libX11 || (headless && *headless && strcmp(headless, "0") != 0))
 		{
 			return success(HEADLESS_DISPLAY);
 		}
@@ -176,6 +183,7 @@ const char *QueryString(EGLDisplay dpy, EGLint name)
 		{
 			return success("EGL_KHR_platform_gbm "
 			               "EGL_KHR_platform_x11 "
+			               "EGL_MESA_platform_surfaceless "
 			               "EGL_EXT_client_extensions "
 			               "EGL_EXT_platform_base");
 		}
@@ -193,14 +201,23 @@ const char *QueryString(EGLDisplay dpy, EGLint name)
 	case EGL_CLIENT_APIS:
 		return success("OpenGL_ES");
 	case EGL_EXTENSIONS:
-		return success("EGL_KHR_create_context "
-		               "EGL_KHR_gl_texture_2D_image "
-		               "EGL_KHR_gl_texture_cubemap_image "
-		               "EGL_KHR_gl_renderbuffer_image "
-		               "EGL_KHR_fence_sync "
-		               "EGL_KHR_image_base "
-		               "EGL_ANDROID_framebuffer_target "
-		               "EGL_ANDROID_recordable");
+		#define EXTENSIONS "EGL_KHR_create_context " \
+		                   "EGL_KHR_gl_texture_2D_image " \
+		                   "EGL_KHR_gl_texture_cubemap_image " \
+		                   "EGL_KHR_gl_renderbuffer_image " \
+		                   "EGL_KHR_fence_sync " \
+		                   "EGL_KHR_image_base " \
+		                   "EGL_IMG_context_priority " \
+		                   "EGL_ANDROID_framebuffer_target " \
+		                   "EGL_ANDROID_recordable"
+
+		if(display->isHeadless())
+		{
+			return success(EXTENSIONS " EGL_SWIFTSHADER_headless_window");
+		}
+
+		return success(EXTENSIONS);
+		#undef EXTENSIONS
 	case EGL_VENDOR:
 		return success("Google Inc.");
 	case EGL_VERSION:
@@ -647,6 +664,7 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 
 	EGLint majorVersion = 1;
 	EGLint minorVersion = 0;
+	int priority = 0;   // Relative to other contexts sharing the rendering threads
 
 	if(attrib_list)
 	{
@@ -700,6 +718,16 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
 				}
 				break;
+			case EGL_CONTEXT_PRIORITY_LEVEL_IMG:
+				switch(attribute[1])
+				{
+				case EGL_CONTEXT_PRIORITY_HIGH_IMG:   priority = 1;  break;
+				case EGL_CONTEXT_PRIORITY_MEDIUM_IMG: priority = 0;  break;
+				case EGL_CONTEXT_PRIORITY_LOW_IMG:    priority = -1; break;
+				default:
+					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
+				}
+				break;
 			default:
 				return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
 			}
@@ -740,7 +768,7 @@ EGLContext CreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_cont
 		return error(EGL_BAD_CONTEXT, EGL_NO_CONTEXT);
 	}
 
-	return display->createContext(config, shareContext, majorVersion);
+	return display->createContext(config, shareContext, majorVersion, priority);
 }
 
 EGLBoolean DestroyContext(EGLDisplay dpy, EGLContext ctx)
@@ -1048,6 +1076,7 @@ EGLDisplay GetPlatformDisplayEXT(EGLenum platform, void *native_display, const E
 		{
 		case EGL_PLATFORM_X11_EXT: break;
 		case EGL_PLATFORM_GBM_KHR: break;
+		case EGL_PLATFORM_SURFACELESS_MESA: break;
 		default:
 			return error(EGL_BAD_PARAMETER, EGL_NO_DISPLAY);
 		}
@@ -1064,7 +1093,7 @@ EGLDisplay GetPlatformDisplayEXT(EGLenum platform, void *native_display, const E
 				return error(EGL_BAD_ATTRIBUTE, EGL_NO_DISPLAY);   // Unimplemented
 			}
 		}
-		else if(platform == EGL_PLATFORM_GBM_KHR)
+		else if(platform == EGL_PLATFORM_GBM_KHR || platform == EGL_PLATFORM_SURFACELESS_MESA)
 		{
 			if(native_display != (void*)EGL_DEFAULT_DISPLAY || attrib_list != NULL)
 			{
@@ -1090,6 +1119,57 @@ EGLSurface CreatePlatformPixmapSurfaceEXT(EGLDisplay dpy, EGLConfig config, void
 	return CreatePixmapSurface(dpy, config, (EGLNativePixmapType)native_pixmap, attrib_list);
 }
 
+EGLBoolean RegisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLHeadlessWindowSWIFTSHADER *window = %p)", dpy, window);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	if(!validateDisplay(display))
+	{
+		return error(EGL_BAD_DISPLAY, EGL_FALSE);
+	}
+
+	if(!display->isHeadless())
+	{
+		return error(EGL_BAD_DISPLAY, EGL_FALSE);
+	}
+
+	if(!display->registerHeadlessWindow(window))
+	{
+		return error(EGL_BAD_NATIVE_WINDOW, EGL_FALSE);
+	}
+
+	return success(EGL_TRUE);
+}
+
+EGLBoolean UnregisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLHeadlessWindowSWIFTSHADER *window = %p)", dpy, window);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	if(!validateDisplay(display))
+	{
+		return error(EGL_BAD_DISPLAY, EGL_FALSE);
+	}
+
+	if(!display->isHeadlessWindow(window))
+	{
+		return error(EGL_BAD_NATIVE_WINDOW, EGL_FALSE);
+	}
+
+	// The surface reads the window's size and memory until it is destroyed
+	if(display->hasExistingWindowSurface((EGLNativeWindowType)window))
+	{
+		return error(EGL_BAD_ACCESS, EGL_FALSE);
+	}
+
+	display->unregisterHeadlessWindow(window);
+
+	return success(EGL_TRUE);
+}
+
 EGLSyncKHR CreateSyncKHR(EGLDisplay dpy, EGLenum type, const EGLint *attrib_list)
 {
 	TRACE("(EGLDisplay dpy = %p, EGLunum type = %x, EGLint *attrib_list=%p)", dpy, type, attrib_list);
@@ -1230,6 +1310,8 @@ __eglMustCastToProperFunctionPointerType GetProcAddress(const char *procname)
 		EXTENSION(eglDestroySyncKHR),
 		EXTENSION(eglClientWaitSyncKHR),
 		EXTENSION(eglGetSyncAttribKHR),
+		EXTENSION(eglRegisterHeadlessWindowSWIFTSHADER),
+		EXTENSION(eglUnregisterHeadlessWindowSWIFTSHADER),
 
 		#undef EXTENSION
 	};
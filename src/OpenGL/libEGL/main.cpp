@@ -26,6 +26,7 @@
 #include "common/debug.h"
 
 #include <EGL/eglext.h>
+#include <EGL/eglext_swiftshader.h>
 
 static sw::Thread::LocalStorageKey currentTLS = TLS_OUT_OF_INDEXES;
 
@@ -369,6 +370,8 @@ EGLSyncKHR CreateSyncKHR(EGLDisplay dpy, EGLenum type, const EGLint *attrib_list
 EGLBoolean DestroySyncKHR(EGLDisplay dpy, EGLSyncKHR sync);
 EGLint ClientWaitSyncKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint flags, EGLTimeKHR timeout);
 EGLBoolean GetSyncAttribKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint attribute, EGLint *value);
+EGLBoolean RegisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
+EGLBoolean UnregisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window);
 __eglMustCastToProperFunctionPointerType GetProcAddress(const char *procname);
 }
 
@@ -584,6 +587,16 @@ EGLAPI EGLBoolean EGLAPIENTRY eglGetSyncAttribKHR(EGLDisplay dpy, EGLSyncKHR syn
 	return egl::GetSyncAttribKHR(dpy, sync, attribute, value);
 }
 
+EGLAPI EGLBoolean EGLAPIENTRY eglRegisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window)
+{
+	return egl::RegisterHeadlessWindowSWIFTSHADER(dpy, window);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglUnregisterHeadlessWindowSWIFTSHADER(EGLDisplay dpy, EGLHeadlessWindowSWIFTSHADER *window)
+{
+	return egl::UnregisterHeadlessWindowSWIFTSHADER(dpy, window);
+}
+
 EGLAPI __eglMustCastToProperFunctionPointerType EGLAPIENTRY eglGetProcAddress(const char *procname)
 {
 	return egl::GetProcAddress(procname);
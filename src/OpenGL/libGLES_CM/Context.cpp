@@ -326,6 +326,11 @@ int Context::getClientVersion() const
 	return 1;
 }
 
+void Context::setPriority(int priority)
+{
+	device->setPriority(priority);
+}
+
 // This function will set all of the state-related dirty flags, so that all state is set during next pre-draw.
 void Context::markAllStateDirty()
 {
@@ -298,6 +298,7 @@ public:
 
 	virtual void makeCurrent(egl::Surface *surface);
 	virtual int getClientVersion() const;
+	virtual void setPriority(int priority);
 	virtual void finish();
 
 	void markAllStateDirty();
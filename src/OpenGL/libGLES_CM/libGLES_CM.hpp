@@ -224,6 +224,9 @@ public:
 	egl::Image *(*createBackBuffer)(int width, int height, const egl::Config *config);
 	egl::Image *(*createDepthStencil)(unsigned int width, unsigned int height, sw::Format format, int multiSampleDepth, bool discard);
 	sw::FrameBuffer *(*createFrameBuffer)(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+	#if defined(__linux__) && !defined(__ANDROID__)
+	sw::FrameBuffer *(*createFrameBufferHeadless)(void *window, int width, int height);
+	#endif
 };
 
 class LibGLES_CM
@@ -335,6 +335,9 @@ extern "C" __eglMustCastToProperFunctionPointerType es1GetProcAddress(const char
 egl::Image *createBackBuffer(int width, int height, const egl::Config *config);
 egl::Image *createDepthStencil(unsigned int width, unsigned int height, sw::Format format, int multiSampleDepth, bool discard);
 sw::FrameBuffer *createFrameBuffer(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+#if defined(__linux__) && !defined(__ANDROID__)
+sw::FrameBuffer *createFrameBufferHeadless(void *window, int width, int height);
+#endif
 
 extern "C"
 {
@@ -1602,6 +1605,9 @@ LibGLES_CMexports::LibGLES_CMexports()
 	this->createBackBuffer = ::createBackBuffer;
 	this->createDepthStencil = ::createDepthStencil;
 	this->createFrameBuffer = ::createFrameBuffer;
+	#if defined(__linux__) && !defined(__ANDROID__)
+	this->createFrameBufferHeadless = ::createFrameBufferHeadless;
+	#endif
 }
 
 extern "C" GL_API LibGLES_CMexports *libGLES_CM_swiftshader()
@@ -312,6 +312,11 @@ EGLint Context::getClientVersion() const
 	return clientVersion;
 }
 
+void Context::setPriority(int priority)
+{
+	device->setPriority(priority);
+}
+
 // This function will set all of the state-related dirty flags, so that all state is set during next pre-draw.
 void Context::markAllStateDirty()
 {
@@ -3093,6 +3098,7 @@ void Context::applyTextures(sw::SamplerType samplerType)
 				device->setTextureFilter(samplerType, samplerIndex, es2sw::ConvertTextureFilter(minFilter, magFilter, maxAnisotropy));
 				device->setMipmapFilter(samplerType, samplerIndex, es2sw::ConvertMipMapFilter(minFilter));
 				device->setMaxAnisotropy(samplerType, samplerIndex, maxAnisotropy);
+				device->setSeamlessCubeMap(samplerType, samplerIndex, clientVersion >= 3);   // Always seamless in OpenGL ES 3.0
 
 				applyTexture(samplerType, samplerIndex, texture);
 			}
@@ -432,6 +432,7 @@ public:
 
 	virtual void makeCurrent(egl::Surface *surface);
 	virtual EGLint getClientVersion() const;
+	virtual void setPriority(int priority);
 
 	void markAllStateDirty();
 
@@ -20,9 +20,48 @@
 
 #include "main.h"
 #include "utilities.h"
+#include "Common/MutexLock.hpp"
 
 #include <string>
 #include <algorithm>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// Translation results of successfully compiled shaders, shared by all contexts.
+	// Shader objects share the sw::Shader too, since nothing changes it after translation.
+	struct CachedShader
+	{
+		std::shared_ptr<sw::Shader> shader;
+		int shaderVersion;
+
+		glsl::VaryingList varyings;
+		glsl::ActiveUniforms activeUniforms;
+		glsl::ActiveAttributes activeAttributes;
+		glsl::ActiveUniformBlocks activeUniformBlocks;
+	};
+
+	const size_t shaderCacheSize = 256;
+
+	// Entries are shared, so a shader can be loaded from one after it was evicted
+	std::unordered_map<std::string, std::shared_ptr<const CachedShader>> shaderCache;   // Keyed by shader type and source
+	std::deque<std::string> shaderCacheOrder;   // Oldest entry first
+	sw::BackoffLock cacheMutex;
+
+	// Compilers share the built-in symbol table, but translate one shader at a time.
+	// Worker threads take idle ones, so shaders compile concurrently.
+	std::vector<TranslatorASM*> idleCompilers[2];   // Vertex and fragment
+	int busyCompilers = 0;
+	sw::BackoffLock compilerMutex;
+
+	std::vector<TranslatorASM*> &idle(GLenum shaderType)
+	{
+		return idleCompilers[shaderType == GL_VERTEX_SHADER ? 0 : 1];
+	}
+}
 
 namespace es2
 {
@@ -31,6 +70,8 @@ bool Shader::compilerInitialized = false;
 Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mResourceManager(manager)
 {
 	mSource = nullptr;
+	clientVersion = 2;
+	compileClient = nullptr;
 
 	clear();
 
@@ -40,6 +81,8 @@ Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mReso
 
 Shader::~Shader()
 {
+	finishCompile();
+
 	delete[] mSource;
 }
 
@@ -90,6 +133,8 @@ void Shader::setSource(GLsizei count, const char *const *string, const GLint *le
 
 size_t Shader::getInfoLogLength() const
 {
+	finishCompile();
+
 	if(infoLog.empty())
 	{
 		return 0;
@@ -102,6 +147,8 @@ size_t Shader::getInfoLogLength() const
 
 void Shader::getInfoLog(GLsizei bufSize, GLsizei *length, char *infoLogOut)
 {
+	finishCompile();
+
 	int index = 0;
 
 	if(bufSize > 0)
@@ -154,15 +201,34 @@ void Shader::getSource(GLsizei bufSize, GLsizei *length, char *source)
 	}
 }
 
-TranslatorASM *Shader::createCompiler(GLenum shaderType)
+TranslatorASM *Shader::acquireCompiler(GLenum shaderType)
 {
+	TranslatorASM *compiler = nullptr;
+
+	compilerMutex.lock();
+
 	if(!compilerInitialized)
 	{
 		InitCompilerGlobals();
 		compilerInitialized = true;
 	}
 
-	TranslatorASM *assembler = new TranslatorASM(this, shaderType);
+	if(!idle(shaderType).empty())
+	{
+		compiler = idle(shaderType).back();
+		idle(shaderType).pop_back();
+	}
+
+	busyCompilers++;
+
+	compilerMutex.unlock();
+
+	if(compiler)
+	{
+		return compiler;
+	}
+
+	TranslatorASM *assembler = new TranslatorASM(nullptr, shaderType);
 
 	ShBuiltInResources resources;
 	resources.MaxVertexAttribs = MAX_VERTEX_ATTRIBS;
@@ -187,6 +253,16 @@ TranslatorASM *Shader::createCompiler(GLenum shaderType)
 	return assembler;
 }
 
+void Shader::recycleCompiler(TranslatorASM *compiler, GLenum shaderType)
+{
+	compilerMutex.lock();
+
+	idle(shaderType).push_back(compiler);
+	busyCompilers--;
+
+	compilerMutex.unlock();
+}
+
 void Shader::clear()
 {
 	infoLog.clear();
@@ -194,39 +270,147 @@ void Shader::clear()
 	varyings.clear();
 	activeUniforms.clear();
 	activeAttributes.clear();
+	activeUniformBlocks.clear();
+}
+
+std::string Shader::cacheKey() const
+{
+	return (getType() == GL_VERTEX_SHADER ? "v" : "f") + compileSource;
+}
+
+bool Shader::loadCachedShader(int &shaderVersion)
+{
+	std::shared_ptr<const CachedShader> cached;
+
+	cacheMutex.lock();
+
+	auto entry = shaderCache.find(cacheKey());
+
+	if(entry != shaderCache.end())
+	{
+		cached = entry->second;
+	}
+
+	cacheMutex.unlock();
+
+	if(!cached)
+	{
+		return false;
+	}
+
+	shareShader(cached->shader);
+	shaderVersion = cached->shaderVersion;
+
+	varyings = cached->varyings;
+	activeUniforms = cached->activeUniforms;
+	activeAttributes = cached->activeAttributes;
+	activeUniformBlocks = cached->activeUniformBlocks;
+
+	return true;
+}
+
+void Shader::storeCachedShader(int shaderVersion)
+{
+	std::shared_ptr<CachedShader> cached = std::make_shared<CachedShader>();
+
+	cached->shader = getSharedShader();
+	cached->shaderVersion = shaderVersion;
+	cached->varyings = varyings;
+	cached->activeUniforms = activeUniforms;
+	cached->activeAttributes = activeAttributes;
+	cached->activeUniformBlocks = activeUniformBlocks;
+
+	std::string key = cacheKey();
+
+	cacheMutex.lock();
+
+	// Another thread may have translated the same source meanwhile
+	if(shaderCache.find(key) == shaderCache.end())
+	{
+		if(shaderCache.size() >= shaderCacheSize)
+		{
+			shaderCache.erase(shaderCacheOrder.front());
+			shaderCacheOrder.pop_front();
+		}
+
+		shaderCache[key] = cached;
+		shaderCacheOrder.push_back(key);
+	}
+
+	cacheMutex.unlock();
 }
 
 void Shader::compile()
 {
-	clear();
+	finishCompile();   // Of the previous source
 
-	createShader();
-	TranslatorASM *compiler = createCompiler(getType());
+	clear();
 
 	// Ensure we don't pass a nullptr source to the compiler
-	const char *source = "\0";
-	if(mSource)
+	compileSource = mSource ? mSource : "";
+	clientVersion = es2::getContext()->getClientVersion();
+
+	int shaderVersion = 100;
+
+	if(loadCachedShader(shaderVersion))
 	{
-		source = mSource;
+		setCompileResult(shaderVersion, true, "");
+		return;
 	}
 
+	createShader();
+
+	compileClient = sw::ThreadPool::createClient();
+	sw::ThreadPool::reserve(1);
+	sw::ThreadPool::submit(compileClient, translateJob, this);
+}
+
+void Shader::translateJob(void *parameters)
+{
+	static_cast<Shader*>(parameters)->translate();
+}
+
+void Shader::translate()
+{
+	const char *source = compileSource.c_str();
+	std::string compilerLog;
+
+	TranslatorASM *compiler = acquireCompiler(getType());
+
+	compiler->setShaderObject(this);
 	bool success = compiler->compile(&source, 1, SH_OBJECT_CODE);
+	compiler->setShaderObject(nullptr);
 
+	int shaderVersion = compiler->getShaderVersion();
+
+	if(success)
+	{
+		storeCachedShader(shaderVersion);
+	}
+	else
+	{
+		compilerLog = compiler->getInfoSink().info.c_str();
+	}
+
+	recycleCompiler(compiler, getType());
+
+	setCompileResult(shaderVersion, success, compilerLog);
+}
+
+void Shader::setCompileResult(int shaderVersion, bool success, const std::string &compilerLog)
+{
 	if(false)
 	{
 		static int serial = 1;
 		char buffer[256];
 		sprintf(buffer, "shader-input-%d-%d.txt", getName(), serial);
 		FILE *file = fopen(buffer, "wt");
-		fprintf(file, "%s", mSource);
+		fprintf(file, "%s", compileSource.c_str());
 		fclose(file);
 		getShader()->print("shader-output-%d-%d.txt", getName(), serial);
 		serial++;
 	}
 
-	int shaderVersion = compiler->getShaderVersion();
-	int clientVersion = es2::getContext()->getClientVersion();
-
 	if(shaderVersion >= 300 && clientVersion < 3)
 	{
 		infoLog = "GLSL ES 3.00 is not supported by OpenGL ES 2.0 contexts";
@@ -237,15 +421,28 @@ void Shader::compile()
 	{
 		deleteShader();
 
-		infoLog += compiler->getInfoSink().info.c_str();
+		infoLog += compilerLog;
 		TRACE("\n%s", infoLog.c_str());
 	}
+}
+
+void Shader::finishCompile() const
+{
+	compileMutex.lock();
+
+	if(compileClient)
+	{
+		sw::ThreadPool::destroyClient(compileClient);   // Waits for the translation
+		compileClient = nullptr;
+	}
 
-	delete compiler;
+	compileMutex.unlock();
 }
 
 bool Shader::isCompiled()
 {
+	finishCompile();
+
 	return getShader() != 0;
 }
 
@@ -281,8 +478,31 @@ void Shader::flagForDeletion()
 
 void Shader::releaseCompiler()
 {
-	FreeCompilerGlobals();
-	compilerInitialized = false;
+	compilerMutex.lock();
+
+	for(std::vector<TranslatorASM*> &compilers : idleCompilers)
+	{
+		for(TranslatorASM *compiler : compilers)
+		{
+			delete compiler;
+		}
+
+		compilers.clear();
+	}
+
+	// Compilers still translating on other threads need the globals
+	if(compilerInitialized && busyCompilers == 0)
+	{
+		FreeCompilerGlobals();
+		compilerInitialized = false;
+	}
+
+	compilerMutex.unlock();
+
+	cacheMutex.lock();
+	shaderCache.clear();
+	shaderCacheOrder.clear();
+	cacheMutex.unlock();
 }
 
 // true if varying x has a higher priority in packing than y
@@ -370,12 +590,11 @@ bool Shader::compareVarying(const glsl::Varying &x, const glsl::Varying &y)
 
 VertexShader::VertexShader(ResourceManager *manager, GLuint handle) : Shader(manager, handle)
 {
-	vertexShader = 0;
 }
 
 VertexShader::~VertexShader()
 {
-	delete vertexShader;
+	finishCompile();   // Before the translation's output goes away
 }
 
 GLenum VertexShader::getType() const
@@ -401,34 +620,41 @@ int VertexShader::getSemanticIndex(const std::string &attributeName)
 
 sw::Shader *VertexShader::getShader() const
 {
-	return vertexShader;
+	return vertexShader.get();
 }
 
 sw::VertexShader *VertexShader::getVertexShader() const
 {
-	return vertexShader;
+	return vertexShader.get();
 }
 
 void VertexShader::createShader()
 {
-	delete vertexShader;
-	vertexShader = new sw::VertexShader();
+	vertexShader = std::make_shared<sw::VertexShader>();
+}
+
+void VertexShader::shareShader(const std::shared_ptr<sw::Shader> &shader)
+{
+	vertexShader = std::static_pointer_cast<sw::VertexShader>(shader);
+}
+
+std::shared_ptr<sw::Shader> VertexShader::getSharedShader() const
+{
+	return vertexShader;
 }
 
 void VertexShader::deleteShader()
 {
-	delete vertexShader;
-	vertexShader = nullptr;
+	vertexShader.reset();
 }
 
 FragmentShader::FragmentShader(ResourceManager *manager, GLuint handle) : Shader(manager, handle)
 {
-	pixelShader = 0;
 }
 
 FragmentShader::~FragmentShader()
 {
-	delete pixelShader;
+	finishCompile();   // Before the translation's output goes away
 }
 
 GLenum FragmentShader::getType() const
@@ -438,24 +664,32 @@ GLenum FragmentShader::getType() const
 
 sw::Shader *FragmentShader::getShader() const
 {
-	return pixelShader;
+	return pixelShader.get();
 }
 
 sw::PixelShader *FragmentShader::getPixelShader() const
 {
-	return pixelShader;
+	return pixelShader.get();
 }
 
 void FragmentShader::createShader()
 {
-	delete pixelShader;
-	pixelShader = new sw::PixelShader();
+	pixelShader = std::make_shared<sw::PixelShader>();
+}
+
+void FragmentShader::shareShader(const std::shared_ptr<sw::Shader> &shader)
+{
+	pixelShader = std::static_pointer_cast<sw::PixelShader>(shader);
+}
+
+std::shared_ptr<sw::Shader> FragmentShader::getSharedShader() const
+{
+	return pixelShader;
 }
 
 void FragmentShader::deleteShader()
 {
-	delete pixelShader;
-	pixelShader = nullptr;
+	pixelShader.reset();
 }
 
 }
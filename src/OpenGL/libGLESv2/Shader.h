@@ -23,11 +23,14 @@
 #include "ResourceManager.h"
 
 #include "compiler/TranslatorASM.h"
+#include "Common/MutexLock.hpp"
+#include "Common/ThreadPool.hpp"
 
 #include <GLES2/gl2.h>
 
 #include <string>
 #include <list>
+#include <memory>
 #include <vector>
 
 namespace glsl
@@ -57,7 +60,7 @@ public:
 	size_t getSourceLength() const;
 	void getSource(GLsizei bufSize, GLsizei *length, char *source);
 
-	void compile();
+	void compile();   // Translates in the background, and queries of the outcome wait for it
 	bool isCompiled();
 
 	void addRef();
@@ -70,8 +73,10 @@ public:
 
 protected:
 	static bool compilerInitialized;
-	TranslatorASM *createCompiler(GLenum shaderType);
+	static TranslatorASM *acquireCompiler(GLenum shaderType);   // For the caller's exclusive use
+	static void recycleCompiler(TranslatorASM *compiler, GLenum shaderType);
 	void clear();
+	void finishCompile() const;   // Waits for the background translation
 
 	static bool compareVarying(const glsl::Varying &x, const glsl::Varying &y);
 
@@ -80,8 +85,23 @@ protected:
 
 private:
 	virtual void createShader() = 0;
+	virtual void shareShader(const std::shared_ptr<sw::Shader> &shader) = 0;   // Translated for another shader object
+	virtual std::shared_ptr<sw::Shader> getSharedShader() const = 0;
 	virtual void deleteShader() = 0;
 
+	std::string cacheKey() const;
+	bool loadCachedShader(int &shaderVersion);
+	void storeCachedShader(int shaderVersion);
+
+	static void translateJob(void *parameters);
+	void translate();
+	void setCompileResult(int shaderVersion, bool success, const std::string &compilerLog);
+
+	std::string compileSource;   // Copied, since the source can change while translating
+	int clientVersion;
+	mutable sw::ThreadPool::Client *compileClient;   // Runs the translation, null when done
+	mutable sw::BackoffLock compileMutex;
+
 	const GLuint mHandle;
 	unsigned int mRefCount;     // Number of program objects this shader is attached to
 	bool mDeleteStatus;         // Flag to indicate that the shader can be deleted when no longer in use
@@ -106,9 +126,11 @@ public:
 
 private:
 	virtual void createShader();
+	virtual void shareShader(const std::shared_ptr<sw::Shader> &shader);
+	virtual std::shared_ptr<sw::Shader> getSharedShader() const;
 	virtual void deleteShader();
 
-	sw::VertexShader *vertexShader;
+	std::shared_ptr<sw::VertexShader> vertexShader;   // Shared with the translation cache once compiled
 };
 
 class FragmentShader : public Shader
@@ -125,9 +147,11 @@ public:
 
 private:
 	virtual void createShader();
+	virtual void shareShader(const std::shared_ptr<sw::Shader> &shader);
+	virtual std::shared_ptr<sw::Shader> getSharedShader() const;
 	virtual void deleteShader();
 
-	sw::PixelShader *pixelShader;
+	std::shared_ptr<sw::PixelShader> pixelShader;   // Shared with the translation cache once compiled
 };
 }
 
@@ -1337,6 +1337,9 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 egl::Image *createBackBuffer(int width, int height, const egl::Config *config);
 egl::Image *createDepthStencil(unsigned int width, unsigned int height, sw::Format format, int multiSampleDepth, bool discard);
 sw::FrameBuffer *createFrameBuffer(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+#if defined(__linux__) && !defined(__ANDROID__)
+sw::FrameBuffer *createFrameBufferHeadless(void *window, int width, int height);
+#endif
 
 LibGLESv2exports::LibGLESv2exports()
 {
@@ -1539,6 +1542,9 @@ LibGLESv2exports::LibGLESv2exports()
 	this->createBackBuffer = ::createBackBuffer;
 	this->createDepthStencil = ::createDepthStencil;
 	this->createFrameBuffer = ::createFrameBuffer;
+	#if defined(__linux__) && !defined(__ANDROID__)
+	this->createFrameBufferHeadless = ::createFrameBufferHeadless;
+	#endif
 }
 
 extern "C" GL_APICALL LibGLESv2exports *libGLESv2_swiftshader()
@@ -39,6 +39,7 @@
 
 #include <xmmintrin.h>
 #include <fstream>
+#include <chrono>
 
 #if defined(__x86_64__) && defined(_WIN32)
 extern "C" void X86CompilationCallback()
@@ -69,6 +70,13 @@ namespace
 	llvm::Function *function = nullptr;
 
 	sw::BackoffLock codegenMutex;
+
+	std::chrono::steady_clock::time_point buildStart;   // Of the current routine
+
+	double seconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double>(end - start).count();
+	}
 }
 
 namespace sw
@@ -102,21 +110,9 @@ namespace sw
 		return reinterpret_cast<BasicBlock*>(t);
 	}
 
-	Nucleus::Nucleus()
+	// Unoptimized routines are emitted with fast instruction selection and register allocation
+	void createExecutionEngine(bool runOptimizations)
 	{
-		::codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
-
-		InitializeNativeTarget();
-		JITEmitDebugInfo = false;
-
-		if(!::context)
-		{
-			::context = new LLVMContext();
-		}
-
-		::module = new Module("", *::context);
-		::routineManager = new LLVMRoutineManager();
-
 		#if defined(__x86_64__)
 			const char *architecture = "x86-64";
 		#else
@@ -134,7 +130,47 @@ namespace sw
 
 		std::string error;
 		TargetMachine *targetMachine = EngineBuilder::selectTarget(::module, architecture, "", MAttrs, Reloc::Default, CodeModel::JITDefault, &error);
-		::executionEngine = JIT::createJIT(::module, 0, ::routineManager, CodeGenOpt::Aggressive, true, targetMachine);
+		::executionEngine = JIT::createJIT(::module, 0, ::routineManager, runOptimizations ? CodeGenOpt::Aggressive : CodeGenOpt::None, true, targetMachine);
+	}
+
+	// The fast tier only promotes stack variables to registers, since emitting code
+	// for their loads and stores takes longer than this pass
+	void promoteStackVariables()
+	{
+		static PassManager *passManager = nullptr;
+
+		if(!passManager)
+		{
+			passManager = new PassManager();
+			passManager->add(new TargetData(*::executionEngine->getTargetData()));
+			passManager->add(createScalarReplAggregatesPass());
+		}
+
+		passManager->run(*::module);
+	}
+
+	Nucleus::Nucleus()
+	{
+		::codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
+
+		::buildStart = std::chrono::steady_clock::now();
+
+		InitializeNativeTarget();
+		JITEmitDebugInfo = false;
+
+		#if defined(__x86_64__)
+			// Routines run from a different address than they're written to. Jump
+			// tables would hold absolute addresses of the written code.
+			DisableJumpTables = true;
+		#endif
+
+		if(!::context)
+		{
+			::context = new LLVMContext();
+		}
+
+		::module = new Module("", *::context);
+		::routineManager = new LLVMRoutineManager();
 
 		if(!::builder)
 		{
@@ -156,8 +192,16 @@ namespace sw
 
 	Nucleus::~Nucleus()
 	{
-		delete ::executionEngine;
-		::executionEngine = nullptr;
+		if(::executionEngine)
+		{
+			delete ::executionEngine;   // Owns the module
+			::executionEngine = nullptr;
+		}
+		else   // No routine was acquired
+		{
+			delete ::module;
+			delete ::routineManager;
+		}
 
 		::routineManager = nullptr;
 		::function = nullptr;
@@ -182,6 +226,15 @@ namespace sw
 			}
 		}
 
+		CompileStatistics statistics = {};
+		auto optimizeStart = std::chrono::steady_clock::now();
+		statistics.buildTime = seconds(::buildStart, optimizeStart);
+
+		for(const llvm::BasicBlock &block : *::function)
+		{
+			statistics.instructions += (int)block.size();
+		}
+
 		if(false)
 		{
 			std::string error;
@@ -189,10 +242,19 @@ namespace sw
 			::module->print(file, 0);
 		}
 
+		createExecutionEngine(runOptimizations);
+
 		if(runOptimizations)
 		{
 			optimize();
 		}
+		else
+		{
+			promoteStackVariables();
+		}
+
+		auto emitStart = std::chrono::steady_clock::now();
+		statistics.optimizeTime = seconds(optimizeStart, emitStart);
 
 		if(false)
 		{
@@ -203,6 +265,11 @@ namespace sw
 
 		void *entry = ::executionEngine->getPointerToFunction(::function);
 		LLVMRoutine *routine = ::routineManager->acquireRoutine(entry);
+		routine->setOptimized(runOptimizations);
+
+		statistics.emitTime = seconds(emitStart, std::chrono::steady_clock::now());
+		statistics.codeSize = routine->getCodeSize();
+		routine->setCompileStatistics(statistics);
 
 		if(CodeAnalystLogJITCode)
 		{
@@ -22,21 +22,36 @@ namespace sw
 {
 	LLVMRoutine::LLVMRoutine(int bufferSize) : bufferSize(bufferSize)
 	{
-		void *memory = allocateExecutable(bufferSize);
+		#if defined(__x86_64__)
+			void *memory = allocateExecutable(bufferSize);
+		#else
+			// The 32-bit JIT resolves calls to external functions relative to where
+			// the routine is written, so it can't run from another address
+			void *memory = allocateExecutablePages(bufferSize);
+		#endif
 
 		buffer = memory;
 		entry = memory;
+		executable = memory;
 		functionSize = bufferSize;   // Updated by LLVMRoutineManager::endFunctionBody
 	}
 
 	LLVMRoutine::~LLVMRoutine()
 	{
-		deallocateExecutable(buffer, bufferSize);
+		#if defined(__x86_64__)
+			deallocateExecutable(buffer);
+		#else
+			deallocateExecutablePages(buffer, bufferSize);
+		#endif
 	}
 
 	const void *LLVMRoutine::getEntry()
 	{
-		return entry;
+		#if defined(__x86_64__)
+			return executable;
+		#else
+			return entry;
+		#endif
 	}
 
 	int LLVMRoutine::getCodeSize()
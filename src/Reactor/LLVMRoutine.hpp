@@ -43,6 +43,7 @@ namespace sw
 	private:
 		void *buffer;
 		const void *entry;
+		const void *executable;   // Where the entry point runs from
 		int bufferSize;
 		int functionSize;
 
@@ -64,10 +64,6 @@ namespace sw
 			sw::atomicIncrement(&averageInstructionSize);
 		}
 
-		// Round up to the next page size
-		size_t pageSize = memoryPageSize();
-		actualSize = (actualSize + pageSize - 1) & ~(pageSize - 1);
-
 		delete routine;
 		routine = new LLVMRoutine(static_cast<int>(actualSize));
 
@@ -128,7 +124,11 @@ namespace sw
 
 	void LLVMRoutineManager::setMemoryExecutable()
 	{
-		markExecutable(routine->buffer, routine->bufferSize);
+		#if defined(__x86_64__)
+			markExecutable(routine->buffer);
+		#else
+			markExecutablePages(routine->buffer, routine->bufferSize);
+		#endif
 	}
 
 	void LLVMRoutineManager::setPoisonMemory(bool poison)
@@ -140,6 +140,10 @@ namespace sw
 	{
 		routine->entry = entry;
 
+		#if defined(__x86_64__)
+			routine->executable = executableAddress(entry);
+		#endif
+
 		LLVMRoutine *result = routine;
 		routine = nullptr;
 
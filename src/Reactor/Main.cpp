@@ -660,6 +660,87 @@ TEST(SubzeroReactorTest, VectorCompare)
 	delete routine;
 }
 
+TEST(SubzeroReactorTest, LoopInvariants)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> out = function.Arg<0>();
+			Pointer<Byte> in = function.Arg<1>();
+
+			Float4 a = *Pointer<Float4>(in);
+			Float4 sum = Float4(0.0f);
+
+			For(Int i = 0, i < 4, i++)
+			{
+				Float4 b = a.yxwz;
+				Float4 c = b.yxwz;
+
+				sum += a * c + a * c;
+				sum += Float4(Float(i));
+			}
+
+			*Pointer<Float4>(out) = sum;
+
+			Return(0);
+		}
+
+		routine = function(L"one");
+
+		if(routine)
+		{
+			float in[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+			float out[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+			int(*callable)(void*, void*) = (int(*)(void*, void*))routine->getEntry();
+			callable(out, in);
+
+			EXPECT_EQ(out[0], 14.0f);
+			EXPECT_EQ(out[1], 38.0f);
+			EXPECT_EQ(out[2], 78.0f);
+			EXPECT_EQ(out[3], 134.0f);
+		}
+	}
+
+	delete routine;
+}
+
+TEST(SubzeroReactorTest, CompileStatistics)
+{
+	Routine *routine = nullptr;
+
+	{
+		Function<Int(Int)> function;
+		{
+			Int x = function.Arg<0>();
+			Int y = x * 3 + 1;
+
+			Return(y);
+		}
+
+		routine = function.unoptimized(L"one");
+
+		if(routine)
+		{
+			const CompileStatistics &statistics = routine->getCompileStatistics();
+
+			EXPECT_FALSE(routine->isOptimized());
+			EXPECT_GT(statistics.instructions, 0);
+			EXPECT_GT(statistics.codeSize, 0);
+			EXPECT_GE(statistics.buildTime, 0.0);
+			EXPECT_GE(statistics.optimizeTime, 0.0);
+			EXPECT_GE(statistics.emitTime, 0.0);
+
+			int(*callable)(int) = (int(*)(int))routine->getEntry();
+			EXPECT_EQ(callable(4), 13);
+		}
+	}
+
+	delete routine;
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -17,7 +17,10 @@
 #include "src/IceCfg.h"
 #include "src/IceCfgNode.h"
 
+#include <algorithm>
+#include <functional>
 #include <map>
+#include <set>
 #include <vector>
 
 namespace
@@ -33,16 +36,25 @@ namespace
 		void eliminateUnitializedLoads();
 		void eliminateLoadsFollowingSingleStore();
 		void optimizeStoresInSingleBasicBlock();
+		void analyzeControlFlow();
+		void combineShuffles();
+		void eliminateCommonSubexpressions();
+		void hoistLoopInvariants();
 
 		void replace(Ice::Inst *instruction, Ice::Operand *newValue);
+		void replaceSource(Ice::Inst *instruction, Ice::SizeT i, Ice::Operand *newValue);
 		void deleteInstruction(Ice::Inst *instruction);
 		bool isDead(Ice::Inst *instruction);
+		bool isSingleDefinition(Ice::Operand *value);
+		bool dominates(Ice::CfgNode *a, Ice::CfgNode *b) const;
+		Ice::Inst *terminator(Ice::CfgNode *basicBlock) const;
 
 		static bool isLoad(const Ice::Inst &instruction);
 		static bool isStore(const Ice::Inst &instruction);
 		static Ice::Operand *storeAddress(const Ice::Inst *instruction);
 		static Ice::Operand *loadAddress(const Ice::Inst *instruction);
 		static Ice::Operand *storeData(const Ice::Inst *instruction);
+		static bool isSpeculatable(const Ice::Inst &instruction);
 
 		Ice::Cfg *function;
 		Ice::GlobalContext *context;
@@ -60,6 +72,28 @@ namespace
 		std::map<Ice::Operand*, Uses> uses;
 		std::map<Ice::Inst*, Ice::CfgNode*> node;
 		std::map<Ice::Variable*, Ice::Inst*> definition;
+		std::set<Ice::Variable*> redefined;   // Variables assigned by more than one instruction
+
+		// Control flow graph, indexed by basic block index
+		std::vector<std::vector<Ice::CfgNode*>> successors;
+		std::vector<std::vector<Ice::CfgNode*>> predecessors;
+		std::vector<Ice::CfgNode*> reversePostOrder;   // Reachable blocks only
+		std::vector<int> postOrderNumber;   // -1 for unreachable blocks
+		std::vector<Ice::CfgNode*> immediateDominator;
+
+		// Operation performed by a side-effect free instruction, used for value numbering
+		struct Expression
+		{
+			Expression(const Ice::Inst &instruction);
+
+			bool operator<(const Expression &other) const;
+
+			Ice::Inst::InstKind kind;
+			int op;
+			Ice::Type type;
+			std::vector<Ice::Operand*> operands;
+			std::vector<int32_t> indices;
+		};
 	};
 
 	void Optimizer::run(Ice::Cfg *function)
@@ -74,6 +108,12 @@ namespace
 		eliminateLoadsFollowingSingleStore();
 		optimizeStoresInSingleBasicBlock();
 		eliminateDeadCode();
+
+		analyzeControlFlow();
+		combineShuffles();
+		eliminateCommonSubexpressions();
+		hoistLoopInvariants();
+		eliminateDeadCode();
 	}
 
 	void Optimizer::eliminateDeadCode()
@@ -338,11 +378,483 @@ namespace
 		}
 	}
 
+	void Optimizer::analyzeControlFlow()
+	{
+		Ice::SizeT numNodes = function->getNumNodes();
+
+		successors.assign(numNodes, {});
+		predecessors.assign(numNodes, {});
+		reversePostOrder.clear();
+		postOrderNumber.assign(numNodes, -1);
+		immediateDominator.assign(numNodes, nullptr);
+
+		for(Ice::CfgNode *basicBlock : function->getNodes())
+		{
+			if(Ice::Inst *branch = terminator(basicBlock))
+			{
+				for(Ice::CfgNode *target : branch->getTerminatorEdges())
+				{
+					auto &targets = successors[basicBlock->getIndex()];
+
+					if(std::find(targets.begin(), targets.end(), target) == targets.end())
+					{
+						targets.push_back(target);
+						predecessors[target->getIndex()].push_back(basicBlock);
+					}
+				}
+			}
+		}
+
+		// Depth-first traversal from the entry block
+		std::vector<bool> visited(numNodes, false);
+		std::vector<std::pair<Ice::CfgNode*, size_t>> stack;
+		Ice::CfgNode *entryBlock = function->getEntryNode();
+
+		visited[entryBlock->getIndex()] = true;
+		stack.push_back({entryBlock, 0});
+
+		while(!stack.empty())
+		{
+			Ice::CfgNode *basicBlock = stack.back().first;
+			auto &targets = successors[basicBlock->getIndex()];
+
+			if(stack.back().second < targets.size())
+			{
+				Ice::CfgNode *target = targets[stack.back().second++];
+
+				if(!visited[target->getIndex()])
+				{
+					visited[target->getIndex()] = true;
+					stack.push_back({target, 0});
+				}
+			}
+			else
+			{
+				postOrderNumber[basicBlock->getIndex()] = (int)reversePostOrder.size();
+				reversePostOrder.push_back(basicBlock);
+				stack.pop_back();
+			}
+		}
+
+		std::reverse(reversePostOrder.begin(), reversePostOrder.end());
+
+		// Iterative dominator computation (Cooper, Harvey and Kennedy)
+		immediateDominator[entryBlock->getIndex()] = entryBlock;
+
+		bool changed;
+		do
+		{
+			changed = false;
+
+			for(Ice::CfgNode *basicBlock : reversePostOrder)
+			{
+				if(basicBlock == entryBlock)
+				{
+					continue;
+				}
+
+				Ice::CfgNode *dominator = nullptr;
+
+				for(Ice::CfgNode *predecessor : predecessors[basicBlock->getIndex()])
+				{
+					if(!immediateDominator[predecessor->getIndex()])
+					{
+						continue;   // Not processed yet, or unreachable
+					}
+
+					if(!dominator)
+					{
+						dominator = predecessor;
+						continue;
+					}
+
+					Ice::CfgNode *a = predecessor;
+					Ice::CfgNode *b = dominator;
+
+					while(a != b)
+					{
+						while(postOrderNumber[a->getIndex()] < postOrderNumber[b->getIndex()])
+						{
+							a = immediateDominator[a->getIndex()];
+						}
+
+						while(postOrderNumber[b->getIndex()] < postOrderNumber[a->getIndex()])
+						{
+							b = immediateDominator[b->getIndex()];
+						}
+					}
+
+					dominator = a;
+				}
+
+				if(immediateDominator[basicBlock->getIndex()] != dominator)
+				{
+					immediateDominator[basicBlock->getIndex()] = dominator;
+					changed = true;
+				}
+			}
+		}
+		while(changed);
+	}
+
+	void Optimizer::combineShuffles()
+	{
+		for(Ice::CfgNode *basicBlock : reversePostOrder)
+		{
+			for(Ice::Inst &inst : basicBlock->getInsts())
+			{
+				if(inst.isDeleted())
+				{
+					continue;
+				}
+
+				if(auto *extract = llvm::dyn_cast<Ice::InstExtractElement>(&inst))
+				{
+					// Extract the element directly from the vector it was shuffled or inserted into
+					while(true)
+					{
+						auto *vector = llvm::dyn_cast<Ice::Variable>(extract->getSrc(0));
+						auto *index = llvm::dyn_cast<Ice::ConstantInteger32>(extract->getSrc(1));
+
+						if(!vector || !index || !isSingleDefinition(vector))
+						{
+							break;
+						}
+
+						Ice::Inst *def = definition[vector];
+						int32_t lane = index->getValue();
+
+						if(auto *shuffle = llvm::dyn_cast_or_null<Ice::InstShuffleVector>(def))
+						{
+							int32_t numElements = (int32_t)shuffle->getNumIndexes();
+							int32_t select = shuffle->getIndexValue(lane);
+							Ice::Operand *source = shuffle->getSrc(select < numElements ? 0 : 1);
+
+							if(source->getType() != vector->getType())
+							{
+								break;
+							}
+
+							replaceSource(extract, 0, source);
+							replaceSource(extract, 1, context->getConstantInt32(select % numElements));
+						}
+						else if(auto *insert = llvm::dyn_cast_or_null<Ice::InstInsertElement>(def))
+						{
+							auto *insertIndex = llvm::dyn_cast<Ice::ConstantInteger32>(insert->getSrc(2));
+
+							if(!insertIndex)
+							{
+								break;
+							}
+
+							if(insertIndex->getValue() == lane)
+							{
+								if(insert->getSrc(1)->getType() != extract->getDest()->getType())
+								{
+									break;
+								}
+
+								replace(extract, insert->getSrc(1));
+								break;
+							}
+
+							replaceSource(extract, 0, insert->getSrc(0));
+						}
+						else
+						{
+							break;
+						}
+					}
+				}
+				else if(auto *shuffle = llvm::dyn_cast<Ice::InstShuffleVector>(&inst))
+				{
+					Ice::Type type = shuffle->getDest()->getType();
+					int32_t numElements = (int32_t)shuffle->getNumIndexes();
+
+					if(shuffle->getSrc(0)->getType() != type || shuffle->getSrc(1)->getType() != type)
+					{
+						continue;
+					}
+
+					// Trace each selected element through shuffles feeding this one
+					std::vector<Ice::Operand*> sources;
+					std::vector<int32_t> lanes(numElements);
+					bool combined = false;
+					bool identity = true;
+
+					for(int32_t i = 0; i < numElements; i++)
+					{
+						int32_t select = shuffle->getIndexValue(i);
+						Ice::Operand *source = shuffle->getSrc(select < numElements ? 0 : 1);
+						int32_t lane = select % numElements;
+
+						auto *vector = llvm::dyn_cast<Ice::Variable>(source);
+						auto *inner = vector && isSingleDefinition(vector) ? llvm::dyn_cast_or_null<Ice::InstShuffleVector>(definition[vector]) : nullptr;
+
+						if(inner && !inner->isDeleted() && (int32_t)inner->getNumIndexes() == numElements &&
+						   inner->getSrc(0)->getType() == type && inner->getSrc(1)->getType() == type)
+						{
+							int32_t innerSelect = inner->getIndexValue(lane);
+							source = inner->getSrc(innerSelect < numElements ? 0 : 1);
+							lane = innerSelect % numElements;
+							combined = true;
+						}
+
+						auto found = std::find(sources.begin(), sources.end(), source);
+
+						if(found == sources.end())
+						{
+							sources.push_back(source);
+							found = sources.end() - 1;
+						}
+
+						lanes[i] = (int32_t)(found - sources.begin()) * numElements + lane;
+						identity = identity && (lanes[i] == i);
+					}
+
+					if(identity && sources.size() == 1)
+					{
+						replace(shuffle, sources[0]);
+					}
+					else if(combined && sources.size() <= 2)
+					{
+						Ice::Variable *dest = shuffle->getDest();
+						Ice::Operand *source1 = sources.size() == 2 ? sources[1] : sources[0];
+						auto *combinedShuffle = Ice::InstShuffleVector::create(function, dest, sources[0], source1);
+
+						for(int32_t lane : lanes)
+						{
+							combinedShuffle->addIndex(llvm::cast<Ice::ConstantInteger32>(context->getConstantInt32(lane)));
+						}
+
+						basicBlock->getInsts().insert(shuffle->getIterator(), combinedShuffle);
+
+						node[combinedShuffle] = basicBlock;
+						definition[dest] = combinedShuffle;
+						uses[sources[0]].insert(sources[0], combinedShuffle);
+
+						if(source1 != sources[0])
+						{
+							uses[source1].insert(source1, combinedShuffle);
+						}
+
+						deleteInstruction(shuffle);
+					}
+				}
+			}
+		}
+	}
+
+	void Optimizer::eliminateCommonSubexpressions()
+	{
+		// Blocks are visited in reverse post-order, so dominating blocks come first
+		std::map<Expression, std::vector<Ice::Inst*>> available;
+
+		for(Ice::CfgNode *basicBlock : reversePostOrder)
+		{
+			for(Ice::Inst &inst : basicBlock->getInsts())
+			{
+				if(inst.isDeleted() || !isSpeculatable(inst) || !isSingleDefinition(inst.getDest()))
+				{
+					continue;
+				}
+
+				bool operandsDefined = true;
+
+				for(Ice::SizeT i = 0; i < inst.getSrcSize(); i++)
+				{
+					operandsDefined = operandsDefined && isSingleDefinition(inst.getSrc(i));
+				}
+
+				if(!operandsDefined)
+				{
+					continue;
+				}
+
+				auto &candidates = available[Expression(inst)];
+				Ice::Inst *equivalent = nullptr;
+
+				for(Ice::Inst *candidate : candidates)
+				{
+					if(!candidate->isDeleted() && dominates(node[candidate], basicBlock))
+					{
+						equivalent = candidate;
+						break;
+					}
+				}
+
+				if(equivalent)
+				{
+					replace(&inst, equivalent->getDest());
+				}
+				else
+				{
+					candidates.push_back(&inst);
+				}
+			}
+		}
+	}
+
+	void Optimizer::hoistLoopInvariants()
+	{
+		// Collect natural loops, identified by their header
+		std::map<Ice::CfgNode*, std::set<Ice::CfgNode*>> loops;
+
+		for(Ice::CfgNode *basicBlock : reversePostOrder)
+		{
+			for(Ice::CfgNode *header : successors[basicBlock->getIndex()])
+			{
+				if(!dominates(header, basicBlock))
+				{
+					continue;
+				}
+
+				auto &body = loops[header];
+				std::vector<Ice::CfgNode*> worklist;
+
+				body.insert(header);
+
+				if(body.insert(basicBlock).second)
+				{
+					worklist.push_back(basicBlock);
+				}
+
+				while(!worklist.empty())
+				{
+					Ice::CfgNode *block = worklist.back();
+					worklist.pop_back();
+
+					for(Ice::CfgNode *predecessor : predecessors[block->getIndex()])
+					{
+						if(postOrderNumber[predecessor->getIndex()] >= 0 && body.insert(predecessor).second)
+						{
+							worklist.push_back(predecessor);
+						}
+					}
+				}
+			}
+		}
+
+		// Process inner loops first, so their invariants can be hoisted further out
+		std::vector<std::pair<Ice::CfgNode*, std::set<Ice::CfgNode*>*>> loopOrder;
+
+		for(auto &loop : loops)
+		{
+			loopOrder.push_back({loop.first, &loop.second});
+		}
+
+		std::stable_sort(loopOrder.begin(), loopOrder.end(), [](const std::pair<Ice::CfgNode*, std::set<Ice::CfgNode*>*> &a, const std::pair<Ice::CfgNode*, std::set<Ice::CfgNode*>*> &b)
+		{
+			return a.second->size() < b.second->size();
+		});
+
+		std::set<Ice::Operand*> arguments(function->getArgs().begin(), function->getArgs().end());
+
+		for(auto &loop : loopOrder)
+		{
+			Ice::CfgNode *header = loop.first;
+			const std::set<Ice::CfgNode*> &body = *loop.second;
+
+			// Require a single predecessor outside the loop which only branches to the header
+			Ice::CfgNode *preheader = nullptr;
+
+			for(Ice::CfgNode *predecessor : predecessors[header->getIndex()])
+			{
+				if(body.count(predecessor) == 0)
+				{
+					preheader = preheader ? header : predecessor;   // Header marks multiple entries
+				}
+			}
+
+			if(!preheader || preheader == header || successors[preheader->getIndex()].size() != 1)
+			{
+				continue;
+			}
+
+			Ice::Inst *branch = terminator(preheader);
+
+			if(!branch)
+			{
+				continue;
+			}
+
+			auto isInvariant = [&](Ice::Operand *operand)
+			{
+				if(llvm::isa<Ice::Constant>(operand))
+				{
+					return true;
+				}
+
+				auto *variable = llvm::dyn_cast<Ice::Variable>(operand);
+
+				if(!variable || !isSingleDefinition(variable))
+				{
+					return false;
+				}
+
+				Ice::Inst *def = definition[variable];
+
+				if(!def)
+				{
+					return arguments.count(variable) != 0;
+				}
+
+				return body.count(node[def]) == 0;
+			};
+
+			bool hoisted;
+			do
+			{
+				hoisted = false;
+				std::vector<Ice::Inst*> invariants;
+
+				for(Ice::CfgNode *basicBlock : reversePostOrder)
+				{
+					if(body.count(basicBlock) == 0)
+					{
+						continue;
+					}
+
+					for(Ice::Inst &inst : basicBlock->getInsts())
+					{
+						if(inst.isDeleted() || !isSpeculatable(inst) || !isSingleDefinition(inst.getDest()))
+						{
+							continue;
+						}
+
+						bool invariant = true;
+
+						for(Ice::SizeT i = 0; i < inst.getSrcSize(); i++)
+						{
+							invariant = invariant && isInvariant(inst.getSrc(i));
+						}
+
+						if(invariant)
+						{
+							invariants.push_back(&inst);
+						}
+					}
+				}
+
+				for(Ice::Inst *inst : invariants)
+				{
+					auto iterator = inst->getIterator();
+					node[inst]->getInsts().remove(iterator);
+					preheader->getInsts().insert(branch->getIterator(), inst);
+					node[inst] = preheader;
+					hoisted = true;
+				}
+			}
+			while(hoisted);
+		}
+	}
+
 	void Optimizer::analyzeUses(Ice::Cfg *function)
 	{
 		uses.clear();
 		node.clear();
 		definition.clear();
+		redefined.clear();
 
 		for(Ice::CfgNode *basicBlock : function->getNodes())
 		{
@@ -354,7 +866,16 @@ namespace
 				}
 
 				node[&instruction] = basicBlock;
-				definition[instruction.getDest()] = &instruction;
+
+				if(Ice::Variable *dest = instruction.getDest())
+				{
+					if(definition[dest])
+					{
+						redefined.insert(dest);
+					}
+
+					definition[dest] = &instruction;
+				}
 
 				for(Ice::SizeT i = 0; i < instruction.getSrcSize(); i++)
 				{
@@ -406,6 +927,49 @@ namespace
 		deleteInstruction(instruction);
 	}
 
+	void Optimizer::replaceSource(Ice::Inst *instruction, Ice::SizeT i, Ice::Operand *newValue)
+	{
+		Ice::Operand *oldValue = instruction->getSrc(i);
+
+		if(oldValue == newValue)
+		{
+			return;
+		}
+
+		bool usesNewValue = false;
+		for(Ice::SizeT j = 0; j < instruction->getSrcSize(); j++)
+		{
+			usesNewValue = usesNewValue || (instruction->getSrc(j) == newValue);
+		}
+
+		instruction->replaceSource(i, newValue);
+
+		if(!usesNewValue)
+		{
+			uses[newValue].insert(newValue, instruction);
+		}
+
+		for(Ice::SizeT j = 0; j < instruction->getSrcSize(); j++)
+		{
+			if(instruction->getSrc(j) == oldValue)
+			{
+				return;   // Still used by another operand
+			}
+		}
+
+		const auto &oldEntry = uses.find(oldValue);
+
+		if(oldEntry != uses.end())
+		{
+			oldEntry->second.erase(instruction);
+
+			if(oldEntry->second.empty())
+			{
+				uses.erase(oldEntry);   // Definition is left for dead code elimination
+			}
+		}
+	}
+
 	void Optimizer::deleteInstruction(Ice::Inst *instruction)
 	{
 		if(!instruction || instruction->isDeleted())
@@ -464,6 +1028,51 @@ namespace
 		return false;
 	}
 
+	bool Optimizer::isSingleDefinition(Ice::Operand *value)
+	{
+		if(auto *variable = llvm::dyn_cast_or_null<Ice::Variable>(value))
+		{
+			return redefined.count(variable) == 0;
+		}
+
+		return value != nullptr;
+	}
+
+	bool Optimizer::dominates(Ice::CfgNode *a, Ice::CfgNode *b) const
+	{
+		if(postOrderNumber[a->getIndex()] < 0 || postOrderNumber[b->getIndex()] < 0)
+		{
+			return false;
+		}
+
+		while(b != a)
+		{
+			Ice::CfgNode *dominator = immediateDominator[b->getIndex()];
+
+			if(dominator == b)
+			{
+				return false;   // Reached the entry block
+			}
+
+			b = dominator;
+		}
+
+		return true;
+	}
+
+	Ice::Inst *Optimizer::terminator(Ice::CfgNode *basicBlock) const
+	{
+		for(Ice::Inst &inst : Ice::reverse_range(basicBlock->getInsts()))
+		{
+			if(!inst.isDeleted())
+			{
+				return llvm::isa<Ice::InstBr>(&inst) || llvm::isa<Ice::InstSwitch>(&inst) ? &inst : nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
 	bool Optimizer::isLoad(const Ice::Inst &instruction)
 	{
 		if(llvm::isa<Ice::InstLoad>(&instruction))
@@ -554,6 +1163,81 @@ namespace
 		return nullptr;
 	}
 
+	bool Optimizer::isSpeculatable(const Ice::Inst &instruction)
+	{
+		switch(instruction.getKind())
+		{
+		case Ice::Inst::Arithmetic:
+			switch(llvm::cast<Ice::InstArithmetic>(&instruction)->getOp())
+			{
+			case Ice::InstArithmetic::Udiv:
+			case Ice::InstArithmetic::Sdiv:
+			case Ice::InstArithmetic::Urem:
+			case Ice::InstArithmetic::Srem:
+				return false;   // May trap
+			default:
+				return true;
+			}
+		case Ice::Inst::Cast:
+		case Ice::Inst::Icmp:
+		case Ice::Inst::Fcmp:
+		case Ice::Inst::Select:
+		case Ice::Inst::ExtractElement:
+		case Ice::Inst::InsertElement:
+		case Ice::Inst::ShuffleVector:
+			return instruction.getDest() != nullptr;
+		default:
+			return false;
+		}
+	}
+
+	Optimizer::Expression::Expression(const Ice::Inst &instruction) : kind(instruction.getKind()), op(0), type(instruction.getDest()->getType())
+	{
+		for(Ice::SizeT i = 0; i < instruction.getSrcSize(); i++)
+		{
+			operands.push_back(instruction.getSrc(i));
+		}
+
+		if(auto *arithmetic = llvm::dyn_cast<Ice::InstArithmetic>(&instruction))
+		{
+			op = arithmetic->getOp();
+
+			if(arithmetic->isCommutative() && std::less<Ice::Operand*>()(operands[1], operands[0]))
+			{
+				std::swap(operands[0], operands[1]);
+			}
+		}
+		else if(auto *cast = llvm::dyn_cast<Ice::InstCast>(&instruction))
+		{
+			op = cast->getCastKind();
+		}
+		else if(auto *icmp = llvm::dyn_cast<Ice::InstIcmp>(&instruction))
+		{
+			op = icmp->getCondition();
+		}
+		else if(auto *fcmp = llvm::dyn_cast<Ice::InstFcmp>(&instruction))
+		{
+			op = fcmp->getCondition();
+		}
+		else if(auto *shuffle = llvm::dyn_cast<Ice::InstShuffleVector>(&instruction))
+		{
+			for(Ice::SizeT i = 0; i < shuffle->getNumIndexes(); i++)
+			{
+				indices.push_back(shuffle->getIndexValue(i));
+			}
+		}
+	}
+
+	bool Optimizer::Expression::operator<(const Expression &other) const
+	{
+		if(kind != other.kind) return kind < other.kind;
+		if(op != other.op) return op < other.op;
+		if(type != other.type) return type < other.type;
+		if(operands != other.operands) return operands < other.operands;
+
+		return indices < other.indices;
+	}
+
 	bool Optimizer::Uses::areOnlyLoadStore() const
 	{
 		return size() == (loads.size() + stores.size());
@@ -2209,6 +2209,7 @@ namespace sw
 		}
 
 		Routine *operator()(const wchar_t *name, ...);
+		Routine *unoptimized(const wchar_t *name, ...);   // Faster to compile, slower to run
 
 	protected:
 		Nucleus *core;
@@ -2718,6 +2719,19 @@ namespace sw
 		return core->acquireRoutine(fullName, true);
 	}
 
+	template<typename Return, typename... Arguments>
+	Routine *Function<Return(Arguments...)>::unoptimized(const wchar_t *name, ...)
+	{
+		wchar_t fullName[1024 + 1];
+
+		va_list vararg;
+		va_start(vararg, name);
+		vswprintf(fullName, 1024, name, vararg);
+		va_end(vararg);
+
+		return core->acquireRoutine(fullName, false);
+	}
+
 	template<class T, class S>
 	RValue<T> ReinterpretCast(RValue<S> val)
 	{
@@ -23,6 +23,9 @@ namespace sw
 	Routine::Routine()
 	{
 		bindCount = 0;
+		useCount = 0;
+		optimized = true;
+		statistics = {};
 	}
 
 	void Routine::bind()
@@ -40,6 +43,31 @@ namespace sw
 		}
 	}
 
+	bool Routine::isOptimized() const
+	{
+		return optimized;
+	}
+
+	void Routine::setOptimized(bool optimized)
+	{
+		this->optimized = optimized;
+	}
+
+	int Routine::use()
+	{
+		return atomicIncrement(&useCount);
+	}
+
+	const CompileStatistics &Routine::getCompileStatistics() const
+	{
+		return statistics;
+	}
+
+	void Routine::setCompileStatistics(const CompileStatistics &statistics)
+	{
+		this->statistics = statistics;
+	}
+
 	Routine::~Routine()
 	{
 		assert(bindCount == 0);
@@ -17,6 +17,16 @@
 
 namespace sw
 {
+	// Cost of compiling a routine, recorded when the routine is acquired
+	struct CompileStatistics
+	{
+		int instructions;      // Reactor IR instructions, before optimization
+		double buildTime;      // Seconds spent generating the IR
+		double optimizeTime;   // Running the optimization passes
+		double emitTime;       // Generating machine code
+		int codeSize;          // Bytes of machine code
+	};
+
 	class Routine
 	{
 	public:
@@ -30,8 +40,19 @@ namespace sw
 		void bind();
 		void unbind();
 
+		// Tiered compilation
+		bool isOptimized() const;
+		void setOptimized(bool optimized);
+		int use();   // Returns the number of invocations so far
+
+		const CompileStatistics &getCompileStatistics() const;
+		void setCompileStatistics(const CompileStatistics &statistics);
+
 	private:
 		volatile int bindCount;
+		volatile int useCount;
+		bool optimized;
+		CompileStatistics statistics;
 	};
 }
 
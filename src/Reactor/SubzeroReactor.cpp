@@ -18,6 +18,7 @@
 #include "Routine.hpp"
 
 #include "Optimizer.hpp"
+#include "../Common/Memory.hpp"
 
 #include "src/IceTypes.h"
 #include "src/IceCfg.h"
@@ -30,22 +31,8 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_os_ostream.h"
 
-#if defined(_WIN32)
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif // !WIN32_LEAN_AND_MEAN
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif // !NOMINMAX
-#include <Windows.h>
-#else
-#include <sys/mman.h>
-#if !defined(MAP_ANONYMOUS)
-#define MAP_ANONYMOUS MAP_ANON
-#endif
-#endif
-
 #include <mutex>
+#include <chrono>
 #include <limits>
 #include <iostream>
 #include <cassert>
@@ -60,6 +47,13 @@ namespace
 
 	std::mutex codegenMutex;
 
+	std::chrono::steady_clock::time_point buildStart;   // Of the current routine
+
+	double seconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double>(end - start).count();
+	}
+
 	Ice::ELFFileStreamer *elfFile = nullptr;
 	Ice::Fdstream *out = nullptr;
 }
@@ -174,7 +168,7 @@ namespace sw
 		return &sectionHeader(elfHeader)[index];
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf32_Rel &relocation, const SectionHeader &relocationTable)
+	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf32_Rel &relocation, const SectionHeader &relocationTable, intptr_t executableOffset)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -203,7 +197,7 @@ namespace sw
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset + executableOffset);
 			}
 			else
 			{
@@ -230,7 +224,7 @@ namespace sw
 		return symbolValue;
 	}
 
-	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf64_Rela &relocation, const SectionHeader &relocationTable)
+	static void *relocateSymbol(const ElfHeader *elfHeader, const Elf64_Rela &relocation, const SectionHeader &relocationTable, intptr_t executableOffset)
 	{
 		const SectionHeader *target = elfSection(elfHeader, relocationTable.sh_info);
 
@@ -259,7 +253,7 @@ namespace sw
 			if(section != SHN_UNDEF && section < SHN_LORESERVE)
 			{
 				const SectionHeader *target = elfSection(elfHeader, symbol.st_shndx);
-				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset);
+				symbolValue = reinterpret_cast<void*>((intptr_t)elfHeader + symbol.st_value + target->sh_offset + executableOffset);
 			}
 			else
 			{
@@ -276,7 +270,7 @@ namespace sw
 			*(int64_t*)patchSite = (int64_t)((intptr_t)symbolValue + *(int64_t*)patchSite) + relocation.r_addend;
 			break;
 		case R_X86_64_PC32:
-			*patchSite = (int32_t)((intptr_t)symbolValue + *patchSite - (intptr_t)patchSite) + relocation.r_addend;
+			*patchSite = (int32_t)((intptr_t)symbolValue + *patchSite - ((intptr_t)patchSite + executableOffset)) + relocation.r_addend;
 			break;
 		case R_X86_64_32S:
 			*patchSite = (int32_t)((intptr_t)symbolValue + *patchSite) + relocation.r_addend;
@@ -289,7 +283,8 @@ namespace sw
 		return symbolValue;
 	}
 
-	void *loadImage(uint8_t *const elfImage)
+	// Relocates the image for running at elfImage + executableOffset
+	void *loadImage(uint8_t *const elfImage, intptr_t executableOffset)
 	{
 		ElfHeader *elfHeader = (ElfHeader*)elfImage;
 
@@ -311,7 +306,7 @@ namespace sw
 			{
 				if(sectionHeader[i].sh_flags & SHF_EXECINSTR)
 				{
-					entry = elfImage + sectionHeader[i].sh_offset;
+					entry = elfImage + sectionHeader[i].sh_offset + executableOffset;
 				}
 			}
 			else if(sectionHeader[i].sh_type == SHT_REL)
@@ -321,7 +316,7 @@ namespace sw
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf32_Rel &relocation = ((const Elf32_Rel*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, relocation, sectionHeader[i], executableOffset);
 				}
 			}
 			else if(sectionHeader[i].sh_type == SHT_RELA)
@@ -331,7 +326,7 @@ namespace sw
 				for(Elf32_Word index = 0; index < sectionHeader[i].sh_size / sectionHeader[i].sh_entsize; index++)
 				{
 					const Elf64_Rela &relocation = ((const Elf64_Rela*)(elfImage + sectionHeader[i].sh_offset))[index];
-					relocateSymbol(elfHeader, relocation, sectionHeader[i]);
+					relocateSymbol(elfHeader, relocation, sectionHeader[i], executableOffset);
 				}
 			}
 		}
@@ -339,41 +334,13 @@ namespace sw
 		return entry;
 	}
 
-	template<typename T>
-	struct ExecutableAllocator
-	{
-		ExecutableAllocator() {};
-		template<class U> ExecutableAllocator(const ExecutableAllocator<U> &other) {};
-
-		using value_type = T;
-		using size_type = std::size_t;
-
-		T *allocate(size_type n)
-		{
-			#if defined(_WIN32)
-				return (T*)VirtualAlloc(NULL, sizeof(T) * n, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-			#else
-				return (T*)mmap(nullptr, sizeof(T) * n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-			#endif
-		}
-
-		void deallocate(T *p, size_type n)
-		{
-			#if defined(_WIN32)
-				VirtualFree(p, 0, MEM_RELEASE);
-			#else
-				munmap(p, sizeof(T) * n);
-			#endif
-		}
-	};
-
 	class ELFMemoryStreamer : public Ice::ELFStreamer, public Routine
 	{
 		ELFMemoryStreamer(const ELFMemoryStreamer &) = delete;
 		ELFMemoryStreamer &operator=(const ELFMemoryStreamer &) = delete;
 
 	public:
-		ELFMemoryStreamer() : Routine(), entry(nullptr)
+		ELFMemoryStreamer() : Routine(), entry(nullptr), image(nullptr)
 		{
 			position = 0;
 			buffer.reserve(0x1000);
@@ -381,13 +348,7 @@ namespace sw
 
 		virtual ~ELFMemoryStreamer()
 		{
-			#if defined(_WIN32)
-				if(buffer.size() != 0)
-				{
-					DWORD exeProtection;
-					VirtualProtect(&buffer[0], buffer.size(), oldProtection, &exeProtection);
-				}
-			#endif
+			deallocateExecutable(image);
 		}
 
 		void write8(uint8_t Value) override
@@ -421,15 +382,16 @@ namespace sw
 		{
 			if(!entry)
 			{
-				#if defined(_WIN32)
-					VirtualProtect(&buffer[0], buffer.size(), PAGE_EXECUTE_READWRITE, &oldProtection);
-				#else
-					mprotect(&buffer[0], buffer.size(), PROT_READ | PROT_WRITE | PROT_EXEC);
-				#endif
-
 				position = std::numeric_limits<std::size_t>::max();   // Can't stream more data after this
 
-				entry = loadImage(&buffer[0]);
+				// The image is copied into the executable arena and relocated for its executable address
+				image = (uint8_t*)allocateExecutable(buffer.size());
+				memcpy(image, &buffer[0], buffer.size());
+
+				entry = loadImage(image, (intptr_t)executableAddress(image) - (intptr_t)image);
+				markExecutable(image);
+
+				std::vector<uint8_t>().swap(buffer);
 			}
 
 			return entry;
@@ -437,18 +399,17 @@ namespace sw
 
 	private:
 		void *entry;
-		std::vector<uint8_t, ExecutableAllocator<uint8_t>> buffer;
+		uint8_t *image;   // Writable address of the loaded image
+		std::vector<uint8_t> buffer;
 		std::size_t position;
-
-		#if defined(_WIN32)
-		DWORD oldProtection;
-		#endif
 	};
 
 	Nucleus::Nucleus()
 	{
 		::codegenMutex.lock();   // Reactor is currently not thread safe
 
+		::buildStart = std::chrono::steady_clock::now();
+
 		Ice::ClFlags &Flags = Ice::ClFlags::Flags;
 		Ice::ClFlags::getParsedClFlags(Flags);
 
@@ -500,7 +461,26 @@ namespace sw
 		std::string asciiName(wideName.begin(), wideName.end());
 		::function->setFunctionName(Ice::GlobalString::createWithString(::context, asciiName));
 
-		optimize();
+		CompileStatistics statistics = {};
+		auto optimizeStart = std::chrono::steady_clock::now();
+		statistics.buildTime = seconds(::buildStart, optimizeStart);
+
+		for(Ice::CfgNode *node : ::function->getNodes())
+		{
+			statistics.instructions += (int)(node->getPhis().size() + node->getInsts().size());
+		}
+
+		if(runOptimizations)
+		{
+			optimize();
+		}
+		else
+		{
+			Ice::ClFlags::Flags.setOptLevel(Ice::Opt_m1);   // Reset to Opt_2 by the next Nucleus
+		}
+
+		auto emitStart = std::chrono::steady_clock::now();
+		statistics.optimizeTime = seconds(optimizeStart, emitStart);
 
 		::function->translate();
 		assert(!::function->hasError());
@@ -517,6 +497,7 @@ namespace sw
 		auto assembler = ::function->releaseAssembler();
 		auto objectWriter = ::context->getObjectWriter();
 		assembler->alignFunction();
+		statistics.codeSize = (int)assembler->getBufferSize();
 		objectWriter->writeFunctionCode(::function->getFunctionName(), false, assembler.get());
 		::context->lowerGlobals("last");
 		::context->lowerConstants();
@@ -524,6 +505,14 @@ namespace sw
 		objectWriter->setUndefinedSyms(::context->getConstantExternSyms());
 		objectWriter->writeNonUserSections();
 
+		statistics.emitTime = seconds(emitStart, std::chrono::steady_clock::now());
+
+		if(::routine)
+		{
+			::routine->setOptimized(runOptimizations);
+			::routine->setCompileStatistics(statistics);
+		}
+
 		return ::routine;
 	}
 
@@ -14,7 +14,9 @@
 
 #include "Blitter.hpp"
 
+#include "CompileLog.hpp"
 #include "Common/Debug.hpp"
+#include "Common/Trace.hpp"
 #include "Reactor/Reactor.hpp"
 
 namespace sw
@@ -41,6 +43,92 @@ namespace sw
 	}
 
 	void Blitter::blit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil)
+	{
+		blit(source, sRect, dest, dRect, blitOptions(filter, isStencil));
+	}
+
+	Blitter::Operation *Blitter::prepareClear(void* pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask)
+	{
+		if(dest->getInternalFormat() == FORMAT_NULL)
+		{
+			return nullptr;
+		}
+
+		int bytes = sw::Surface::bytes(format);
+		ASSERT(bytes <= (int)sizeof(Operation::pixel));
+
+		Operation *operation = new Operation;
+		memcpy(operation->pixel, pixel, bytes);   // The caller's color may not outlive the operation
+		operation->color = new sw::Surface(1, 1, 1, format, operation->pixel, bytes, bytes);
+
+		Blitter::Options clearOptions = static_cast<sw::Blitter::Options>((rgbaMask & 0xF) | CLEAR_OPERATION);
+		SliceRect sRect(dRect);
+		sRect.slice = 0;
+
+		if(!prepare(*operation, operation->color, sRect, dest, dRect, clearOptions, PRIVATE, MANAGED))
+		{
+			delete operation->color;
+			delete operation;
+
+			return nullptr;
+		}
+
+		return operation;
+	}
+
+	Blitter::Operation *Blitter::prepareBlit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil)
+	{
+		if(dest->getInternalFormat() == FORMAT_NULL)
+		{
+			return nullptr;
+		}
+
+		Operation *operation = new Operation;
+		operation->color = nullptr;
+
+		if(!prepare(*operation, source, sRect, dest, dRect, blitOptions(filter, isStencil), PRIVATE, MANAGED))
+		{
+			delete operation;
+
+			return nullptr;
+		}
+
+		return operation;
+	}
+
+	void Blitter::execute(const Operation *operation, int band, int bandCount)
+	{
+		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))operation->routine->getEntry();
+
+		const BlitData &data = operation->data;
+		BlitData rows = data;
+
+		// Bands interleave pairs of rows the same way pixel clusters do, so each
+		// worker only touches rows it also owns while rendering draw calls.
+		int firstPair = data.y0d >> 1;
+		int pair = firstPair + ((band - firstPair) & (bandCount - 1));
+
+		for(int y = 2 * pair; y < data.y1d; y += 2 * bandCount)
+		{
+			rows.y0d = max(y, data.y0d);
+			rows.y1d = min(y + 2, data.y1d);
+			rows.y0 = data.y0 + (rows.y0d - data.y0d) * data.h;
+
+			blitFunction(&rows);
+		}
+	}
+
+	void Blitter::finish(Operation *operation)
+	{
+		unlock(*operation);
+
+		operation->routine->unbind();
+
+		delete operation->color;
+		delete operation;
+	}
+
+	Blitter::Options Blitter::blitOptions(bool filter, bool isStencil)
 	{
 		Blitter::Options options = WRITE_RGBA;
 		if(filter)
@@ -51,11 +139,13 @@ namespace sw
 		{
 			options = static_cast<Blitter::Options>(options | USE_STENCIL);
 		}
-		blit(source, sRect, dest, dRect, options);
+		return options;
 	}
 
 	void Blitter::blit(Surface *source, const SliceRect &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options& options)
 	{
+		TraceSpan span("Blit", "blit");
+
 		if(dest->getInternalFormat() == FORMAT_NULL)
 		{
 			return;
@@ -83,8 +173,9 @@ namespace sw
 			swap(sRect.y0, sRect.y1);
 		}
 
+		// Reference implementation, for formats without routine support
 		source->lockInternal(sRect.x0, sRect.y0, sRect.slice, sw::LOCK_READONLY, sw::PUBLIC);
-		dest->lockInternal(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC);
+		dest->lockInternal(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, Region(dRect.x0, dRect.y0, dRect.slice, dRect.x1, dRect.y1, dRect.slice + 1));
 
 		float w = static_cast<float>(sRect.x1 - sRect.x0) / static_cast<float>(dRect.x1 - dRect.x0);
 		float h = static_cast<float>(sRect.y1 - sRect.y0) / static_cast<float>(dRect.y1 - dRect.y0);
@@ -113,6 +204,12 @@ namespace sw
 
 	void Blitter::blit3D(Surface *source, Surface *dest)
 	{
+		if(blit3DReactor(source, dest))
+		{
+			return;
+		}
+
+		// Reference implementation, for formats without routine support
 		source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
 		dest->lockInternal(0, 0, 0, sw::LOCK_WRITEONLY, sw::PUBLIC);
 
@@ -332,6 +429,172 @@ namespace sw
 		case FORMAT_S8:
 			c.x = Float(Int(*Pointer<Byte>(element)));
 			break;
+		case FORMAT_R3G3B2:
+			{
+				Int rgb = Int(*Pointer<Byte>(element));
+				c.x = Float((rgb >> 5) & Int(0x07));
+				c.y = Float((rgb >> 2) & Int(0x07));
+				c.z = Float(rgb & Int(0x03));
+			}
+			break;
+		case FORMAT_A8R3G3B2:
+			{
+				Int argb = Int(*Pointer<UShort>(element));
+				c.x = Float((argb >> 5) & Int(0x07));
+				c.y = Float((argb >> 2) & Int(0x07));
+				c.z = Float(argb & Int(0x03));
+				c.w = Float(argb >> 8);
+			}
+			break;
+		case FORMAT_X4R4G4B4:
+		case FORMAT_A4R4G4B4:
+			{
+				Int argb = Int(*Pointer<UShort>(element));
+				c.x = Float((argb >> 8) & Int(0x0F));
+				c.y = Float((argb >> 4) & Int(0x0F));
+				c.z = Float(argb & Int(0x0F));
+				c.w = (format == FORMAT_A4R4G4B4) ? Float(argb >> 12) : Float(float(0x0F));
+			}
+			break;
+		case FORMAT_R4G4B4A4:
+			{
+				Int rgba = Int(*Pointer<UShort>(element));
+				c.x = Float(rgba >> 12);
+				c.y = Float((rgba >> 8) & Int(0x0F));
+				c.z = Float((rgba >> 4) & Int(0x0F));
+				c.w = Float(rgba & Int(0x0F));
+			}
+			break;
+		case FORMAT_X1R5G5B5:
+		case FORMAT_A1R5G5B5:
+			{
+				Int argb = Int(*Pointer<UShort>(element));
+				c.x = Float((argb >> 10) & Int(0x1F));
+				c.y = Float((argb >> 5) & Int(0x1F));
+				c.z = Float(argb & Int(0x1F));
+				c.w = (format == FORMAT_A1R5G5B5) ? Float(argb >> 15) : Float(1.0f);
+			}
+			break;
+		case FORMAT_R5G5B5A1:
+			{
+				Int rgba = Int(*Pointer<UShort>(element));
+				c.x = Float(rgba >> 11);
+				c.y = Float((rgba >> 6) & Int(0x1F));
+				c.z = Float((rgba >> 1) & Int(0x1F));
+				c.w = Float(rgba & Int(0x01));
+			}
+			break;
+		case FORMAT_A2R10G10B10:
+			c.x = Float(Int((*Pointer<UInt>(element) & UInt(0x3FF00000)) >> 20));
+			c.y = Float(Int((*Pointer<UInt>(element) & UInt(0x000FFC00)) >> 10));
+			c.z = Float(Int((*Pointer<UInt>(element) & UInt(0x000003FF))));
+			c.w = Float(Int((*Pointer<UInt>(element) & UInt(0xC0000000)) >> 30));
+			break;
+		case FORMAT_L16:
+			c.xyz = Float(Int(*Pointer<UShort>(element)));
+			c.w = float(0xFFFF);
+			break;
+		case FORMAT_A8L8:
+			c.xyz = Float(Int(*Pointer<Byte>(element + 0)));
+			c.w = Float(Int(*Pointer<Byte>(element + 1)));
+			break;
+		case FORMAT_A4L4:
+			{
+				Int al = Int(*Pointer<Byte>(element));
+				c.xyz = Float(al & Int(0x0F));
+				c.w = Float(al >> 4);
+			}
+			break;
+		case FORMAT_R16F:
+			c.x = Extract(halfToFloat(Int4(Int(*Pointer<UShort>(element)))), 0);
+			break;
+		case FORMAT_A16F:
+			c.w = Extract(halfToFloat(Int4(Int(*Pointer<UShort>(element)))), 0);
+			break;
+		case FORMAT_L16F:
+			c.xyz = Extract(halfToFloat(Int4(Int(*Pointer<UShort>(element)))), 0);
+			break;
+		case FORMAT_G16R16F:
+		case FORMAT_A16L16F:
+			{
+				Int4 halves = Int4(Int(*Pointer<UShort>(element + 0)));
+				halves = Insert(halves, Int(*Pointer<UShort>(element + 2)), 1);
+				Float4 f = halfToFloat(halves);
+
+				if(format == FORMAT_G16R16F)
+				{
+					c.x = Float(f.x);
+					c.y = Float(f.y);
+				}
+				else
+				{
+					c.xyz = Float(f.x);
+					c.w = Float(f.y);
+				}
+			}
+			break;
+		case FORMAT_B16G16R16F:
+			{
+				Int4 halves = Int4(Int(*Pointer<UShort>(element + 0)));
+				halves = Insert(halves, Int(*Pointer<UShort>(element + 2)), 1);
+				halves = Insert(halves, Int(*Pointer<UShort>(element + 4)), 2);
+				c.xyz = halfToFloat(halves);
+			}
+			break;
+		case FORMAT_A16B16G16R16F:
+			c = halfToFloat(Int4(*Pointer<UShort4>(element)));
+			break;
+		case FORMAT_A32F:
+			c.w = *Pointer<Float>(element);
+			break;
+		case FORMAT_L32F:
+			c.xyz = *Pointer<Float>(element);
+			break;
+		case FORMAT_A32L32F:
+			c.xyz = *Pointer<Float>(element + 0);
+			c.w = *Pointer<Float>(element + 4);
+			break;
+		case FORMAT_V8U8:
+			c.x = Float(Int(*Pointer<SByte>(element + 0)));
+			c.y = Float(Int(*Pointer<SByte>(element + 1)));
+			break;
+		case FORMAT_Q8W8V8U8:
+			c = Float4(*Pointer<SByte4>(element));
+			break;
+		case FORMAT_X8L8V8U8:
+			c.x = Float(Int(*Pointer<SByte>(element + 0)));
+			c.y = Float(Int(*Pointer<SByte>(element + 1)));
+			c.z = Float(Int(*Pointer<Byte>(element + 2)));
+			c.w = float(0xFF);
+			break;
+		case FORMAT_L6V5U5:
+			{
+				Int lvu = Int(*Pointer<UShort>(element));
+				c.x = Float((lvu << 27) >> 27);   // Sign extend
+				c.y = Float((lvu << 22) >> 27);
+				c.z = Float(lvu >> 10);
+			}
+			break;
+		case FORMAT_V16U16:
+			c.x = Float(Int(*Pointer<Short>(element + 0)));
+			c.y = Float(Int(*Pointer<Short>(element + 2)));
+			break;
+		case FORMAT_A2W10V10U10:
+			{
+				Int awvu = As<Int>(*Pointer<UInt>(element));
+				c.x = Float((awvu << 22) >> 22);   // Sign extend
+				c.y = Float((awvu << 12) >> 22);
+				c.z = Float((awvu << 2) >> 22);
+				c.w = Float(Int((*Pointer<UInt>(element) & UInt(0xC0000000)) >> 30));
+			}
+			break;
+		case FORMAT_A16W16V16U16:
+			c = Float4(*Pointer<Short4>(element));
+			c.w = Float(Int(*Pointer<UShort>(element + 6)));
+			break;
+		case FORMAT_Q16W16V16U16:
+			c = Float4(*Pointer<Short4>(element));
+			break;
 		default:
 			return false;
 		}
@@ -699,12 +962,247 @@ namespace sw
 		case FORMAT_S8:
 			*Pointer<Byte>(element) = Byte(RoundInt(Float(c.x)));
 			break;
+		case FORMAT_R3G3B2:
+			{
+				const int shift[4] = {5, 2, 0, 0};
+				const int bits[4] = {3, 3, 2, 0};
+				writePacked(c, element, 1, shift, bits, 0x00, options);
+			}
+			break;
+		case FORMAT_A8R3G3B2:
+			{
+				const int shift[4] = {5, 2, 0, 8};
+				const int bits[4] = {3, 3, 2, 8};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_X4R4G4B4:
+			{
+				const int shift[4] = {8, 4, 0, 0};
+				const int bits[4] = {4, 4, 4, 0};
+				writePacked(c, element, 2, shift, bits, 0xF000, options);
+			}
+			break;
+		case FORMAT_A4R4G4B4:
+			{
+				const int shift[4] = {8, 4, 0, 12};
+				const int bits[4] = {4, 4, 4, 4};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_R4G4B4A4:
+			{
+				const int shift[4] = {12, 8, 4, 0};
+				const int bits[4] = {4, 4, 4, 4};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_X1R5G5B5:
+			{
+				const int shift[4] = {10, 5, 0, 0};
+				const int bits[4] = {5, 5, 5, 0};
+				writePacked(c, element, 2, shift, bits, 0x8000, options);
+			}
+			break;
+		case FORMAT_A1R5G5B5:
+			{
+				const int shift[4] = {10, 5, 0, 15};
+				const int bits[4] = {5, 5, 5, 1};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_R5G5B5A1:
+			{
+				const int shift[4] = {11, 6, 1, 0};
+				const int bits[4] = {5, 5, 5, 1};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_A2R10G10B10:
+			{
+				const int shift[4] = {20, 10, 0, 30};
+				const int bits[4] = {10, 10, 10, 2};
+				writePacked(c, element, 4, shift, bits, 0x00000000, options);
+			}
+			break;
+		case FORMAT_A4L4:
+			{
+				const int shift[4] = {0, 0, 0, 4};
+				const int bits[4] = {4, 0, 0, 4};
+				writePacked(c, element, 1, shift, bits, 0x00, options);
+			}
+			break;
+		case FORMAT_L6V5U5:
+			{
+				const int shift[4] = {0, 5, 10, 0};
+				const int bits[4] = {5, 5, 6, 0};
+				writePacked(c, element, 2, shift, bits, 0x0000, options);
+			}
+			break;
+		case FORMAT_A2W10V10U10:
+			{
+				const int shift[4] = {0, 10, 20, 30};
+				const int bits[4] = {10, 10, 10, 2};
+				writePacked(c, element, 4, shift, bits, 0x00000000, options);
+			}
+			break;
+		case FORMAT_L16:
+			if(writeR) { *Pointer<UShort>(element) = UShort(RoundInt(Float(c.x))); }
+			break;
+		case FORMAT_A8L8:
+			if(writeR) { *Pointer<Byte>(element + 0) = Byte(RoundInt(Float(c.x))); }
+			if(writeA) { *Pointer<Byte>(element + 1) = Byte(RoundInt(Float(c.w))); }
+			break;
+		case FORMAT_R16F:
+		case FORMAT_L16F:
+			if(writeR) { *Pointer<UShort>(element) = UShort(Extract(floatToHalf(c), 0)); }
+			break;
+		case FORMAT_A16F:
+			if(writeA) { *Pointer<UShort>(element) = UShort(Extract(floatToHalf(c), 3)); }
+			break;
+		case FORMAT_A16L16F:
+			{
+				Int4 halves = floatToHalf(c);
+				if(writeR) { *Pointer<UShort>(element + 0) = UShort(Extract(halves, 0)); }
+				if(writeA) { *Pointer<UShort>(element + 2) = UShort(Extract(halves, 3)); }
+			}
+			break;
+		case FORMAT_G16R16F:
+		case FORMAT_B16G16R16F:
+		case FORMAT_A16B16G16R16F:
+			{
+				Int4 halves = floatToHalf(c);
+
+				if(writeRGBA && format == FORMAT_A16B16G16R16F)
+				{
+					*Pointer<UShort4>(element) = UShort4(halves);
+				}
+				else
+				{
+					if(writeR) { *Pointer<UShort>(element + 0) = UShort(Extract(halves, 0)); }
+					if(writeG) { *Pointer<UShort>(element + 2) = UShort(Extract(halves, 1)); }
+					if(writeB && format != FORMAT_G16R16F) { *Pointer<UShort>(element + 4) = UShort(Extract(halves, 2)); }
+					if(writeA && format == FORMAT_A16B16G16R16F) { *Pointer<UShort>(element + 6) = UShort(Extract(halves, 3)); }
+				}
+			}
+			break;
+		case FORMAT_A32F:
+			if(writeA) { *Pointer<Float>(element) = c.w; }
+			break;
+		case FORMAT_L32F:
+			if(writeR) { *Pointer<Float>(element) = c.x; }
+			break;
+		case FORMAT_A32L32F:
+			if(writeR) { *Pointer<Float>(element + 0) = c.x; }
+			if(writeA) { *Pointer<Float>(element + 4) = c.w; }
+			break;
+		case FORMAT_Q8W8V8U8:
+			if(writeA) { *Pointer<SByte>(element + 3) = SByte(RoundInt(Float(c.w))); }
+			if(writeB) { *Pointer<SByte>(element + 2) = SByte(RoundInt(Float(c.z))); }
+		case FORMAT_V8U8:
+			if(writeG) { *Pointer<SByte>(element + 1) = SByte(RoundInt(Float(c.y))); }
+			if(writeR) { *Pointer<SByte>(element + 0) = SByte(RoundInt(Float(c.x))); }
+			break;
+		case FORMAT_X8L8V8U8:
+			if(writeR) { *Pointer<SByte>(element + 0) = SByte(RoundInt(Float(c.x))); }
+			if(writeG) { *Pointer<SByte>(element + 1) = SByte(RoundInt(Float(c.y))); }
+			if(writeB) { *Pointer<Byte>(element + 2) = Byte(RoundInt(Float(c.z))); }
+			if(writeA) { *Pointer<Byte>(element + 3) = Byte(0xFF); }
+			break;
+		case FORMAT_A16W16V16U16:
+			if(writeA) { *Pointer<UShort>(element + 6) = UShort(RoundInt(Float(c.w))); }
+			if(writeB) { *Pointer<Short>(element + 4) = Short(RoundInt(Float(c.z))); }
+			if(writeG) { *Pointer<Short>(element + 2) = Short(RoundInt(Float(c.y))); }
+			if(writeR) { *Pointer<Short>(element + 0) = Short(RoundInt(Float(c.x))); }
+			break;
+		case FORMAT_Q16W16V16U16:
+			if(writeA) { *Pointer<Short>(element + 6) = Short(RoundInt(Float(c.w))); }
+			if(writeB) { *Pointer<Short>(element + 4) = Short(RoundInt(Float(c.z))); }
+		case FORMAT_V16U16:
+			if(writeG) { *Pointer<Short>(element + 2) = Short(RoundInt(Float(c.y))); }
+			if(writeR) { *Pointer<Short>(element + 0) = Short(RoundInt(Float(c.x))); }
+			break;
 		default:
 			return false;
 		}
 		return true;
 	}
 
+	void Blitter::writePacked(Float4 &c, Pointer<Byte> element, int bytes, const int shift[4], const int bits[4], unsigned int ones, const Blitter::Options& options)
+	{
+		const bool write[4] =
+		{
+			(options & WRITE_RED) == WRITE_RED,
+			(options & WRITE_GREEN) == WRITE_GREEN,
+			(options & WRITE_BLUE) == WRITE_BLUE,
+			(options & WRITE_ALPHA) == WRITE_ALPHA,
+		};
+
+		Int packed = Int(ones);
+		unsigned int mask = ones;   // Bits to be written
+		unsigned int used = ones;   // Bits occupied by the format
+
+		for(int i = 0; i < 4; i++)
+		{
+			unsigned int field = ((1u << bits[i]) - 1) << shift[i];
+			used |= field;
+
+			if(bits[i] && write[i])
+			{
+				packed = packed | ((RoundInt(Extract(c, i)) << shift[i]) & Int(field));
+				mask |= field;
+			}
+		}
+
+		switch(bytes)
+		{
+		case 1:
+			if(mask != used) { packed = (Int(*Pointer<Byte>(element)) & Int(~mask)) | packed; }
+			*Pointer<Byte>(element) = Byte(packed);
+			break;
+		case 2:
+			if(mask != used) { packed = (Int(*Pointer<UShort>(element)) & Int(~mask)) | packed; }
+			*Pointer<UShort>(element) = UShort(packed);
+			break;
+		case 4:
+			if(mask != used) { packed = (As<Int>(*Pointer<UInt>(element)) & Int(~mask)) | packed; }
+			*Pointer<UInt>(element) = As<UInt>(packed);
+			break;
+		default:
+			ASSERT(false);
+		}
+	}
+
+	Float4 Blitter::halfToFloat(RValue<Int4> halves)
+	{
+		// Shifting the exponent and mantissa into place and rescaling handles denormals,
+		// infinities and NaNs get their exponent saturated afterwards.
+		Int4 magnitude = halves & Int4(0x7FFF);
+		Int4 sign = (halves & Int4(0x8000)) << 16;
+		Int4 infNaN = CmpNLT(magnitude, Int4(0x7C00)) & Int4(0x7F800000);
+
+		Float4 f = As<Float4>(magnitude << 13) * Float4(5.192296858534828e+33f);   // 2^(127 - 15)
+
+		return As<Float4>(As<Int4>(f) | infNaN | sign);
+	}
+
+	Int4 Blitter::floatToHalf(RValue<Float4> floats)
+	{
+		Int4 bits = As<Int4>(floats);
+		Int4 sign = (bits >> 16) & Int4(0x8000);
+		Int4 magnitude = bits & Int4(0x7FFFFFFF);
+
+		// Clamp finite values to the largest half, then rebias the exponent and round
+		Float4 f = As<Float4>(Min(magnitude, Int4(0x477FE000))) * Float4(1.925929944387236e-34f);   // 2^(15 - 127)
+		Int4 half = (As<Int4>(f) + Int4(0x1000)) >> 13;
+
+		Int4 infNaN = CmpNLT(magnitude, Int4(0x7F800000));
+		Int4 nan = CmpNLE(magnitude, Int4(0x7F800000));
+		half = (half & ~infNaN) | (infNaN & Int4(0x7C00)) | (nan & Int4(0x0200));
+
+		return half | sign;
+	}
+
 	bool Blitter::read(Int4 &c, Pointer<Byte> element, Format format)
 	{
 		c = Int4(0, 0, 0, 1);
@@ -989,8 +1487,64 @@ namespace sw
 		case FORMAT_D32FS8_TEXTURE:
 		case FORMAT_D32FS8_SHADOW:
 		case FORMAT_S8:
+		case FORMAT_R16F:
+		case FORMAT_A16F:
+		case FORMAT_L16F:
+		case FORMAT_G16R16F:
+		case FORMAT_A16L16F:
+		case FORMAT_B16G16R16F:
+		case FORMAT_A16B16G16R16F:
+		case FORMAT_A32F:
+		case FORMAT_L32F:
+		case FORMAT_A32L32F:
 			scale = vector(1.0f, 1.0f, 1.0f, 1.0f);
 			break;
+		case FORMAT_R3G3B2:
+			scale = vector(0x07, 0x07, 0x03, 1.0f);
+			break;
+		case FORMAT_A8R3G3B2:
+			scale = vector(0x07, 0x07, 0x03, 0xFF);
+			break;
+		case FORMAT_X4R4G4B4:
+		case FORMAT_A4R4G4B4:
+		case FORMAT_R4G4B4A4:
+		case FORMAT_A4L4:
+			scale = vector(0x0F, 0x0F, 0x0F, 0x0F);
+			break;
+		case FORMAT_X1R5G5B5:
+		case FORMAT_A1R5G5B5:
+		case FORMAT_R5G5B5A1:
+			scale = vector(0x1F, 0x1F, 0x1F, 0x01);
+			break;
+		case FORMAT_A2R10G10B10:
+			scale = vector(0x3FF, 0x3FF, 0x3FF, 0x03);
+			break;
+		case FORMAT_L16:
+			scale = vector(0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF);
+			break;
+		case FORMAT_A8L8:
+			scale = vector(0xFF, 0xFF, 0xFF, 0xFF);
+			break;
+		case FORMAT_V8U8:
+		case FORMAT_Q8W8V8U8:
+			scale = vector(0x7F, 0x7F, 0x7F, 0x7F);
+			break;
+		case FORMAT_X8L8V8U8:
+			scale = vector(0x7F, 0x7F, 0xFF, 0xFF);
+			break;
+		case FORMAT_L6V5U5:
+			scale = vector(0x0F, 0x0F, 0x3F, 1.0f);
+			break;
+		case FORMAT_V16U16:
+		case FORMAT_Q16W16V16U16:
+			scale = vector(0x7FFF, 0x7FFF, 0x7FFF, 0x7FFF);
+			break;
+		case FORMAT_A16W16V16U16:
+			scale = vector(0x7FFF, 0x7FFF, 0x7FFF, 0xFFFF);
+			break;
+		case FORMAT_A2W10V10U10:
+			scale = vector(0x1FF, 0x1FF, 0x1FF, 0x03);
+			break;
 		default:
 			return false;
 		}
@@ -1055,6 +1609,8 @@ namespace sw
 
 	Routine *Blitter::generate(BlitState &state)
 	{
+		TraceSpan span("Compile blit routine", "jit");
+
 		Function<Void(Pointer<Byte>)> function;
 		{
 			Pointer<Byte> blit(function.Arg<0>());
@@ -1077,6 +1633,9 @@ namespace sw
 			Int sWidth = *Pointer<Int>(blit + OFFSET(BlitData,sWidth));
 			Int sHeight = *Pointer<Int>(blit + OFFSET(BlitData,sHeight));
 
+			Int slice1B = *Pointer<Int>(blit + OFFSET(BlitData,slice1B));
+			Float4 fz = Float4(*Pointer<Float>(blit + OFFSET(BlitData,fz)));
+
 			bool intSrc = Surface::isNonNormalizedInteger(state.sourceFormat);
 			bool intDst = Surface::isNonNormalizedInteger(state.destFormat);
 			bool intBoth = intSrc && intDst;
@@ -1200,6 +1759,21 @@ namespace sw
 							        c01 * fx * (Float4(1.0f) - fy) +
 							        c10 * (Float4(1.0f) - fx) * fy +
 							        c11 * fx * fy;
+
+							if(state.options & FILTER_SLICES)
+							{
+								Float4 d00; if(!read(d00, s00 + slice1B, state.sourceFormat)) return nullptr;
+								Float4 d01; if(!read(d01, s01 + slice1B, state.sourceFormat)) return nullptr;
+								Float4 d10; if(!read(d10, s10 + slice1B, state.sourceFormat)) return nullptr;
+								Float4 d11; if(!read(d11, s11 + slice1B, state.sourceFormat)) return nullptr;
+
+								Float4 color1 = d00 * (Float4(1.0f) - fx) * (Float4(1.0f) - fy) +
+								                d01 * fx * (Float4(1.0f) - fy) +
+								                d10 * (Float4(1.0f) - fx) * fy +
+								                d11 * fx * fy;
+
+								color = color + (color1 - color) * fz;
+							}
 						}
 
 						if(!ApplyScaleAndClamp(color, state) || !write(color, d, state.destFormat, state.options))
@@ -1215,10 +1789,149 @@ namespace sw
 			}
 		}
 
-		return function(L"BlitRoutine");
+		Routine *routine = function(L"BlitRoutine");
+		CompileLog::add(CompileLog::BLIT, &state, sizeof(BlitState), routine);
+
+		return routine;
 	}
 
 	bool Blitter::blitReactor(Surface *source, const SliceRect &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options& options)
+	{
+		Operation operation;
+
+		if(!prepare(operation, source, sourceRect, dest, destRect, options, sw::PUBLIC, sw::PUBLIC))
+		{
+			return false;
+		}
+
+		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))operation.routine->getEntry();
+
+		blitFunction(&operation.data);
+
+		unlock(operation);
+		operation.routine->unbind();
+
+		return true;
+	}
+
+	bool Blitter::blit3DReactor(Surface *source, Surface *dest)
+	{
+		if(dest->getInternalFormat() == FORMAT_NULL)
+		{
+			return true;
+		}
+
+		BlitState state;
+
+		state.sourceFormat = source->getInternalFormat();
+		state.destFormat = dest->getInternalFormat();
+		state.options = static_cast<Blitter::Options>(WRITE_RGBA | FILTER_LINEAR | FILTER_SLICES);
+
+		// Integer formats aren't filtered by blit routines
+		if(Surface::isNonNormalizedInteger(state.sourceFormat) || Surface::isNonNormalizedInteger(state.destFormat))
+		{
+			return false;
+		}
+
+		Routine *blitRoutine = getRoutine(state);
+
+		if(!blitRoutine)
+		{
+			return false;
+		}
+
+		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
+
+		unsigned char *sourceBase = (unsigned char*)source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+		unsigned char *destBase = (unsigned char*)dest->lockInternal(0, 0, 0, sw::LOCK_DISCARD, sw::PUBLIC);
+
+		int sWidth = source->getWidth();
+		int sHeight = source->getHeight();
+		int sDepth = source->getDepth();
+		int dWidth = dest->getWidth();
+		int dHeight = dest->getHeight();
+		int dDepth = dest->getDepth();
+		int sSliceB = source->getInternalSliceB();
+		int dSliceB = dest->getInternalSliceB();
+
+		BlitData data;
+
+		data.sPitchB = source->getInternalPitchB();
+		data.dPitchB = dest->getInternalPitchB();
+
+		data.w = static_cast<float>(sWidth) / static_cast<float>(dWidth);
+		data.h = static_cast<float>(sHeight) / static_cast<float>(dHeight);
+		data.x0 = 0.5f * data.w;
+		data.y0 = 0.5f * data.h;
+
+		data.x0d = 0;
+		data.x1d = dWidth;
+		data.y0d = 0;
+		data.y1d = dHeight;
+
+		data.sWidth = sWidth;
+		data.sHeight = sHeight;
+
+		float d = static_cast<float>(sDepth) / static_cast<float>(dDepth);
+
+		for(int k = 0; k < dDepth; k++)
+		{
+			float z = (k + 0.5f) * d - 0.5f;
+			int z0 = clamp(static_cast<int>(z), 0, sDepth - 1);
+			int z1 = min(z0 + 1, sDepth - 1);
+
+			data.source = sourceBase + z0 * sSliceB;
+			data.dest = destBase + k * dSliceB;
+			data.slice1B = (z1 - z0) * sSliceB;
+			data.fz = clamp(z - z0, 0.0f, 1.0f);
+
+			blitFunction(&data);
+		}
+
+		source->unlockInternal();
+		dest->unlockInternal();
+		blitRoutine->unbind();
+
+		return true;
+	}
+
+	Routine *Blitter::getRoutine(BlitState &state)
+	{
+		criticalSection.lock();
+		Routine *blitRoutine = blitCache->query(state);
+
+		if(!blitRoutine)
+		{
+			blitRoutine = generate(state);
+
+			if(!blitRoutine)
+			{
+				criticalSection.unlock();
+				return nullptr;
+			}
+
+			blitRoutine = blitCache->add(state, blitRoutine);
+		}
+
+		criticalSection.unlock();   // The routine is kept alive by the returned reference when evicted
+
+		return blitRoutine;
+	}
+
+	Routine *Blitter::compile(const void *state, size_t size)
+	{
+		if(size != sizeof(BlitState))
+		{
+			return nullptr;
+		}
+
+		BlitState blitState;
+		memcpy(&blitState, state, sizeof(BlitState));
+
+		return generate(blitState);
+	}
+
+	bool Blitter::prepare(Operation &operation, Surface *source, const SliceRect &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options& options, Accessor sourceClient, Accessor destClient)
 	{
 		ASSERT(!(options & CLEAR_OPERATION) || ((source->getWidth() == 1) && (source->getHeight() == 1) && (source->getDepth() == 1)));
 
@@ -1245,35 +1958,23 @@ namespace sw
 		state.destFormat = isStencil ? dest->getStencilFormat() : dest->getFormat(useDestInternal);
 		state.options = options;
 
-		criticalSection.lock();
-		Routine *blitRoutine = blitCache->query(state);
+		Routine *blitRoutine = getRoutine(state);
 
 		if(!blitRoutine)
 		{
-			blitRoutine = generate(state);
-
-			if(!blitRoutine)
-			{
-				criticalSection.unlock();
-				return false;
-			}
-
-			blitCache->add(state, blitRoutine);
+			return false;
 		}
 
-		criticalSection.unlock();
-
-		void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
-
-		BlitData data;
+		BlitData &data = operation.data;
 
 		bool isRGBA = ((options & WRITE_RGBA) == WRITE_RGBA);
 		bool isEntireDest = dest->isEntire(destRect);
 
-		data.source = isStencil ? source->lockStencil(0, 0, 0, sw::PUBLIC) :
-		                          source->lock(0, 0, sourceRect.slice, sw::LOCK_READONLY, sw::PUBLIC, useSourceInternal);
-		data.dest = isStencil ? dest->lockStencil(0, 0, 0, sw::PUBLIC) :
-		                        dest->lock(0, 0, destRect.slice, isRGBA ? (isEntireDest ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY) : sw::LOCK_READWRITE, sw::PUBLIC, useDestInternal);
+		data.source = isStencil ? source->lockStencil(0, 0, 0, sourceClient) :
+		                          source->lock(0, 0, sourceRect.slice, sw::LOCK_READONLY, sourceClient, useSourceInternal);
+		data.dest = isStencil ? dest->lockStencil(0, 0, 0, destClient) :
+		                        dest->lock(0, 0, destRect.slice, isRGBA ? (isEntireDest ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY) : sw::LOCK_READWRITE, destClient, useDestInternal,
+		                                   Region(dRect.x0, dRect.y0, destRect.slice, dRect.x1, dRect.y1, destRect.slice + 1));
 		data.sPitchB = isStencil ? source->getStencilPitchB() : source->getPitchB(useSourceInternal);
 		data.dPitchB = isStencil ? dest->getStencilPitchB() : dest->getPitchB(useDestInternal);
 
@@ -1290,19 +1991,30 @@ namespace sw
 		data.sWidth = source->getWidth();
 		data.sHeight = source->getHeight();
 
-		blitFunction(&data);
+		data.slice1B = 0;
+		data.fz = 0.0f;
 
-		if(isStencil)
+		operation.routine = blitRoutine;
+		operation.source = source;
+		operation.dest = dest;
+		operation.useSourceInternal = useSourceInternal;
+		operation.useDestInternal = useDestInternal;
+		operation.isStencil = isStencil;
+
+		return true;
+	}
+
+	void Blitter::unlock(Operation &operation)
+	{
+		if(operation.isStencil)
 		{
-			source->unlockStencil();
-			dest->unlockStencil();
+			operation.source->unlockStencil();
+			operation.dest->unlockStencil();
 		}
 		else
 		{
-			source->unlock(useSourceInternal);
-			dest->unlock(useDestInternal);
+			operation.source->unlock(operation.useSourceInternal);
+			operation.dest->unlock(operation.useDestInternal);
 		}
-
-		return true;
 	}
 }
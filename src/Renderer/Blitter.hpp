@@ -36,6 +36,7 @@ namespace sw
 			FILTER_LINEAR = 0x10,
 			CLEAR_OPERATION = 0x20,
 			USE_STENCIL = 0x40,
+			FILTER_SLICES = 0x80,   // Linear filtering between two source slices
 		};
 
 		struct BlitState
@@ -69,9 +70,28 @@ namespace sw
 
 			int sWidth;
 			int sHeight;
+
+			int slice1B;   // Offset of the second source slice, for FILTER_SLICES
+			float fz;      // Weight of the second source slice
 		};
 
 	public:
+		// Blit or clear with its surfaces locked, executed in row bands by the renderer's worker threads
+		struct Operation
+		{
+			Routine *routine;
+			BlitData data;
+
+			Surface *source;
+			Surface *dest;
+			bool useSourceInternal;
+			bool useDestInternal;
+			bool isStencil;
+
+			Surface *color;   // Single pixel source of clears
+			unsigned char pixel[16];
+		};
+
 		Blitter();
 
 		virtual ~Blitter();
@@ -80,16 +100,34 @@ namespace sw
 		void blit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false);
 		void blit3D(Surface *source, Surface *dest);
 
+		// Deferred operations lock the source for PRIVATE and the destination for MANAGED access.
+		// They return null when no routine can be generated, in which case nothing was locked.
+		Operation *prepareClear(void* pixel, sw::Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask);
+		Operation *prepareBlit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false);
+		static void execute(const Operation *operation, int band, int bandCount);   // Row pairs with index % bandCount == band
+		static void finish(Operation *operation);
+
+		// Generates the routine of a state from a compile log capture. Returns null if it doesn't match this build.
+		Routine *compile(const void *state, size_t size);
+
 	private:
 		bool read(Float4 &color, Pointer<Byte> element, Format format);
 		bool write(Float4 &color, Pointer<Byte> element, Format format, const Blitter::Options& options);
 		bool read(Int4 &color, Pointer<Byte> element, Format format);
 		bool write(Int4 &color, Pointer<Byte> element, Format format, const Blitter::Options& options);
+		static void writePacked(Float4 &color, Pointer<Byte> element, int bytes, const int shift[4], const int bits[4], unsigned int ones, const Blitter::Options& options);
+		static Float4 halfToFloat(RValue<Int4> halves);
+		static Int4 floatToHalf(RValue<Float4> floats);
 		static bool GetScale(float4& scale, Format format);
 		static bool ApplyScaleAndClamp(Float4& value, const BlitState& state);
 		static Int ComputeOffset(Int& x, Int& y, Int& pitchB, int bytes, bool quadLayout);
+		static Blitter::Options blitOptions(bool filter, bool isStencil);
 		void blit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, const Blitter::Options& options);
 		bool blitReactor(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, const Blitter::Options& options);
+		bool blit3DReactor(Surface *source, Surface *dest);
+		bool prepare(Operation &operation, Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, const Blitter::Options& options, Accessor sourceClient, Accessor destClient);
+		static void unlock(Operation &operation);
+		Routine *getRoutine(BlitState &state);   // Returns a bound routine, or null
 		Routine *generate(BlitState &state);
 
 		RoutineCache<BlitState> *blitCache;
@@ -16,6 +16,7 @@
 
 #include "Polygon.hpp"
 #include "Renderer.hpp"
+#include "Metrics.hpp"
 #include "Debug.hpp"
 
 namespace sw
@@ -42,6 +43,20 @@ namespace sw
 
 	bool Clipper::clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw)
 	{
+		DrawData &data = *draw.data;
+
+		if((clipFlagsOr & CLIP_SIDES) && insideGuardBand(polygon, data))
+		{
+			clipFlagsOr &= ~CLIP_SIDES;
+		}
+
+		if(!(clipFlagsOr & (CLIP_FRUSTUM | CLIP_USER)))
+		{
+			return true;
+		}
+
+		Metrics::add(Metrics::PRIMITIVES_CLIPPED);
+
 		if(clipFlagsOr & CLIP_FRUSTUM)
 		{
 			if(clipFlagsOr & CLIP_NEAR)   clipNear(polygon);
@@ -60,8 +75,6 @@ namespace sw
 
 		if(clipFlagsOr & CLIP_USER)
 		{
-			DrawData &data = *draw.data;
-
 			if(polygon.n >= 3) {
 			if(draw.clipFlags & CLIP_PLANE0) clipPlane(polygon, data.clipPlane[0]);
 			if(polygon.n >= 3) {
@@ -346,6 +359,25 @@ namespace sw
 		polygon.i += 1;
 	}
 
+	bool Clipper::insideGuardBand(const Polygon &polygon, const DrawData &data) const
+	{
+		const float4 *const *V = polygon.P[polygon.i];
+
+		for(int i = 0; i < polygon.n; i++)
+		{
+			float x = data.guardBandX * V[i]->w;
+			float y = data.guardBandY * V[i]->w;
+
+			// Also false for negative w, and NaN
+			if(!(V[i]->x <= x && V[i]->x >= -x && V[i]->y <= y && V[i]->y >= -y))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	inline void Clipper::clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const
 	{
 		float D = 1.0f / (dj - di);
@@ -38,6 +38,7 @@ namespace sw
 			CLIP_NEAR   = 1 << 5,
 
 			CLIP_FRUSTUM = 0x003F,
+			CLIP_SIDES   = CLIP_RIGHT | CLIP_TOP | CLIP_LEFT | CLIP_BOTTOM,
 
 			CLIP_FINITE = 1 << 7,   // All position coordinates are finite
 
@@ -52,6 +53,11 @@ namespace sw
 			CLIP_USER = 0x3F00
 		};
 
+		// Primitives which lie within this many pixels of the origin in both directions aren't
+		// clipped against the viewport sides. They're scissored by the rasterizer instead, and
+		// stay within the range of the setup routine's 28.4 fixed-point coordinates.
+		enum {GUARD_BAND = 8192};
+
 		Clipper(bool symmetricNormalizedDepth);
 
 		~Clipper();
@@ -68,6 +74,8 @@ namespace sw
 		void clipBottom(Polygon &polygon);
 		void clipPlane(Polygon &polygon, const Plane &plane);
 
+		bool insideGuardBand(const Polygon &polygon, const DrawData &data) const;
+
 		void clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const;
 
 		float n;   // Near clip plane distance
@@ -0,0 +1,611 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CompileLog.hpp"
+
+#include "Vertex.hpp"
+#include "VertexProcessor.hpp"
+#include "PixelProcessor.hpp"
+#include "Shader/VertexShader.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Common/MutexLock.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sw
+{
+	namespace
+	{
+		BackoffLock mutex;
+		std::vector<CompileLog::Record> ring;   // Wraps around at MAX_RECORDS
+		size_t next = 0;
+		CompileLog::Totals kindTotals[CompileLog::KINDS] = {};
+
+		// Captures hold raw parameter and semantic structures, so they are only readable by a
+		// build with the same layout. The header records the sizes to reject other builds.
+		const char captureMagic[4] = {'S', 'W', 'C', 'L'};
+		const uint32_t captureHeader[] = {1, sizeof(Shader::DestinationParameter), sizeof(Shader::SourceParameter), sizeof(Shader::Semantic)};
+
+		const char *capturePath = getenv("SWIFTSHADER_COMPILE_LOG");
+		FILE *captureFile = nullptr;
+		bool captureOpened = false;
+
+		// Closes the capture when the library is unloaded
+		struct Capture
+		{
+			~Capture()
+			{
+				if(captureFile)
+				{
+					fclose(captureFile);
+					captureFile = nullptr;
+				}
+			}
+		};
+
+		Capture capture;
+
+		class Writer
+		{
+		public:
+			template<class T>
+			void put(const T &value)
+			{
+				const unsigned char *data = reinterpret_cast<const unsigned char*>(&value);
+				bytes.insert(bytes.end(), data, data + sizeof(T));
+			}
+
+			void put(const void *data, size_t size)
+			{
+				bytes.insert(bytes.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+			}
+
+			std::vector<unsigned char> bytes;
+		};
+
+		class Reader
+		{
+		public:
+			Reader(const unsigned char *data, size_t size) : data(data), size(size), offset(0)
+			{
+			}
+
+			template<class T>
+			bool get(T &value)
+			{
+				return get(&value, sizeof(T));
+			}
+
+			bool get(void *value, size_t count)
+			{
+				if(count > size - offset)
+				{
+					return false;
+				}
+
+				memcpy(value, data + offset, count);
+				offset += count;
+
+				return true;
+			}
+
+		private:
+			const unsigned char *data;
+			size_t size;
+			size_t offset;
+		};
+
+		// Gives access to the protected members which can't be set through the public interface
+		template<class ShaderType>
+		class CapturedShader : public ShaderType
+		{
+		public:
+			void restore(unsigned short version, unsigned short usedSamplers)
+			{
+				this->version = version;
+				this->usedSamplers = usedSamplers;
+			}
+		};
+
+		void writeInstructions(Writer &writer, const Shader *shader)
+		{
+			unsigned short usedSamplers = 0;
+
+			for(int i = 0; i < 16; i++)
+			{
+				usedSamplers |= shader->usesSampler(i) ? 1 << i : 0;
+			}
+
+			writer.put(shader->getVersion());
+			writer.put(usedSamplers);
+			writer.put((uint32_t)shader->getLength());
+
+			for(size_t i = 0; i < shader->getLength(); i++)
+			{
+				const Shader::Instruction *instruction = shader->getInstruction(i);
+
+				writer.put(instruction->opcode);
+				writer.put(instruction->control);
+				writer.put(instruction->predicate);
+				writer.put(instruction->predicateNot);
+				writer.put(instruction->predicateSwizzle);
+				writer.put(instruction->coissue);
+				writer.put(instruction->samplerType);
+				writer.put(instruction->usage);
+				writer.put(instruction->usageIndex);
+				writer.put(instruction->dst);
+
+				for(int j = 0; j < 5; j++)
+				{
+					writer.put(instruction->src[j]);
+				}
+
+				writer.put(instruction->analysis);
+			}
+		}
+
+		template<class ShaderType>
+		bool readInstructions(Reader &reader, CapturedShader<ShaderType> &shader)
+		{
+			unsigned short version;
+			unsigned short usedSamplers;
+			uint32_t length;
+
+			if(!reader.get(version) || !reader.get(usedSamplers) || !reader.get(length))
+			{
+				return false;
+			}
+
+			shader.restore(version, usedSamplers);
+
+			for(uint32_t i = 0; i < length; i++)
+			{
+				Shader::Instruction *instruction = new Shader::Instruction(Shader::OPCODE_NOP);
+				shader.append(instruction);   // Deleted by the shader when incomplete
+
+				bool complete = reader.get(instruction->opcode) &&
+				                reader.get(instruction->control) &&
+				                reader.get(instruction->predicate) &&
+				                reader.get(instruction->predicateNot) &&
+				                reader.get(instruction->predicateSwizzle) &&
+				                reader.get(instruction->coissue) &&
+				                reader.get(instruction->samplerType) &&
+				                reader.get(instruction->usage) &&
+				                reader.get(instruction->usageIndex) &&
+				                reader.get(instruction->dst);
+
+				for(int j = 0; j < 5; j++)
+				{
+					complete = complete && reader.get(instruction->src[j]);
+				}
+
+				if(!complete || !reader.get(instruction->analysis))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void writeShader(Writer &writer, CompileLog::Kind kind, const Shader *shader)
+		{
+			writeInstructions(writer, shader);
+
+			if(kind == CompileLog::VERTEX)
+			{
+				const VertexShader *vertexShader = static_cast<const VertexShader*>(shader);
+
+				for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+				{
+					writer.put(vertexShader->getInput(i));
+					writer.put(vertexShader->getAttribType(i));
+				}
+
+				for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+				{
+					for(int c = 0; c < 4; c++)
+					{
+						writer.put(vertexShader->getOutput(i, c));
+					}
+				}
+
+				writer.put(vertexShader->getPositionRegister());
+				writer.put(vertexShader->getPointSizeRegister());
+				writer.put(vertexShader->isInstanceIdDeclared());
+			}
+			else if(kind == CompileLog::PIXEL)
+			{
+				const PixelShader *pixelShader = static_cast<const PixelShader*>(shader);
+
+				for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+				{
+					for(int c = 0; c < 4; c++)
+					{
+						writer.put(pixelShader->getInput(i, c));
+					}
+				}
+
+				writer.put(pixelShader->isVPosDeclared());
+				writer.put(pixelShader->isVFaceDeclared());
+			}
+		}
+
+		// Called with the mutex held
+		void writeCapture(const CompileLog::Record &record, const Shader *shader)
+		{
+			if(!captureOpened)
+			{
+				captureOpened = true;
+
+				if(capturePath && *capturePath)
+				{
+					captureFile = fopen(capturePath, "wb");
+
+					if(captureFile)
+					{
+						fwrite(captureMagic, sizeof(captureMagic), 1, captureFile);
+						fwrite(captureHeader, sizeof(captureHeader), 1, captureFile);
+					}
+					else
+					{
+						fprintf(stderr, "SwiftShader: cannot write compile log %s\n", capturePath);
+					}
+				}
+			}
+
+			if(!captureFile)
+			{
+				return;
+			}
+
+			Writer writer;
+			writer.put((uint32_t)record.kind);
+			writer.put(record.optimized);
+			writer.put((uint32_t)record.state.size());
+			writer.put(record.state.data(), record.state.size());
+
+			Writer shaderWriter;
+
+			if(shader)
+			{
+				writeShader(shaderWriter, record.kind, shader);
+			}
+
+			writer.put((uint32_t)shaderWriter.bytes.size());
+			writer.put(shaderWriter.bytes.data(), shaderWriter.bytes.size());
+
+			fwrite(writer.bytes.data(), writer.bytes.size(), 1, captureFile);
+			fflush(captureFile);   // Keep the capture usable if the process doesn't exit cleanly
+		}
+
+		// FNV-1a
+		uint32_t hash(const void *data, int size)
+		{
+			const unsigned char *bytes = static_cast<const unsigned char*>(data);
+			uint32_t hash = 2166136261u;
+
+			for(int i = 0; i < size; i++)
+			{
+				hash = (hash ^ bytes[i]) * 16777619u;
+			}
+
+			return hash;
+		}
+
+		// Shader serial numbers depend on the order shaders were created in. They, and the
+		// state's own hash which includes them, are left out so the hash is stable across runs.
+		template<class State>
+		uint32_t stateHash(const void *state, int size)
+		{
+			if(size != sizeof(State))
+			{
+				return hash(state, size);
+			}
+
+			State stable;
+			memcpy(&stable, state, sizeof(State));
+			stable.shaderID = 0;
+			stable.hash = 0;
+
+			return hash(&stable, sizeof(State));
+		}
+
+		uint32_t stateHash(CompileLog::Kind kind, const void *state, int size)
+		{
+			switch(kind)
+			{
+			case CompileLog::VERTEX: return stateHash<VertexProcessor::State>(state, size);
+			case CompileLog::PIXEL:  return stateHash<PixelProcessor::State>(state, size);
+			default:                 return hash(state, size);
+			}
+		}
+	}
+
+	void CompileLog::add(Kind kind, const void *state, int size, const Routine *routine, const Shader *shader)
+	{
+		if(!routine)
+		{
+			return;
+		}
+
+		Record record;
+		record.kind = kind;
+		record.stateHash = stateHash(kind, state, size);
+		record.state.assign(static_cast<const unsigned char*>(state), static_cast<const unsigned char*>(state) + size);
+		record.optimized = routine->isOptimized();
+		record.statistics = routine->getCompileStatistics();
+
+		mutex.lock();
+
+		writeCapture(record, shader);
+
+		if(ring.size() < MAX_RECORDS)
+		{
+			ring.push_back(record);
+		}
+		else
+		{
+			ring[next] = record;
+		}
+
+		next = (next + 1) % MAX_RECORDS;
+
+		Totals &totals = kindTotals[kind];
+		totals.routines++;
+		totals.instructions += record.statistics.instructions;
+		totals.buildTime += record.statistics.buildTime;
+		totals.optimizeTime += record.statistics.optimizeTime;
+		totals.emitTime += record.statistics.emitTime;
+		totals.codeSize += record.statistics.codeSize;
+
+		mutex.unlock();
+	}
+
+	std::vector<CompileLog::Record> CompileLog::records()
+	{
+		mutex.lock();
+
+		std::vector<Record> records;
+		records.reserve(ring.size());
+
+		size_t first = (ring.size() < MAX_RECORDS) ? 0 : next;
+
+		for(size_t i = 0; i < ring.size(); i++)
+		{
+			records.push_back(ring[(first + i) % ring.size()]);
+		}
+
+		mutex.unlock();
+
+		return records;
+	}
+
+	CompileLog::Totals CompileLog::totals(Kind kind)
+	{
+		mutex.lock();
+		Totals totals = kindTotals[kind];
+		mutex.unlock();
+
+		return totals;
+	}
+
+	void CompileLog::clear()
+	{
+		mutex.lock();
+
+		ring.clear();
+		next = 0;
+
+		for(int i = 0; i < KINDS; i++)
+		{
+			kindTotals[i] = {};
+		}
+
+		mutex.unlock();
+	}
+
+	bool CompileLog::load(const char *fileName, std::vector<Record> &records)
+	{
+		FILE *file = fopen(fileName, "rb");
+
+		if(!file)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> bytes;
+		unsigned char buffer[4096];
+		size_t count;
+
+		while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			bytes.insert(bytes.end(), buffer, buffer + count);
+		}
+
+		fclose(file);
+
+		Reader reader(bytes.data(), bytes.size());
+
+		char magic[sizeof(captureMagic)];
+		uint32_t header[sizeof(captureHeader) / sizeof(captureHeader[0])];
+
+		if(!reader.get(magic) || memcmp(magic, captureMagic, sizeof(magic)) != 0 ||
+		   !reader.get(header) || memcmp(header, captureHeader, sizeof(header)) != 0)
+		{
+			return false;
+		}
+
+		records.clear();
+
+		for(;;)
+		{
+			uint32_t kind;
+			uint32_t stateSize;
+			uint32_t shaderSize;
+			Record record = {};
+
+			if(!reader.get(kind))
+			{
+				break;   // End of the capture
+			}
+
+			if(kind >= KINDS || !reader.get(record.optimized) || !reader.get(stateSize))
+			{
+				return false;
+			}
+
+			record.kind = (Kind)kind;
+			record.state.resize(stateSize);
+
+			if(!reader.get(record.state.data(), stateSize) || !reader.get(shaderSize))
+			{
+				return false;
+			}
+
+			record.shader.resize(shaderSize);
+
+			if(!reader.get(record.shader.data(), shaderSize))
+			{
+				return false;
+			}
+
+			record.stateHash = stateHash(record.kind, record.state.data(), stateSize);
+			records.push_back(record);
+		}
+
+		return true;
+	}
+
+	VertexShader *CompileLog::createVertexShader(const Record &record)
+	{
+		if(record.kind != VERTEX || record.shader.empty())
+		{
+			return nullptr;
+		}
+
+		Reader reader(record.shader.data(), record.shader.size());
+		CapturedShader<VertexShader> captured;
+
+		if(!readInstructions(reader, captured))
+		{
+			return nullptr;
+		}
+
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			Shader::Semantic semantic;
+			VertexShader::AttribType attribType;
+
+			if(!reader.get(semantic) || !reader.get(attribType))
+			{
+				return nullptr;
+			}
+
+			captured.setInput(i, semantic, attribType);
+		}
+
+		Shader::Semantic output[MAX_VERTEX_OUTPUTS][4];
+		int positionRegister;
+		int pointSizeRegister;
+		bool instanceIdDeclared;
+
+		if(!reader.get(output) || !reader.get(positionRegister) || !reader.get(pointSizeRegister) || !reader.get(instanceIdDeclared))
+		{
+			return nullptr;
+		}
+
+		captured.setPositionRegister(positionRegister);
+
+		if(pointSizeRegister != Unused)
+		{
+			captured.setPointSizeRegister(pointSizeRegister);
+		}
+
+		if(instanceIdDeclared)
+		{
+			captured.declareInstanceId();
+		}
+
+		// Restore each component, overriding the semantics set along with the registers
+		for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+		{
+			for(int c = 3; c >= 0; c--)
+			{
+				captured.setOutput(i, c + 1, output[i][c]);
+			}
+		}
+
+		return new VertexShader(&captured);
+	}
+
+	PixelShader *CompileLog::createPixelShader(const Record &record)
+	{
+		if(record.kind != PIXEL || record.shader.empty())
+		{
+			return nullptr;
+		}
+
+		Reader reader(record.shader.data(), record.shader.size());
+		CapturedShader<PixelShader> captured;
+
+		if(!readInstructions(reader, captured))
+		{
+			return nullptr;
+		}
+
+		Shader::Semantic input[MAX_FRAGMENT_INPUTS][4];
+		bool vPosDeclared;
+		bool vFaceDeclared;
+
+		if(!reader.get(input) || !reader.get(vPosDeclared) || !reader.get(vFaceDeclared))
+		{
+			return nullptr;
+		}
+
+		for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+		{
+			for(int c = 3; c >= 0; c--)
+			{
+				captured.setInput(i, c + 1, input[i][c]);
+			}
+		}
+
+		if(vPosDeclared)
+		{
+			captured.declareVPos();
+		}
+
+		if(vFaceDeclared)
+		{
+			captured.declareVFace();
+		}
+
+		return new PixelShader(&captured);
+	}
+
+	const char *CompileLog::name(Kind kind)
+	{
+		switch(kind)
+		{
+		case VERTEX: return "vertex";
+		case SETUP:  return "setup";
+		case PIXEL:  return "pixel";
+		case BLIT:   return "blit";
+		default:     return "unknown";
+		}
+	}
+}
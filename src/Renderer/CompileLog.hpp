@@ -0,0 +1,90 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_CompileLog_hpp
+#define sw_CompileLog_hpp
+
+#include "Common/Types.hpp"
+#include "Reactor/Routine.hpp"
+
+#include <vector>
+
+namespace sw
+{
+	class Shader;
+	class VertexShader;
+	class PixelShader;
+
+	// Compile statistics of the most recently generated routines, attributed to the state they
+	// were compiled for. States are identified by a hash of their bytes, which leaves out shader
+	// serial numbers so it is stable across runs of the same build. States which only differ in
+	// their shader therefore share a hash. Setting SWIFTSHADER_COMPILE_LOG to a file name also captures the state bytes and
+	// shader of every compile to that file, so the routines of a workload can be replayed.
+	class CompileLog
+	{
+	public:
+		enum Kind
+		{
+			VERTEX,
+			SETUP,
+			PIXEL,
+			BLIT,
+
+			KINDS
+		};
+
+		struct Record
+		{
+			Kind kind;
+			uint32_t stateHash;
+			std::vector<unsigned char> state;
+			std::vector<unsigned char> shader;   // Serialized, only kept in captures
+			bool optimized;
+			CompileStatistics statistics;
+		};
+
+		struct Totals
+		{
+			int routines;
+			int64_t instructions;
+			double buildTime;
+			double optimizeTime;
+			double emitTime;
+			int64_t codeSize;
+		};
+
+		static void add(Kind kind, const void *state, int size, const Routine *routine, const Shader *shader = nullptr);
+
+		// Oldest first
+		static std::vector<Record> records();
+
+		// Over all routines compiled since the last clear, including those no longer recorded
+		static Totals totals(Kind kind);
+
+		static void clear();
+
+		// Reads the records of a capture. Returns false if it can't be opened or was written by an incompatible build.
+		static bool load(const char *fileName, std::vector<Record> &records);
+
+		// Recreates the shader of a captured record, or returns null if it was compiled without one
+		static VertexShader *createVertexShader(const Record &record);
+		static PixelShader *createPixelShader(const Record &record);
+
+		static const char *name(Kind kind);
+
+		enum {MAX_RECORDS = 4096};
+	};
+}
+
+#endif   // sw_CompileLog_hpp
@@ -36,7 +36,11 @@ namespace sw
 
 	bool forceWindowed = false;
 	bool quadLayoutEnabled = false;
+	bool tiledTextureLayout = false;         // Sample from a copy of textures stored in 4x4 tiles, at twice the memory
+	bool adaptiveAnisotropy = false;         // Count anisotropic taps per pixel, and halve them on the coarser mipmap level
+	bool samplerFastPaths = true;            // Dedicated sampling code for non-mipmapped, clamped RGBA8 textures
 	bool veryEarlyDepthTest = true;
+	bool shaderOptimizations = true;         // Fold constants, propagate copies and remove redundant and dead shader instructions
 	bool complementaryDepthBuffer = false;
 	bool postBlendSRGB = false;
 	bool exactColorRounding = false;
@@ -313,6 +317,8 @@ namespace sw
 
 		colorLogicOpEnabled = false;
 		logicalOperation = LOGICALOP_COPY;
+
+		stateDirty = true;
 	}
 
 	const float &Context::exp2Bias()
@@ -330,19 +336,72 @@ namespace sw
 		this->bias = exp2(bias + 0.5f);
 	}
 
+	void Context::setSurface(Surface *&field, Surface *surface)
+	{
+		// Surfaces can be reallocated at the same address, so compare the properties the states depend on
+		if(!field || !surface)
+		{
+			stateDirty = stateDirty || (field != surface);
+		}
+		else if(field->getInternalFormat() != surface->getInternalFormat() ||
+		        field->getExternalFormat() != surface->getExternalFormat() ||
+		        field->getMultiSampleCount() != surface->getMultiSampleCount() ||
+		        field->getSuperSampleCount() != surface->getSuperSampleCount())
+		{
+			stateDirty = true;
+		}
+
+		field = surface;
+	}
+
+	bool Context::isStateDirty() const
+	{
+		if(stateDirty)
+		{
+			return true;
+		}
+
+		for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
+		{
+			if(sampler[i].isModified()) return true;
+		}
+
+		for(int i = 0; i < 8; i++)
+		{
+			if(textureStage[i].isModified()) return true;
+		}
+
+		return false;
+	}
+
+	void Context::clearStateDirty()
+	{
+		stateDirty = false;
+
+		for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
+		{
+			sampler[i].clearModified();
+		}
+
+		for(int i = 0; i < 8; i++)
+		{
+			textureStage[i].clearModified();
+		}
+	}
+
 	void Context::setLightingEnable(bool lightingEnable)
 	{
-		this->lightingEnable = lightingEnable;
+		setState(Context::lightingEnable, lightingEnable);
 	}
 
 	void Context::setSpecularEnable(bool specularEnable)
 	{
-		Context::specularEnable = specularEnable;
+		setState(Context::specularEnable, specularEnable);
 	}
 
 	void Context::setLightEnable(int light, bool lightEnable)
 	{
-		Context::lightEnable[light] = lightEnable;
+		setState(Context::lightEnable[light], lightEnable);
 	}
 
 	void Context::setLightPosition(int light, Point worldLightPosition)
@@ -352,38 +411,39 @@ namespace sw
 
 	void Context::setAmbientMaterialSource(MaterialSource ambientMaterialSource)
 	{
-		Context::ambientMaterialSource = ambientMaterialSource;
+		setState(Context::ambientMaterialSource, ambientMaterialSource);
 	}
 
 	void Context::setDiffuseMaterialSource(MaterialSource diffuseMaterialSource)
 	{
-		Context::diffuseMaterialSource = diffuseMaterialSource;
+		setState(Context::diffuseMaterialSource, diffuseMaterialSource);
 	}
 
 	void Context::setSpecularMaterialSource(MaterialSource specularMaterialSource)
 	{
-		Context::specularMaterialSource = specularMaterialSource;
+		setState(Context::specularMaterialSource, specularMaterialSource);
 	}
 
 	void Context::setEmissiveMaterialSource(MaterialSource emissiveMaterialSource)
 	{
-		Context::emissiveMaterialSource = emissiveMaterialSource;
+		setState(Context::emissiveMaterialSource, emissiveMaterialSource);
 	}
 
 	void Context::setPointSpriteEnable(bool pointSpriteEnable)
 	{
-		Context::pointSpriteEnable = pointSpriteEnable;
+		setState(Context::pointSpriteEnable, pointSpriteEnable);
 	}
 
 	void Context::setPointScaleEnable(bool pointScaleEnable)
 	{
-		Context::pointScaleEnable = pointScaleEnable;
+		setState(Context::pointScaleEnable, pointScaleEnable);
 	}
 
 	bool Context::setDepthBufferEnable(bool depthBufferEnable)
 	{
 		bool modified = (Context::depthBufferEnable != depthBufferEnable);
 		Context::depthBufferEnable = depthBufferEnable;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -391,6 +451,7 @@ namespace sw
 	{
 		bool modified = (Context::alphaBlendEnable != alphaBlendEnable);
 		Context::alphaBlendEnable = alphaBlendEnable;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -398,6 +459,7 @@ namespace sw
 	{
 		bool modified = (Context::sourceBlendFactorState != sourceBlendFactor);
 		Context::sourceBlendFactorState = sourceBlendFactor;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -405,6 +467,7 @@ namespace sw
 	{
 		bool modified = (Context::destBlendFactorState != destBlendFactor);
 		Context::destBlendFactorState = destBlendFactor;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -412,6 +475,7 @@ namespace sw
 	{
 		bool modified = (Context::blendOperationState != blendOperation);
 		Context::blendOperationState = blendOperation;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -419,6 +483,7 @@ namespace sw
 	{
 		bool modified = (Context::separateAlphaBlendEnable != separateAlphaBlendEnable);
 		Context::separateAlphaBlendEnable = separateAlphaBlendEnable;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -426,6 +491,7 @@ namespace sw
 	{
 		bool modified = (Context::sourceBlendFactorStateAlpha != sourceBlendFactorAlpha);
 		Context::sourceBlendFactorStateAlpha = sourceBlendFactorAlpha;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -433,6 +499,7 @@ namespace sw
 	{
 		bool modified = (Context::destBlendFactorStateAlpha != destBlendFactorAlpha);
 		Context::destBlendFactorStateAlpha = destBlendFactorAlpha;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -440,6 +507,7 @@ namespace sw
 	{
 		bool modified = (Context::blendOperationStateAlpha != blendOperationAlpha);
 		Context::blendOperationStateAlpha = blendOperationAlpha;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -447,6 +515,7 @@ namespace sw
 	{
 		bool modified = (Context::colorWriteMask[index] != colorWriteMask);
 		Context::colorWriteMask[index] = colorWriteMask;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -454,6 +523,7 @@ namespace sw
 	{
 		bool modified = (Context::writeSRGB != sRGB);
 		Context::writeSRGB = sRGB;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -461,6 +531,7 @@ namespace sw
 	{
 		bool modified = (Context::colorLogicOpEnabled != enabled);
 		Context::colorLogicOpEnabled = enabled;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
@@ -468,12 +539,13 @@ namespace sw
 	{
 		bool modified = (Context::logicalOperation != logicalOperation);
 		Context::logicalOperation = logicalOperation;
+		stateDirty = stateDirty || modified;
 		return modified;
 	}
 
 	void Context::setColorVertexEnable(bool colorVertexEnable)
 	{
-		Context::colorVertexEnable = colorVertexEnable;
+		setState(Context::colorVertexEnable, colorVertexEnable);
 	}
 
 	bool Context::fogActive()
@@ -298,6 +298,14 @@ namespace sw
 
 		void setGlobalMipmapBias(float bias);
 
+		// Draws only derive new processor states when a setter modified a field they depend on.
+		// Fields which only feed uniforms or draw data can be assigned directly.
+		template<class T, class V>
+		bool setState(T &field, const V &value);
+		void setSurface(Surface *&field, Surface *surface);
+		bool isStateDirty() const;
+		void clearStateDirty();
+
 		// Set fixed-function vertex pipeline states
 		void setLightingEnable(bool lightingEnable);
 		void setSpecularEnable(bool specularEnable);
@@ -528,7 +536,23 @@ namespace sw
 
 		bool colorLogicOpEnabled;
 		LogicalOperation logicalOperation;
+
+		bool stateDirty;
 	};
+
+	template<class T, class V>
+	bool Context::setState(T &field, const V &value)
+	{
+		if(field == static_cast<T>(value))
+		{
+			return false;
+		}
+
+		field = static_cast<T>(value);
+		stateDirty = true;
+
+		return true;
+	}
 }
 
 #endif   // sw_Context_hpp
@@ -17,6 +17,8 @@
 
 #include "Common/Math.hpp"
 
+#include <utility>
+
 namespace sw
 {
 	template<class Key, class Data>
@@ -29,6 +31,8 @@ namespace sw
 
 		Data *query(const Key &key) const;
 		Data *add(const Key &key, Data *data);
+		bool replace(const Key &key, Data *data);   // Keeps the entry's position
+		void resize(int n);   // Keeps the most recently used entries
 	
 		int getSize() {return size;}
 		Key &getKey(int i) {return key[i];}
@@ -140,6 +144,48 @@ namespace sw
 
 		return data;
 	}
+
+	template<class Key, class Data>
+	bool LRUCache<Key, Data>::replace(const Key &key, Data *data)
+	{
+		for(int i = top; i > top - fill; i--)
+		{
+			int j = i & mask;
+
+			if(key == *ref[j])
+			{
+				data->bind();
+				this->data[j]->unbind();
+				this->data[j] = data;
+
+				return true;
+			}
+		}
+
+		return false;   // Not found
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::resize(int n)
+	{
+		LRUCache<Key, Data> resized(n);
+
+		// Least recently used first, so the oldest entries are evicted when shrinking
+		for(int i = top - fill + 1; i <= top; i++)
+		{
+			int j = i & mask;
+
+			resized.add(*ref[j], data[j]);
+		}
+
+		std::swap(size, resized.size);
+		std::swap(mask, resized.mask);
+		std::swap(top, resized.top);
+		std::swap(fill, resized.fill);
+		std::swap(key, resized.key);
+		std::swap(ref, resized.ref);
+		std::swap(data, resized.data);
+	}
 }
 
 #endif   // sw_LRUCache_hpp
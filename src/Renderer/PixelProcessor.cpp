@@ -21,6 +21,10 @@
 #include "Primitive.hpp"
 #include "Constants.hpp"
 #include "Debug.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "CompileLog.hpp"
+#include "Timer.hpp"
 
 #include <string.h>
 
@@ -72,13 +76,12 @@ namespace sw
 		                             // Round to nearest LOD [0.7, 1.4]:  0.0
 		                             // Round to lowest LOD  [1.0, 2.0]:  0.5
 
-		routineCache = 0;
-		setRoutineCacheSize(1024);
+		routineCache = RoutineCache<State>::acquireShared(1024, precachePixel ? "sw-pixel" : 0);
 	}
 
 	PixelProcessor::~PixelProcessor()
 	{
-		delete routineCache;
+		RoutineCache<State>::releaseShared();
 		routineCache = 0;
 	}
 
@@ -161,17 +164,17 @@ namespace sw
 
 	void PixelProcessor::setRenderTarget(int index, Surface *renderTarget)
 	{
-		context->renderTarget[index] = renderTarget;
+		context->setSurface(context->renderTarget[index], renderTarget);
 	}
 
 	void PixelProcessor::setDepthBuffer(Surface *depthBuffer)
 	{
-		context->depthBuffer = depthBuffer;
+		context->setSurface(context->depthBuffer, depthBuffer);
 	}
 
 	void PixelProcessor::setStencilBuffer(Surface *stencilBuffer)
 	{
-		context->stencilBuffer = stencilBuffer;
+		context->setSurface(context->stencilBuffer, stencilBuffer);
 	}
 
 	void PixelProcessor::setTexCoordIndex(unsigned int stage, int texCoordIndex)
@@ -381,6 +384,15 @@ namespace sw
 		else ASSERT(false);
 	}
 
+	void PixelProcessor::setSeamlessCubeMap(unsigned int sampler, bool enable)
+	{
+		if(sampler < TEXTURE_IMAGE_UNITS)
+		{
+			context->sampler[sampler].setSeamlessCubeMap(enable);
+		}
+		else ASSERT(false);
+	}
+
 	void PixelProcessor::setAddressingModeU(unsigned int sampler, AddressingMode addressMode)
 	{
 		if(sampler < TEXTURE_IMAGE_UNITS)
@@ -538,27 +550,27 @@ namespace sw
 
 	void PixelProcessor::setDepthCompare(DepthCompareMode depthCompareMode)
 	{
-		context->depthCompareMode = depthCompareMode;
+		context->setState(context->depthCompareMode, depthCompareMode);
 	}
 
 	void PixelProcessor::setAlphaCompare(AlphaCompareMode alphaCompareMode)
 	{
-		context->alphaCompareMode = alphaCompareMode;
+		context->setState(context->alphaCompareMode, alphaCompareMode);
 	}
 
 	void PixelProcessor::setDepthWriteEnable(bool depthWriteEnable)
 	{
-		context->depthWriteEnable = depthWriteEnable;
+		context->setState(context->depthWriteEnable, depthWriteEnable);
 	}
 
 	void PixelProcessor::setAlphaTestEnable(bool alphaTestEnable)
 	{
-		context->alphaTestEnable = alphaTestEnable;
+		context->setState(context->alphaTestEnable, alphaTestEnable);
 	}
 
 	void PixelProcessor::setCullMode(CullMode cullMode)
 	{
-		context->cullMode = cullMode;
+		context->setState(context->cullMode, cullMode);
 	}
 
 	void PixelProcessor::setColorWriteMask(int index, int rgbaMask)
@@ -568,12 +580,12 @@ namespace sw
 
 	void PixelProcessor::setStencilEnable(bool stencilEnable)
 	{
-		context->stencilEnable = stencilEnable;
+		context->setState(context->stencilEnable, stencilEnable);
 	}
 
 	void PixelProcessor::setStencilCompare(StencilCompareMode stencilCompareMode)
 	{
-		context->stencilCompareMode = stencilCompareMode;
+		context->setState(context->stencilCompareMode, stencilCompareMode);
 	}
 
 	void PixelProcessor::setStencilReference(int stencilReference)
@@ -590,66 +602,66 @@ namespace sw
 
 	void PixelProcessor::setStencilMask(int stencilMask)
 	{
-		context->stencilMask = stencilMask;
+		context->setState(context->stencilMask, stencilMask);
 		stencil.set(context->stencilReference, stencilMask, context->stencilWriteMask);
 	}
 
 	void PixelProcessor::setStencilMaskCCW(int stencilMaskCCW)
 	{
-		context->stencilMaskCCW = stencilMaskCCW;
+		context->setState(context->stencilMaskCCW, stencilMaskCCW);
 		stencilCCW.set(context->stencilReferenceCCW, stencilMaskCCW, context->stencilWriteMaskCCW);
 	}
 
 	void PixelProcessor::setStencilFailOperation(StencilOperation stencilFailOperation)
 	{
-		context->stencilFailOperation = stencilFailOperation;
+		context->setState(context->stencilFailOperation, stencilFailOperation);
 	}
 
 	void PixelProcessor::setStencilPassOperation(StencilOperation stencilPassOperation)
 	{
-		context->stencilPassOperation = stencilPassOperation;
+		context->setState(context->stencilPassOperation, stencilPassOperation);
 	}
 
 	void PixelProcessor::setStencilZFailOperation(StencilOperation stencilZFailOperation)
 	{
-		context->stencilZFailOperation = stencilZFailOperation;
+		context->setState(context->stencilZFailOperation, stencilZFailOperation);
 	}
 
 	void PixelProcessor::setStencilWriteMask(int stencilWriteMask)
 	{
-		context->stencilWriteMask = stencilWriteMask;
+		context->setState(context->stencilWriteMask, stencilWriteMask);
 		stencil.set(context->stencilReference, context->stencilMask, stencilWriteMask);
 	}
 
 	void PixelProcessor::setStencilWriteMaskCCW(int stencilWriteMaskCCW)
 	{
-		context->stencilWriteMaskCCW = stencilWriteMaskCCW;
+		context->setState(context->stencilWriteMaskCCW, stencilWriteMaskCCW);
 		stencilCCW.set(context->stencilReferenceCCW, context->stencilMaskCCW, stencilWriteMaskCCW);
 	}
 
 	void PixelProcessor::setTwoSidedStencil(bool enable)
 	{
-		context->twoSidedStencil = enable;
+		context->setState(context->twoSidedStencil, enable);
 	}
 
 	void PixelProcessor::setStencilCompareCCW(StencilCompareMode stencilCompareMode)
 	{
-		context->stencilCompareModeCCW = stencilCompareMode;
+		context->setState(context->stencilCompareModeCCW, stencilCompareMode);
 	}
 
 	void PixelProcessor::setStencilFailOperationCCW(StencilOperation stencilFailOperation)
 	{
-		context->stencilFailOperationCCW = stencilFailOperation;
+		context->setState(context->stencilFailOperationCCW, stencilFailOperation);
 	}
 
 	void PixelProcessor::setStencilPassOperationCCW(StencilOperation stencilPassOperation)
 	{
-		context->stencilPassOperationCCW = stencilPassOperation;
+		context->setState(context->stencilPassOperationCCW, stencilPassOperation);
 	}
 
 	void PixelProcessor::setStencilZFailOperationCCW(StencilOperation stencilZFailOperation)
 	{
-		context->stencilZFailOperationCCW = stencilZFailOperation;
+		context->setState(context->stencilZFailOperationCCW, stencilZFailOperation);
 	}
 
 	void PixelProcessor::setTextureFactor(const Color<float> &textureFactor)
@@ -778,12 +790,12 @@ namespace sw
 
 	void PixelProcessor::setFillMode(FillMode fillMode)
 	{
-		context->fillMode = fillMode;
+		context->setState(context->fillMode, fillMode);
 	}
 
 	void PixelProcessor::setShadingMode(ShadingMode shadingMode)
 	{
-		context->shadingMode = shadingMode;
+		context->setState(context->shadingMode, shadingMode);
 	}
 
 	void PixelProcessor::setAlphaBlendEnable(bool alphaBlendEnable)
@@ -886,7 +898,7 @@ namespace sw
 
 	void PixelProcessor::setPixelFogMode(FogMode fogMode)
 	{
-		context->pixelFogMode = fogMode;
+		context->setState(context->pixelFogMode, fogMode);
 	}
 
 	void PixelProcessor::setPerspectiveCorrection(bool perspectiveEnable)
@@ -896,13 +908,12 @@ namespace sw
 
 	void PixelProcessor::setOcclusionEnabled(bool enable)
 	{
-		context->occlusionEnabled = enable;
+		context->setState(context->occlusionEnabled, enable);
 	}
 
 	void PixelProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precachePixel ? "sw-pixel" : 0);
+		routineCache->resize(clamp(cacheSize, 1, 65536));
 	}
 
 	void PixelProcessor::setFogRanges(float start, float end)
@@ -1151,28 +1162,67 @@ namespace sw
 	Routine *PixelProcessor::routine(const State &state)
 	{
 		Routine *routine = routineCache->query(state);
+		const bool integerPipeline = (context->pixelShaderVersion() <= 0x0104);
+
+		Metrics::add(routine ? Metrics::PIXEL_ROUTINE_HITS : Metrics::PIXEL_ROUTINE_MISSES);
 
 		if(!routine)
+		{
+			routine = generate(state, context->pixelShader, integerPipeline, !tieredCompilation);
+			routine = routineCache->add(state, routine);
+		}
+
+		return routine;
+	}
+
+	void PixelProcessor::use(const State &state, Routine *routine)
+	{
+		if(routineCache->isHot(routine))
 		{
 			const bool integerPipeline = (context->pixelShaderVersion() <= 0x0104);
-			QuadRasterizer *generator = nullptr;
 
-			if(integerPipeline)
-			{
-				generator = new PixelPipeline(state, context->pixelShader);
-			}
-			else
+			// The shader can change or be deleted while compiling, so use a copy
+			const PixelShader *shader = context->pixelShader ? new PixelShader(context->pixelShader) : nullptr;
+
+			routineCache->promote(state, [=]()
 			{
-				generator = new PixelProgram(state, context->pixelShader);
-			}
+				Routine *optimized = generate(state, shader, integerPipeline, true);
+				delete shader;
 
-			generator->generate();
-			routine = (*generator)(L"PixelRoutine_%0.8X", state.shaderID);
-			delete generator;
+				return optimized;
+			});
+		}
+	}
 
-			routineCache->add(state, routine);
+	int PixelProcessor::promotions() const
+	{
+		return routineCache->promotions();
+	}
+
+	Routine *PixelProcessor::generate(const State &state, const PixelShader *shader, bool integerPipeline, bool optimize)
+	{
+		TraceSpan span("Compile pixel routine", "jit");
+		int64_t start = Metrics::enabled() ? Timer::counter() : 0;
+
+		QuadRasterizer *generator = nullptr;
+
+		if(integerPipeline)
+		{
+			generator = new PixelPipeline(state, shader);
+		}
+		else
+		{
+			generator = new PixelProgram(state, shader);
 		}
 
+		generator->generate();
+		Routine *routine = optimize ? (*generator)(L"PixelRoutine_%0.8X", state.shaderID) : generator->unoptimized(L"PixelRoutine_%0.8X", state.shaderID);
+		delete generator;
+
+		CompileLog::add(CompileLog::PIXEL, &state, sizeof(State), routine, shader);
+		Metrics::add(Metrics::PIXEL_ROUTINE_COMPILES);
+		Metrics::addTime(Metrics::PIXEL_COMPILE_TIME, start);
+
 		return routine;
 	}
 }
@@ -224,6 +224,7 @@ namespace sw
 		void setTextureFilter(unsigned int sampler, FilterType textureFilter);
 		void setMipmapFilter(unsigned int sampler, MipmapType mipmapFilter);
 		void setGatherEnable(unsigned int sampler, bool enable);
+		void setSeamlessCubeMap(unsigned int sampler, bool enable);
 		void setAddressingModeU(unsigned int sampler, AddressingMode addressingMode);
 		void setAddressingModeV(unsigned int sampler, AddressingMode addressingMode);
 		void setAddressingModeW(unsigned int sampler, AddressingMode addressingMode);
@@ -301,7 +302,9 @@ namespace sw
 
 	protected:
 		const State update() const;
-		Routine *routine(const State &state);
+		Routine *routine(const State &state);   // Returns a reference which the caller must unbind
+		void use(const State &state, Routine *routine);   // Counts a draw with the routine, for tiered compilation
+		int promotions() const;   // Changes when cached routines were replaced by optimized ones
 		void setRoutineCacheSize(int routineCacheSize);
 
 		// Shader constants
@@ -327,6 +330,7 @@ namespace sw
 		UniformBufferInfo uniformBufferInfo[MAX_UNIFORM_BUFFER_BINDINGS];
 
 		void setFogRanges(float start, float end);
+		static Routine *generate(const State &state, const PixelShader *shader, bool integerPipeline, bool optimize);
 
 		Context *const context;
 
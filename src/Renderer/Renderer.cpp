@@ -24,6 +24,9 @@
 #include "Polygon.hpp"
 #include "SwiftConfig.hpp"
 #include "MutexLock.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
 #include "CPUID.hpp"
 #include "Memory.hpp"
 #include "Resource.hpp"
@@ -31,6 +34,8 @@
 #include "Debug.hpp"
 #include "Reactor/Reactor.hpp"
 
+#include <cmath>
+
 #undef max
 
 bool disableServer = true;
@@ -70,16 +75,14 @@ namespace sw
 	TranscendentalPrecision rcpPrecision = ACCURATE;
 	TranscendentalPrecision rsqPrecision = ACCURATE;
 	bool perspectiveCorrection = true;
-
-	struct Parameters
-	{
-		Renderer *renderer;
-		int threadIndex;
-	};
+	bool tieredCompilation = true;   // Recompile frequently used routines with optimizations
+	bool guardBandClipping = true;   // Only clip primitives against the viewport sides when they leave the guard band
+	bool vertexPrepass = false;      // Shade positions first, and fully shade only the vertices of triangles which aren't culled
 
 	DrawCall::DrawCall()
 	{
 		queries = 0;
+		blit = nullptr;
 
 		vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
 		vsDirtyConstI = 16;
@@ -128,12 +131,20 @@ namespace sw
 		{
 			vertexTask[i] = 0;
 
-			worker[i] = 0;
-			resume[i] = 0;
+			threadParameters[i].renderer = this;
+			threadParameters[i].threadIndex = i;
 			suspend[i] = 0;
 		}
 
+		vertexRoutine = nullptr;
+		positionRoutine = nullptr;
+		setupRoutine = nullptr;
+		pixelRoutine = nullptr;
+		vertexPromotions = 0;
+		pixelPromotions = 0;
+
 		threadsAwake = 0;
+		client = ThreadPool::createClient();
 		resumeApp = new Event();
 
 		currentDraw = 0;
@@ -170,6 +181,8 @@ namespace sw
 		updateConfiguration(true);
 
 		sync = new Resource(0);
+
+		Metrics::start();
 	}
 
 	Renderer::~Renderer()
@@ -180,8 +193,23 @@ namespace sw
 		clipper = 0;
 
 		terminateThreads();
+		ThreadPool::destroyClient(client);
 		delete resumeApp;
 
+		Metrics::stop();
+
+		if(vertexRoutine)
+		{
+			vertexRoutine->unbind();
+			setupRoutine->unbind();
+			pixelRoutine->unbind();
+		}
+
+		if(positionRoutine)
+		{
+			positionRoutine->unbind();
+		}
+
 		for(int draw = 0; draw < DRAW_COUNT; draw++)
 		{
 			delete drawCall[draw];
@@ -204,19 +232,103 @@ namespace sw
 
 	void Renderer::clear(void *pixel, Format format, Surface *dest, const SliceRect &dRect, unsigned int rgbaMask)
 	{
-		blitter.clear(pixel, format, dest, dRect, rgbaMask);
+		Blitter::Operation *operation = nullptr;
+
+		if(threadCount > 1)
+		{
+			operation = blitter.prepareClear(pixel, format, dest, dRect, rgbaMask);
+		}
+
+		if(operation)
+		{
+			scheduleBlit(operation);
+		}
+		else
+		{
+			blitter.clear(pixel, format, dest, dRect, rgbaMask);
+		}
 	}
 
 	void Renderer::blit(Surface *source, const SliceRect &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil)
 	{
-		blitter.blit(source, sRect, dest, dRect, filter, isStencil);
+		Blitter::Operation *operation = nullptr;
+
+		if(threadCount > 1 && source != dest)   // Bands of the same surface may overlap
+		{
+			if(source->getMultiSampleCount() > 1)
+			{
+				// Only public read locks resolve multisampled surfaces
+				source->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+				source->unlockInternal();
+			}
+
+			operation = blitter.prepareBlit(source, sRect, dest, dRect, filter, isStencil);
+		}
+
+		if(operation)
+		{
+			scheduleBlit(operation);
+		}
+		else
+		{
+			blitter.blit(source, sRect, dest, dRect, filter, isStencil);
+		}
 	}
 
 	void Renderer::blit3D(Surface *source, Surface *dest)
 	{
+		// No routine for trilinear volume blits yet, so this waits for all preceding work on the surfaces
 		blitter.blit3D(source, dest);
 	}
 
+	void Renderer::scheduleBlit(Blitter::Operation *operation)
+	{
+		sync->lock(sw::PRIVATE);
+
+		DrawCall *draw = 0;
+
+		do
+		{
+			for(int i = 0; i < DRAW_COUNT; i++)
+			{
+				if(drawCall[i]->references == -1)
+				{
+					draw = drawCall[i];
+					drawList[nextDraw % DRAW_COUNT] = draw;
+
+					break;
+				}
+			}
+
+			if(!draw)
+			{
+				resumeApp->wait();
+			}
+		}
+		while(!draw);
+
+		// A single primitive which every pixel cluster processes, in order with the draws around it
+		draw->blit = operation;
+		draw->batchSize = 1;
+		draw->primitive = 0;
+		draw->count = 1;
+		draw->references = 1;
+
+		schedulerMutex.lock();
+		nextDraw++;
+		schedulerMutex.unlock();
+
+		if(!threadsAwake)
+		{
+			suspend[0]->wait();
+
+			threadsAwake = 1;
+			task[0].type = Task::RESUME;
+
+			resumeThread(0);
+		}
+	}
+
 	void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update)
 	{
 		#ifndef NDEBUG
@@ -226,11 +338,21 @@ namespace sw
 			}
 		#endif
 
-		context->drawType = drawType;
+		TraceSpan span("Draw", "api");
+
+		Metrics::add(Metrics::DRAWS);
+		Metrics::add(Metrics::PRIMITIVES, count);
+
+		context->setState(context->drawType, drawType);
 
 		updateConfiguration();
 		updateClipper();
 
+		if(update)
+		{
+			VertexProcessor::updateTransformAndLighting();
+		}
+
 		int ss = context->getSuperSampleCount();
 		int ms = context->getMultiSampleCount();
 
@@ -246,15 +368,67 @@ namespace sw
 
 			sync->lock(sw::PRIVATE);
 
-			if(update || oldMultiSampleMask != context->multiSampleMask)
+			// Draws with unchanged state keep the previous routines, without hashing or cache lookups
+			if((update && stateModified()) || oldMultiSampleMask != context->multiSampleMask)
 			{
 				vertexState = VertexProcessor::update(drawType);
 				setupState = SetupProcessor::update();
 				pixelState = PixelProcessor::update();
+				context->clearStateDirty();
+
+				if(vertexRoutine)
+				{
+					vertexRoutine->unbind();
+					setupRoutine->unbind();
+					pixelRoutine->unbind();
+				}
+
+				if(positionRoutine)
+				{
+					positionRoutine->unbind();
+				}
+
+				vertexPromotions = VertexProcessor::promotions();
+				pixelPromotions = PixelProcessor::promotions();
 
 				vertexRoutine = VertexProcessor::routine(vertexState);
 				setupRoutine = SetupProcessor::routine(setupState);
 				pixelRoutine = PixelProcessor::routine(pixelState);
+
+				// Culling on positions only applies to what solid triangle setup would cull
+				bool prepass = vertexPrepass && setupState.isDrawSolidTriangle && !setupState.rasterizerDiscard && !vertexState.transformFeedbackEnabled;
+				positionRoutine = nullptr;
+
+				if(prepass)
+				{
+					prepassState = positionState(vertexState);
+					positionRoutine = VertexProcessor::routine(prepassState);
+				}
+			}
+			else if(VertexProcessor::promotions() != vertexPromotions || PixelProcessor::promotions() != pixelPromotions)
+			{
+				// Pick up routines which were recompiled with optimizations, for the same states
+				vertexPromotions = VertexProcessor::promotions();
+				pixelPromotions = PixelProcessor::promotions();
+
+				vertexRoutine->unbind();
+				pixelRoutine->unbind();
+				vertexRoutine = VertexProcessor::routine(vertexState);
+				pixelRoutine = PixelProcessor::routine(pixelState);
+
+				if(positionRoutine)
+				{
+					positionRoutine->unbind();
+					positionRoutine = VertexProcessor::routine(prepassState);
+				}
+			}
+
+			VertexProcessor::use(vertexState, vertexRoutine);
+			PixelProcessor::use(pixelState, pixelRoutine);
+
+			if(positionRoutine)
+			{
+				VertexProcessor::use(prepassState, positionRoutine);
 			}
 
 			int batch = batchSize / ms;
@@ -336,10 +510,17 @@ namespace sw
 			setupRoutine->bind();
 			pixelRoutine->bind();
 
+			if(positionRoutine)
+			{
+				positionRoutine->bind();
+			}
+
 			draw->vertexRoutine = vertexRoutine;
+			draw->positionRoutine = positionRoutine;
 			draw->setupRoutine = setupRoutine;
 			draw->pixelRoutine = pixelRoutine;
 			draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
+			draw->positionPointer = positionRoutine ? (VertexProcessor::RoutinePointer)positionRoutine->getEntry() : nullptr;
 			draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
 			draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
 			draw->setupPrimitives = setupPrimitives;
@@ -595,6 +776,19 @@ namespace sw
 				data->slopeDepthBias = slopeDepthBias;
 				data->depthRange = Z;
 				data->depthNear = N;
+
+				// Without the guard band, primitives are clipped as soon as they cross the viewport
+				if(guardBandClipping)
+				{
+					data->guardBandX = max((Clipper::GUARD_BAND - abs(X0)) / abs(W), 1.0f);
+					data->guardBandY = max((Clipper::GUARD_BAND - abs(Y0)) / abs(H), 1.0f);
+				}
+				else
+				{
+					data->guardBandX = 1.0f;
+					data->guardBandY = 1.0f;
+				}
+
 				draw->clipFlags = clipFlags;
 
 				if(clipFlags)
@@ -610,13 +804,16 @@ namespace sw
 
 			// Target
 			{
+				// Pixels are only written inside the scissor rectangle
+				const Region writeRegion(scissor.x0, scissor.y0, q * ms, scissor.x1, scissor.y1, q * ms + ms);
+
 				for(int index = 0; index < RENDERTARGETS; index++)
 				{
 					draw->renderTarget[index] = context->renderTarget[index];
 
 					if(draw->renderTarget[index])
 					{
-						data->colorBuffer[index] = (unsigned int*)context->renderTarget[index]->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED);
+						data->colorBuffer[index] = (unsigned int*)context->renderTarget[index]->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED, writeRegion);
 						data->colorPitchB[index] = context->renderTarget[index]->getInternalPitchB();
 						data->colorSliceB[index] = context->renderTarget[index]->getInternalSliceB();
 					}
@@ -627,7 +824,7 @@ namespace sw
 
 				if(draw->depthBuffer)
 				{
-					data->depthBuffer = (float*)context->depthBuffer->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED);
+					data->depthBuffer = (float*)context->depthBuffer->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED, writeRegion);
 					data->depthPitchB = context->depthBuffer->getInternalPitchB();
 					data->depthSliceB = context->depthBuffer->getInternalSliceB();
 				}
@@ -666,7 +863,7 @@ namespace sw
 					threadsAwake = 1;
 					task[0].type = Task::RESUME;
 
-					resume[0]->signal();
+					resumeThread(0);
 				}
 			}
 			else   // Use main thread for draw execution
@@ -684,6 +881,10 @@ namespace sw
 		Renderer *renderer = static_cast<Parameters*>(parameters)->renderer;
 		int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
 
+		// Pool threads are shared with other jobs, which must not inherit the denormal mode
+		bool flushToZero = CPUID::getFlushToZero();
+		bool denormalsAreZero = CPUID::getDenormalsAreZero();
+
 		if(logPrecision < IEEE)
 		{
 			CPUID::setFlushToZero(true);
@@ -691,17 +892,27 @@ namespace sw
 		}
 
 		renderer->threadLoop(threadIndex);
+
+		CPUID::setFlushToZero(flushToZero);
+		CPUID::setDenormalsAreZero(denormalsAreZero);
 	}
 
 	void Renderer::threadLoop(int threadIndex)
 	{
-		while(!exitThreads)
+		while(task[threadIndex].type != Task::SUSPEND)
 		{
-			taskLoop(threadIndex);
+			scheduleTask(threadIndex);
+			executeTask(threadIndex);
 
-			suspend[threadIndex]->signal();
-			resume[threadIndex]->wait();
+			// Let other renderers use the pool thread, and continue after them
+			if(task[threadIndex].type != Task::SUSPEND && ThreadPool::contended(client))
+			{
+				resumeThread(threadIndex);
+				return;
+			}
 		}
+
+		suspend[threadIndex]->signal();
 	}
 
 	void Renderer::taskLoop(int threadIndex)
@@ -713,6 +924,11 @@ namespace sw
 		}
 	}
 
+	void Renderer::resumeThread(int threadIndex)
+	{
+		ThreadPool::submit(client, threadFunction, &threadParameters[threadIndex]);
+	}
+
 	void Renderer::findAvailableTasks()
 	{
 		// Find pixel tasks
@@ -818,7 +1034,7 @@ namespace sw
 					{
 						suspend[i]->wait();
 						task[i].type = Task::RESUME;
-						resume[i]->signal();
+						resumeThread(i);
 
 						threadsAwake++;
 						wakeup--;
@@ -853,7 +1069,20 @@ namespace sw
 				DrawCall *draw = drawList[primitiveProgress[unit].drawCall % DRAW_COUNT];
 				int (Renderer::*setupPrimitives)(int batch, int count) = draw->setupPrimitives;
 
-				processPrimitiveVertices(unit, input, count, draw->count, threadIndex);
+				if(draw->blit)   // No vertices, go straight to the pixel clusters
+				{
+					primitiveProgress[unit].visible = 1;
+					primitiveProgress[unit].references = clusterCount;
+
+					break;
+				}
+
+				int remaining = 0;
+
+				{
+					TraceSpan span("Vertices", "pipeline");
+					remaining = processPrimitiveVertices(unit, input, count, draw->count, threadIndex);
+				}
 
 				#if PERF_HUD
 					int64_t time = Timer::ticks();
@@ -865,7 +1094,14 @@ namespace sw
 
 				if(!draw->setupState.rasterizerDiscard)
 				{
-					visible = (this->*setupPrimitives)(unit, count);
+					TraceSpan span("Setup", "pipeline");
+					visible = (this->*setupPrimitives)(unit, remaining);
+				}
+
+				if(Metrics::enabled())
+				{
+					Metrics::add(Metrics::PRIMITIVES_CULLED, count - visible);
+					Metrics::add(Metrics::PIXELS, coverage(unit, visible, draw->setupState.multiSample));
 				}
 
 				primitiveProgress[unit].visible = visible;
@@ -889,7 +1125,16 @@ namespace sw
 					DrawData *data = draw->data;
 					PixelProcessor::RoutinePointer pixelRoutine = draw->pixelPointer;
 
-					pixelRoutine(primitive, visible, cluster, data);
+					if(draw->blit)
+					{
+						TraceSpan span("Blit", "blit");
+						Blitter::execute(draw->blit, cluster, clusterCount);
+					}
+					else
+					{
+						TraceSpan span("Pixels", "pipeline");
+						pixelRoutine(primitive, visible, cluster, data);
+					}
 				}
 
 				finishRendering(task[threadIndex]);
@@ -914,6 +1159,16 @@ namespace sw
 		sync->unlock();
 	}
 
+	void Renderer::setPriority(int priority)
+	{
+		ThreadPool::setPriority(client, priority);
+	}
+
+	bool Renderer::hasOptimizedRoutines() const
+	{
+		return vertexRoutine && vertexRoutine->isOptimized() && pixelRoutine->isOptimized();
+	}
+
 	void Renderer::finishRendering(Task &pixelTask)
 	{
 		int unit = pixelTask.primitiveUnit;
@@ -939,7 +1194,17 @@ namespace sw
 		{
 			ref = atomicDecrement(&draw.references);
 
-			if(ref == 0)
+			if(ref == 0 && draw.blit)
+			{
+				Blitter::finish(draw.blit);
+				draw.blit = nullptr;
+
+				sync->unlock();
+
+				draw.references = -1;
+				resumeApp->signal();
+			}
+			else if(ref == 0)
 			{
 				#if PERF_PROFILE
 					for(int cluster = 0; cluster < clusterCount; cluster++)
@@ -1042,6 +1307,11 @@ namespace sw
 				draw.setupRoutine->unbind();
 				draw.pixelRoutine->unbind();
 
+				if(draw.positionRoutine)
+				{
+					draw.positionRoutine->unbind();
+				}
+
 				sync->unlock();
 
 				draw.references = -1;
@@ -1052,7 +1322,7 @@ namespace sw
 		pixelProgress[cluster].executing = false;
 	}
 
-	void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
+	int Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
 	{
 		Triangle *triangle = triangleBatch[unit];
 		DrawCall *draw = drawList[primitiveProgress[unit].drawCall % DRAW_COUNT];
@@ -1066,6 +1336,8 @@ namespace sw
 		{
 			task->vertexCache.clear();
 			task->vertexCache.drawCall = primitiveProgress[unit].drawCall;
+			task->positionCache.clear();
+			task->positionCache.drawCall = primitiveProgress[unit].drawCall;
 		}
 
 		unsigned int batch[128][3];   // FIXME: Adjust to dynamic batch size
@@ -1472,12 +1744,85 @@ namespace sw
 			break;
 		default:
 			ASSERT(false);
-			return;
+			return 0;
+		}
+
+		if(draw->positionPointer)
+		{
+			task->primitiveStart = start;
+			task->vertexCount = triangleCount * 3;
+			draw->positionPointer(&triangle->v0, (unsigned int*)&batch, task, data);
+
+			triangleCount = cullTriangles(*draw, triangle, batch, triangleCount);
+
+			if(triangleCount == 0)
+			{
+				return 0;
+			}
 		}
 
 		task->primitiveStart = start;
 		task->vertexCount = triangleCount * 3;
 		vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+
+		return triangleCount;
+	}
+
+	// Removes the triangles which solid triangle setup would reject, keeping the order of the others
+	int Renderer::cullTriangles(const DrawCall &draw, const Triangle *triangle, unsigned int (*batch)[3], int count)
+	{
+		const SetupProcessor::State &state = draw.setupState;
+		int pos = state.positionRegister;
+		int remaining = 0;
+
+		for(int i = 0; i < count; i++, triangle++)
+		{
+			const Vertex &v0 = triangle->v0;
+			const Vertex &v1 = triangle->v1;
+			const Vertex &v2 = triangle->v2;
+
+			if((v0.clipFlags & v1.clipFlags & v2.clipFlags) != Clipper::CLIP_FINITE)
+			{
+				continue;   // Outside of the same frustum plane
+			}
+
+			// As computed by SetupRoutine
+			float x0 = (float)v0.X;
+			float x1 = (float)v1.X;
+			float x2 = (float)v2.X;
+
+			float y0 = (float)v0.Y;
+			float y1 = (float)v1.Y;
+			float y2 = (float)v2.Y;
+
+			float A = (y2 - y0) * x1 + (y1 - y2) * x0 + (y0 - y1) * x2;   // Area
+
+			if(A == 0.0f)
+			{
+				continue;
+			}
+
+			// The XOR of the w sign bits
+			bool negativeW = (std::signbit(v0.v[pos].w) != std::signbit(v1.v[pos].w)) != std::signbit(v2.v[pos].w);
+
+			A = negativeW ? -A : A;
+
+			if(state.cullMode == CULL_CLOCKWISE)
+			{
+				if(A >= 0.0f) continue;
+			}
+			else if(state.cullMode == CULL_COUNTERCLOCKWISE)
+			{
+				if(A <= 0.0f) continue;
+			}
+
+			batch[remaining][0] = batch[i][0];
+			batch[remaining][1] = batch[i][1];
+			batch[remaining][2] = batch[i][2];
+			remaining++;
+		}
+
+		return remaining;
 	}
 
 	int Renderer::setupSolidTriangles(int unit, int count)
@@ -1676,6 +2021,28 @@ namespace sw
 		return visible;
 	}
 
+	int64_t Renderer::coverage(int unit, int visible, int ms) const
+	{
+		const Primitive *primitive = primitiveBatch[unit];
+		int64_t pixels = 0;
+
+		// Only the first sample's outline, so multisampled pixels are counted once
+		for(int i = 0; i < visible; i++, primitive += ms)
+		{
+			for(int y = primitive->yMin; y < primitive->yMax; y++)
+			{
+				const Primitive::Span &span = primitive->outline[y];
+
+				if(span.right > span.left)
+				{
+					pixels += span.right - span.left;
+				}
+			}
+		}
+
+		return pixels;
+	}
+
 	bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw)
 	{
 		const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
@@ -1972,19 +2339,11 @@ namespace sw
 
 			task[i].type = Task::SUSPEND;
 
-			resume[i] = new Event();
 			suspend[i] = new Event();
-
-			Parameters parameters;
-			parameters.threadIndex = i;
-			parameters.renderer = this;
-
-			exitThreads = false;
-			worker[i] = new Thread(threadFunction, &parameters);
-
-			suspend[i]->wait();
 			suspend[i]->signal();
 		}
+
+		ThreadPool::reserve(threadCount);
 	}
 
 	void Renderer::terminateThreads()
@@ -1996,16 +2355,10 @@ namespace sw
 
 		for(int thread = 0; thread < threadCount; thread++)
 		{
-			if(worker[thread])
+			if(suspend[thread])
 			{
-				exitThreads = true;
-				resume[thread]->signal();
-				worker[thread]->join();
+				suspend[thread]->wait();
 
-				delete worker[thread];
-				worker[thread] = 0;
-				delete resume[thread];
-				resume[thread] = 0;
 				delete suspend[thread];
 				suspend[thread] = 0;
 			}
@@ -2124,7 +2477,7 @@ namespace sw
 
 	void Renderer::setTransparencyAntialiasing(TransparencyAntialiasing transparencyAntialiasing)
 	{
-		sw::transparencyAntialiasing = transparencyAntialiasing;
+		context->setState(sw::transparencyAntialiasing, transparencyAntialiasing);
 	}
 
 	bool Renderer::isReadWriteTexture(int sampler)
@@ -2224,6 +2577,18 @@ namespace sw
 		}
 	}
 
+	void Renderer::setSeamlessCubeMap(SamplerType type, int sampler, bool enable)
+	{
+		if(type == SAMPLER_PIXEL)
+		{
+			PixelProcessor::setSeamlessCubeMap(sampler, enable);
+		}
+		else
+		{
+			VertexProcessor::setSeamlessCubeMap(sampler, enable);
+		}
+	}
+
 	void Renderer::setAddressingModeU(SamplerType type, int sampler, AddressingMode addressMode)
 	{
 		if(type == SAMPLER_PIXEL)
@@ -2426,24 +2791,29 @@ namespace sw
 
 	void Renderer::setSlopeDepthBias(float slopeBias)
 	{
+		if((slopeDepthBias != 0.0f) != (slopeBias != 0.0f))
+		{
+			context->stateDirty = true;   // Part of the setup state
+		}
+
 		slopeDepthBias = slopeBias;
 	}
 
 	void Renderer::setRasterizerDiscard(bool rasterizerDiscard)
 	{
-		context->rasterizerDiscard = rasterizerDiscard;
+		context->setState(context->rasterizerDiscard, rasterizerDiscard);
 	}
 
 	void Renderer::setPixelShader(const PixelShader *shader)
 	{
-		context->pixelShader = shader;
+		context->setState(context->pixelShader, shader);
 
 		loadConstants(shader);
 	}
 
 	void Renderer::setVertexShader(const VertexShader *shader)
 	{
-		context->vertexShader = shader;
+		context->setState(context->vertexShader, shader);
 
 		loadConstants(shader);
 	}
@@ -2641,6 +3011,39 @@ namespace sw
 		updateClipPlanes = true;
 	}
 
+	bool Renderer::stateModified() const
+	{
+		if(!vertexRoutine || context->isStateDirty())
+		{
+			return true;
+		}
+
+		// Shader objects can be reallocated at the same address. The vertex state keeps
+		// its serial ID as a uint64_t, converted from the int the way update() stores it.
+		int vertexSerialID = context->vertexShader ? context->vertexShader->getSerialID() : 0;
+		int pixelSerialID = context->pixelShader ? context->pixelShader->getSerialID() : 0;
+
+		if(vertexState.shaderID != (uint64_t)vertexSerialID || pixelState.shaderID != pixelSerialID)
+		{
+			return true;
+		}
+
+		// Input streams are reset and bound again for every draw
+		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+		{
+			const Stream &input = context->input[i];
+
+			if(vertexState.input[i].type != input.type ||
+			   vertexState.input[i].count != input.count ||
+			   vertexState.input[i].normalized != input.normalized)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	void Renderer::updateConfiguration(bool initialUpdate)
 	{
 		bool newConfiguration = swiftConfig->hasNewConfiguration();
@@ -2752,9 +3155,11 @@ namespace sw
 			minPrimitives = configuration.minPrimitives;
 			maxPrimitives = configuration.maxPrimitives;
 		#endif
+
+			context->stateDirty = true;   // The switches above are part of the processor states
 		}
 
-		if(!initialUpdate && !worker[0])
+		if(!initialUpdate && !suspend[0])
 		{
 			initializeThreads();
 		}
@@ -22,6 +22,7 @@
 #include "Blitter.hpp"
 #include "Common/MutexLock.hpp"
 #include "Common/Thread.hpp"
+#include "Common/ThreadPool.hpp"
 #include "Main/Config.hpp"
 
 #include <list>
@@ -181,6 +182,8 @@ namespace sw
 		float slopeDepthBias;
 		float depthRange;
 		float depthNear;
+		float guardBandX;   // Extent of the guard band, relative to w
+		float guardBandY;
 		Plane clipPlane[6];
 
 		unsigned int *colorBuffer[RENDERTARGETS];
@@ -214,10 +217,12 @@ namespace sw
 		int batchSize;
 
 		Routine *vertexRoutine;
+		Routine *positionRoutine;   // For culling before full vertex shading, if any
 		Routine *setupRoutine;
 		Routine *pixelRoutine;
 
 		VertexProcessor::RoutinePointer vertexPointer;
+		VertexProcessor::RoutinePointer positionPointer;
 		SetupProcessor::RoutinePointer setupPointer;
 		PixelProcessor::RoutinePointer pixelPointer;
 
@@ -246,6 +251,8 @@ namespace sw
 
 		int clipFlags;
 
+		Blitter::Operation *blit;   // Blit or clear instead of a draw, when non-null
+
 		volatile int primitive;    // Current primitive to enter pipeline
 		volatile int count;        // Number of primitives to render
 		volatile int references;   // Remaining references to this draw call, 0 when done drawing, -1 when resources unlocked and slot is free
@@ -337,6 +344,7 @@ namespace sw
 		void setTextureFilter(SamplerType type, int sampler, FilterType textureFilter);
 		void setMipmapFilter(SamplerType type, int sampler, MipmapType mipmapFilter);
 		void setGatherEnable(SamplerType type, int sampler, bool enable);
+		void setSeamlessCubeMap(SamplerType type, int sampler, bool enable);
 		void setAddressingModeU(SamplerType type, int sampler, AddressingMode addressingMode);
 		void setAddressingModeV(SamplerType type, int sampler, AddressingMode addressingMode);
 		void setAddressingModeW(SamplerType type, int sampler, AddressingMode addressingMode);
@@ -391,6 +399,12 @@ namespace sw
 
 		void synchronize();
 
+		// Scheduling on the process-wide thread pool, relative to other renderers
+		void setPriority(int priority);
+
+		// Whether the latest draw used vertex and pixel routines compiled with optimizations
+		bool hasOptimizedRoutines() const;
+
 		#if PERF_HUD
 			// Performance timers
 			int getThreadCount();
@@ -404,12 +418,15 @@ namespace sw
 		static void threadFunction(void *parameters);
 		void threadLoop(int threadIndex);
 		void taskLoop(int threadIndex);
+		void resumeThread(int threadIndex);
 		void findAvailableTasks();
 		void scheduleTask(int threadIndex);
 		void executeTask(int threadIndex);
 		void finishRendering(Task &pixelTask);
+		void scheduleBlit(Blitter::Operation *operation);
 
-		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+		int processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);   // Returns the number of triangles left for setup
+		int cullTriangles(const DrawCall &draw, const Triangle *triangle, unsigned int (*batch)[3], int count);
 
 		int setupSolidTriangles(int batch, int count);
 		int setupWireframeTriangle(int batch, int count);
@@ -419,10 +436,12 @@ namespace sw
 
 		bool setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
 		bool setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
+		int64_t coverage(int unit, int visible, int ms) const;   // Pixels within the primitive outlines
 
 		bool isReadWriteTexture(int sampler);
 		void updateClipper();
 		void updateConfiguration(bool initialUpdate = false);
+		bool stateModified() const;   // Since the processor states were last derived
 		void initializeThreads();
 		void terminateThreads();
 
@@ -443,10 +462,15 @@ namespace sw
 		Plane clipPlane[MAX_CLIP_PLANES];   // Tranformed to clip space
 		bool updateClipPlanes;
 
-		volatile bool exitThreads;
+		struct Parameters
+		{
+			Renderer *renderer;
+			int threadIndex;
+		};
+
 		volatile int threadsAwake;
-		Thread *worker[16];
-		Event *resume[16];         // Events for resuming threads
+		ThreadPool::Client *client;   // Queue for running this renderer's threads on the shared pool
+		Parameters threadParameters[16];
 		Event *suspend[16];        // Events for suspending threads
 		Event *resumeApp;          // Event for resuming the application thread
 
@@ -481,12 +505,19 @@ namespace sw
 		Resource *sync;
 
 		VertexProcessor::State vertexState;
+		VertexProcessor::State prepassState;   // Of the position routine
 		SetupProcessor::State setupState;
 		PixelProcessor::State pixelState;
 
+		// Referenced until replaced, as the shared routine caches can evict them
 		Routine *vertexRoutine;
+		Routine *positionRoutine;
 		Routine *setupRoutine;
 		Routine *pixelRoutine;
+
+		// Promotion counts of the routine caches when the routines were queried
+		int vertexPromotions;
+		int pixelPromotions;
 	};
 }
 
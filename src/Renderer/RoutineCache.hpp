@@ -17,32 +17,245 @@
 
 #include "LRUCache.hpp"
 
+#include "Common/Thread.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Common/MutexLock.hpp"
+#include "Common/Debug.hpp"
+#include "Common/Trace.hpp"
 #include "Reactor/Reactor.hpp"
 
+#include <functional>
+
 namespace sw
 {
+	extern bool tieredCompilation;
+
 	template<class State>
 	class RoutineCache : public LRUCache<State, Routine>
 	{
 	public:
+		// One cache per State type is shared by all renderers in the process. It is created
+		// by the first user and deleted with the last one.
+		static RoutineCache *acquireShared(int n, const char *precache = 0);
+		static void releaseShared();
+
 		RoutineCache(int n, const char *precache = 0);
 		~RoutineCache();
 
+		// Routines are returned with a reference held for the caller, since other threads can
+		// evict them at any time. Add returns the cached routine instead of the new one if
+		// another thread added the same state first.
+		Routine *query(const State &state);
+		Routine *add(const State &state, Routine *routine);
+		void resize(int n);
+
+		// Tiered compilation. Routines are first compiled without optimizations. Each draw
+		// counts a use of its routines, and isHot() returns true exactly once per routine when
+		// it has been used often enough. promote() then recompiles it with optimizations as a
+		// job on the shared thread pool, and the result replaces the cached routine. Callers
+		// which keep routines across draws poll promotions() to know when to query again.
+		// Both tiers use the Reactor back-end the library is built with, since the LLVM and
+		// Subzero back-ends each define the whole Reactor API and cannot be linked together.
+		// The compile function must not depend on objects the application can change, so
+		// shaders are copied, and copies keep the version which selects their semantics.
+		bool isHot(Routine *routine);
+		void promote(const State &state, const std::function<Routine*()> &compile);
+		int promotions() const;   // Number of routines replaced so far
+
 	private:
+		struct Promotion
+		{
+			RoutineCache *cache;
+			State state;
+			std::function<Routine*()> compile;
+		};
+
+		static void promotionJob(void *parameters);
+
+		static RoutineCache *shared;
+		static int sharedCount;
+		static BackoffLock sharedMutex;
+
+		enum {PROMOTION_THRESHOLD = 16};   // Uses before recompiling with optimizations
+
 		const char *precache;
 		#if defined(_WIN32)
 		HMODULE precacheDLL;
 		#endif
+
+		BackoffLock mutex;
+
+		ThreadPool::Client *promotionClient;   // Created with the first promotion
+		volatile int promotionCount;
 	};
 
+	template<class State>
+	RoutineCache<State> *RoutineCache<State>::shared = nullptr;
+
+	template<class State>
+	int RoutineCache<State>::sharedCount = 0;
+
+	template<class State>
+	BackoffLock RoutineCache<State>::sharedMutex;
+
+	template<class State>
+	RoutineCache<State> *RoutineCache<State>::acquireShared(int n, const char *precache)
+	{
+		sharedMutex.lock();
+
+		if(!shared)
+		{
+			shared = new RoutineCache<State>(n, precache);
+		}
+
+		sharedCount++;
+
+		RoutineCache<State> *cache = shared;
+		sharedMutex.unlock();
+
+		return cache;
+	}
+
+	template<class State>
+	void RoutineCache<State>::releaseShared()
+	{
+		sharedMutex.lock();
+
+		if(--sharedCount == 0)
+		{
+			delete shared;
+			shared = nullptr;
+		}
+
+		sharedMutex.unlock();
+	}
+
 	template<class State>
 	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache)
 	{
+		promotionClient = nullptr;
+		promotionCount = 0;
 	}
 
 	template<class State>
 	RoutineCache<State>::~RoutineCache()
 	{
+		if(promotionClient)
+		{
+			ThreadPool::destroyClient(promotionClient);   // Waits for the promotions in progress
+		}
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::query(const State &state)
+	{
+		mutex.lock();
+
+		Routine *routine = LRUCache<State, Routine>::query(state);
+
+		if(routine)
+		{
+			routine->bind();
+		}
+
+		mutex.unlock();
+
+		return routine;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::add(const State &state, Routine *routine)
+	{
+		mutex.lock();
+
+		Routine *cached = LRUCache<State, Routine>::query(state);
+
+		if(cached)
+		{
+			delete routine;   // Compiled concurrently by another renderer
+			routine = cached;
+		}
+		else
+		{
+			LRUCache<State, Routine>::add(state, routine);
+		}
+
+		routine->bind();
+		mutex.unlock();
+
+		return routine;
+	}
+
+	template<class State>
+	void RoutineCache<State>::resize(int n)
+	{
+		mutex.lock();
+		LRUCache<State, Routine>::resize(n);
+		mutex.unlock();
+	}
+
+	template<class State>
+	bool RoutineCache<State>::isHot(Routine *routine)
+	{
+		if(!tieredCompilation || routine->isOptimized())
+		{
+			return false;
+		}
+
+		return routine->use() == PROMOTION_THRESHOLD;   // Only one caller sees the threshold
+	}
+
+	template<class State>
+	void RoutineCache<State>::promote(const State &state, const std::function<Routine*()> &compile)
+	{
+		mutex.lock();
+
+		if(!promotionClient)
+		{
+			promotionClient = ThreadPool::createClient();
+		}
+
+		mutex.unlock();
+
+		Promotion *promotion = new Promotion();
+		promotion->cache = this;
+		promotion->state = state;
+		promotion->compile = compile;
+
+		ThreadPool::reserve(1);
+		ThreadPool::submit(promotionClient, promotionJob, promotion);
+	}
+
+	template<class State>
+	int RoutineCache<State>::promotions() const
+	{
+		return promotionCount;
+	}
+
+	template<class State>
+	void RoutineCache<State>::promotionJob(void *parameters)
+	{
+		Promotion *promotion = static_cast<Promotion*>(parameters);
+		RoutineCache<State> *cache = promotion->cache;
+
+		Routine *routine = promotion->compile();
+
+		cache->mutex.lock();
+
+		if(routine && !cache->LRUCache<State, Routine>::replace(promotion->state, routine))
+		{
+			delete routine;   // Evicted while compiling
+			routine = nullptr;
+		}
+
+		cache->mutex.unlock();
+
+		if(routine)
+		{
+			atomicIncrement(&cache->promotionCount);
+		}
+
+		delete promotion;
 	}
 }
 
@@ -24,6 +24,8 @@
 
 namespace sw
 {
+	extern bool adaptiveAnisotropy;
+
 	FilterType Sampler::maximumTextureFilterQuality = FILTER_LINEAR;
 	MipmapType Sampler::maximumMipmapFilterQuality = MIPMAP_POINT;
 
@@ -46,9 +48,15 @@ namespace sw
 			for(int face = 0; face < 6; face++)
 			{
 				mipmap.buffer[face] = &zero;
+				tiledMipmap[level].buffer[face] = &zero;
 			}
+
+			tiledMipmap[level].pitchP = 0;
+			tiledMipmap[level].sliceP = 0;
 		}
 
+		linearLevels = (1 << MIPMAP_LEVELS) - 1;
+
 		externalTextureFormat = FORMAT_NULL;
 		internalTextureFormat = FORMAT_NULL;
 		textureType = TEXTURE_NULL;
@@ -60,6 +68,7 @@ namespace sw
 		mipmapFilterState = MIPMAP_NONE;
 		sRGB = false;
 		gather = false;
+		seamlessCube = false;
 
 		swizzleR = SWIZZLE_RED;
 		swizzleG = SWIZZLE_GREEN;
@@ -73,6 +82,8 @@ namespace sw
 		texture.maxLevel = 1000;
 		texture.maxLod = MIPMAP_LEVELS - 2;	// Trilinear accesses lod+1
 		texture.minLod = 0;
+
+		modified = true;
 	}
 
 	Sampler::~Sampler()
@@ -97,6 +108,9 @@ namespace sw
 			state.swizzleG = swizzleG;
 			state.swizzleB = swizzleB;
 			state.swizzleA = swizzleA;
+			state.tiledLayout = hasTiledLayout();
+			state.adaptiveAnisotropy = adaptiveAnisotropy && state.textureFilter == FILTER_ANISOTROPIC;
+			state.seamlessCube = seamlessCube && textureType == TEXTURE_CUBE && state.textureFilter != FILTER_POINT && state.textureFilter != FILTER_GATHER;
 
 			#if PERF_PROFILE
 				state.compressedFormat = Surface::isCompressed(externalTextureFormat);
@@ -112,10 +126,33 @@ namespace sw
 		{
 			Mipmap &mipmap = texture.mipmap[level];
 
-			mipmap.buffer[face] = surface->lockInternal(0, 0, 0, LOCK_UNLOCKED, PRIVATE);
+			const void *buffer = surface->lockInternal(0, 0, 0, LOCK_UNLOCKED, PRIVATE);
+			modified = modified || (face == 0 && mipmap.buffer[0] != buffer);   // See mipmapFilter()
+			mipmap.buffer[face] = buffer;
+
+			TiledMipmap &tiled = tiledMipmap[level];
+			tiled.buffer[face] = surface->lockTiled(PRIVATE);
+			unsigned int linear = tiled.buffer[face] ? 0 : 1 << level;
+			unsigned int previousLevels = linearLevels;
+
+			if(face == 0)
+			{
+				tiled.pitchP = surface->getTiledPitchP();
+				tiled.sliceP = surface->getTiledSliceP();
+				linearLevels = (linearLevels & ~(1 << level)) | linear;
+			}
+			else
+			{
+				linearLevels |= linear;
+			}
+
+			modified = modified || (linearLevels != previousLevels);
 
 			if(face == 0)
 			{
+				modified = modified || (externalTextureFormat != surface->getExternalFormat()) ||
+				                       (internalTextureFormat != surface->getInternalFormat());
+
 				externalTextureFormat = surface->getExternalFormat();
 				internalTextureFormat = surface->getInternalFormat();
 
@@ -148,23 +185,20 @@ namespace sw
 					texture.depthLOD[3] = depth * exp2LOD;
 				}
 
-				if(Surface::isFloatFormat(internalTextureFormat))
-				{
-					mipmap.fWidth[0] = (float)width / 65536.0f;
-					mipmap.fWidth[1] = (float)width / 65536.0f;
-					mipmap.fWidth[2] = (float)width / 65536.0f;
-					mipmap.fWidth[3] = (float)width / 65536.0f;
-
-					mipmap.fHeight[0] = (float)height / 65536.0f;
-					mipmap.fHeight[1] = (float)height / 65536.0f;
-					mipmap.fHeight[2] = (float)height / 65536.0f;
-					mipmap.fHeight[3] = (float)height / 65536.0f;
-
-					mipmap.fDepth[0] = (float)depth / 65536.0f;
-					mipmap.fDepth[1] = (float)depth / 65536.0f;
-					mipmap.fDepth[2] = (float)depth / 65536.0f;
-					mipmap.fDepth[3] = (float)depth / 65536.0f;
-				}
+				mipmap.fWidth[0] = (float)width / 65536.0f;
+				mipmap.fWidth[1] = (float)width / 65536.0f;
+				mipmap.fWidth[2] = (float)width / 65536.0f;
+				mipmap.fWidth[3] = (float)width / 65536.0f;
+
+				mipmap.fHeight[0] = (float)height / 65536.0f;
+				mipmap.fHeight[1] = (float)height / 65536.0f;
+				mipmap.fHeight[2] = (float)height / 65536.0f;
+				mipmap.fHeight[3] = (float)height / 65536.0f;
+
+				mipmap.fDepth[0] = (float)depth / 65536.0f;
+				mipmap.fDepth[1] = (float)depth / 65536.0f;
+				mipmap.fDepth[2] = (float)depth / 65536.0f;
+				mipmap.fDepth[3] = (float)depth / 65536.0f;
 
 				short halfTexelU = 0x8000 / width;
 				short halfTexelV = 0x8000 / height;
@@ -236,41 +270,59 @@ namespace sw
 			}
 		}
 
+		modified = modified || (textureType != type);
 		textureType = type;
 	}
 
 	void Sampler::setTextureFilter(FilterType textureFilter)
 	{
-		this->textureFilter = (FilterType)min(textureFilter, maximumTextureFilterQuality);
+		textureFilter = (FilterType)min(textureFilter, maximumTextureFilterQuality);
+
+		modified = modified || (this->textureFilter != textureFilter);
+		this->textureFilter = textureFilter;
 	}
 
 	void Sampler::setMipmapFilter(MipmapType mipmapFilter)
 	{
-		mipmapFilterState = (MipmapType)min(mipmapFilter, maximumMipmapFilterQuality);
+		mipmapFilter = (MipmapType)min(mipmapFilter, maximumMipmapFilterQuality);
+
+		modified = modified || (mipmapFilterState != mipmapFilter);
+		mipmapFilterState = mipmapFilter;
 	}
 
 	void Sampler::setGatherEnable(bool enable)
 	{
+		modified = modified || (gather != enable);
 		gather = enable;
 	}
 
+	void Sampler::setSeamlessCubeMap(bool enable)
+	{
+		modified = modified || (seamlessCube != enable);
+		seamlessCube = enable;
+	}
+
 	void Sampler::setAddressingModeU(AddressingMode addressingMode)
 	{
+		modified = modified || (addressingModeU != addressingMode);
 		addressingModeU = addressingMode;
 	}
 
 	void Sampler::setAddressingModeV(AddressingMode addressingMode)
 	{
+		modified = modified || (addressingModeV != addressingMode);
 		addressingModeV = addressingMode;
 	}
 
 	void Sampler::setAddressingModeW(AddressingMode addressingMode)
 	{
+		modified = modified || (addressingModeW != addressingMode);
 		addressingModeW = addressingMode;
 	}
 
 	void Sampler::setReadSRGB(bool sRGB)
 	{
+		modified = modified || (this->sRGB != sRGB);
 		this->sRGB = sRGB;
 	}
 
@@ -295,26 +347,31 @@ namespace sw
 
 	void Sampler::setMaxAnisotropy(float maxAnisotropy)
 	{
+		modified = modified || (texture.maxAnisotropy != maxAnisotropy);
 		texture.maxAnisotropy = maxAnisotropy;
 	}
 
 	void Sampler::setSwizzleR(SwizzleType swizzleR)
 	{
+		modified = modified || (this->swizzleR != swizzleR);
 		this->swizzleR = swizzleR;
 	}
 
 	void Sampler::setSwizzleG(SwizzleType swizzleG)
 	{
+		modified = modified || (this->swizzleG != swizzleG);
 		this->swizzleG = swizzleG;
 	}
 
 	void Sampler::setSwizzleB(SwizzleType swizzleB)
 	{
+		modified = modified || (this->swizzleB != swizzleB);
 		this->swizzleB = swizzleB;
 	}
 
 	void Sampler::setSwizzleA(SwizzleType swizzleA)
 	{
+		modified = modified || (this->swizzleA != swizzleA);
 		this->swizzleA = swizzleA;
 	}
 
@@ -377,9 +434,46 @@ namespace sw
 		return textureType == TEXTURE_3D || textureType == TEXTURE_2D_ARRAY;
 	}
 
+	bool Sampler::isModified() const
+	{
+		return modified;
+	}
+
+	void Sampler::clearModified()
+	{
+		modified = false;
+	}
+
 	const Texture &Sampler::getTextureData()
 	{
-		return texture;
+		if(!hasTiledLayout())
+		{
+			return texture;
+		}
+
+		tiledTexture = texture;
+
+		for(int level = 0; level < MIPMAP_LEVELS; level++)
+		{
+			Mipmap &mipmap = tiledTexture.mipmap[level];
+			const TiledMipmap &tiled = tiledMipmap[level];
+
+			for(int face = 0; face < 6; face++)
+			{
+				mipmap.buffer[face] = tiled.buffer[face];
+			}
+
+			// SamplerCore multiplies the tile column by 4, see computeIndices()
+			mipmap.onePitchP[0] = 4;
+			mipmap.onePitchP[1] = tiled.pitchP;
+			mipmap.onePitchP[2] = 4;
+			mipmap.onePitchP[3] = tiled.pitchP;
+
+			mipmap.sliceP[0] = tiled.sliceP;
+			mipmap.sliceP[1] = tiled.sliceP;
+		}
+
+		return tiledTexture;
 	}
 
 	MipmapType Sampler::mipmapFilter() const
@@ -441,6 +535,12 @@ namespace sw
 		return addressingModeV;
 	}
 
+	bool Sampler::hasTiledLayout() const
+	{
+		// All levels must be tiled, since the layout is part of the sampler state
+		return textureType != TEXTURE_NULL && linearLevels == 0;
+	}
+
 	AddressingMode Sampler::getAddressingModeW() const
 	{
 		if(hasCubeTexture())
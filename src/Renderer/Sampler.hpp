@@ -139,6 +139,9 @@ namespace sw
 			SwizzleType swizzleG           : BITS(SWIZZLE_LAST);
 			SwizzleType swizzleB           : BITS(SWIZZLE_LAST);
 			SwizzleType swizzleA           : BITS(SWIZZLE_LAST);
+			bool tiledLayout               : 1;
+			bool seamlessCube              : 1;
+			bool adaptiveAnisotropy        : 1;
 
 			#if PERF_PROFILE
 			bool compressedFormat          : 1;
@@ -156,6 +159,7 @@ namespace sw
 		void setTextureFilter(FilterType textureFilter);
 		void setMipmapFilter(MipmapType mipmapFilter);
 		void setGatherEnable(bool enable);
+		void setSeamlessCubeMap(bool enable);
 		void setAddressingModeU(AddressingMode addressingMode);
 		void setAddressingModeV(AddressingMode addressingMode);
 		void setAddressingModeW(AddressingMode addressingMode);
@@ -182,6 +186,10 @@ namespace sw
 
 		const Texture &getTextureData();
 
+		// Set when a field which affects the sampler state changes
+		bool isModified() const;
+		void clearModified();
+
 	private:
 		MipmapType mipmapFilter() const;
 		TextureType getTextureType() const;
@@ -189,6 +197,7 @@ namespace sw
 		AddressingMode getAddressingModeU() const;
 		AddressingMode getAddressingModeV() const;
 		AddressingMode getAddressingModeW() const;
+		bool hasTiledLayout() const;
 
 		Format externalTextureFormat;
 		Format internalTextureFormat;
@@ -201,6 +210,7 @@ namespace sw
 		MipmapType mipmapFilterState;
 		bool sRGB;
 		bool gather;
+		bool seamlessCube;
 
 		SwizzleType swizzleR;
 		SwizzleType swizzleG;
@@ -209,6 +219,19 @@ namespace sw
 		Texture texture;
 		float exp2LOD;
 
+		struct TiledMipmap
+		{
+			const void *buffer[6];
+			short pitchP;
+			int sliceP;
+		};
+
+		TiledMipmap tiledMipmap[MIPMAP_LEVELS];
+		unsigned int linearLevels;   // Levels with a face that has no tiled copy
+		Texture tiledTexture;
+
+		bool modified;
+
 		static FilterType maximumTextureFilterQuality;
 		static MipmapType maximumMipmapFilterQuality;
 	};
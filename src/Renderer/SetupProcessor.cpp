@@ -21,6 +21,10 @@
 #include "Renderer.hpp"
 #include "Constants.hpp"
 #include "Debug.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "CompileLog.hpp"
+#include "Timer.hpp"
 
 namespace sw
 {
@@ -59,13 +63,12 @@ namespace sw
 
 	SetupProcessor::SetupProcessor(Context *context) : context(context)
 	{
-		routineCache = 0;
-		setRoutineCacheSize(1024);
+		routineCache = RoutineCache<State>::acquireShared(1024, precacheSetup ? "sw-setup" : 0);
 	}
 
 	SetupProcessor::~SetupProcessor()
 	{
-		delete routineCache;
+		RoutineCache<State>::releaseShared();
 		routineCache = 0;
 	}
 
@@ -227,14 +230,23 @@ namespace sw
 	{
 		Routine *routine = routineCache->query(state);
 
+		Metrics::add(routine ? Metrics::SETUP_ROUTINE_HITS : Metrics::SETUP_ROUTINE_MISSES);
+
 		if(!routine)
 		{
+			TraceSpan span("Compile setup routine", "jit");
+			int64_t start = Metrics::enabled() ? Timer::counter() : 0;
+
 			SetupRoutine *generator = new SetupRoutine(state);
 			generator->generate();
 			routine = generator->getRoutine();
 			delete generator;
 
-			routineCache->add(state, routine);
+			CompileLog::add(CompileLog::SETUP, &state, sizeof(State), routine);
+			Metrics::add(Metrics::SETUP_ROUTINE_COMPILES);
+			Metrics::addTime(Metrics::SETUP_COMPILE_TIME, start);
+
+			routine = routineCache->add(state, routine);
 		}
 
 		return routine;
@@ -242,7 +254,6 @@ namespace sw
 
 	void SetupProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheSetup ? "sw-setup" : 0);
+		routineCache->resize(clamp(cacheSize, 1, 65536));
 	}
 }
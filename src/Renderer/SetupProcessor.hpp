@@ -91,7 +91,7 @@ namespace sw
 
 	protected:
 		State update() const;
-		Routine *routine(const State &state);
+		Routine *routine(const State &state);   // Returns a reference which the caller must unbind
 
 		void setRoutineCacheSize(int cacheSize);
 
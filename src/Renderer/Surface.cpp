@@ -34,6 +34,7 @@
 namespace sw
 {
 	extern bool quadLayoutEnabled;
+	extern bool tiledTextureLayout;
 	extern bool complementaryDepthBuffer;
 	extern TranscendentalPrecision logPrecision;
 
@@ -48,6 +49,70 @@ namespace sw
 		y1 = clamp(y1, minY, maxY);
 	}
 
+	void Region::merge(const Region &region)
+	{
+		x0 = min(x0, region.x0);
+		y0 = min(y0, region.y0);
+		z0 = min(z0, region.z0);
+		x1 = max(x1, region.x1);
+		y1 = max(y1, region.y1);
+		z1 = max(z1, region.z1);
+	}
+
+	bool Region::contains(const Region &region) const
+	{
+		return x0 <= region.x0 && y0 <= region.y0 && z0 <= region.z0 &&
+		       x1 >= region.x1 && y1 >= region.y1 && z1 >= region.z1;
+	}
+
+	void RegionList::add(const Region &newRegion)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			if(region[i].contains(newRegion))
+			{
+				return;
+			}
+		}
+
+		// Drop the regions the new one covers
+		int kept = 0;
+
+		for(int i = 0; i < count; i++)
+		{
+			if(!newRegion.contains(region[i]))
+			{
+				region[kept++] = region[i];
+			}
+		}
+
+		count = kept;
+
+		if(count < MAX_REGIONS)
+		{
+			region[count++] = newRegion;
+			return;
+		}
+
+		int nearest = 0;
+		long long leastGrowth = 0;
+
+		for(int i = 0; i < count; i++)
+		{
+			Region merged = region[i];
+			merged.merge(newRegion);
+			long long growth = merged.volume() - region[i].volume();
+
+			if(i == 0 || growth < leastGrowth)
+			{
+				nearest = i;
+				leastGrowth = growth;
+			}
+		}
+
+		region[nearest].merge(newRegion);
+	}
+
 	void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
 	{
 		void *element = (unsigned char*)buffer + x * bytes + y * pitchB + z * sliceB;
@@ -1078,7 +1143,7 @@ namespace sw
 		case LOCK_WRITEONLY:
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
-			dirty = true;
+			markDirty();
 			break;
 		default:
 			ASSERT(false);
@@ -1165,6 +1230,48 @@ namespace sw
 		lock = LOCK_UNLOCKED;
 	}
 
+	void Surface::Buffer::markDirty()
+	{
+		dirty = true;
+		dirtyRegions.clear();
+		dirtyRegions.add(Region(0, 0, 0, width, height, depth));
+	}
+
+	void Surface::Buffer::markDirty(const Region &region)
+	{
+		Region clipped = region;
+		clipped.clip(0, 0, width, height);
+		clipped.z0 = max(clipped.z0, 0);
+		clipped.z1 = min(clipped.z1, depth);
+
+		if(clipped.width() <= 0 || clipped.height() <= 0 || clipped.depth() <= 0)
+		{
+			return;
+		}
+
+		if(!dirty)
+		{
+			dirty = true;
+			dirtyRegions.clear();
+		}
+
+		dirtyRegions.add(clipped);
+	}
+
+	Surface::Buffer Surface::Buffer::view(const Region &region) const
+	{
+		Buffer view = *this;
+
+		view.buffer = (unsigned char*)buffer + region.z0 * sliceB + region.y0 * pitchB + region.x0 * bytes;
+		view.width = region.width();
+		view.height = region.height();
+		view.depth = region.depth();
+		view.dirtyRegions.clear();
+		view.dirtyRegions.add(Region(0, 0, 0, view.width, view.height, view.depth));
+
+		return view;
+	}
+
 	Surface::Surface(int width, int height, int depth, Format format, void *pixels, int pitch, int slice) : lockable(true), renderTarget(false)
 	{
 		resource = new Resource(0);
@@ -1183,7 +1290,8 @@ namespace sw
 		external.sliceB = slice;
 		external.sliceP = external.bytes ? slice / external.bytes : 0;
 		external.lock = LOCK_UNLOCKED;
-		external.dirty = true;
+		external.tiledLayout = false;
+		external.markDirty();
 
 		internal.buffer = 0;
 		internal.width = width;
@@ -1196,6 +1304,7 @@ namespace sw
 		internal.sliceB = sliceB(internal.width, internal.height, internal.format, false);
 		internal.sliceP = sliceP(internal.width, internal.height, internal.format, false);
 		internal.lock = LOCK_UNLOCKED;
+		internal.tiledLayout = false;
 		internal.dirty = false;
 
 		stencil.buffer = 0;
@@ -1209,8 +1318,25 @@ namespace sw
 		stencil.sliceB = sliceB(stencil.width, stencil.height, stencil.format, false);
 		stencil.sliceP = sliceP(stencil.width, stencil.height, stencil.format, false);
 		stencil.lock = LOCK_UNLOCKED;
+		stencil.tiledLayout = false;
 		stencil.dirty = false;
 
+		tiled.buffer = 0;
+		tiled.width = width;
+		tiled.height = height;
+		tiled.depth = depth;
+		tiled.format = internal.format;
+		tiled.bytes = internal.bytes;
+		tiled.pitchP = align(width, 4);
+		tiled.pitchB = tiled.pitchP * tiled.bytes;
+		tiled.sliceP = tiled.pitchP * align(height, 4);
+		tiled.sliceB = tiled.sliceP * tiled.bytes;
+		tiled.lock = LOCK_UNLOCKED;
+		tiled.tiledLayout = true;
+		tiled.dirty = false;
+
+		tiledStale = false;
+
 		dirtyMipmaps = true;
 		paletteUsed = 0;
 	}
@@ -1233,6 +1359,7 @@ namespace sw
 		external.sliceB = sliceB(external.width, external.height, external.format, renderTarget && !texture);
 		external.sliceP = sliceP(external.width, external.height, external.format, renderTarget && !texture);
 		external.lock = LOCK_UNLOCKED;
+		external.tiledLayout = false;
 		external.dirty = false;
 
 		internal.buffer = 0;
@@ -1246,6 +1373,7 @@ namespace sw
 		internal.sliceB = sliceB(internal.width, internal.height, internal.format, renderTarget);
 		internal.sliceP = sliceP(internal.width, internal.height, internal.format, renderTarget);
 		internal.lock = LOCK_UNLOCKED;
+		internal.tiledLayout = false;
 		internal.dirty = false;
 
 		stencil.buffer = 0;
@@ -1259,8 +1387,25 @@ namespace sw
 		stencil.sliceB = sliceB(stencil.width, stencil.height, stencil.format, renderTarget);
 		stencil.sliceP = sliceP(stencil.width, stencil.height, stencil.format, renderTarget);
 		stencil.lock = LOCK_UNLOCKED;
+		stencil.tiledLayout = false;
 		stencil.dirty = false;
 
+		tiled.buffer = 0;
+		tiled.width = width;
+		tiled.height = height;
+		tiled.depth = depth;
+		tiled.format = internal.format;
+		tiled.bytes = internal.bytes;
+		tiled.pitchP = align(width, 4);
+		tiled.pitchB = tiled.pitchP * tiled.bytes;
+		tiled.sliceP = tiled.pitchP * align(height, 4);
+		tiled.sliceB = tiled.sliceP * tiled.bytes;
+		tiled.lock = LOCK_UNLOCKED;
+		tiled.tiledLayout = true;
+		tiled.dirty = false;
+
+		tiledStale = false;
+
 		dirtyMipmaps = true;
 		paletteUsed = 0;
 	}
@@ -1287,10 +1432,12 @@ namespace sw
 		}
 
 		deallocate(stencil.buffer);
+		deallocate(tiled.buffer);
 
 		external.buffer = 0;
 		internal.buffer = 0;
 		stencil.buffer = 0;
+		tiled.buffer = 0;
 	}
 
 	void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
@@ -1335,11 +1482,28 @@ namespace sw
 		return external.lockRect(x, y, z, lock);
 	}
 
-	void Surface::unlockExternal()
+	void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client, const Region &writeRegion)
 	{
-		resource->unlock();
+		bool dirty = external.dirty;
+		RegionList dirtyRegions = external.dirtyRegions;
+
+		void *data = lockExternal(x, y, z, lock, client);
+
+		if(lock == LOCK_WRITEONLY || lock == LOCK_READWRITE)
+		{
+			external.dirty = dirty;
+			external.dirtyRegions = dirtyRegions;
+			external.markDirty(writeRegion);
+		}
+
+		return data;
+	}
 
+	void Surface::unlockExternal()
+	{
 		external.unlockRect();
+
+		resource->unlock();   // Last access, the surface may get destroyed once unlocked
 	}
 
 	void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
@@ -1386,11 +1550,21 @@ namespace sw
 			}
 		}
 
-		if(external.dirty || (isPalette(external.format) && paletteUsed != Surface::paletteID))
+		if(isPalette(external.format) && paletteUsed != Surface::paletteID)
+		{
+			external.markDirty();   // All texels change with the palette
+		}
+
+		if(external.dirty)
 		{
 			if(lock != LOCK_DISCARD)
 			{
 				update(internal, external);
+
+				for(int i = 0; i < external.dirtyRegions.count; i++)
+				{
+					markTiledStale(external.dirtyRegions.region[i]);
+				}
 			}
 
 			external.dirty = false;
@@ -1406,6 +1580,7 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyMipmaps = true;
+			markTiledStale(Region(0, 0, 0, internal.width, internal.height, internal.depth));
 			break;
 		default:
 			ASSERT(false);
@@ -1419,11 +1594,97 @@ namespace sw
 		return internal.lockRect(x, y, z, lock);
 	}
 
-	void Surface::unlockInternal()
+	void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client, const Region &writeRegion)
 	{
-		resource->unlock();
+		bool dirty = internal.dirty;
+		RegionList dirtyRegions = internal.dirtyRegions;
+		bool stale = tiledStale;
+		RegionList staleRegions = tiledStaleRegions;
+		bool updated = external.dirty || isPalette(external.format);
+
+		void *data = lockInternal(x, y, z, lock, client);
 
+		if(lock == LOCK_WRITEONLY || lock == LOCK_READWRITE)
+		{
+			internal.dirty = dirty;
+			internal.dirtyRegions = dirtyRegions;
+			internal.markDirty(writeRegion);
+
+			if(!updated)
+			{
+				tiledStale = stale;
+				tiledStaleRegions = staleRegions;
+				markTiledStale(writeRegion);
+			}
+		}
+
+		return data;
+	}
+
+	void Surface::unlockInternal()
+	{
 		internal.unlockRect();
+
+		resource->unlock();   // Last access, the surface may get destroyed once unlocked
+	}
+
+	void *Surface::lockTiled(Accessor client)
+	{
+		if(!tiledTextureLayout || !ownExternal || !isTileable(internal.format))
+		{
+			return nullptr;
+		}
+
+		// Waits for deferred writes, like blits and render-to-texture. Earlier readers of
+		// the tiled copy can't be pending when it's stale, since writes wait for them.
+		lockInternal(0, 0, 0, LOCK_READONLY, PRIVATE);
+
+		if(!tiled.buffer)
+		{
+			tiled.buffer = allocateBuffer(tiled.pitchP, align(tiled.height, 4), tiled.depth, tiled.format);
+			markTiledStale(Region(0, 0, 0, tiled.width, tiled.height, tiled.depth));
+		}
+
+		if(tiledStale)
+		{
+			Buffer source = internal;
+			source.dirty = true;
+			source.dirtyRegions = tiledStaleRegions;
+
+			update(tiled, source);
+
+			tiledStale = false;
+		}
+
+		unlockInternal();
+
+		return tiled.buffer;
+	}
+
+	void Surface::markTiledStale(const Region &region)
+	{
+		if(!tiled.buffer)
+		{
+			return;   // Tiled entirely on first use
+		}
+
+		Region clipped = region;
+		clipped.clip(0, 0, tiled.width, tiled.height);
+		clipped.z0 = max(clipped.z0, 0);
+		clipped.z1 = min(clipped.z1, tiled.depth);
+
+		if(clipped.width() <= 0 || clipped.height() <= 0 || clipped.depth() <= 0)
+		{
+			return;
+		}
+
+		if(!tiledStale)
+		{
+			tiledStale = true;
+			tiledStaleRegions.clear();
+		}
+
+		tiledStaleRegions.add(clipped);
 	}
 
 	void *Surface::lockStencil(int x, int y, int front, Accessor client)
@@ -1440,9 +1701,9 @@ namespace sw
 
 	void Surface::unlockStencil()
 	{
-		resource->unlock();
-
 		stencil.unlockRect();
+
+		resource->unlock();   // Last access, the surface may get destroyed once unlocked
 	}
 
 	int Surface::bytes(Format format)
@@ -1773,6 +2034,56 @@ namespace sw
 		{
 			ASSERT(source.dirty && !destination.dirty);
 
+			int width = min(destination.width, source.width);
+			int height = min(destination.height, source.height);
+			int depth = min(destination.depth, source.depth);
+
+			bool entire = false;
+
+			for(int i = 0; i < source.dirtyRegions.count; i++)
+			{
+				const Region &region = source.dirtyRegions.region[i];
+
+				entire = entire || (region.x0 <= 0 && region.y0 <= 0 && region.z0 <= 0 &&
+				                    region.x1 >= width && region.y1 >= height && region.z1 >= depth);
+			}
+
+			if(destination.tiledLayout)
+			{
+				ASSERT(destination.format == source.format && !source.tiledLayout);
+
+				for(int i = 0; i < source.dirtyRegions.count; i++)
+				{
+					Region region = source.dirtyRegions.region[i];
+					region.clip(0, 0, width, height);
+					region.z1 = min(region.z1, depth);
+
+					tile(destination, source, region);
+				}
+
+				return;
+			}
+
+			if(!entire && hasRegionViews(source.format) && hasRegionViews(destination.format))
+			{
+				for(int i = 0; i < source.dirtyRegions.count; i++)
+				{
+					Region region = source.dirtyRegions.region[i];
+					region.clip(0, 0, width, height);
+					region.z1 = min(region.z1, depth);
+
+					if(region.width() > 0 && region.height() > 0 && region.depth() > 0)
+					{
+						Buffer destinationRegion = destination.view(region);
+						Buffer sourceRegion = source.view(region);
+
+						update(destinationRegion, sourceRegion);
+					}
+				}
+
+				return;
+			}
+
 			switch(source.format)
 			{
 			case FORMAT_R8G8B8:		decodeR8G8B8(destination, source);		break;   // FIXME: Check destination format
@@ -1877,6 +2188,31 @@ namespace sw
 		}
 	}
 
+	void Surface::tile(Buffer &destination, const Buffer &source, const Region &region)
+	{
+		// Texel (x, y) of a 4x4 tile layout is at (y & ~3) * pitchP + (x & ~3) * 4 + (y & 3) * 4 + (x & 3),
+		// so a tile occupies 16 consecutive texels and each row of a tile is contiguous.
+		int bytes = source.bytes;
+		int x0 = region.x0 & ~3;
+
+		for(int z = region.z0; z < region.z1; z++)
+		{
+			const unsigned char *sourceSlice = (const unsigned char*)source.buffer + z * source.sliceB;
+			unsigned char *destinationSlice = (unsigned char*)destination.buffer + z * destination.sliceB;
+
+			for(int y = region.y0; y < region.y1; y++)
+			{
+				const unsigned char *sourceRow = sourceSlice + y * source.pitchB;
+				unsigned char *destinationRow = destinationSlice + (y & ~3) * destination.pitchB + (y & 3) * 4 * bytes;
+
+				for(int x = x0; x < region.x1; x += 4)
+				{
+					memcpy(destinationRow + x * 4 * bytes, sourceRow + x * bytes, min(region.x1 - x, 4) * bytes);
+				}
+			}
+		}
+	}
+
 	void Surface::decodeR8G8B8(Buffer &destination, const Buffer &source)
 	{
 		unsigned char *sourceSlice = (unsigned char*)source.buffer;
@@ -2657,6 +2993,45 @@ namespace sw
 		return false;
 	}
 
+	bool Surface::hasRegionViews(Format format)
+	{
+		// Buffer::view() offsets the base pointer by whole rows and texels. That
+		// doesn't address compressed blocks, the separate YV12 chroma planes or
+		// the 2x2 quads of quad layouts, so those formats are updated entirely.
+		if(isCompressed(format) || hasQuadLayout(format))
+		{
+			return false;
+		}
+
+		switch(format)
+		{
+		case FORMAT_YV12_BT601:
+		case FORMAT_YV12_BT709:
+		case FORMAT_YV12_JFIF:
+			return false;   // Planar
+		default:
+			return true;
+		}
+	}
+
+	bool Surface::isTileable(Format format)
+	{
+		if(format == FORMAT_NULL || isDepth(format) || isStencil(format) || isCompressed(format) || hasQuadLayout(format))
+		{
+			return false;
+		}
+
+		switch(format)
+		{
+		case FORMAT_YV12_BT601:
+		case FORMAT_YV12_BT709:
+		case FORMAT_YV12_JFIF:
+			return false;   // Planar
+		default:
+			return true;
+		}
+	}
+
 	bool Surface::isPalette(Format format)
 	{
 		switch(format)
@@ -2729,7 +3104,25 @@ namespace sw
 		case FORMAT_X32B32G32R32UI:
 		case FORMAT_A32B32G32R32I:
 		case FORMAT_A32B32G32R32UI:
+		case FORMAT_R3G3B2:
+		case FORMAT_A8R3G3B2:
+		case FORMAT_X4R4G4B4:
+		case FORMAT_A4R4G4B4:
+		case FORMAT_R4G4B4A4:
+		case FORMAT_X1R5G5B5:
+		case FORMAT_A1R5G5B5:
+		case FORMAT_R5G5B5A1:
+		case FORMAT_A2R10G10B10:
+		case FORMAT_A4L4:
+		case FORMAT_L6V5U5:
+		case FORMAT_A2W10V10U10:
 			return false;
+		case FORMAT_R16F:
+		case FORMAT_A16F:
+		case FORMAT_G16R16F:
+		case FORMAT_B16G16R16F:
+		case FORMAT_A16B16G16R16F:
+		case FORMAT_A32F:
 		case FORMAT_R32F:
 		case FORMAT_G32R32F:
 		case FORMAT_B32G32R32F:
@@ -2795,6 +3188,16 @@ namespace sw
 		case FORMAT_YV12_BT601:
 		case FORMAT_YV12_BT709:
 		case FORMAT_YV12_JFIF:
+		case FORMAT_R3G3B2:
+		case FORMAT_A8R3G3B2:
+		case FORMAT_X4R4G4B4:
+		case FORMAT_A4R4G4B4:
+		case FORMAT_R4G4B4A4:
+		case FORMAT_X1R5G5B5:
+		case FORMAT_A1R5G5B5:
+		case FORMAT_R5G5B5A1:
+		case FORMAT_A2R10G10B10:
+		case FORMAT_A4L4:
 			return true;
 		case FORMAT_A8B8G8R8I:
 		case FORMAT_A16B16G16R16I:
@@ -2812,6 +3215,7 @@ namespace sw
 			return component >= 1;
 		case FORMAT_V8U8:
 		case FORMAT_X8L8V8U8:
+		case FORMAT_L6V5U5:
 		case FORMAT_V16U16:
 		case FORMAT_G32R32F:
 		case FORMAT_G8R8I:
@@ -2820,6 +3224,7 @@ namespace sw
 		case FORMAT_G8R8I_SNORM:
 			return component >= 2;
 		case FORMAT_A16W16V16U16:
+		case FORMAT_A2W10V10U10:
 		case FORMAT_B32G32R32F:
 		case FORMAT_X32B32G32R32F:
 		case FORMAT_X8B8G8R8I:
@@ -3390,6 +3795,48 @@ namespace sw
 		}
 	}
 
+	Color<float> Surface::readExternal(int x, int y, int z) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.read(x, y, z);
+	}
+
+	Color<float> Surface::readExternal(int x, int y) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.read(x, y);
+	}
+
+	Color<float> Surface::sampleExternal(float x, float y, float z) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.sample(x, y, z);
+	}
+
+	Color<float> Surface::sampleExternal(float x, float y) const
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		return external.sample(x, y);
+	}
+
+	void Surface::writeExternal(int x, int y, int z, const Color<float> &color)
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		external.write(x, y, z, color);
+	}
+
+	void Surface::writeExternal(int x, int y, const Color<float> &color)
+	{
+		ASSERT(external.lock != LOCK_UNLOCKED);
+
+		external.write(x, y, color);
+	}
+
 	void Surface::copyInternal(const Surface* source, int x, int y, float srcX, float srcY, bool filter)
 	{
 		ASSERT(internal.lock != LOCK_UNLOCKED && source && source->internal.lock != LOCK_UNLOCKED);
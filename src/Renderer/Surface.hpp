@@ -48,6 +48,36 @@ namespace sw
 		int slice;
 	};
 
+	struct Region : public Rect
+	{
+		Region() : Rect(0, 0, 0, 0), z0(0), z1(0) {}   // Empty
+		Region(int x0i, int y0i, int z0i, int x1i, int y1i, int z1i) : Rect(x0i, y0i, x1i, y1i), z0(z0i), z1(z1i) {}
+
+		void merge(const Region &region);
+		bool contains(const Region &region) const;
+
+		int depth() const { return z1 - z0; }
+		long long volume() const { return (long long)width() * height() * depth(); }
+
+		int z0;   // Inclusive
+		int z1;   // Exclusive
+	};
+
+	// A few regions, so that separate updates don't merge into one large box.
+	// Once full, a new region is merged into the one whose bounds grow least.
+	struct RegionList
+	{
+		RegionList() : count(0) {}
+
+		void add(const Region &region);
+		void clear() { count = 0; }
+
+		enum {MAX_REGIONS = 4};
+
+		int count;
+		Region region[MAX_REGIONS];
+	};
+
 	enum Format : unsigned char
 	{
 		FORMAT_NULL,
@@ -235,6 +265,10 @@ namespace sw
 			void *lockRect(int x, int y, int z, Lock lock);
 			void unlockRect();
 
+			void markDirty();   // Entire buffer
+			void markDirty(const Region &region);
+			Buffer view(const Region &region) const;   // Shares the memory of the region
+
 			void *buffer;
 			int width;
 			int height;
@@ -246,8 +280,10 @@ namespace sw
 			int sliceP;
 			Format format;
 			Lock lock;
+			bool tiledLayout;   // 4x4 texel tiles, pitch and height aligned to 4
 
 			bool dirty;
+			RegionList dirtyRegions;   // Only valid when dirty
 		};
 
 	public:
@@ -257,6 +293,7 @@ namespace sw
 		virtual ~Surface();
 
 		inline void *lock(int x, int y, int z, Lock lock, Accessor client, bool internal = false);
+		inline void *lock(int x, int y, int z, Lock lock, Accessor client, bool internal, const Region &writeRegion);
 		inline void unlock(bool internal = false);
 		inline int getWidth() const;
 		inline int getHeight() const;
@@ -268,6 +305,7 @@ namespace sw
 		inline int getSliceP(bool internal = false) const;
 
 		void *lockExternal(int x, int y, int z, Lock lock, Accessor client);
+		void *lockExternal(int x, int y, int z, Lock lock, Accessor client, const Region &writeRegion);   // Only writeRegion becomes dirty
 		void unlockExternal();
 		inline Format getExternalFormat() const;
 		inline int getExternalPitchB() const;
@@ -276,6 +314,7 @@ namespace sw
 		inline int getExternalSliceP() const;
 
 		virtual void *lockInternal(int x, int y, int z, Lock lock, Accessor client);
+		void *lockInternal(int x, int y, int z, Lock lock, Accessor client, const Region &writeRegion);   // Only writeRegion becomes dirty
 		virtual void unlockInternal();
 		inline Format getInternalFormat() const;
 		inline int getInternalPitchB() const;
@@ -283,6 +322,10 @@ namespace sw
 		inline int getInternalSliceB() const;
 		inline int getInternalSliceP() const;
 
+		virtual void *lockTiled(Accessor client);   // Unlocked read access to a tiled copy of the internal buffer, or null
+		inline int getTiledPitchP() const;
+		inline int getTiledSliceP() const;
+
 		void *lockStencil(int x, int y, int front, Accessor client);
 		void unlockStencil();
 		inline Format getStencilFormat() const;
@@ -328,6 +371,8 @@ namespace sw
 		static bool isStencil(Format format);
 		static bool isDepth(Format format);
 		static bool hasQuadLayout(Format format);
+		static bool isTileable(Format format);
+		static bool hasRegionViews(Format format);
 		static bool isPalette(Format format);
 
 		static bool isFloatFormat(Format format);
@@ -444,17 +489,23 @@ namespace sw
 
 		static void update(Buffer &destination, Buffer &source);
 		static void genericUpdate(Buffer &destination, Buffer &source);
+		static void tile(Buffer &destination, const Buffer &source, const Region &region);
 		static void *allocateBuffer(int width, int height, int depth, Format format);
 		static void memfill4(void *buffer, int pattern, int bytes);
 
 		bool identicalFormats() const;
 		Format selectInternalFormat(Format format) const;
+		void markTiledStale(const Region &region);
 
 		void resolve();
 
 		Buffer external;
 		Buffer internal;
 		Buffer stencil;
+		Buffer tiled;   // Sampled copy of the internal buffer
+
+		bool tiledStale;
+		RegionList tiledStaleRegions;   // Internal texels not yet copied to the tiled buffer
 
 		const bool lockable;
 		const bool renderTarget;
@@ -480,6 +531,11 @@ namespace sw
 		return internal ? lockInternal(x, y, z, lock, client) : lockExternal(x, y, z, lock, client);
 	}
 
+	void *Surface::lock(int x, int y, int z, Lock lock, Accessor client, bool internal, const Region &writeRegion)
+	{
+		return internal ? lockInternal(x, y, z, lock, client, writeRegion) : lockExternal(x, y, z, lock, client, writeRegion);
+	}
+
 	void Surface::unlock(bool internal)
 	{
 		return internal ? unlockInternal() : unlockExternal();
@@ -575,6 +631,16 @@ namespace sw
 		return internal.sliceP;
 	}
 
+	int Surface::getTiledPitchP() const
+	{
+		return tiled.pitchP;
+	}
+
+	int Surface::getTiledSliceP() const
+	{
+		return tiled.sliceP;
+	}
+
 	Format Surface::getStencilFormat() const
 	{
 		return stencil.format;
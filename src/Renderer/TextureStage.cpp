@@ -57,6 +57,8 @@ namespace sw
 		texCoordIndex = stage;
 		this->sampler = sampler;
 		this->previousStage = previousStage;
+
+		modified = true;
 	}
 
 	TextureStage::State TextureStage::textureStageState() const
@@ -134,84 +136,110 @@ namespace sw
 	{
 		ASSERT(texCoordIndex < 8);
 
+		modified = modified || (this->texCoordIndex != (int)texCoordIndex);
 		this->texCoordIndex = texCoordIndex;
 	}
 
 	void TextureStage::setStageOperation(StageOperation stageOperation)
 	{
+		modified = modified || (this->stageOperation != stageOperation);
 		this->stageOperation = stageOperation;
 	}
 
 	void TextureStage::setFirstArgument(SourceArgument firstArgument)
 	{
+		modified = modified || (this->firstArgument != firstArgument);
 		this->firstArgument = firstArgument;
 	}
 
 	void TextureStage::setSecondArgument(SourceArgument secondArgument)
 	{
+		modified = modified || (this->secondArgument != secondArgument);
 		this->secondArgument = secondArgument;
 	}
 
 	void TextureStage::setThirdArgument(SourceArgument thirdArgument)
 	{
+		modified = modified || (this->thirdArgument != thirdArgument);
 		this->thirdArgument = thirdArgument;
 	}
 
 	void TextureStage::setStageOperationAlpha(StageOperation stageOperationAlpha)
 	{
+		modified = modified || (this->stageOperationAlpha != stageOperationAlpha);
 		this->stageOperationAlpha = stageOperationAlpha;
 	}
 
 	void TextureStage::setFirstArgumentAlpha(SourceArgument firstArgumentAlpha)
 	{
+		modified = modified || (this->firstArgumentAlpha != firstArgumentAlpha);
 		this->firstArgumentAlpha = firstArgumentAlpha;
 	}
 
 	void TextureStage::setSecondArgumentAlpha(SourceArgument secondArgumentAlpha)
 	{
+		modified = modified || (this->secondArgumentAlpha != secondArgumentAlpha);
 		this->secondArgumentAlpha = secondArgumentAlpha;
 	}
 
 	void TextureStage::setThirdArgumentAlpha(SourceArgument thirdArgumentAlpha)
 	{
-		this->thirdArgumentAlpha= thirdArgumentAlpha;
+		modified = modified || (this->thirdArgumentAlpha != thirdArgumentAlpha);
+		this->thirdArgumentAlpha = thirdArgumentAlpha;
 	}
 
 	void TextureStage::setFirstModifier(ArgumentModifier firstModifier)
 	{
+		modified = modified || (this->firstModifier != firstModifier);
 		this->firstModifier = firstModifier;
 	}
 
 	void TextureStage::setSecondModifier(ArgumentModifier secondModifier)
 	{
+		modified = modified || (this->secondModifier != secondModifier);
 		this->secondModifier = secondModifier;
 	}
 
 	void TextureStage::setThirdModifier(ArgumentModifier thirdModifier)
 	{
+		modified = modified || (this->thirdModifier != thirdModifier);
 		this->thirdModifier = thirdModifier;
 	}
 
 	void TextureStage::setFirstModifierAlpha(ArgumentModifier firstModifierAlpha)
 	{
+		modified = modified || (this->firstModifierAlpha != firstModifierAlpha);
 		this->firstModifierAlpha = firstModifierAlpha;
 	}
 
 	void TextureStage::setSecondModifierAlpha(ArgumentModifier secondModifierAlpha)
 	{
+		modified = modified || (this->secondModifierAlpha != secondModifierAlpha);
 		this->secondModifierAlpha = secondModifierAlpha;
 	}
 
 	void TextureStage::setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha)
 	{
+		modified = modified || (this->thirdModifierAlpha != thirdModifierAlpha);
 		this->thirdModifierAlpha = thirdModifierAlpha;
 	}
 
 	void TextureStage::setDestinationArgument(DestinationArgument destinationArgument)
 	{
+		modified = modified || (this->destinationArgument != destinationArgument);
 		this->destinationArgument = destinationArgument;
 	}
 
+	bool TextureStage::isModified() const
+	{
+		return modified;
+	}
+
+	void TextureStage::clearModified()
+	{
+		modified = false;
+	}
+
 	bool TextureStage::usesColor(SourceArgument source) const
 	{
 		// One argument
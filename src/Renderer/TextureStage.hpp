@@ -158,6 +158,10 @@ namespace sw
 		void setThirdModifierAlpha(ArgumentModifier thirdModifierAlpha);
 		void setDestinationArgument(DestinationArgument destinationArgument);
 
+		// Set when a field which affects the texture stage state changes
+		bool isModified() const;
+		void clearModified();
+
 		Uniforms uniforms;   // FIXME: Private
 
 	private:
@@ -192,6 +196,8 @@ namespace sw
 		int texCoordIndex;
 		const Sampler *sampler;
 		const TextureStage *previousStage;
+
+		bool modified;
 	};
 }
 
@@ -21,6 +21,10 @@
 #include "PixelShader.hpp"
 #include "Constants.hpp"
 #include "Debug.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "CompileLog.hpp"
+#include "Timer.hpp"
 
 #include <string.h>
 
@@ -118,13 +122,12 @@ namespace sw
 			updateModelMatrix[i] = true;
 		}
 
-		routineCache = 0;
-		setRoutineCacheSize(1024);
+		routineCache = RoutineCache<State>::acquireShared(1024, precacheVertex ? "sw-vertex" : 0);
 	}
 
 	VertexProcessor::~VertexProcessor()
 	{
-		delete routineCache;
+		RoutineCache<State>::releaseShared();
 		routineCache = 0;
 	}
 
@@ -140,7 +143,7 @@ namespace sw
 			context->input[i].defaults();
 		}
 
-		context->preTransformed = preTransformed;
+		context->setState(context->preTransformed, preTransformed);
 	}
 
 	void VertexProcessor::setFloatConstant(unsigned int index, const float value[4])
@@ -246,7 +249,7 @@ namespace sw
 	void VertexProcessor::setProjectionMatrix(const Matrix &P)
 	{
 		this->P = P;
-		context->wBasedFog = (P[3][0] != 0.0f) || (P[3][1] != 0.0f) || (P[3][2] != 0.0f) || (P[3][3] != 1.0f);
+		context->setState(context->wBasedFog, (P[3][0] != 0.0f) || (P[3][1] != 0.0f) || (P[3][2] != 0.0f) || (P[3][3] != 1.0f));
 
 		updateMatrix = true;
 		updateProjectionMatrix = true;
@@ -346,12 +349,12 @@ namespace sw
 
 	void VertexProcessor::setFogEnable(bool fogEnable)
 	{
-		context->fogEnable = fogEnable;
+		context->setState(context->fogEnable, fogEnable);
 	}
 
 	void VertexProcessor::setVertexFogMode(FogMode fogMode)
 	{
-		context->vertexFogMode = fogMode;
+		context->setState(context->vertexFogMode, fogMode);
 	}
 
 	void VertexProcessor::setInstanceID(int instanceID)
@@ -443,19 +446,19 @@ namespace sw
 
 	void VertexProcessor::setRangeFogEnable(bool enable)
 	{
-		context->rangeFogEnable = enable;
+		context->setState(context->rangeFogEnable, enable);
 	}
 
 	void VertexProcessor::setIndexedVertexBlendEnable(bool indexedVertexBlendEnable)
 	{
-		context->indexedVertexBlendEnable = indexedVertexBlendEnable;
+		context->setState(context->indexedVertexBlendEnable, indexedVertexBlendEnable);
 	}
 
 	void VertexProcessor::setVertexBlendMatrixCount(unsigned int vertexBlendMatrixCount)
 	{
 		if(vertexBlendMatrixCount <= 4)
 		{
-			context->vertexBlendMatrixCount = vertexBlendMatrixCount;
+			context->setState(context->vertexBlendMatrixCount, vertexBlendMatrixCount);
 		}
 		else ASSERT(false);
 	}
@@ -464,7 +467,7 @@ namespace sw
 	{
 		if(stage < TEXTURE_IMAGE_UNITS)
 		{
-			context->textureWrap[stage] = mask;
+			context->setState(context->textureWrap[stage], mask);
 		}
 		else ASSERT(false);
 
@@ -480,19 +483,19 @@ namespace sw
 	{
 		if(stage < 8)
 		{
-			context->texGen[stage] = texGen;
+			context->setState(context->texGen[stage], texGen);
 		}
 		else ASSERT(false);
 	}
 
 	void VertexProcessor::setLocalViewer(bool localViewer)
 	{
-		context->localViewer = localViewer;
+		context->setState(context->localViewer, localViewer);
 	}
 
 	void VertexProcessor::setNormalizeNormals(bool normalizeNormals)
 	{
-		context->normalizeNormals = normalizeNormals;
+		context->setState(context->normalizeNormals, normalizeNormals);
 	}
 
 	void VertexProcessor::setTextureMatrix(int stage, const Matrix &T)
@@ -508,8 +511,8 @@ namespace sw
 
 	void VertexProcessor::setTextureTransform(int stage, int count, bool project)
 	{
-		context->textureTransformCount[stage] = count;
-		context->textureTransformProject[stage] = project;
+		context->setState(context->textureTransformCount[stage], count);
+		context->setState(context->textureTransformProject[stage], project);
 	}
 
 	void VertexProcessor::setTextureFilter(unsigned int sampler, FilterType textureFilter)
@@ -539,6 +542,15 @@ namespace sw
 		else ASSERT(false);
 	}
 
+	void VertexProcessor::setSeamlessCubeMap(unsigned int sampler, bool enable)
+	{
+		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
+		{
+			context->sampler[TEXTURE_IMAGE_UNITS + sampler].setSeamlessCubeMap(enable);
+		}
+		else ASSERT(false);
+	}
+
 	void VertexProcessor::setAddressingModeU(unsigned int sampler, AddressingMode addressMode)
 	{
 		if(sampler < VERTEX_TEXTURE_IMAGE_UNITS)
@@ -706,12 +718,12 @@ namespace sw
 
 	void VertexProcessor::setTransformFeedbackQueryEnabled(bool enable)
 	{
-		context->transformFeedbackQueryEnabled = enable;
+		context->setState(context->transformFeedbackQueryEnabled, enable);
 	}
 
 	void VertexProcessor::enableTransformFeedback(uint64_t enable)
 	{
-		context->transformFeedbackEnabled = enable;
+		context->setState(context->transformFeedbackEnabled, enable);
 	}
 
 	const Matrix &VertexProcessor::getModelTransform(int i)
@@ -871,11 +883,10 @@ namespace sw
 
 	void VertexProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheVertex ? "sw-vertex" : 0);
+		routineCache->resize(clamp(cacheSize, 1, 65536));
 	}
 
-	const VertexProcessor::State VertexProcessor::update(DrawType drawType)
+	void VertexProcessor::updateTransformAndLighting()
 	{
 		if(isFixedFunction())
 		{
@@ -895,7 +906,10 @@ namespace sw
 				updateLighting = false;
 			}
 		}
+	}
 
+	const VertexProcessor::State VertexProcessor::update(DrawType drawType)
+	{
 		State state;
 
 		if(context->vertexShader)
@@ -1062,30 +1076,90 @@ namespace sw
 		return state;
 	}
 
+	const VertexProcessor::State VertexProcessor::positionState(const State &state)
+	{
+		State position = state;
+
+		position.positionOnly = true;
+		position.transformFeedbackQueryEnabled = false;
+		position.transformFeedbackEnabled = 0;
+
+		// Computations which only lead to other outputs are eliminated as dead code
+		for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+		{
+			if(i != (int)state.positionRegister)
+			{
+				position.output[i].write = 0;
+				position.output[i].clamp = 0;
+			}
+		}
+
+		position.hash = position.computeHash();
+
+		return position;
+	}
+
 	Routine *VertexProcessor::routine(const State &state)
 	{
 		Routine *routine = routineCache->query(state);
 
+		Metrics::add(routine ? Metrics::VERTEX_ROUTINE_HITS : Metrics::VERTEX_ROUTINE_MISSES);
+
 		if(!routine)   // Create one
 		{
-			VertexRoutine *generator = nullptr;
+			routine = generate(state, context->vertexShader, !tieredCompilation);
+			routine = routineCache->add(state, routine);
+		}
 
-			if(state.fixedFunction)
-			{
-				generator = new VertexPipeline(state);
-			}
-			else
+		return routine;
+	}
+
+	void VertexProcessor::use(const State &state, Routine *routine)
+	{
+		if(routineCache->isHot(routine))
+		{
+			// The shader can change or be deleted while compiling, so use a copy
+			const VertexShader *shader = state.fixedFunction ? nullptr : new VertexShader(context->vertexShader);
+
+			routineCache->promote(state, [=]()
 			{
-				generator = new VertexProgram(state, context->vertexShader);
-			}
+				Routine *optimized = generate(state, shader, true);
+				delete shader;
+
+				return optimized;
+			});
+		}
+	}
+
+	int VertexProcessor::promotions() const
+	{
+		return routineCache->promotions();
+	}
+
+	Routine *VertexProcessor::generate(const State &state, const VertexShader *shader, bool optimize)
+	{
+		TraceSpan span("Compile vertex routine", "jit");
+		int64_t start = Metrics::enabled() ? Timer::counter() : 0;
 
-			generator->generate();
-			routine = (*generator)(L"VertexRoutine_%0.8X", state.shaderID);
-			delete generator;
+		VertexRoutine *generator = nullptr;
 
-			routineCache->add(state, routine);
+		if(state.fixedFunction)
+		{
+			generator = new VertexPipeline(state);
+		}
+		else
+		{
+			generator = new VertexProgram(state, shader);
 		}
 
+		generator->generate();
+		Routine *routine = optimize ? (*generator)(L"VertexRoutine_%0.8X", state.shaderID) : generator->unoptimized(L"VertexRoutine_%0.8X", state.shaderID);
+		delete generator;
+
+		CompileLog::add(CompileLog::VERTEX, &state, sizeof(State), routine, shader);
+		Metrics::add(Metrics::VERTEX_ROUTINE_COMPILES);
+		Metrics::addTime(Metrics::VERTEX_COMPILE_TIME, start);
+
 		return routine;
 	}
 }
@@ -39,6 +39,7 @@ namespace sw
 		unsigned int vertexCount;
 		unsigned int primitiveStart;
 		VertexCache vertexCache;
+		VertexCache positionCache;   // Of the position-only routine
 	};
 
 	class VertexProcessor
@@ -52,6 +53,7 @@ namespace sw
 
 			bool fixedFunction             : 1;
 			bool textureSampling           : 1;
+			bool positionOnly              : 1;
 			unsigned int positionRegister  : BITS(MAX_VERTEX_OUTPUTS);
 			unsigned int pointSizeRegister : BITS(MAX_VERTEX_OUTPUTS);
 
@@ -251,6 +253,7 @@ namespace sw
 		void setTextureFilter(unsigned int sampler, FilterType textureFilter);
 		void setMipmapFilter(unsigned int sampler, MipmapType mipmapFilter);
 		void setGatherEnable(unsigned int sampler, bool enable);
+		void setSeamlessCubeMap(unsigned int sampler, bool enable);
 		void setAddressingModeU(unsigned int sampler, AddressingMode addressingMode);
 		void setAddressingModeV(unsigned int sampler, AddressingMode addressingMode);
 		void setAddressingModeW(unsigned int sampler, AddressingMode addressingMode);
@@ -281,8 +284,12 @@ namespace sw
 		const Matrix &getModelTransform(int i);
 		const Matrix &getViewTransform();
 
+		void updateTransformAndLighting();   // Fixed-function uniforms, needed by every draw
 		const State update(DrawType drawType);
-		Routine *routine(const State &state);
+		const State positionState(const State &state);   // Variant which only writes the position, for culling before shading
+		Routine *routine(const State &state);   // Returns a reference which the caller must unbind
+		void use(const State &state, Routine *routine);   // Counts a draw with the routine, for tiered compilation
+		int promotions() const;   // Changes when cached routines were replaced by optimized ones
 
 		bool isFixedFunction();
 		void setRoutineCacheSize(int cacheSize);
@@ -322,6 +329,7 @@ namespace sw
 		void setTransform(const Matrix &M, int i);
 		void setCameraTransform(const Matrix &M, int i);
 		void setNormalTransform(const Matrix &M, int i);
+		static Routine *generate(const State &state, const VertexShader *shader, bool optimize);
 
 		Context *const context;
 
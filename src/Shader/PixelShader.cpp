@@ -22,6 +22,7 @@ namespace sw
 {
 	PixelShader::PixelShader(const PixelShader *ps) : Shader()
 	{
+		shaderType = SHADER_PIXEL;
 		version = 0x0300;
 		vPosDeclared = false;
 		vFaceDeclared = false;
@@ -29,6 +30,8 @@ namespace sw
 
 		if(ps)   // Make a copy
 		{
+			version = ps->version;   // ps_1_x semantics and the analysis depend on it
+
 			for(size_t i = 0; i < ps->getLength(); i++)
 			{
 				append(new sw::Shader::Instruction(*ps->getInstruction(i)));
@@ -50,6 +50,8 @@ namespace
 
 namespace sw
 {
+	extern bool samplerFastPaths;
+
 	SamplerCore::SamplerCore(Pointer<Byte> &constants, const Sampler::State &state) : constants(constants), state(state)
 	{
 	}
@@ -70,6 +72,13 @@ namespace sw
 			}
 		#endif
 
+		if(hasFastPath(function))
+		{
+			sampleFast(texture, c, u, v, fixed12);
+
+			return;
+		}
+
 		Float4 uuuu = u;
 		Float4 vvvv = v;
 		Float4 wwww = w;
@@ -102,7 +111,7 @@ namespace sw
 			}
 
 			Float lod;
-			Float anisotropy;
+			Int4 taps;
 			Float4 uDelta;
 			Float4 vDelta;
 			Float lodBias = (function == Fetch) ? Float4(As<Int4>(q)).x : q.x;
@@ -111,7 +120,7 @@ namespace sw
 			{
 				if(state.textureType != TEXTURE_CUBE)
 				{
-					computeLod(texture, lod, anisotropy, uDelta, vDelta, uuuu, vvvv, lodBias, dsx, dsy, function);
+					computeLod(texture, lod, taps, uDelta, vDelta, uuuu, vvvv, lodBias, dsx, dsy, function);
 				}
 				else
 				{
@@ -125,13 +134,13 @@ namespace sw
 
 			if(!hasFloatTexture())
 			{
-				sampleFilter(texture, c, uuuu, vvvv, wwww, offset, lod, anisotropy, uDelta, vDelta, face, function);
+				sampleFilter(texture, c, uuuu, vvvv, wwww, offset, lod, taps, uDelta, vDelta, face, function);
 			}
 			else
 			{
 				Vector4f cf;
 
-				sampleFloatFilter(texture, cf, uuuu, vvvv, wwww, offset, lod, anisotropy, uDelta, vDelta, face, function);
+				sampleFloatFilter(texture, cf, uuuu, vvvv, wwww, offset, lod, taps, uDelta, vDelta, face, function);
 
 				convertFixed12(c, cf);
 			}
@@ -331,7 +340,7 @@ namespace sw
 				}
 
 				Float lod;
-				Float anisotropy;
+				Int4 taps;
 				Float4 uDelta;
 				Float4 vDelta;
 				Float lodBias = (function == Fetch) ? Float4(As<Int4>(q)).x : q.x;
@@ -340,7 +349,7 @@ namespace sw
 				{
 					if(state.textureType != TEXTURE_CUBE)
 					{
-						computeLod(texture, lod, anisotropy, uDelta, vDelta, uuuu, vvvv, lodBias, dsx, dsy, function);
+						computeLod(texture, lod, taps, uDelta, vDelta, uuuu, vvvv, lodBias, dsx, dsy, function);
 					}
 					else
 					{
@@ -352,7 +361,7 @@ namespace sw
 					computeLod3D(texture, lod, uuuu, vvvv, wwww, lodBias, dsx, dsy, function);
 				}
 
-				sampleFloatFilter(texture, c, uuuu, vvvv, wwww, offset, lod, anisotropy, uDelta, vDelta, face, function);
+				sampleFloatFilter(texture, c, uuuu, vvvv, wwww, offset, lod, taps, uDelta, vDelta, face, function);
 			}
 			else
 			{
@@ -563,6 +572,174 @@ namespace sw
 		}
 	}
 
+	void SamplerCore::sampleFast(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, bool fixed12)
+	{
+		// Single level, so no LOD computation. Coordinates are clamped, so no wrapping.
+		Pointer<Byte> mipmap = texture + OFFSET(Texture,mipmap[0]);
+		Pointer<Byte> buffer = *Pointer<Pointer<Byte> >(mipmap + OFFSET(Mipmap,buffer[0]));
+
+		Float4 width = *Pointer<Float4>(mipmap + OFFSET(Mipmap,fWidth)) * Float4(1 << 16);
+		Float4 height = *Pointer<Float4>(mipmap + OFFSET(Mipmap,fHeight)) * Float4(1 << 16);
+		Int4 maxX = Int4(*Pointer<UShort4>(mipmap + OFFSET(Mipmap,width))) - Int4(1);
+		Int4 maxY = Int4(*Pointer<UShort4>(mipmap + OFFSET(Mipmap,height))) - Int4(1);
+		Int4 pitchP = Int4(*Pointer<Int>(mipmap + OFFSET(Mipmap,onePitchP)) >> 16);
+
+		Float4 uu = Min(Max(u, Float4(0.0f)), Float4(1.0f));
+		Float4 vv = Min(Max(v, Float4(0.0f)), Float4(1.0f));
+
+		Int4 x0;
+		Int4 y0;
+		Int4 x1;
+		Int4 y1;
+		UShort4 f0u;
+		UShort4 f0v;
+
+		if(state.textureFilter == FILTER_POINT)
+		{
+			x0 = Min(Int4(uu * width), maxX);
+			y0 = Min(Int4(vv * height), maxY);
+		}
+		else
+		{
+			// 16.16 fixed-point position relative to the texel centres
+			Int4 x = Int4((uu * width - Float4(0.5f)) * Float4(1 << 16));
+			Int4 y = Int4((vv * height - Float4(0.5f)) * Float4(1 << 16));
+
+			f0u = UShort4(x & Int4(0xFFFF));
+			f0v = UShort4(y & Int4(0xFFFF));
+
+			x0 = x >> 16;
+			y0 = y >> 16;
+			x1 = Min(x0 + Int4(1), maxX);
+			y1 = Min(y0 + Int4(1), maxY);
+			x0 = Max(x0, Int4(0));
+			y0 = Max(y0, Int4(0));
+		}
+
+		// Texel offsets of the columns and rows
+		Int4 column0;
+		Int4 column1;
+		Int4 row0;
+		Int4 row1;
+
+		if(state.tiledLayout)
+		{
+			// 4x4 tiles: (y & ~3) * pitchP + (x & ~3) * 4 + (y & 3) * 4 + (x & 3)
+			column0 = ((x0 & Int4(~3)) << 2) + (x0 & Int4(3));
+			row0 = (y0 & Int4(~3)) * pitchP + ((y0 & Int4(3)) << 2);
+
+			if(state.textureFilter != FILTER_POINT)
+			{
+				column1 = ((x1 & Int4(~3)) << 2) + (x1 & Int4(3));
+				row1 = (y1 & Int4(~3)) * pitchP + ((y1 & Int4(3)) << 2);
+			}
+		}
+		else
+		{
+			column0 = x0;
+			row0 = y0 * pitchP;
+
+			if(state.textureFilter != FILTER_POINT)
+			{
+				column1 = x1;
+				row1 = y1 * pitchP;
+			}
+		}
+
+		if(state.textureFilter == FILTER_POINT)
+		{
+			Int4 index = row0 + column0;
+
+			fetchFast(c, buffer, index);
+		}
+		else
+		{
+			Vector4s c0;
+			Vector4s c1;
+			Vector4s c2;
+			Vector4s c3;
+
+			Int4 index0 = row0 + column0;
+			Int4 index1 = row0 + column1;
+			Int4 index2 = row1 + column0;
+			Int4 index3 = row1 + column1;
+
+			fetchFast(c0, buffer, index0);
+			fetchFast(c1, buffer, index1);
+			fetchFast(c2, buffer, index2);
+			fetchFast(c3, buffer, index3);
+
+			UShort4 f1u = ~f0u;
+			UShort4 f1v = ~f0v;
+
+			UShort4 f0u0v = MulHigh(f0u, f0v);
+			UShort4 f1u0v = MulHigh(f1u, f0v);
+			UShort4 f0u1v = MulHigh(f0u, f1v);
+			UShort4 f1u1v = MulHigh(f1u, f1v);
+
+			for(int component = 0; component < 4; component++)
+			{
+				c[component] = MulHigh(As<UShort4>(c0[component]), f1u1v) +
+				               MulHigh(As<UShort4>(c1[component]), f0u1v) +
+				               MulHigh(As<UShort4>(c2[component]), f1u0v) +
+				               MulHigh(As<UShort4>(c3[component]), f0u0v);
+			}
+		}
+
+		if(fixed12)
+		{
+			c.x = As<UShort4>(c.x) >> 4;
+			c.y = As<UShort4>(c.y) >> 4;
+			c.z = As<UShort4>(c.z) >> 4;
+			c.w = As<UShort4>(c.w) >> 4;
+		}
+
+		if(state.textureFormat == FORMAT_X8B8G8R8 || state.textureFormat == FORMAT_X8R8G8B8)
+		{
+			c.w = fixed12 ? Short4(0x1000) : Short4(0xFFFFu);
+		}
+	}
+
+	void SamplerCore::fetchFast(Vector4s &c, Pointer<Byte> &buffer, Int4 &index)
+	{
+		Byte4 c0 = Pointer<Byte4>(buffer)[Extract(index, 0)];
+		Byte4 c1 = Pointer<Byte4>(buffer)[Extract(index, 1)];
+		Byte4 c2 = Pointer<Byte4>(buffer)[Extract(index, 2)];
+		Byte4 c3 = Pointer<Byte4>(buffer)[Extract(index, 3)];
+		c.x = Unpack(c0, c1);
+		c.y = Unpack(c2, c3);
+
+		switch(state.textureFormat)
+		{
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8R8G8B8:
+			c.z = c.x;
+			c.z = As<Short4>(UnpackLow(c.z, c.y));
+			c.x = As<Short4>(UnpackHigh(c.x, c.y));
+			c.y = c.z;
+			c.w = c.x;
+			c.z = UnpackLow(As<Byte8>(c.z), As<Byte8>(c.z));
+			c.y = UnpackHigh(As<Byte8>(c.y), As<Byte8>(c.y));
+			c.x = UnpackLow(As<Byte8>(c.x), As<Byte8>(c.x));
+			c.w = UnpackHigh(As<Byte8>(c.w), As<Byte8>(c.w));
+			break;
+		case FORMAT_A8B8G8R8:
+		case FORMAT_X8B8G8R8:
+			c.z = c.x;
+			c.x = As<Short4>(UnpackLow(c.x, c.y));
+			c.z = As<Short4>(UnpackHigh(c.z, c.y));
+			c.y = c.x;
+			c.w = c.z;
+			c.x = UnpackLow(As<Byte8>(c.x), As<Byte8>(c.x));
+			c.y = UnpackHigh(As<Byte8>(c.y), As<Byte8>(c.y));
+			c.z = UnpackLow(As<Byte8>(c.z), As<Byte8>(c.z));
+			c.w = UnpackHigh(As<Byte8>(c.w), As<Byte8>(c.w));
+			break;
+		default:
+			ASSERT(false);
+		}
+	}
+
 	void SamplerCore::border(Short4 &mask, Float4 &coordinates)
 	{
 		Int4 border = As<Int4>(CmpLT(Abs(coordinates - Float4(0.5f)), Float4(0.5f)));
@@ -611,9 +788,9 @@ namespace sw
 		return uvw;
 	}
 
-	void SamplerCore::sampleFilter(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function)
+	void SamplerCore::sampleFilter(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int4 &taps, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function)
 	{
-		sampleAniso(texture, c, u, v, w, offset, lod, anisotropy, uDelta, vDelta, face, false, function);
+		sampleAniso(texture, c, u, v, w, offset, lod, taps, uDelta, vDelta, face, false, function);
 
 		if(function == Fetch)
 		{
@@ -624,7 +801,7 @@ namespace sw
 		{
 			Vector4s cc;
 
-			sampleAniso(texture, cc, u, v, w, offset, lod, anisotropy, uDelta, vDelta, face, true, function);
+			sampleAniso(texture, cc, u, v, w, offset, lod, taps, uDelta, vDelta, face, true, function);
 
 			lod *= Float(1 << 16);
 
@@ -712,7 +889,7 @@ namespace sw
 		}
 	}
 
-	void SamplerCore::sampleAniso(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function)
+	void SamplerCore::sampleAniso(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int4 &taps, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function)
 	{
 		if(state.textureFilter != FILTER_ANISOTROPIC || function == Lod || function == Fetch)
 		{
@@ -720,7 +897,8 @@ namespace sw
 		}
 		else
 		{
-			Int a = RoundInt(anisotropy);
+			Int4 levelTaps;
+			Int a = anisotropyTaps(taps, levelTaps, secondLOD);
 
 			Vector4s cSum;
 
@@ -729,9 +907,29 @@ namespace sw
 			cSum.z = Short4(0);
 			cSum.w = Short4(0);
 
-			Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
-			Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
-			UShort4 cw = *Pointer<UShort4>(constants + OFFSET(Constants,cWeight) + 8 * a);
+			Float4 A;
+			Float4 B;
+			UShort4 cw;
+
+			if(!state.adaptiveAnisotropy)
+			{
+				A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
+				B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
+				cw = *Pointer<UShort4>(constants + OFFSET(Constants,cWeight) + 8 * a);
+			}
+			else
+			{
+				// Each pixel spreads its own number of taps along its major axis
+				for(int i = 0; i < 4; i++)
+				{
+					Int t = Extract(levelTaps, i);
+
+					A = Insert(A, *Pointer<Float>(constants + OFFSET(Constants,uvWeight) + 16 * t), i);
+					B = Insert(B, *Pointer<Float>(constants + OFFSET(Constants,uvStart) + 16 * t), i);
+					cw = As<UShort4>(Insert(As<Short4>(cw), *Pointer<Short>(constants + OFFSET(Constants,cWeight) + 8 * t), i));
+				}
+			}
+
 			Short4 sw = Short4(cw >> 1);
 
 			Float4 du = uDelta;
@@ -752,6 +950,15 @@ namespace sw
 				u0 += du;
 				v0 += dv;
 
+				if(state.adaptiveAnisotropy)
+				{
+					// Pixels which have taken all of their taps stop accumulating
+					Short4 active = Short4(CmpLT(Int4(i), levelTaps));
+
+					cw = As<UShort4>(As<Short4>(cw) & active);
+					sw = sw & active;
+				}
+
 				if(hasUnsignedTextureComponent(0)) cSum.x += As<Short4>(MulHigh(As<UShort4>(c.x), cw)); else cSum.x += MulHigh(c.x, sw);
 				if(hasUnsignedTextureComponent(1)) cSum.y += As<Short4>(MulHigh(As<UShort4>(c.y), cw)); else cSum.y += MulHigh(c.y, sw);
 				if(hasUnsignedTextureComponent(2)) cSum.z += As<Short4>(MulHigh(As<UShort4>(c.z), cw)); else cSum.z += MulHigh(c.z, sw);
@@ -768,6 +975,25 @@ namespace sw
 		}
 	}
 
+	Int SamplerCore::anisotropyTaps(Int4 &taps, Int4 &levelTaps, bool secondLOD)
+	{
+		levelTaps = taps;
+
+		if(!state.adaptiveAnisotropy)
+		{
+			return Extract(levelTaps, 0);
+		}
+
+		if(secondLOD)
+		{
+			// The coarser level has half the texels along the axis, so half the taps cover it
+			levelTaps = (levelTaps + Int4(1)) >> 1;
+		}
+
+		// The quad takes as many taps as its pixel with the most
+		return Max(Max(Extract(levelTaps, 0), Extract(levelTaps, 1)), Max(Extract(levelTaps, 2), Extract(levelTaps, 3)));
+	}
+
 	void SamplerCore::sampleQuad(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function)
 	{
 		if(state.textureType != TEXTURE_3D)
@@ -807,22 +1033,49 @@ namespace sw
 			Vector4s c2;
 			Vector4s c3;
 
-			Short4 uuuu0 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 0 : -1, lod);
-			Short4 vvvv0 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 0 : -1, lod);
-			Short4 uuuu1 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 2 : +1, lod);
-			Short4 vvvv1 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 2 : +1, lod);
+			// Fractions
+			UShort4 f0u;
+			UShort4 f0v;
 
-			sampleTexel(c0, uuuu0, vvvv0, wwww, offset, mipmap, buffer, function);
-			sampleTexel(c1, uuuu1, vvvv0, wwww, offset, mipmap, buffer, function);
-			sampleTexel(c2, uuuu0, vvvv1, wwww, offset, mipmap, buffer, function);
-			sampleTexel(c3, uuuu1, vvvv1, wwww, offset, mipmap, buffer, function);
+			if(state.seamlessCube && !gather)
+			{
+				Short4 uuuuTap[4];
+				Short4 vvvvTap[4];
+				Pointer<Byte> bufferTap[4][4];
+				Float4 fu;
+				Float4 fv;
 
-			if(!gather)   // Blend
+				cubeSeamless(mipmap, u, v, face, uuuuTap, vvvvTap, bufferTap, fu, fv);
+
+				sampleTexel(c0, uuuuTap[0], vvvvTap[0], wwww, offset, mipmap, bufferTap[0], function);
+				sampleTexel(c1, uuuuTap[1], vvvvTap[1], wwww, offset, mipmap, bufferTap[1], function);
+				sampleTexel(c2, uuuuTap[2], vvvvTap[2], wwww, offset, mipmap, bufferTap[2], function);
+				sampleTexel(c3, uuuuTap[3], vvvvTap[3], wwww, offset, mipmap, bufferTap[3], function);
+
+				f0u = UShort4(Int4(Min(fu * Float4(1 << 16), Float4(0xFFFF))));
+				f0v = UShort4(Int4(Min(fv * Float4(1 << 16), Float4(0xFFFF))));
+			}
+			else
 			{
-				// Fractions
-				UShort4 f0u = As<UShort4>(uuuu0) * *Pointer<UShort4>(mipmap + OFFSET(Mipmap,width));
-				UShort4 f0v = As<UShort4>(vvvv0) * *Pointer<UShort4>(mipmap + OFFSET(Mipmap,height));
+				Short4 uuuu0 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 0 : -1, lod);
+				Short4 vvvv0 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 0 : -1, lod);
+				Short4 uuuu1 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 2 : +1, lod);
+				Short4 vvvv1 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 2 : +1, lod);
+
+				sampleTexel(c0, uuuu0, vvvv0, wwww, offset, mipmap, buffer, function);
+				sampleTexel(c1, uuuu1, vvvv0, wwww, offset, mipmap, buffer, function);
+				sampleTexel(c2, uuuu0, vvvv1, wwww, offset, mipmap, buffer, function);
+				sampleTexel(c3, uuuu1, vvvv1, wwww, offset, mipmap, buffer, function);
+
+				if(!gather)
+				{
+					f0u = As<UShort4>(uuuu0) * *Pointer<UShort4>(mipmap + OFFSET(Mipmap,width));
+					f0v = As<UShort4>(vvvv0) * *Pointer<UShort4>(mipmap + OFFSET(Mipmap,height));
+				}
+			}
 
+			if(!gather)   // Blend
+			{
 				UShort4 f1u = ~f0u;
 				UShort4 f1v = ~f0v;
 
@@ -1097,9 +1350,9 @@ namespace sw
 		}
 	}
 
-	void SamplerCore::sampleFloatFilter(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function)
+	void SamplerCore::sampleFloatFilter(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int4 &taps, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function)
 	{
-		sampleFloatAniso(texture, c, u, v, w, offset, lod, anisotropy, uDelta, vDelta, face, false, function);
+		sampleFloatAniso(texture, c, u, v, w, offset, lod, taps, uDelta, vDelta, face, false, function);
 
 		if(function == Fetch)
 		{
@@ -1110,7 +1363,7 @@ namespace sw
 		{
 			Vector4f cc;
 
-			sampleFloatAniso(texture, cc, u, v, w, offset, lod, anisotropy, uDelta, vDelta, face, true, function);
+			sampleFloatAniso(texture, cc, u, v, w, offset, lod, taps, uDelta, vDelta, face, true, function);
 
 			Float4 lod4 = Float4(Frac(lod));
 
@@ -1177,7 +1430,7 @@ namespace sw
 		}
 	}
 
-	void SamplerCore::sampleFloatAniso(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function)
+	void SamplerCore::sampleFloatAniso(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int4 &taps, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function)
 	{
 		if(state.textureFilter != FILTER_ANISOTROPIC || function == Lod || function == Fetch)
 		{
@@ -1185,7 +1438,8 @@ namespace sw
 		}
 		else
 		{
-			Int a = RoundInt(anisotropy);
+			Int4 levelTaps;
+			Int a = anisotropyTaps(taps, levelTaps, secondLOD);
 
 			Vector4f cSum;
 
@@ -1194,8 +1448,27 @@ namespace sw
 			cSum.z = Float4(0.0f);
 			cSum.w = Float4(0.0f);
 
-			Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
-			Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
+			Float4 A;
+			Float4 B;
+
+			if(!state.adaptiveAnisotropy)
+			{
+				A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
+				B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
+			}
+			else
+			{
+				// Each pixel spreads its own number of taps along its major axis
+				for(int i = 0; i < 4; i++)
+				{
+					Int t = Extract(levelTaps, i);
+
+					A = Insert(A, *Pointer<Float>(constants + OFFSET(Constants,uvWeight) + 16 * t), i);
+					B = Insert(B, *Pointer<Float>(constants + OFFSET(Constants,uvStart) + 16 * t), i);
+				}
+			}
+
+			Float4 cWeight = A;
 
 			Float4 du = uDelta;
 			Float4 dv = vDelta;
@@ -1215,10 +1488,16 @@ namespace sw
 				u0 += du;
 				v0 += dv;
 
-				cSum.x += c.x * A;
-				cSum.y += c.y * A;
-				cSum.z += c.z * A;
-				cSum.w += c.w * A;
+				if(state.adaptiveAnisotropy)
+				{
+					// Pixels which have taken all of their taps stop accumulating
+					cWeight = As<Float4>(As<Int4>(cWeight) & CmpLT(Int4(i), levelTaps));
+				}
+
+				cSum.x += c.x * cWeight;
+				cSum.y += c.y * cWeight;
+				cSum.z += c.z * cWeight;
+				cSum.w += c.w * cWeight;
 
 				i++;
 			}
@@ -1270,22 +1549,44 @@ namespace sw
 			Vector4f c2;
 			Vector4f c3;
 
-			Short4 uuuu0 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 0 : -1, lod);
-			Short4 vvvv0 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 0 : -1, lod);
-			Short4 uuuu1 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 2 : +1, lod);
-			Short4 vvvv1 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 2 : +1, lod);
+			// Fractions
+			Float4 fu;
+			Float4 fv;
 
-			sampleTexel(c0, uuuu0, vvvv0, wwww, offset, w, mipmap, buffer, function);
-			sampleTexel(c1, uuuu1, vvvv0, wwww, offset, w, mipmap, buffer, function);
-			sampleTexel(c2, uuuu0, vvvv1, wwww, offset, w, mipmap, buffer, function);
-			sampleTexel(c3, uuuu1, vvvv1, wwww, offset, w, mipmap, buffer, function);
+			if(state.seamlessCube && !gather)
+			{
+				Short4 uuuuTap[4];
+				Short4 vvvvTap[4];
+				Pointer<Byte> bufferTap[4][4];
 
-			if(!gather)   // Blend
+				cubeSeamless(mipmap, u, v, face, uuuuTap, vvvvTap, bufferTap, fu, fv);
+
+				sampleTexel(c0, uuuuTap[0], vvvvTap[0], wwww, offset, w, mipmap, bufferTap[0], function);
+				sampleTexel(c1, uuuuTap[1], vvvvTap[1], wwww, offset, w, mipmap, bufferTap[1], function);
+				sampleTexel(c2, uuuuTap[2], vvvvTap[2], wwww, offset, w, mipmap, bufferTap[2], function);
+				sampleTexel(c3, uuuuTap[3], vvvvTap[3], wwww, offset, w, mipmap, bufferTap[3], function);
+			}
+			else
 			{
-				// Fractions
-				Float4 fu = Frac(Float4(As<UShort4>(uuuu0)) * *Pointer<Float4>(mipmap + OFFSET(Mipmap,fWidth)));
-				Float4 fv = Frac(Float4(As<UShort4>(vvvv0)) * *Pointer<Float4>(mipmap + OFFSET(Mipmap,fHeight)));
+				Short4 uuuu0 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 0 : -1, lod);
+				Short4 vvvv0 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 0 : -1, lod);
+				Short4 uuuu1 = offsetSample(uuuu, mipmap, OFFSET(Mipmap,uHalf), state.addressingModeU == ADDRESSING_WRAP, gather ? 2 : +1, lod);
+				Short4 vvvv1 = offsetSample(vvvv, mipmap, OFFSET(Mipmap,vHalf), state.addressingModeV == ADDRESSING_WRAP, gather ? 2 : +1, lod);
 
+				sampleTexel(c0, uuuu0, vvvv0, wwww, offset, w, mipmap, buffer, function);
+				sampleTexel(c1, uuuu1, vvvv0, wwww, offset, w, mipmap, buffer, function);
+				sampleTexel(c2, uuuu0, vvvv1, wwww, offset, w, mipmap, buffer, function);
+				sampleTexel(c3, uuuu1, vvvv1, wwww, offset, w, mipmap, buffer, function);
+
+				if(!gather)
+				{
+					fu = Frac(Float4(As<UShort4>(uuuu0)) * *Pointer<Float4>(mipmap + OFFSET(Mipmap,fWidth)));
+					fv = Frac(Float4(As<UShort4>(vvvv0)) * *Pointer<Float4>(mipmap + OFFSET(Mipmap,fHeight)));
+				}
+			}
+
+			if(!gather)   // Blend
+			{
 				if(componentCount >= 1) c0.x = c0.x + fu * (c1.x - c0.x);
 				if(componentCount >= 2) c0.y = c0.y + fu * (c1.y - c0.y);
 				if(componentCount >= 3) c0.z = c0.z + fu * (c1.z - c0.z);
@@ -1403,7 +1704,7 @@ namespace sw
 		}
 	}
 
-	void SamplerCore::computeLod(Pointer<Byte> &texture, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Float4 &uuuu, Float4 &vvvv, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, SamplerFunction function)
+	void SamplerCore::computeLod(Pointer<Byte> &texture, Float &lod, Int4 &taps, Float4 &uDelta, Float4 &vDelta, Float4 &uuuu, Float4 &vvvv, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, SamplerFunction function)
 	{
 		if(function != Lod && function != Fetch)
 		{
@@ -1442,10 +1743,53 @@ namespace sw
 				uDelta = As<Float4>(As<Int4>(dudx) & mask | As<Int4>(dudy) & ~mask);
 				vDelta = As<Float4>(As<Int4>(dvdx) & mask | As<Int4>(dvdy) & ~mask);
 
-				anisotropy = lod * Rcp_pp(det);
+				Float anisotropy = lod * Rcp_pp(det);
 				anisotropy = Min(anisotropy, *Pointer<Float>(texture + OFFSET(Texture,maxAnisotropy)));
 
 				lod *= Rcp_pp(anisotropy * anisotropy);
+
+				if(!state.adaptiveAnisotropy)
+				{
+					taps = Int4(RoundInt(anisotropy));
+				}
+				else
+				{
+					// Each pixel's own footprint, from the differences along its row and column of the quad
+					if(function != Grad)
+					{
+						dudx = uuuu.yyww - uuuu.xxzz;
+						dudy = uuuu.zwzw - uuuu.xyxy;
+						dvdx = vvvv.yyww - vvvv.xxzz;
+						dvdy = vvvv.zwzw - vvvv.xyxy;
+					}
+					else
+					{
+						dudx = dsx.x;
+						dudy = dsy.x;
+						dvdx = dsx.y;
+						dvdy = dsy.y;
+					}
+
+					Float4 widthHeight = *Pointer<Float4>(texture + OFFSET(Texture,widthHeightLOD));
+					Float4 dUdx = dudx * widthHeight.xxxx;
+					Float4 dUdy = dudy * widthHeight.xxxx;
+					Float4 dVdx = dvdx * widthHeight.zzzz;
+					Float4 dVdy = dvdy * widthHeight.zzzz;
+
+					Float4 dUV2dx = dUdx * dUdx + dVdx * dVdx;
+					Float4 dUV2dy = dUdy * dUdy + dVdy * dVdy;
+					Float4 det4 = Abs(dUdx * dVdy - dUdy * dVdx);
+
+					mask = As<Int4>(CmpNLT(dUV2dx, dUV2dy));
+					uDelta = As<Float4>(As<Int4>(dudx) & mask | As<Int4>(dudy) & ~mask);
+					vDelta = As<Float4>(As<Int4>(dvdx) & mask | As<Int4>(dvdy) & ~mask);
+
+					Float4 anisotropy4 = Max(dUV2dx, dUV2dy) * Rcp_pp(det4);
+					anisotropy4 = Min(anisotropy4, Float4(*Pointer<Float>(texture + OFFSET(Texture,maxAnisotropy))));
+
+					// Round to nearest, since rounding up takes more taps than the footprint needs
+					taps = Max(RoundInt(anisotropy4), Int4(1));
+				}
 			}
 
 			// log2(sqrt(lod))
@@ -1649,6 +1993,63 @@ namespace sw
 		lodZ = z * M;
 	}
 
+	void SamplerCore::cubeSeamless(Pointer<Byte> &mipmap, Float4 &u, Float4 &v, Int face[4], Short4 uuuu[4], Short4 vvvv[4], Pointer<Byte> buffer[4][4], Float4 &fu, Float4 &fv)
+	{
+		// Bilinear footprint in texels. Cube faces are square, so the width applies to both axes.
+		Float4 size = *Pointer<Float4>(mipmap + OFFSET(Mipmap,fWidth)) * Float4(1 << 16);
+		Float4 x = u * size - Float4(0.5f);
+		Float4 y = v * size - Float4(0.5f);
+		Float4 x0 = Floor(x);
+		Float4 y0 = Floor(y);
+
+		fu = x - x0;
+		fv = y - y0;
+
+		Int4 f = Insert(Insert(Insert(Int4(face[0]), face[1], 1), face[2], 2), face[3], 3);
+		Int4 xAxis = CmpEQ(f & Int4(6), Int4(0));
+		Int4 yAxis = CmpEQ(f & Int4(6), Int4(2));
+		Int4 zAxis = CmpEQ(f & Int4(6), Int4(4));
+		Float4 sign = Float4(Int4(1) - ((f & Int4(1)) << 1));   // -1 for negative faces
+		Float4 scale = Float4(2.0f) / size;
+
+		for(int i = 0; i < 4; i++)
+		{
+			// Face coordinates of the texel centre, up to one texel beyond the edge
+			Float4 s = (x0 + Float4((i & 1) + 0.5f)) * scale - Float4(1.0f);
+			Float4 t = (y0 + Float4((i >> 1) + 0.5f)) * scale - Float4(1.0f);
+
+			// Fold texels beyond an edge onto the adjacent face: the overshoot is taken off the major
+			// axis instead, so the direction projects onto the edge row of the neighbour. Across a
+			// corner this picks the corner texel of one of the two adjacent faces.
+			Float4 m = Float4(2.0f) - Max(Max(Abs(s), Abs(t)), Float4(1.0f));
+			s = Min(Max(s, Float4(-1.0f)), Float4(1.0f));
+			t = Min(Max(t, Float4(-1.0f)), Float4(1.0f));
+
+			// Direction vector, inverting the projection done by cubeFace()
+			Float4 major = sign * m;
+			Float4 dx = As<Float4>((xAxis & As<Int4>(major)) | (yAxis & As<Int4>(s)) | (zAxis & As<Int4>(sign * s)));
+			Float4 dy = As<Float4>((yAxis & As<Int4>(major)) | (~yAxis & As<Int4>(-t)));
+			Float4 dz = As<Float4>((xAxis & As<Int4>(-sign * s)) | (yAxis & As<Int4>(sign * t)) | (zAxis & As<Int4>(major)));
+
+			Int tapFace[4];
+			Float4 U;
+			Float4 V;
+			Float4 lodX;
+			Float4 lodY;
+			Float4 lodZ;
+
+			cubeFace(tapFace, U, V, lodX, lodY, lodZ, dx, dy, dz);
+
+			uuuu[i] = address(U, ADDRESSING_CLAMP, mipmap);
+			vvvv[i] = address(V, ADDRESSING_CLAMP, mipmap);
+
+			for(int j = 0; j < 4; j++)
+			{
+				buffer[i][j] = *Pointer<Pointer<Byte> >(mipmap + OFFSET(Mipmap,buffer) + tapFace[j] * sizeof(void*));
+			}
+		}
+	}
+
 	Short4 SamplerCore::applyOffset(Short4 &uvw, Float4 &offset, const Int4 &whd, AddressingMode mode)
 	{
 		Int4 tmp = Int4(As<UShort4>(uvw));
@@ -1691,12 +2092,28 @@ namespace sw
 			vvvv = applyOffset(vvvv, offset.y, Int4(*Pointer<UShort4>(mipmap + OFFSET(Mipmap, height))), texelFetch ? ADDRESSING_TEXELFETCH : state.addressingModeV);
 		}
 
+		Short4 tile;
+
+		if(state.tiledLayout)
+		{
+			// 4x4 tiles: (y & ~3) * pitchP + (x & ~3) * 4 + (y & 3) * 4 + (x & 3), with onePitchP = (4, pitchP)
+			tile = ((vvvv & Short4(0x0003)) << 2) | (uuuu & Short4(0x0003));
+			uuuu &= Short4(0xFFFCu);
+			vvvv &= Short4(0xFFFCu);
+		}
+
 		Short4 uuu2 = uuuu;
 		uuuu = As<Short4>(UnpackLow(uuuu, vvvv));
 		uuu2 = As<Short4>(UnpackHigh(uuu2, vvvv));
 		uuuu = As<Short4>(MulAdd(uuuu, *Pointer<Short4>(mipmap + OFFSET(Mipmap,onePitchP))));
 		uuu2 = As<Short4>(MulAdd(uuu2, *Pointer<Short4>(mipmap + OFFSET(Mipmap,onePitchP))));
 
+		if(state.tiledLayout)
+		{
+			uuuu = As<Short4>(As<Int2>(uuuu) + UnpackLow(tile, Short4(0x0000)));
+			uuu2 = As<Short4>(As<Int2>(uuu2) + UnpackHigh(tile, Short4(0x0000)));
+		}
+
 		if((state.textureType == TEXTURE_3D) || (state.textureType == TEXTURE_2D_ARRAY))
 		{
 			if(state.textureType != TEXTURE_2D_ARRAY)
@@ -2232,6 +2649,37 @@ namespace sw
 		c = Insert(c, *Pointer<Short>(LUT + 2 * Int(Extract(c, 3))), 3);
 	}
 
+	bool SamplerCore::hasFastPath(SamplerFunction function) const
+	{
+		// Non-mipmapped, clamped 2D RGBA8 textures sampled with point or bilinear filtering
+		if(!samplerFastPaths || function == Fetch || function.option == Offset)
+		{
+			return false;
+		}
+
+		switch(state.textureFormat)
+		{
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8R8G8B8:
+		case FORMAT_A8B8G8R8:
+		case FORMAT_X8B8G8R8:
+			break;
+		default:
+			return false;
+		}
+
+		return state.textureType == TEXTURE_2D &&
+		       state.mipmapFilter == MIPMAP_NONE &&
+		       (state.textureFilter == FILTER_POINT || state.textureFilter == FILTER_LINEAR) &&
+		       state.addressingModeU == ADDRESSING_CLAMP &&
+		       state.addressingModeV == ADDRESSING_CLAMP &&
+		       !state.sRGB &&
+		       state.swizzleR == SWIZZLE_RED &&
+		       state.swizzleG == SWIZZLE_GREEN &&
+		       state.swizzleB == SWIZZLE_BLUE &&
+		       state.swizzleA == SWIZZLE_ALPHA;
+	}
+
 	bool SamplerCore::hasFloatTexture() const
 	{
 		return Surface::isFloatFormat(state.textureFormat);
@@ -578,6 +578,14 @@ namespace sw
 				Pointer<Byte> rightEdge = primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right);
 				Pointer<Byte> edge = IfThenElse(swap, rightEdge, leftEdge);
 
+				// Edges of guard band primitives can start far above the scissor rectangle. Move their
+				// start to its top row, so the initial error term below doesn't overflow.
+				If((y1 << 4) - Y1 > 0x0F)
+				{
+					X1 = X1 + RoundInt(Float(X2 - X1) * Float((y1 << 4) - Y1) / Float(Y2 - Y1));
+					Y1 = y1 << 4;
+				}
+
 				// Deltas
 				Int DX12 = X2 - X1;
 				Int DY12 = Y2 - Y1;
@@ -18,14 +18,18 @@
 #include "PixelShader.hpp"
 #include "Math.hpp"
 #include "Debug.hpp"
+#include "Thread.hpp"
 
 #include <set>
 #include <fstream>
 #include <sstream>
 #include <stdarg.h>
+#include <string.h>
 
 namespace sw
 {
+	extern bool shaderOptimizations;
+
 	volatile int Shader::serialCounter = 1;
 
 	Shader::Opcode Shader::OPCODE_DP(int i)
@@ -1100,6 +1104,207 @@ namespace sw
 		return opcode == OPCODE_ENDLOOP || opcode == OPCODE_ENDREP || opcode == OPCODE_ENDWHILE || opcode == OPCODE_ENDSWITCH;;
 	}
 
+	// Instructions which start or end a basic block, or change the execution mask of subsequent instructions
+	bool Shader::Instruction::isControlFlow() const
+	{
+		switch(opcode)
+		{
+		case OPCODE_CALL:
+		case OPCODE_CALLNZ:
+		case OPCODE_LOOP:
+		case OPCODE_RET:
+		case OPCODE_ENDLOOP:
+		case OPCODE_LABEL:
+		case OPCODE_REP:
+		case OPCODE_ENDREP:
+		case OPCODE_IF:
+		case OPCODE_IFC:
+		case OPCODE_ELSE:
+		case OPCODE_ENDIF:
+		case OPCODE_BREAK:
+		case OPCODE_BREAKC:
+		case OPCODE_BREAKP:
+		case OPCODE_TEXKILL:
+		case OPCODE_PHASE:
+		case OPCODE_END:
+		case OPCODE_WHILE:
+		case OPCODE_ENDWHILE:
+		case OPCODE_DISCARD:
+		case OPCODE_LEAVE:
+		case OPCODE_CONTINUE:
+		case OPCODE_TEST:
+		case OPCODE_SWITCH:
+		case OPCODE_ENDSWITCH:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Instructions which only write their destination register, and only read their source operands
+	bool Shader::Instruction::isSideEffectFree() const
+	{
+		if(isComponentwise())
+		{
+			return true;
+		}
+
+		switch(opcode)
+		{
+		case OPCODE_DP1:
+		case OPCODE_DP2:
+		case OPCODE_DP3:
+		case OPCODE_DP4:
+		case OPCODE_DP2ADD:
+		case OPCODE_DET2:
+		case OPCODE_DET3:
+		case OPCODE_DET4:
+		case OPCODE_LEN2:
+		case OPCODE_LEN3:
+		case OPCODE_LEN4:
+		case OPCODE_DIST1:
+		case OPCODE_DIST2:
+		case OPCODE_DIST3:
+		case OPCODE_DIST4:
+		case OPCODE_NRM2:
+		case OPCODE_NRM3:
+		case OPCODE_NRM4:
+		case OPCODE_CRS:
+		case OPCODE_EQ:
+		case OPCODE_NE:
+		case OPCODE_ALL:
+		case OPCODE_ANY:
+		case OPCODE_EXTRACT:
+		case OPCODE_INSERT:
+		case OPCODE_FORWARD1:
+		case OPCODE_FORWARD2:
+		case OPCODE_FORWARD3:
+		case OPCODE_FORWARD4:
+		case OPCODE_REFLECT1:
+		case OPCODE_REFLECT2:
+		case OPCODE_REFLECT3:
+		case OPCODE_REFLECT4:
+		case OPCODE_REFRACT1:
+		case OPCODE_REFRACT2:
+		case OPCODE_REFRACT3:
+		case OPCODE_REFRACT4:
+		case OPCODE_PACKSNORM2x16:
+		case OPCODE_PACKUNORM2x16:
+		case OPCODE_PACKHALF2x16:
+		case OPCODE_UNPACKSNORM2x16:
+		case OPCODE_UNPACKUNORM2x16:
+		case OPCODE_UNPACKHALF2x16:
+		case OPCODE_DFDX:
+		case OPCODE_DFDY:
+		case OPCODE_FWIDTH:
+		case OPCODE_TEX:
+		case OPCODE_TEXLDD:
+		case OPCODE_TEXLDL:
+		case OPCODE_TEXSIZE:
+		case OPCODE_TEXOFFSET:
+		case OPCODE_TEXLDLOFFSET:
+		case OPCODE_TEXELFETCH:
+		case OPCODE_TEXELFETCHOFFSET:
+		case OPCODE_TEXGRAD:
+		case OPCODE_TEXGRADOFFSET:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Instructions for which each destination component only depends on the same component of the (swizzled) sources
+	bool Shader::Instruction::isComponentwise() const
+	{
+		switch(opcode)
+		{
+		case OPCODE_MOV:
+		case OPCODE_ADD:
+		case OPCODE_SUB:
+		case OPCODE_MAD:
+		case OPCODE_MUL:
+		case OPCODE_MIN:
+		case OPCODE_MAX:
+		case OPCODE_SLT:
+		case OPCODE_SGE:
+		case OPCODE_LRP:
+		case OPCODE_FRC:
+		case OPCODE_SGN:
+		case OPCODE_ABS:
+		case OPCODE_CMP0:
+		case OPCODE_COS:
+		case OPCODE_SIN:
+		case OPCODE_TAN:
+		case OPCODE_ACOS:
+		case OPCODE_ASIN:
+		case OPCODE_ATAN:
+		case OPCODE_ATAN2:
+		case OPCODE_COSH:
+		case OPCODE_SINH:
+		case OPCODE_TANH:
+		case OPCODE_ACOSH:
+		case OPCODE_ASINH:
+		case OPCODE_ATANH:
+		case OPCODE_TRUNC:
+		case OPCODE_FLOOR:
+		case OPCODE_ROUND:
+		case OPCODE_ROUNDEVEN:
+		case OPCODE_CEIL:
+		case OPCODE_SQRT:
+		case OPCODE_RSQ:
+		case OPCODE_DIV:
+		case OPCODE_MOD:
+		case OPCODE_EXP2:
+		case OPCODE_LOG2:
+		case OPCODE_EXP:
+		case OPCODE_LOG:
+		case OPCODE_POW:
+		case OPCODE_F2B:
+		case OPCODE_B2F:
+		case OPCODE_F2I:
+		case OPCODE_I2F:
+		case OPCODE_F2U:
+		case OPCODE_U2F:
+		case OPCODE_I2B:
+		case OPCODE_B2I:
+		case OPCODE_NEG:
+		case OPCODE_NOT:
+		case OPCODE_OR:
+		case OPCODE_XOR:
+		case OPCODE_AND:
+		case OPCODE_STEP:
+		case OPCODE_SMOOTH:
+		case OPCODE_FLOATBITSTOINT:
+		case OPCODE_FLOATBITSTOUINT:
+		case OPCODE_INTBITSTOFLOAT:
+		case OPCODE_UINTBITSTOFLOAT:
+		case OPCODE_ICMP:
+		case OPCODE_UCMP:
+		case OPCODE_SELECT:
+		case OPCODE_INEG:
+		case OPCODE_IABS:
+		case OPCODE_ISGN:
+		case OPCODE_IADD:
+		case OPCODE_ISUB:
+		case OPCODE_IMUL:
+		case OPCODE_IDIV:
+		case OPCODE_IMAD:
+		case OPCODE_IMOD:
+		case OPCODE_SHL:
+		case OPCODE_ISHR:
+		case OPCODE_IMIN:
+		case OPCODE_IMAX:
+		case OPCODE_UDIV:
+		case OPCODE_UMOD:
+		case OPCODE_USHR:
+		case OPCODE_UMIN:
+		case OPCODE_UMAX:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	bool Shader::Instruction::isPredicated() const
 	{
 		return predicate ||
@@ -1109,7 +1314,7 @@ namespace sw
 		       analysisLeave;
 	}
 
-	Shader::Shader() : serialID(serialCounter++)
+	Shader::Shader() : serialID(atomicIncrement(&serialCounter))
 	{
 		usedSamplers = 0;
 	}
@@ -1464,11 +1669,108 @@ namespace sw
 		return instruction[i];
 	}
 
+	namespace
+	{
+		bool isLiteral(const Shader::Parameter &parameter)
+		{
+			return parameter.type == Shader::PARAMETER_FLOAT4LITERAL ||
+			       parameter.type == Shader::PARAMETER_BOOL1LITERAL ||
+			       parameter.type == Shader::PARAMETER_INT4LITERAL;
+		}
+
+		bool isMatrixOperation(Shader::Opcode opcode)
+		{
+			return opcode == Shader::OPCODE_M4X4 || opcode == Shader::OPCODE_M4X3 ||
+			       opcode == Shader::OPCODE_M3X4 || opcode == Shader::OPCODE_M3X3 || opcode == Shader::OPCODE_M3X2;
+		}
+
+		bool writesRegister(const Shader::Instruction *instruction, const Shader::Parameter &parameter)
+		{
+			return instruction->dst.type == parameter.type && instruction->dst.index == parameter.index;
+		}
+
+		// Components of a source operand which are read by the instruction
+		int readMask(const Shader::Instruction *instruction, int i)
+		{
+			const Shader::SourceParameter &src = instruction->src[i];
+			int mask = instruction->isComponentwise() ? instruction->dst.mask : 0xF;
+			int read = 0;
+
+			for(int component = 0; component < 4; component++)
+			{
+				if(mask & (1 << component))
+				{
+					read |= 1 << ((src.swizzle >> (2 * component)) & 0x3);
+				}
+			}
+
+			return read;
+		}
+
+		unsigned int composeSwizzle(unsigned int inner, unsigned int outer)
+		{
+			unsigned int swizzle = 0;
+
+			for(int component = 0; component < 4; component++)
+			{
+				int select = (outer >> (2 * component)) & 0x3;
+				swizzle |= ((inner >> (2 * select)) & 0x3) << (2 * component);
+			}
+
+			return swizzle;
+		}
+
+		bool equalSources(const Shader::SourceParameter &a, const Shader::SourceParameter &b)
+		{
+			if(a.type != b.type || a.swizzle != b.swizzle || a.modifier != b.modifier)
+			{
+				return false;
+			}
+
+			if(a.type == Shader::PARAMETER_VOID)
+			{
+				return true;
+			}
+
+			if(isLiteral(a))
+			{
+				return memcmp(a.value, b.value, sizeof(a.value)) == 0;
+			}
+
+			return a.index == b.index && a.bufferIndex == b.bufferIndex &&
+			       a.rel.type == Shader::PARAMETER_VOID && b.rel.type == Shader::PARAMETER_VOID;
+		}
+	}
+
 	void Shader::optimize()
 	{
 		optimizeLeave();
 		optimizeCall();
 		removeNull();
+
+		if(!shaderOptimizations)
+		{
+			return;
+		}
+
+		// Iterate the data flow optimizations until they stop making progress, as
+		// each of them can expose new opportunities for the others.
+		for(int pass = 0; pass < 8 && optimizableTemporaries(); pass++)
+		{
+			bool progress = false;
+
+			progress |= optimizeConstants();
+			progress |= optimizeCopies();
+			progress |= optimizeRedundancy();
+			progress |= optimizeDeadCode();
+
+			removeNull();
+
+			if(!progress)
+			{
+				break;
+			}
+		}
 	}
 
 	void Shader::optimizeLeave()
@@ -1549,6 +1851,404 @@ namespace sw
 		}
 	}
 
+	// Data flow optimizations are only applied to temporaries which are not dynamically indexed,
+	// and not to ps_1_x shaders, where r0 holds the output color.
+	bool Shader::optimizableTemporaries() const
+	{
+		if(shaderType == SHADER_PIXEL && majorVersion < 2)
+		{
+			return false;
+		}
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			if(instruction[i]->dst.type == PARAMETER_TEMP && instruction[i]->dst.rel.type != PARAMETER_VOID)
+			{
+				return false;
+			}
+
+			for(int j = 0; j < 5; j++)
+			{
+				const SourceParameter &src = instruction[i]->src[j];
+
+				if(src.type == PARAMETER_TEMP && src.rel.type != PARAMETER_VOID)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool Shader::optimizeConstants()
+	{
+		// Fold arithmetic on literal operands into a move of the resulting literal
+		bool progress = false;
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			Instruction *inst = instruction[i];
+			int operands = 0;
+
+			switch(inst->opcode)
+			{
+			case OPCODE_ADD: operands = 2; break;
+			case OPCODE_SUB: operands = 2; break;
+			case OPCODE_MUL: operands = 2; break;
+			case OPCODE_MAD: operands = 3; break;
+			default: continue;
+			}
+
+			if(inst->predicate || inst->dst.integer || inst->dst.saturate || inst->dst.shift != 0)
+			{
+				continue;
+			}
+
+			float s[3][4];
+			bool literal = true;
+
+			for(int j = 0; j < operands; j++)
+			{
+				const SourceParameter &src = inst->src[j];
+
+				if(src.type != PARAMETER_FLOAT4LITERAL || (src.modifier != MODIFIER_NONE && src.modifier != MODIFIER_NEGATE))
+				{
+					literal = false;
+					break;
+				}
+
+				for(int c = 0; c < 4; c++)
+				{
+					float value = src.value[(src.swizzle >> (2 * c)) & 0x3];
+					s[j][c] = (src.modifier == MODIFIER_NEGATE) ? -value : value;
+				}
+			}
+
+			if(!literal)
+			{
+				continue;
+			}
+
+			SourceParameter result;
+			result.type = PARAMETER_FLOAT4LITERAL;
+
+			for(int c = 0; c < 4; c++)
+			{
+				switch(inst->opcode)
+				{
+				case OPCODE_ADD: result.value[c] = s[0][c] + s[1][c]; break;
+				case OPCODE_SUB: result.value[c] = s[0][c] - s[1][c]; break;
+				case OPCODE_MUL: result.value[c] = s[0][c] * s[1][c]; break;
+				case OPCODE_MAD:
+					{
+						float product = s[0][c] * s[1][c];   // Not fused
+						result.value[c] = product + s[2][c];
+					}
+					break;
+				default:
+					ASSERT(false);
+				}
+			}
+
+			inst->opcode = OPCODE_MOV;
+			inst->src[0] = result;
+			inst->src[1] = SourceParameter();
+			inst->src[2] = SourceParameter();
+			progress = true;
+		}
+
+		return progress;
+	}
+
+	bool Shader::optimizeCopies()
+	{
+		// Replace reads of a temporary written by a move with reads of the move's source,
+		// as long as neither has been overwritten since, within the same basic block.
+		bool progress = false;
+		std::vector<const Instruction*> copies;
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			Instruction *inst = instruction[i];
+
+			if(inst->isControlFlow())
+			{
+				copies.clear();
+				continue;
+			}
+
+			if(inst->isSideEffectFree())
+			{
+				for(int j = 0; j < 5; j++)
+				{
+					SourceParameter &src = inst->src[j];
+
+					if(src.type != PARAMETER_TEMP)
+					{
+						continue;
+					}
+
+					for(size_t k = 0; k < copies.size(); k++)
+					{
+						const Instruction *copy = copies[k];
+
+						if(copy->dst.index != src.index || (readMask(inst, j) & ~copy->dst.mask) != 0)
+						{
+							continue;
+						}
+
+						const SourceParameter &source = copy->src[0];
+
+						if(source.modifier != MODIFIER_NONE && src.modifier != MODIFIER_NONE)
+						{
+							break;
+						}
+
+						Modifier modifier = (src.modifier != MODIFIER_NONE) ? src.modifier : source.modifier;
+						unsigned int swizzle = composeSwizzle(source.swizzle, src.swizzle);
+
+						src = source;
+						src.swizzle = swizzle;
+						src.modifier = modifier;
+						progress = true;
+						break;
+					}
+				}
+			}
+
+			if(inst->dst.type != PARAMETER_VOID)
+			{
+				for(size_t k = 0; k < copies.size(); )
+				{
+					if(writesRegister(inst, copies[k]->dst) || writesRegister(inst, copies[k]->src[0]))
+					{
+						copies.erase(copies.begin() + k);
+					}
+					else
+					{
+						k++;
+					}
+				}
+			}
+
+			if(inst->opcode == OPCODE_MOV && !inst->predicate &&
+			   inst->dst.type == PARAMETER_TEMP && !inst->dst.saturate && inst->dst.shift == 0)
+			{
+				const SourceParameter &source = inst->src[0];
+				bool forwardable = false;
+
+				switch(source.type)
+				{
+				case PARAMETER_FLOAT4LITERAL:
+					forwardable = true;
+					break;
+				case PARAMETER_TEMP:
+				case PARAMETER_INPUT:
+				case PARAMETER_CONST:
+					forwardable = source.rel.type == PARAMETER_VOID && !writesRegister(inst, source);
+					break;
+				default:
+					break;
+				}
+
+				if(forwardable && (source.modifier == MODIFIER_NONE || source.modifier == MODIFIER_NEGATE ||
+				                   source.modifier == MODIFIER_ABS || source.modifier == MODIFIER_ABS_NEGATE))
+				{
+					copies.push_back(inst);
+				}
+			}
+		}
+
+		return progress;
+	}
+
+	bool Shader::optimizeRedundancy()
+	{
+		// Replace instructions which recompute the result of an earlier identical instruction
+		// in the same basic block, including texture fetches, with a move of that result.
+		bool progress = false;
+		std::vector<const Instruction*> available;
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			Instruction *inst = instruction[i];
+
+			if(inst->isControlFlow())
+			{
+				available.clear();
+				continue;
+			}
+
+			bool candidate = inst->isSideEffectFree() && !inst->predicate && inst->opcode != OPCODE_MOV &&
+			                 inst->dst.type == PARAMETER_TEMP;
+
+			for(int j = 0; j < 5 && candidate; j++)
+			{
+				if(writesRegister(inst, inst->src[j]) && !isLiteral(inst->src[j]))
+				{
+					candidate = false;
+				}
+			}
+
+			if(candidate)
+			{
+				for(size_t k = 0; k < available.size(); k++)
+				{
+					const Instruction *previous = available[k];
+
+					if(previous->opcode != inst->opcode ||
+					   previous->control != inst->control ||
+					   previous->samplerType != inst->samplerType ||
+					   previous->dst.integer != inst->dst.integer ||
+					   previous->dst.saturate != inst->dst.saturate ||
+					   previous->dst.partialPrecision != inst->dst.partialPrecision ||
+					   previous->dst.shift != inst->dst.shift ||
+					   (inst->dst.mask & ~previous->dst.mask) != 0)
+					{
+						continue;
+					}
+
+					bool equal = true;
+
+					for(int j = 0; j < 5; j++)
+					{
+						equal = equal && equalSources(previous->src[j], inst->src[j]);
+					}
+
+					if(equal)
+					{
+						inst->opcode = OPCODE_MOV;
+						inst->dst.saturate = false;
+						inst->src[0] = SourceParameter();
+						inst->src[0].type = PARAMETER_TEMP;
+						inst->src[0].index = previous->dst.index;
+
+						for(int j = 1; j < 5; j++)
+						{
+							inst->src[j] = SourceParameter();
+						}
+
+						progress = true;
+						break;
+					}
+				}
+			}
+
+			if(inst->dst.type != PARAMETER_VOID)
+			{
+				for(size_t k = 0; k < available.size(); )
+				{
+					bool clobbered = writesRegister(inst, available[k]->dst);
+
+					for(int j = 0; j < 5; j++)
+					{
+						if(!isLiteral(available[k]->src[j]) && writesRegister(inst, available[k]->src[j]))
+						{
+							clobbered = true;
+						}
+					}
+
+					if(clobbered)
+					{
+						available.erase(available.begin() + k);
+					}
+					else
+					{
+						k++;
+					}
+				}
+			}
+
+			if(candidate && inst->opcode != OPCODE_MOV)
+			{
+				available.push_back(inst);
+			}
+		}
+
+		return progress;
+	}
+
+	bool Shader::optimizeDeadCode()
+	{
+		// Determine which components of each temporary are ever read
+		std::vector<unsigned char> read;
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			const Instruction *inst = instruction[i];
+
+			for(int j = 0; j < 5; j++)
+			{
+				const SourceParameter &src = inst->src[j];
+
+				if(src.type == PARAMETER_VOID || isLiteral(src))
+				{
+					continue;
+				}
+
+				if(src.rel.type == PARAMETER_TEMP)
+				{
+					if(src.rel.index >= read.size()) read.resize(src.rel.index + 1);
+					read[src.rel.index] |= 0xF;
+				}
+
+				if(src.type == PARAMETER_TEMP)
+				{
+					bool matrix = (j == 1) && isMatrixOperation(inst->opcode);   // Reads consecutive rows
+					unsigned int last = src.index + (matrix ? 3 : 0);
+
+					if(last >= read.size()) read.resize(last + 1);
+
+					for(unsigned int index = src.index; index <= last; index++)
+					{
+						read[index] |= matrix ? 0xF : readMask(inst, j);
+					}
+				}
+			}
+
+			if(inst->dst.type != PARAMETER_VOID && inst->dst.type != PARAMETER_LABEL && inst->dst.rel.type == PARAMETER_TEMP)
+			{
+				if(inst->dst.rel.index >= read.size()) read.resize(inst->dst.rel.index + 1);
+				read[inst->dst.rel.index] |= 0xF;
+			}
+
+			if(inst->dst.type == PARAMETER_TEMP && !inst->isSideEffectFree())   // Conservatively assume the destination is also an input
+			{
+				if(inst->dst.index >= read.size()) read.resize(inst->dst.index + 1);
+				read[inst->dst.index] |= 0xF;
+			}
+		}
+
+		// Eliminate writes to components which are never read
+		bool progress = false;
+
+		for(size_t i = 0; i < instruction.size(); i++)
+		{
+			Instruction *inst = instruction[i];
+
+			if(inst->dst.type != PARAMETER_TEMP || !inst->isSideEffectFree())
+			{
+				continue;
+			}
+
+			int live = (inst->dst.index < read.size()) ? (inst->dst.mask & read[inst->dst.index]) : 0;
+
+			if(live == 0)
+			{
+				inst->opcode = OPCODE_NULL;
+				progress = true;
+			}
+			else if(live != inst->dst.mask && inst->isComponentwise())
+			{
+				inst->dst.mask = live;
+				progress = true;
+			}
+		}
+
+		return progress;
+	}
+
 	void Shader::removeNull()
 	{
 		size_t size = 0;
@@ -497,6 +497,9 @@ namespace sw
 			bool isBreak() const;
 			bool isLoopOrSwitch() const;
 			bool isEndLoopOrSwitch() const;
+			bool isControlFlow() const;
+			bool isSideEffectFree() const;
+			bool isComponentwise() const;
 
 			bool isPredicated() const;
 
@@ -608,6 +611,11 @@ namespace sw
 
 		void optimizeLeave();
 		void optimizeCall();
+		bool optimizeConstants();
+		bool optimizeCopies();
+		bool optimizeRedundancy();
+		bool optimizeDeadCode();
+		bool optimizableTemporaries() const;
 		void removeNull();
 
 		void analyzeDirtyConstants();
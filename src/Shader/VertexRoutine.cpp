@@ -41,7 +41,7 @@ namespace sw
 	{
 		const bool textureSampling = state.textureSampling;
 
-		Pointer<Byte> cache = task + OFFSET(VertexTask,vertexCache);
+		Pointer<Byte> cache = task + (state.positionOnly ? OFFSET(VertexTask,positionCache) : OFFSET(VertexTask,vertexCache));
 		Pointer<Byte> vertexCache = cache + OFFSET(VertexCache,vertex);
 		Pointer<Byte> tagCache = cache + OFFSET(VertexCache,tag);
 
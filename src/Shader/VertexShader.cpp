@@ -23,6 +23,7 @@ namespace sw
 {
 	VertexShader::VertexShader(const VertexShader *vs) : Shader()
 	{
+		shaderType = SHADER_VERTEX;
 		version = 0x0300;
 		positionRegister = Pos;
 		pointSizeRegister = Unused;
@@ -37,6 +38,8 @@ namespace sw
 
 		if(vs)   // Make a copy
 		{
+			version = vs->version;   // The analysis depends on it
+
 			for(size_t i = 0; i < vs->getLength(); i++)
 			{
 				append(new sw::Shader::Instruction(*vs->getInstruction(i)));
@@ -0,0 +1,104 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Shader/Constants.hpp"
+#include "Common/Memory.hpp"
+
+#include <new>
+
+using namespace sw;
+
+namespace benchmark
+{
+	DrawData *createDrawData()
+	{
+		DrawData *data = (DrawData*)allocate(sizeof(DrawData));
+		clearDrawData(data);
+
+		return data;
+	}
+
+	void clearDrawData(DrawData *data)
+	{
+		new(data) DrawData();   // Value-initialization zeroes all members
+		data->constants = &constants;
+	}
+
+	void destroyDrawData(DrawData *data)
+	{
+		deallocate(data);
+	}
+
+	Shader::DestinationParameter destination(Shader::ParameterType type, int index, int mask)
+	{
+		Shader::DestinationParameter dst;
+		dst.type = type;
+		dst.index = index;
+		dst.mask = mask;
+
+		return dst;
+	}
+
+	Shader::SourceParameter source(Shader::ParameterType type, int index, int swizzle)
+	{
+		Shader::SourceParameter src;
+		src.type = type;
+		src.index = index;
+		src.swizzle = swizzle;
+
+		return src;
+	}
+
+	Shader::SourceParameter literal(float x, float y, float z, float w)
+	{
+		Shader::SourceParameter src;
+		src.type = Shader::PARAMETER_FLOAT4LITERAL;
+		src.value[0] = x;
+		src.value[1] = y;
+		src.value[2] = z;
+		src.value[3] = w;
+
+		return src;
+	}
+
+	Shader::Instruction *instruction(Shader::Opcode opcode, const Shader::DestinationParameter &dst,
+	                                 const Shader::SourceParameter &src0, const Shader::SourceParameter &src1, const Shader::SourceParameter &src2)
+	{
+		Shader::Instruction *instruction = new Shader::Instruction(opcode);
+		instruction->dst = dst;
+		instruction->src[0] = src0;
+		instruction->src[1] = src1;
+		instruction->src[2] = src2;
+
+		return instruction;
+	}
+
+	void appendArithmetic(Shader &shader, int operations)
+	{
+		const Shader::DestinationParameter r0 = destination(Shader::PARAMETER_TEMP, 0);
+
+		for(int i = 0; i < operations; i++)
+		{
+			shader.append(instruction(Shader::OPCODE_MAD, r0,
+			                          source(Shader::PARAMETER_TEMP, 0, 0x39),   // yzwx
+			                          literal(1.5f, 2.25f, 3.125f, 0.75f),
+			                          source(Shader::PARAMETER_TEMP, 0)));
+
+			shader.append(instruction(Shader::OPCODE_FRC, r0, source(Shader::PARAMETER_TEMP, 0)));
+		}
+	}
+}
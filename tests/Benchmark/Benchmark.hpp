@@ -0,0 +1,107 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef benchmark_Benchmark_hpp
+#define benchmark_Benchmark_hpp
+
+#include "Shader/Shader.hpp"
+#include "Common/Timer.hpp"
+
+#include <vector>
+
+namespace sw
+{
+	struct DrawData;
+}
+
+// Helpers shared by the benchmark programs, which drive the processors'
+// routines directly rather than through a graphics API.
+namespace benchmark
+{
+	const int frames = 16;              // Timed runs, of which the fastest is reported
+	const int complexOperations = 24;   // Multiply-add and fraction pairs in the complex shaders
+
+	// Returns the time of the fastest of a number of calls, in seconds
+	template<class Function>
+	double bestTime(Function function, int runs = frames)
+	{
+		double best = 1.0e30;
+
+		for(int run = 0; run < runs; run++)
+		{
+			double start = sw::Timer::seconds();
+			function();
+			double time = sw::Timer::seconds() - start;
+
+			best = time < best ? time : best;
+		}
+
+		return best;
+	}
+
+	// Zero-initialized draw data, as the routines read it
+	sw::DrawData *createDrawData();
+	void clearDrawData(sw::DrawData *data);
+	void destroyDrawData(sw::DrawData *data);
+
+	sw::Shader::DestinationParameter destination(sw::Shader::ParameterType type, int index, int mask = 0xF);
+	sw::Shader::SourceParameter source(sw::Shader::ParameterType type, int index, int swizzle = 0xE4);
+	sw::Shader::SourceParameter literal(float x, float y, float z, float w);
+
+	sw::Shader::Instruction *instruction(sw::Shader::Opcode opcode, const sw::Shader::DestinationParameter &dst,
+	                                     const sw::Shader::SourceParameter &src0 = sw::Shader::SourceParameter(),
+	                                     const sw::Shader::SourceParameter &src1 = sw::Shader::SourceParameter(),
+	                                     const sw::Shader::SourceParameter &src2 = sw::Shader::SourceParameter());
+
+	// Appends a chain of dependent multiply-add and fraction pairs on r0
+	void appendArithmetic(sw::Shader &shader, int operations);
+
+	// A shader without and with the arithmetic chain
+	template<class ShaderType>
+	struct Program
+	{
+		const char *name;
+		ShaderType *shader;
+	};
+
+	template<class ShaderType>
+	std::vector<Program<ShaderType>> createPrograms(ShaderType *(*createShader)(int operations))
+	{
+		std::vector<Program<ShaderType>> programs;
+
+		programs.push_back({"simple", createShader(0)});
+		programs.push_back({"complex", createShader(complexOperations)});
+
+		return programs;
+	}
+
+	template<class ShaderType>
+	void deletePrograms(std::vector<Program<ShaderType>> &programs)
+	{
+		for(Program<ShaderType> &program : programs)
+		{
+			delete program.shader;
+		}
+
+		programs.clear();
+	}
+
+	// Column text for a comparison of results which must match
+	inline const char *match(bool identical)
+	{
+		return identical ? "yes" : "NO";
+	}
+}
+
+#endif   // benchmark_Benchmark_hpp
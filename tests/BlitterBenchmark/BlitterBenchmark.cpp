@@ -0,0 +1,406 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks Blitter routines against the per-pixel reference conversion for
+// every pair of compatible formats, and measures their throughput.
+
+#include "Renderer/Blitter.hpp"
+#include "Renderer/Surface.hpp"
+#include "Common/Timer.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace sw;
+
+namespace
+{
+	const int sourceWidth = 67;
+	const int sourceHeight = 45;
+	const int destWidth = 256;
+	const int destHeight = 192;
+	const int repeats = 8;
+
+	enum Class
+	{
+		UNORM,
+		SNORM,
+		FLOAT16,
+		FLOAT32,
+		INTEGER,
+		DEPTH,
+	};
+
+	struct FormatInfo
+	{
+		Format format;
+		const char *name;
+		Class type;
+		int bits[4];   // Per component, for the comparison tolerance. Unsigned components of signed formats count an extra bit.
+	};
+
+	#define FORMAT(format, type, r, g, b, a) {FORMAT_##format, #format, type, {r, g, b, a}}
+
+	const FormatInfo formats[] =
+	{
+		FORMAT(A8, UNORM, 0, 0, 0, 8),
+		FORMAT(R8, UNORM, 8, 0, 0, 0),
+		FORMAT(L8, UNORM, 8, 8, 8, 0),
+		FORMAT(L16, UNORM, 16, 16, 16, 0),
+		FORMAT(A8L8, UNORM, 8, 8, 8, 8),
+		FORMAT(A4L4, UNORM, 4, 4, 4, 4),
+		FORMAT(R3G3B2, UNORM, 3, 3, 2, 0),
+		FORMAT(A8R3G3B2, UNORM, 3, 3, 2, 8),
+		FORMAT(X4R4G4B4, UNORM, 4, 4, 4, 0),
+		FORMAT(A4R4G4B4, UNORM, 4, 4, 4, 4),
+		FORMAT(R4G4B4A4, UNORM, 4, 4, 4, 4),
+		FORMAT(R5G6B5, UNORM, 5, 6, 5, 0),
+		FORMAT(X1R5G5B5, UNORM, 5, 5, 5, 0),
+		FORMAT(A1R5G5B5, UNORM, 5, 5, 5, 1),
+		FORMAT(R5G5B5A1, UNORM, 5, 5, 5, 1),
+		FORMAT(R8G8B8, UNORM, 8, 8, 8, 0),
+		FORMAT(B8G8R8, UNORM, 8, 8, 8, 0),
+		FORMAT(X8R8G8B8, UNORM, 8, 8, 8, 0),
+		FORMAT(A8R8G8B8, UNORM, 8, 8, 8, 8),
+		FORMAT(X8B8G8R8, UNORM, 8, 8, 8, 0),
+		FORMAT(A8B8G8R8, UNORM, 8, 8, 8, 8),
+		FORMAT(G8R8, UNORM, 8, 8, 0, 0),
+		FORMAT(G16R16, UNORM, 16, 16, 0, 0),
+		FORMAT(A16B16G16R16, UNORM, 16, 16, 16, 16),
+		FORMAT(A2R10G10B10, UNORM, 10, 10, 10, 2),
+		FORMAT(A2B10G10R10, UNORM, 10, 10, 10, 2),
+		FORMAT(R8I_SNORM, SNORM, 8, 0, 0, 0),
+		FORMAT(G8R8I_SNORM, SNORM, 8, 8, 0, 0),
+		FORMAT(X8B8G8R8I_SNORM, SNORM, 8, 8, 8, 0),
+		FORMAT(A8B8G8R8I_SNORM, SNORM, 8, 8, 8, 8),
+		FORMAT(V8U8, SNORM, 8, 8, 0, 0),
+		FORMAT(Q8W8V8U8, SNORM, 8, 8, 8, 8),
+		FORMAT(X8L8V8U8, SNORM, 8, 8, 9, 0),
+		FORMAT(L6V5U5, SNORM, 5, 5, 7, 0),
+		FORMAT(V16U16, SNORM, 16, 16, 0, 0),
+		FORMAT(A16W16V16U16, SNORM, 16, 16, 16, 17),
+		FORMAT(Q16W16V16U16, SNORM, 16, 16, 16, 16),
+		FORMAT(A2W10V10U10, SNORM, 10, 10, 10, 3),
+		FORMAT(R16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(A16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(L16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(G16R16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(A16L16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(B16G16R16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(A16B16G16R16F, FLOAT16, 0, 0, 0, 0),
+		FORMAT(R32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(A32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(L32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(A32L32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(G32R32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(B32G32R32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(X32B32G32R32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(A32B32G32R32F, FLOAT32, 0, 0, 0, 0),
+		FORMAT(R8I, INTEGER, 0, 0, 0, 0),
+		FORMAT(R8UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(G8R8I, INTEGER, 0, 0, 0, 0),
+		FORMAT(G8R8UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(X8B8G8R8I, INTEGER, 0, 0, 0, 0),
+		FORMAT(X8B8G8R8UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(A8B8G8R8I, INTEGER, 0, 0, 0, 0),
+		FORMAT(A8B8G8R8UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(R16I, INTEGER, 0, 0, 0, 0),
+		FORMAT(R16UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(G16R16I, INTEGER, 0, 0, 0, 0),
+		FORMAT(G16R16UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(X16B16G16R16I, INTEGER, 0, 0, 0, 0),
+		FORMAT(X16B16G16R16UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(A16B16G16R16I, INTEGER, 0, 0, 0, 0),
+		FORMAT(A16B16G16R16UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(R32I, INTEGER, 0, 0, 0, 0),
+		FORMAT(R32UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(G32R32I, INTEGER, 0, 0, 0, 0),
+		FORMAT(G32R32UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(X32B32G32R32I, INTEGER, 0, 0, 0, 0),
+		FORMAT(X32B32G32R32UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(A32B32G32R32I, INTEGER, 0, 0, 0, 0),
+		FORMAT(A32B32G32R32UI, INTEGER, 0, 0, 0, 0),
+		FORMAT(D32F_LOCKABLE, DEPTH, 0, 0, 0, 0),
+		FORMAT(D32FS8_TEXTURE, DEPTH, 0, 0, 0, 0),
+	};
+
+	#undef FORMAT
+
+	bool compatible(const FormatInfo &source, const FormatInfo &dest)
+	{
+		bool sourceColor = source.type != INTEGER && source.type != DEPTH;
+		bool destColor = dest.type != INTEGER && dest.type != DEPTH;
+
+		return (sourceColor && destColor) || (source.type == dest.type);
+	}
+
+	float tolerance(const FormatInfo &info, int component, float value)
+	{
+		int bits = info.bits[component];
+
+		switch(info.type)
+		{
+		case UNORM: return bits ? 1.01f / ((1 << bits) - 1) : 1.0e-5f;
+		case SNORM: return bits ? 1.01f / ((1 << (bits - 1)) - 1) : 1.0e-5f;
+		case FLOAT16: return 2.0e-3f * fmaxf(fabsf(value), 1.0f);
+		case FLOAT32: return 1.0e-5f * fmaxf(fabsf(value), 1.0f);
+		case INTEGER: return 0.5f;
+		case DEPTH: return 1.0e-5f;
+		}
+
+		return 0.0f;
+	}
+
+	// Leaves the external buffer dirty, so blits operate directly on the tested format
+	Surface *createSource(const FormatInfo &info)
+	{
+		Surface *surface = new Surface(nullptr, sourceWidth, sourceHeight, 1, info.format, true, false);
+		surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+		unsigned int seed = info.format;
+
+		for(int y = 0; y < sourceHeight; y++)
+		{
+			for(int x = 0; x < sourceWidth; x++)
+			{
+				float c[4];
+
+				for(int i = 0; i < 4; i++)
+				{
+					seed = seed * 1103515245 + 12345;
+					c[i] = (info.type == INTEGER) ? (float)((seed >> 16) % 100) : (float)(seed >> 8) / (float)(1 << 24);
+				}
+
+				surface->writeExternal(x, y, Color<float>(c[0], c[1], c[2], c[3]));
+			}
+		}
+
+		surface->unlockExternal();
+
+		return surface;
+	}
+
+	Surface *createDest(const FormatInfo &info)
+	{
+		Surface *surface = new Surface(nullptr, destWidth, destHeight, 1, info.format, true, false);
+		surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+		surface->unlockExternal();
+
+		return surface;
+	}
+
+	// Per-pixel conversion through Color<float>, as performed by Surface::copyInternal()
+	void reference(Surface *source, Surface *dest, const SliceRect &sRect, const SliceRect &dRect, bool filter)
+	{
+		source->lockExternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+		dest->lockExternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC);
+
+		// Compute and accumulate the coordinates like the blit routines, to sample the same texels
+		float w = 1.0f / (dRect.x1 - dRect.x0) * (sRect.x1 - sRect.x0);
+		float h = 1.0f / (dRect.y1 - dRect.y0) * (sRect.y1 - sRect.y0);
+		float y = (float)sRect.y0 + 0.5f * h;
+
+		for(int j = dRect.y0; j < dRect.y1; j++)
+		{
+			float x = (float)sRect.x0 + 0.5f * w;
+
+			for(int i = dRect.x0; i < dRect.x1; i++)
+			{
+				dest->writeExternal(i, j, filter ? source->sampleExternal(x, y) : source->readExternal((int)x, (int)y));
+
+				x += w;
+			}
+
+			y += h;
+		}
+
+		source->unlockExternal();
+		dest->unlockExternal();
+	}
+
+	int compare(Surface *result, Surface *expected, const FormatInfo &info, float &maxError)
+	{
+		result->lockExternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+		expected->lockExternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+
+		int mismatches = 0;
+
+		for(int y = 0; y < destHeight; y++)
+		{
+			for(int x = 0; x < destWidth; x++)
+			{
+				Color<float> r = result->readExternal(x, y);
+				Color<float> e = expected->readExternal(x, y);
+
+				const float resultC[4] = {r.r, r.g, r.b, r.a};
+				const float expectedC[4] = {e.r, e.g, e.b, e.a};
+
+				for(int i = 0; i < 4; i++)
+				{
+					float error = fabsf(resultC[i] - expectedC[i]);
+
+					if(!(error <= tolerance(info, i, expectedC[i])))   // Also catches NaN
+					{
+						mismatches++;
+						maxError = fmaxf(maxError, error);
+						break;
+					}
+				}
+			}
+		}
+
+		result->unlockExternal();
+		expected->unlockExternal();
+
+		return mismatches;
+	}
+
+	struct Result
+	{
+		int pairs;
+		int mismatches;
+		double pixelRate[2];   // Point and linear, in Mpixels per second
+	};
+
+	Result test(const FormatInfo &source)
+	{
+		Result result = {0, 0, {0.0, 0.0}};
+		Surface *sourceSurface = createSource(source);
+
+		// Stretch a sub-rectangle, flipped vertically, into most of the destination
+		SliceRect sRect(3, sourceHeight - 2, sourceWidth - 5, 1, 0);
+		SliceRect dRect(2, 1, destWidth - 3, destHeight - 2, 0);
+		double pixels = (double)(dRect.x1 - dRect.x0) * (dRect.y1 - dRect.y0) * repeats;
+
+		for(const FormatInfo &dest : formats)
+		{
+			if(!compatible(source, dest))
+			{
+				continue;
+			}
+
+			for(int linear = 0; linear < 2; linear++)
+			{
+				bool filter = linear && source.type != INTEGER && dest.type != INTEGER;
+
+				Surface *destSurface = createDest(dest);
+				Surface *expectedSurface = createDest(dest);
+
+				blitter.blit(sourceSurface, sRect, destSurface, dRect, filter);
+				reference(sourceSurface, expectedSurface, sRect, dRect, filter);
+
+				float maxError = 0.0f;
+				int mismatches = compare(destSurface, expectedSurface, dest, maxError);
+
+				if(mismatches)
+				{
+					printf("%s -> %s (%s): %d mismatching pixels, max error %g\n", source.name, dest.name, linear ? "linear" : "point", mismatches, maxError);
+					result.mismatches++;
+				}
+
+				double start = Timer::seconds();
+
+				for(int i = 0; i < repeats; i++)
+				{
+					blitter.blit(sourceSurface, sRect, destSurface, dRect, filter);
+				}
+
+				double time = Timer::seconds() - start;
+				result.pixelRate[linear] += pixels / time / 1.0e6;
+
+				delete destSurface;
+				delete expectedSurface;
+			}
+
+			result.pairs++;
+		}
+
+		if(result.pairs)
+		{
+			result.pixelRate[0] /= result.pairs;
+			result.pixelRate[1] /= result.pairs;
+		}
+
+		delete sourceSurface;
+
+		return result;
+	}
+
+	// Stencil blits copy the separate stencil buffer, which isn't filtered or converted
+	bool testStencil()
+	{
+		Surface *source = new Surface(nullptr, sourceWidth, sourceHeight, 1, FORMAT_D24S8, true, false);
+		Surface *dest = new Surface(nullptr, sourceWidth, sourceHeight, 1, FORMAT_D24S8, true, false);
+
+		unsigned char *stencil = (unsigned char*)source->lockStencil(0, 0, 0, PUBLIC);
+		unsigned int seed = 1;
+
+		for(int i = 0; i < source->getStencilSliceB(); i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			stencil[i] = (unsigned char)(seed >> 16);
+		}
+
+		source->unlockStencil();
+
+		SliceRect rect(0, 0, sourceWidth, sourceHeight, 0);
+		blitter.blit(source, rect, dest, rect, false, true);
+
+		const unsigned char *expected = (const unsigned char*)source->lockStencil(0, 0, 0, PUBLIC);
+		const unsigned char *result = (const unsigned char*)dest->lockStencil(0, 0, 0, PUBLIC);
+		bool match = memcmp(expected, result, source->getStencilSliceB()) == 0;
+		source->unlockStencil();
+		dest->unlockStencil();
+
+		delete source;
+		delete dest;
+
+		if(!match)
+		{
+			printf("S8 -> S8: mismatch\n");
+		}
+
+		return match;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int failures = 0;
+	Result results[sizeof(formats) / sizeof(formats[0])];
+
+	for(size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+	{
+		results[i] = test(formats[i]);
+		failures += results[i].mismatches;
+	}
+
+	if(!testStencil())
+	{
+		failures++;
+	}
+
+	printf("\n%-16s %6s %10s %14s %14s\n", "source", "pairs", "mismatches", "point (MP/s)", "linear (MP/s)");
+
+	for(size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+	{
+		const Result &result = results[i];
+
+		printf("%-16s %6d %10d %14.1f %14.1f\n", formats[i].name, result.pairs, result.mismatches, result.pixelRate[0], result.pixelRate[1]);
+	}
+
+	printf("\n%d mismatching format pairs\n", failures);
+
+	return failures ? 1 : 0;
+}
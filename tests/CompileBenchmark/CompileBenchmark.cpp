@@ -0,0 +1,223 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays the vertex, setup, pixel and blit states captured from a workload
+// through the JIT and reports the compile statistics of each routine: IR
+// instructions, time spent building, optimizing and emitting it, and machine
+// code size. Capture a workload by running it with SWIFTSHADER_COMPILE_LOG set
+// to a file name, then pass that file. Each routine is compiled in the mode it
+// was captured in, so tiered compilation replays both. Build with
+// REACTOR_BACKEND set to compare back-ends on the same capture.
+
+#include "Renderer/CompileLog.hpp"
+#include "Renderer/Blitter.hpp"
+#include "Renderer/VertexProcessor.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/SetupProcessor.hpp"
+#include "Shader/VertexPipeline.hpp"
+#include "Shader/VertexProgram.hpp"
+#include "Shader/VertexShader.hpp"
+#include "Shader/PixelPipeline.hpp"
+#include "Shader/PixelProgram.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Shader/SetupRoutine.hpp"
+#include "Reactor/Reactor.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+
+namespace
+{
+	// Copies the captured bytes, or returns false if the state layout differs from this build's
+	template<class State>
+	bool capturedState(const CompileLog::Record &record, State &state)
+	{
+		if(record.state.size() != sizeof(State))
+		{
+			return false;
+		}
+
+		memcpy(&state, record.state.data(), sizeof(State));
+
+		return true;
+	}
+
+	Routine *compileVertex(const CompileLog::Record &record)
+	{
+		VertexProcessor::State state;
+
+		if(!capturedState(record, state))
+		{
+			return nullptr;
+		}
+
+		VertexShader *shader = CompileLog::createVertexShader(record);
+		VertexRoutine *generator = nullptr;
+
+		if(state.fixedFunction)
+		{
+			generator = new VertexPipeline(state);
+		}
+		else if(shader)
+		{
+			generator = new VertexProgram(state, shader);
+		}
+		else
+		{
+			return nullptr;
+		}
+
+		generator->generate();
+		Routine *routine = record.optimized ? (*generator)(L"VertexRoutine") : generator->unoptimized(L"VertexRoutine");
+		delete generator;
+		delete shader;
+
+		CompileLog::add(CompileLog::VERTEX, &state, sizeof(state), routine);
+
+		return routine;
+	}
+
+	Routine *compileSetup(const CompileLog::Record &record)
+	{
+		SetupProcessor::State state;
+
+		if(!capturedState(record, state))
+		{
+			return nullptr;
+		}
+
+		SetupRoutine generator(state);
+		generator.generate();
+		Routine *routine = generator.getRoutine();
+
+		CompileLog::add(CompileLog::SETUP, &state, sizeof(state), routine);
+
+		return routine;
+	}
+
+	Routine *compilePixel(const CompileLog::Record &record)
+	{
+		PixelProcessor::State state;
+
+		if(!capturedState(record, state))
+		{
+			return nullptr;
+		}
+
+		// Fixed function and ps_1_x states use the integer pipeline, as the pixel processor chooses
+		PixelShader *shader = CompileLog::createPixelShader(record);
+		QuadRasterizer *generator = nullptr;
+
+		if(!shader || shader->getVersion() <= 0x0104)
+		{
+			generator = new PixelPipeline(state, shader);
+		}
+		else
+		{
+			generator = new PixelProgram(state, shader);
+		}
+
+		generator->generate();
+		Routine *routine = record.optimized ? (*generator)(L"PixelRoutine") : generator->unoptimized(L"PixelRoutine");
+		delete generator;
+		delete shader;
+
+		CompileLog::add(CompileLog::PIXEL, &state, sizeof(state), routine);
+
+		return routine;
+	}
+
+	// Adds itself to the log
+	Routine *compileBlit(const CompileLog::Record &record)
+	{
+		return blitter.compile(record.state.data(), record.state.size());
+	}
+
+	void print(const char *kind, size_t index, const char *mode, const CompileStatistics &statistics, uint32_t hash)
+	{
+		printf("%-7s %6d %-6s %08X %8d %10.3f %10.3f %10.3f %9d\n", kind, (int)index, mode, hash,
+		       statistics.instructions, statistics.buildTime * 1000.0, statistics.optimizeTime * 1000.0, statistics.emitTime * 1000.0, statistics.codeSize);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc != 2)
+	{
+		printf("Usage: %s <capture>\n", argv[0]);
+		printf("Capture a workload by running it with SWIFTSHADER_COMPILE_LOG=<capture>\n");
+
+		return 1;
+	}
+
+	std::vector<CompileLog::Record> records;
+
+	if(!CompileLog::load(argv[1], records))
+	{
+		printf("Cannot read %s, or it was captured by an incompatible build\n", argv[1]);
+
+		return 1;
+	}
+
+	CompileLog::clear();
+
+	int skipped = 0;
+
+	printf("%-7s %6s %-6s %-8s %8s %10s %10s %10s %9s\n", "Kind", "Record", "Mode", "Hash", "IR", "Build ms", "Opt ms", "Emit ms", "Bytes");
+
+	for(size_t i = 0; i < records.size(); i++)
+	{
+		const CompileLog::Record &record = records[i];
+		Routine *routine = nullptr;
+
+		switch(record.kind)
+		{
+		case CompileLog::VERTEX: routine = compileVertex(record); break;
+		case CompileLog::SETUP:  routine = compileSetup(record);  break;
+		case CompileLog::PIXEL:  routine = compilePixel(record);  break;
+		case CompileLog::BLIT:   routine = compileBlit(record);   break;
+		default:                 break;
+		}
+
+		if(!routine)
+		{
+			skipped++;
+			continue;
+		}
+
+		print(CompileLog::name(record.kind), i, routine->isOptimized() ? "opt" : "unopt", routine->getCompileStatistics(), record.stateHash);
+
+		delete routine;
+	}
+
+	printf("\n%-7s %9s %8s %10s %10s %10s %9s\n", "Kind", "Routines", "IR", "Build ms", "Opt ms", "Emit ms", "Bytes");
+
+	for(int kind = 0; kind < CompileLog::KINDS; kind++)
+	{
+		CompileLog::Totals totals = CompileLog::totals((CompileLog::Kind)kind);
+
+		printf("%-7s %9d %8lld %10.3f %10.3f %10.3f %9lld\n", CompileLog::name((CompileLog::Kind)kind), totals.routines, (long long)totals.instructions,
+		       totals.buildTime * 1000.0, totals.optimizeTime * 1000.0, totals.emitTime * 1000.0, (long long)totals.codeSize);
+	}
+
+	if(skipped)
+	{
+		printf("\n%d records could not be replayed\n", skipped);
+	}
+
+	return 0;
+}
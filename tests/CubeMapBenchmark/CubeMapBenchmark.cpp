@@ -0,0 +1,517 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that seamless cube map filtering is continuous across face edges
+// and corners, and measures environment map sampling throughput with and
+// without it.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Sampler.hpp"
+#include "Renderer/Surface.hpp"
+#include "Shader/SamplerCore.hpp"
+#include "Shader/Constants.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+
+namespace
+{
+	const int testSize = 32;
+	const int benchmarkSize = 256;
+	const int targetSize = 512;
+
+	const float edgeDelta = 2.0e-4f;      // Distance from the edge of the samples on either side, in face coordinates
+	const float seamTolerance = 0.02f;    // Largest difference between the samples on either side of an edge
+	const float smoothTolerance = 0.01f;  // Largest error when sampling a smooth function of the direction
+	const float cornerTolerance = 0.01f;  // Corners substitute a texel of one adjacent face for the missing one
+
+	struct FormatInfo
+	{
+		Format format;
+		const char *name;
+	};
+
+	const FormatInfo formats[] =
+	{
+		{FORMAT_A8B8G8R8, "A8B8G8R8"},
+		{FORMAT_A32B32G32R32F, "A32B32G32R32F"},
+	};
+
+	typedef void (*SampleFunction)(const void *texture, const void *constants, const float *directions, float *output, int count);
+
+	// Samples count directions, stored as x, y and z rows of four per quad,
+	// and writes the results as r, g, b and a rows of four.
+	Routine *generate(const Sampler::State &state)
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> texture = function.Arg<0>();
+			Pointer<Byte> constants = function.Arg<1>();
+			Pointer<Byte> directions = function.Arg<2>();
+			Pointer<Byte> output = function.Arg<3>();
+			Int count = function.Arg<4>();
+
+			SamplerCore sampler(constants, state);
+
+			Int i = 0;
+
+			For(i = 0, i < count, i += 4)
+			{
+				Float4 x = *Pointer<Float4>(directions + i * 12 + 0);
+				Float4 y = *Pointer<Float4>(directions + i * 12 + 16);
+				Float4 z = *Pointer<Float4>(directions + i * 12 + 32);
+				Float4 q = Float4(0.0f);
+				Vector4f dsx;
+				Vector4f dsy;
+				Vector4f offset;
+				Vector4f c;
+
+				dsx.x = dsx.y = dsx.z = Float4(0.0f);
+				dsy.x = dsy.y = dsy.z = Float4(0.0f);
+
+				sampler.sampleTexture(texture, c, x, y, z, q, dsx, dsy, offset, Implicit);
+
+				*Pointer<Float4>(output + i * 16 + 0) = c.x;
+				*Pointer<Float4>(output + i * 16 + 16) = c.y;
+				*Pointer<Float4>(output + i * 16 + 32) = c.z;
+				*Pointer<Float4>(output + i * 16 + 48) = c.w;
+			}
+
+			Return();
+		}
+
+		return function(L"CubeMapBenchmark");
+	}
+
+	// Direction of face coordinates s, t in [-1, 1], matching SamplerCore::cubeFace()
+	void faceDirection(int face, float s, float t, float d[3])
+	{
+		switch(face)
+		{
+		case 0: d[0] = 1.0f;  d[1] = -t;    d[2] = -s;    break;   // +X
+		case 1: d[0] = -1.0f; d[1] = -t;    d[2] = s;     break;   // -X
+		case 2: d[0] = s;     d[1] = 1.0f;  d[2] = t;     break;   // +Y
+		case 3: d[0] = s;     d[1] = -1.0f; d[2] = -t;    break;   // -Y
+		case 4: d[0] = s;     d[1] = -t;    d[2] = 1.0f;  break;   // +Z
+		case 5: d[0] = -s;    d[1] = -t;    d[2] = -1.0f; break;   // -Z
+		}
+	}
+
+	void smoothColor(const float d[3], float color[4])
+	{
+		float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+		color[0] = 0.5f + 0.4f * d[0] / length;
+		color[1] = 0.5f + 0.4f * d[1] / length;
+		color[2] = 0.5f + 0.4f * d[2] / length;
+		color[3] = 1.0f;
+	}
+
+	void noiseColor(int face, int x, int y, float color[4])
+	{
+		unsigned int seed = (face * 65521 + y) * 65537 + x;
+
+		for(int i = 0; i < 4; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			color[i] = ((seed >> 16) & 0xFF) / 255.0f;
+		}
+	}
+
+	void createCube(Surface *faces[6], int size, Format format, bool noise)
+	{
+		for(int face = 0; face < 6; face++)
+		{
+			Surface *surface = new Surface(nullptr, size, size, 1, format, true, false);
+			unsigned char *buffer = (unsigned char*)surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+			for(int y = 0; y < size; y++)
+			{
+				for(int x = 0; x < size; x++)
+				{
+					float color[4];
+
+					if(noise)
+					{
+						noiseColor(face, x, y, color);
+					}
+					else
+					{
+						float d[3];
+						faceDirection(face, (x + 0.5f) / size * 2.0f - 1.0f, (y + 0.5f) / size * 2.0f - 1.0f, d);
+						smoothColor(d, color);
+					}
+
+					unsigned char *texel = buffer + y * surface->getExternalPitchB() + x * Surface::bytes(format);
+
+					if(format == FORMAT_A32B32G32R32F)
+					{
+						memcpy(texel, color, 4 * sizeof(float));
+					}
+					else
+					{
+						for(int i = 0; i < 4; i++)
+						{
+							texel[i] = (unsigned char)(color[i] * 255.0f + 0.5f);
+						}
+					}
+				}
+			}
+
+			surface->unlockExternal();
+			faces[face] = surface;
+		}
+	}
+
+	// Directions stored as x, y and z rows of four per quad
+	struct Directions
+	{
+		Directions() : count(0)
+		{
+		}
+
+		void add(const float d[3])
+		{
+			size_t quad = (count / 4) * 12;
+
+			if(count % 4 == 0)
+			{
+				// Pad the quad with a valid direction
+				data.resize(quad + 12, 0.0f);
+				data[quad + 0] = data[quad + 1] = data[quad + 2] = data[quad + 3] = 1.0f;
+			}
+
+			for(int i = 0; i < 3; i++)
+			{
+				data[quad + i * 4 + count % 4] = d[i];
+			}
+
+			count++;
+		}
+
+		void get(int index, float d[3]) const
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				d[i] = data[(index / 4) * 12 + i * 4 + index % 4];
+			}
+		}
+
+		std::vector<float> data;
+		int count;
+	};
+
+	class CubeSampler
+	{
+	public:
+		CubeSampler(Surface *faces[6], bool seamless)
+		{
+			Sampler sampler;
+			sampler.setTextureFilter(FILTER_LINEAR);
+			sampler.setMipmapFilter(MIPMAP_NONE);
+			sampler.setAddressingModeU(ADDRESSING_CLAMP);
+			sampler.setAddressingModeV(ADDRESSING_CLAMP);
+			sampler.setSeamlessCubeMap(seamless);
+
+			for(int face = 0; face < 6; face++)
+			{
+				sampler.setTextureLevel(face, 0, faces[face], TEXTURE_CUBE);
+			}
+
+			Sampler::State state = sampler.samplerState();
+
+			if(state.seamlessCube != seamless)
+			{
+				printf("unexpected seamless cube map state\n");
+			}
+
+			routine = generate(state);
+			sample = (SampleFunction)routine->getEntry();
+
+			texture = (Texture*)allocate(sizeof(Texture));
+			memcpy(texture, &sampler.getTextureData(), sizeof(Texture));
+		}
+
+		~CubeSampler()
+		{
+			deallocate(texture);
+			delete routine;
+		}
+
+		// Colors are stored as r, g, b and a rows of four per quad
+		void operator()(const Directions &directions, std::vector<float> &colors)
+		{
+			colors.resize(directions.data.size() / 3 * 4);
+
+			sample(texture, &constants, directions.data.data(), colors.data(), directions.count);
+		}
+
+	private:
+		Routine *routine;
+		SampleFunction sample;
+		Texture *texture;
+	};
+
+	void getColor(const std::vector<float> &colors, int index, float color[4])
+	{
+		for(int i = 0; i < 4; i++)
+		{
+			color[i] = colors[(index / 4) * 16 + i * 4 + index % 4];
+		}
+	}
+
+	float difference(const float a[4], const float b[4])
+	{
+		float maximum = 0.0f;
+
+		for(int i = 0; i < 4; i++)
+		{
+			maximum = fmaxf(maximum, fabsf(a[i] - b[i]));
+		}
+
+		return maximum;
+	}
+
+	// Samples pairs of directions on either side of every face edge. Returns the largest difference within a pair.
+	float testSeams(Surface *faces[6], bool seamless)
+	{
+		Directions directions;
+		int pairs = 0;
+
+		for(int face = 0; face < 6; face++)
+		{
+			for(int edge = 0; edge < 4; edge++)
+			{
+				// Stay one texel away from the corners
+				for(float p = -1.0f + 2.0f / testSize; p <= 1.0f - 2.0f / testSize; p += 0.37f / testSize)
+				{
+					for(int side = -1; side <= 1; side += 2)
+					{
+						float e = (edge & 1) ? 1.0f : -1.0f;
+						float r = e * (1.0f + side * edgeDelta);
+						float d[3];
+
+						faceDirection(face, (edge & 2) ? p : r, (edge & 2) ? r : p, d);
+						directions.add(d);
+					}
+
+					pairs++;
+				}
+			}
+		}
+
+		std::vector<float> colors;
+		CubeSampler sample(faces, seamless);
+		sample(directions, colors);
+
+		float maximum = 0.0f;
+
+		for(int i = 0; i < pairs; i++)
+		{
+			float inside[4];
+			float outside[4];
+
+			getColor(colors, 2 * i + 0, inside);
+			getColor(colors, 2 * i + 1, outside);
+
+			maximum = fmaxf(maximum, difference(inside, outside));
+		}
+
+		return maximum;
+	}
+
+	// Samples a cube holding a smooth function of the direction. Returns the largest
+	// error away from the corners and near the corners, respectively.
+	void testSmooth(Surface *faces[6], bool seamless, float &error, float &cornerError)
+	{
+		Directions directions;
+		std::vector<bool> corner;
+		unsigned int seed = 1;
+
+		for(int i = 0; i < 16384; i++)
+		{
+			float d[3];
+
+			for(int j = 0; j < 3; j++)
+			{
+				seed = seed * 1103515245 + 12345;
+				d[j] = ((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+			}
+
+			// Bias a quarter of the samples towards the corners
+			if(i % 4 == 0)
+			{
+				for(int j = 0; j < 3; j++)
+				{
+					d[j] = (d[j] < 0.0f ? -1.0f : 1.0f) + d[j] * 0.05f;
+				}
+			}
+
+			float m = fmaxf(fmaxf(fabsf(d[0]), fabsf(d[1])), fabsf(d[2]));
+			float n = fminf(fminf(fabsf(d[0]), fabsf(d[1])), fabsf(d[2]));
+			float second = fabsf(d[0]) + fabsf(d[1]) + fabsf(d[2]) - m - n;
+
+			directions.add(d);
+			corner.push_back(second / m > 1.0f - 2.0f / testSize && n / m > 1.0f - 2.0f / testSize);
+		}
+
+		std::vector<float> colors;
+		CubeSampler sample(faces, seamless);
+		sample(directions, colors);
+
+		error = 0.0f;
+		cornerError = 0.0f;
+
+		for(size_t i = 0; i < corner.size(); i++)
+		{
+			float d[3];
+			float expected[4];
+			float color[4];
+
+			directions.get((int)i, d);
+			smoothColor(d, expected);
+			getColor(colors, (int)i, color);
+
+			float e = difference(expected, color);
+
+			if(corner[i])
+			{
+				cornerError = fmaxf(cornerError, e);
+			}
+			else
+			{
+				error = fmaxf(error, e);
+			}
+		}
+	}
+
+	// Reflection vectors of a mirror sphere filling the target, viewed along -z, over a background looking into the map.
+	void environmentDirections(Directions &directions)
+	{
+		for(int y = 0; y < targetSize; y++)
+		{
+			for(int x = 0; x < targetSize; x++)
+			{
+				float nx = (x + 0.5f) / (targetSize / 2) - 1.0f;
+				float ny = (y + 0.5f) / (targetSize / 2) - 1.0f;
+				float r2 = nx * nx + ny * ny;
+				float d[3] = {nx, ny, -1.0f};
+
+				if(r2 < 1.0f)
+				{
+					float nz = sqrtf(1.0f - r2);
+
+					d[0] = 2.0f * nz * nx;
+					d[1] = 2.0f * nz * ny;
+					d[2] = 2.0f * nz * nz - 1.0f;
+				}
+
+				directions.add(d);
+			}
+		}
+	}
+
+	double measure(Surface *faces[6], bool seamless, const Directions &directions)
+	{
+		std::vector<float> colors;
+		CubeSampler sample(faces, seamless);
+
+		return benchmark::bestTime([&]()
+		{
+			sample(directions, colors);
+		});
+	}
+
+	void deleteCube(Surface *faces[6])
+	{
+		for(int face = 0; face < 6; face++)
+		{
+			delete faces[face];
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int failures = 0;
+
+	printf("%-14s %-9s %10s %10s %10s\n", "format", "seamless", "seam", "error", "corner");
+
+	for(const FormatInfo &format : formats)
+	{
+		Surface *noise[6];
+		Surface *smooth[6];
+		createCube(noise, testSize, format.format, true);
+		createCube(smooth, testSize, format.format, false);
+
+		for(int seamless = 0; seamless <= 1; seamless++)
+		{
+			float seam = testSeams(noise, seamless != 0);
+			float error;
+			float cornerError;
+			testSmooth(smooth, seamless != 0, error, cornerError);
+
+			bool pass = true;
+
+			if(seamless)
+			{
+				pass = seam <= seamTolerance && error <= smoothTolerance && cornerError <= cornerTolerance;
+			}
+			else
+			{
+				pass = seam > seamTolerance;   // Seams must show, or the test above proves nothing
+			}
+
+			printf("%-14s %-9s %10.4f %10.4f %10.4f%s\n", format.name, seamless ? "yes" : "no", seam, error, cornerError, pass ? "" : "   FAILED");
+
+			if(!pass)
+			{
+				failures++;
+			}
+		}
+
+		deleteCube(noise);
+		deleteCube(smooth);
+	}
+
+	Directions directions;
+	environmentDirections(directions);
+
+	printf("\n%-14s %16s %16s %9s\n", "format", "seamless (MT/s)", "clamped (MT/s)", "overhead");
+
+	for(const FormatInfo &format : formats)
+	{
+		Surface *faces[6];
+		createCube(faces, benchmarkSize, format.format, true);
+
+		double clamped = measure(faces, false, directions);
+		double seamless = measure(faces, true, directions);
+		double texels = (double)targetSize * targetSize / 1.0e6;
+
+		printf("%-14s %16.1f %16.1f %8.2fx\n", format.name, texels / seamless, texels / clamped, seamless / clamped);
+
+		deleteCube(faces);
+	}
+
+	printf("\n%d failures\n", failures);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures pixel routine fill rate for a simple and an arithmetic-heavy
+// shader. Large primitives have long spans, while small triangles have
+// many partial spans.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/Primitive.hpp"
+#include "Shader/PixelProgram.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	const int targetSize = 512;
+	const int triangleSize = 16;
+
+	typedef void (*PixelFunction)(const Primitive *primitive, int count, int cluster, DrawData *data);
+
+	struct Scene
+	{
+		const char *name;
+		Primitive *primitives;
+		int count;
+		int pixels;
+	};
+
+	// Copies v0 to the color output, with a chain of dependent arithmetic in between
+	PixelShader *createShader(int operations)
+	{
+		PixelShader shader;
+		shader.setInput(0, 4, Shader::Semantic(Shader::USAGE_TEXCOORD, 0));
+
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_TEMP, 0), source(Shader::PARAMETER_INPUT, 0)));
+		appendArithmetic(shader, operations);
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_COLOROUT, 0), source(Shader::PARAMETER_TEMP, 0)));
+
+		return new PixelShader(&shader);   // The copy is optimized and analyzed
+	}
+
+	Routine *generate(const PixelShader *shader)
+	{
+		PixelProcessor::State state;
+
+		state.shaderID = shader->getSerialID();
+		state.alphaCompareMode = ALPHA_ALWAYS;
+		state.logicalOperation = LOGICALOP_COPY;
+		state.colorWriteMask = 0xF;
+		state.targetFormat[0] = FORMAT_A8R8G8B8;
+		state.multiSample = 1;
+		state.multiSampleMask = 1;
+		state.interpolant[0].component = 0xF;
+
+		PixelProgram program(state, shader);
+		program.generate();
+
+		return program(L"FillRateBenchmark");
+	}
+
+	// v0 holds the normalized pixel position, and constant blue and alpha
+	void setInterpolants(Primitive &primitive)
+	{
+		primitive.xQuad = vector(0.0f, 1.0f, 0.0f, 1.0f);
+		primitive.yQuad = vector(0.0f, 0.0f, 1.0f, 1.0f);
+
+		for(int component = 0; component < 4; component++)
+		{
+			PlaneEquation &plane = primitive.V[0][component];
+
+			plane.A = replicate(component == 0 ? 1.0f / targetSize : 0.0f);
+			plane.B = replicate(component == 1 ? 1.0f / targetSize : 0.0f);
+			plane.C = replicate(component == 2 ? 0.5f : (component == 3 ? 1.0f : 0.0f));
+		}
+	}
+
+	Primitive *allocatePrimitives(int count)
+	{
+		Primitive *primitives = (Primitive*)allocate(count * sizeof(Primitive));
+		memset(primitives, 0, count * sizeof(Primitive));
+
+		return primitives;
+	}
+
+	Scene createRectangle()
+	{
+		Primitive *primitive = allocatePrimitives(1);
+
+		primitive->yMin = 0;
+		primitive->yMax = targetSize;
+
+		for(int y = 0; y < targetSize; y++)
+		{
+			primitive->outline[y].left = 0;
+			primitive->outline[y].right = targetSize;
+		}
+
+		setInterpolants(*primitive);
+
+		Scene scene = {"large", primitive, 1, targetSize * targetSize};
+
+		return scene;
+	}
+
+	// Right triangles with the vertical edge on the left, one per triangleSize cell
+	Scene createTriangles()
+	{
+		const int cells = targetSize / triangleSize;
+		Primitive *primitives = allocatePrimitives(cells * cells);
+		int pixels = 0;
+
+		for(int cy = 0; cy < cells; cy++)
+		{
+			for(int cx = 0; cx < cells; cx++)
+			{
+				Primitive &primitive = primitives[cy * cells + cx];
+				int x0 = cx * triangleSize;
+				int y0 = cy * triangleSize;
+
+				primitive.yMin = y0;
+				primitive.yMax = y0 + triangleSize;
+
+				for(int y = 0; y < triangleSize; y++)
+				{
+					primitive.outline[y0 + y].left = x0;
+					primitive.outline[y0 + y].right = x0 + triangleSize - y;
+					pixels += triangleSize - y;
+				}
+
+				setInterpolants(primitive);
+			}
+		}
+
+		Scene scene = {"small", primitives, cells * cells, pixels};
+
+		return scene;
+	}
+
+	// Returns the best time per frame
+	double run(Routine *routine, const Scene &scene, DrawData *data, unsigned int *target)
+	{
+		PixelFunction shade = (PixelFunction)routine->getEntry();
+
+		memset(target, 0, targetSize * targetSize * 4);   // Every frame writes the same pixels
+
+		return bestTime([&]()
+		{
+			shade(scene.primitives, scene.count, 0, data);
+		});
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int *target = (unsigned int*)allocate(targetSize * targetSize * 4);
+
+	DrawData *data = createDrawData();
+	data->colorBuffer[0] = target;
+	data->colorPitchB[0] = targetSize * 4;
+	data->colorSliceB[0] = targetSize * targetSize * 4;
+
+	std::vector<Program<PixelShader>> programs = createPrograms(createShader);
+	const Scene scenes[] = {createRectangle(), createTriangles()};
+
+	printf("%-8s %-6s %10s\n", "shader", "scene", "Mpx/s");
+
+	for(const Program<PixelShader> &program : programs)
+	{
+		for(const Scene &scene : scenes)
+		{
+			Routine *routine = generate(program.shader);
+			double time = run(routine, scene, data, target);
+			delete routine;
+
+			printf("%-8s %-6s %10.1f\n", program.name, scene.name, scene.pixels / time * 1.0e-6);
+		}
+	}
+
+	deletePrograms(programs);
+
+	for(const Scene &scene : scenes)
+	{
+		deallocate(scene.primitives);
+	}
+
+	destroyDrawData(data);
+	deallocate(target);
+
+	return 0;
+}
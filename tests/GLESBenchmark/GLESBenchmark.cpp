@@ -0,0 +1,713 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures end-to-end OpenGL ES throughput on a headless EGL display: draw
+// calls, fill rate, texture sampling per filter mode, blending, multisample
+// resolves, texture uploads, readback, and uncached and cached shader compile,
+// link and first draw times. Each scene renders into a framebuffer object and
+// is timed to glFinish. Results are printed, and optionally written as JSON to
+// track them across commits.
+//
+// Usage: GLESBenchmark [--json <file>] [--filter <substring>] [--time <seconds>]
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	const int targetSize = 512;
+	const int uploadSize = 1024;
+	const int layers = 8;             // Full-screen quads per fill rate frame
+	const int drawsPerFrame = 1000;
+	const int compiledPrograms = 16;
+
+	double minimumTime = 0.5;         // Per scene, in seconds
+
+	struct Result
+	{
+		std::string name;
+		double value;
+		const char *unit;
+		bool higherIsBetter;
+	};
+
+	std::vector<Result> results;
+	const char *filter = nullptr;
+
+	const char *const vertexShader =
+		"attribute vec2 position;\n"
+		"uniform vec2 offset;\n"
+		"uniform float scale;\n"
+		"varying vec2 uv;\n"
+		"void main()\n"
+		"{\n"
+		"	uv = position * 0.5 + 0.5;\n"
+		"	gl_Position = vec4(position * scale + offset, 0.0, 1.0);\n"
+		"}\n";
+
+	const char *const colorShader =
+		"precision mediump float;\n"
+		"uniform vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = color;\n"
+		"}\n";
+
+	const char *const complexShader =
+		"precision highp float;\n"
+		"varying vec2 uv;\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 c = vec4(uv, 0.5, 1.0);\n"
+		"	for(int i = 0; i < 16; i++)\n"
+		"	{\n"
+		"		c = fract(c * vec4(1.5, 2.25, 3.125, 0.75) + c.yzwx);\n"
+		"	}\n"
+		"	gl_FragColor = c;\n"
+		"}\n";
+
+	const char *const textureShader =
+		"precision mediump float;\n"
+		"uniform sampler2D sampler;\n"
+		"varying vec2 uv;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = texture2D(sampler, uv * 2.0);\n"   // Minified, so mipmaps are used
+		"}\n";
+
+	double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool selected(const char *name)
+	{
+		return !filter || strstr(name, filter);
+	}
+
+	void report(const char *name, double value, const char *unit, bool higherIsBetter = true)
+	{
+		GLenum error = glGetError();
+
+		if(error != GL_NO_ERROR)
+		{
+			printf("%-28s GL error 0x%04X\n", name, error);
+			return;
+		}
+
+		printf("%-28s %12.2f %s\n", name, value, unit);
+
+		Result result = {name, value, unit, higherIsBetter};
+		results.push_back(result);
+	}
+
+	// Returns the average time per frame, after a first frame which compiles the routines
+	double measure(const std::function<void()> &frame)
+	{
+		frame();
+		glFinish();
+
+		int frames = 0;
+		double start = now();
+		double elapsed = 0.0;
+
+		do
+		{
+			frame();
+			glFinish();
+
+			frames++;
+			elapsed = now() - start;
+		}
+		while(elapsed < minimumTime);
+
+		return elapsed / frames;
+	}
+
+	GLuint compile(GLenum type, const char *source)
+	{
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint compiled = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+		if(!compiled)
+		{
+			char log[1024] = "";
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			fprintf(stderr, "Shader compilation failed: %s\n", log);
+		}
+
+		return shader;
+	}
+
+	GLuint link(GLuint vertex, GLuint fragment)
+	{
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glBindAttribLocation(program, 0, "position");
+		glLinkProgram(program);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+		if(!linked)
+		{
+			fprintf(stderr, "Program link failed\n");
+		}
+
+		return program;
+	}
+
+	GLuint createProgram(const char *fragmentSource)
+	{
+		GLuint vertex = compile(GL_VERTEX_SHADER, vertexShader);
+		GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentSource);
+		GLuint program = link(vertex, fragment);
+
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+
+		return program;
+	}
+
+	void useProgram(GLuint program, float scale, float x, float y)
+	{
+		glUseProgram(program);
+		glUniform1f(glGetUniformLocation(program, "scale"), scale);
+		glUniform2f(glGetUniformLocation(program, "offset"), x, y);
+		glUniform4f(glGetUniformLocation(program, "color"), 0.25f, 0.5f, 0.75f, 0.5f);
+		glUniform1i(glGetUniformLocation(program, "sampler"), 0);
+	}
+
+	void drawQuad()
+	{
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	double megapixels(double pixels, double time)
+	{
+		return pixels / time * 1.0e-6;
+	}
+
+	double megabytes(double bytes, double time)
+	{
+		return bytes / time / (1024.0 * 1024.0);
+	}
+
+	void drawCalls()
+	{
+		GLuint program = createProgram(colorShader);
+		useProgram(program, 0.01f, 0.0f, 0.0f);
+		GLint offset = glGetUniformLocation(program, "offset");
+
+		if(selected("draw_calls"))
+		{
+			double time = measure([=]()
+			{
+				for(int i = 0; i < drawsPerFrame; i++)
+				{
+					glUniform2f(offset, (i % 100) * 0.02f - 1.0f, (i / 100) * 0.02f - 1.0f);
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+				}
+			});
+
+			report("draw_calls", drawsPerFrame / time, "draws/s");
+		}
+
+		// Every draw changes state which affects the routines
+		if(selected("draw_calls_state_changes"))
+		{
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			double time = measure([=]()
+			{
+				for(int i = 0; i < drawsPerFrame; i++)
+				{
+					if(i & 1)
+					{
+						glEnable(GL_BLEND);
+					}
+					else
+					{
+						glDisable(GL_BLEND);
+					}
+
+					glUniform2f(offset, (i % 100) * 0.02f - 1.0f, (i / 100) * 0.02f - 1.0f);
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+				}
+			});
+
+			glDisable(GL_BLEND);
+
+			report("draw_calls_state_changes", drawsPerFrame / time, "draws/s");
+		}
+
+		glDeleteProgram(program);
+	}
+
+	void fillRate(const char *name, const char *fragmentSource, bool blend)
+	{
+		if(!selected(name))
+		{
+			return;
+		}
+
+		GLuint program = createProgram(fragmentSource);
+		useProgram(program, 1.0f, 0.0f, 0.0f);
+
+		if(blend)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+
+		double time = measure([]()
+		{
+			for(int i = 0; i < layers; i++)
+			{
+				drawQuad();
+			}
+		});
+
+		glDisable(GL_BLEND);
+		glDeleteProgram(program);
+
+		report(name, megapixels((double)layers * targetSize * targetSize, time), "Mpixels/s");
+	}
+
+	void sampling()
+	{
+		struct Filter
+		{
+			const char *name;
+			GLenum minFilter;
+			GLenum magFilter;
+		};
+
+		const Filter filters[] =
+		{
+			{"sample_nearest", GL_NEAREST, GL_NEAREST},
+			{"sample_linear", GL_LINEAR, GL_LINEAR},
+			{"sample_mipmap_nearest", GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST},
+			{"sample_mipmap_linear", GL_LINEAR_MIPMAP_NEAREST, GL_LINEAR},
+			{"sample_trilinear", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR},
+		};
+
+		std::vector<unsigned int> pixels(targetSize * targetSize);
+
+		for(int y = 0; y < targetSize; y++)
+		{
+			for(int x = 0; x < targetSize; x++)
+			{
+				pixels[y * targetSize + x] = ((x ^ y) & 8) ? 0xFFFFFFFF : 0xFF000000 | (x * 0x0101 + y * 0x010000);
+			}
+		}
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, targetSize, targetSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		GLuint program = createProgram(textureShader);
+		useProgram(program, 1.0f, 0.0f, 0.0f);
+
+		for(const Filter &filter : filters)
+		{
+			if(!selected(filter.name))
+			{
+				continue;
+			}
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter.minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter.magFilter);
+
+			double time = measure([]()
+			{
+				for(int i = 0; i < layers; i++)
+				{
+					drawQuad();
+				}
+			});
+
+			report(filter.name, megapixels((double)layers * targetSize * targetSize, time), "Mpixels/s");
+		}
+
+		glDeleteProgram(program);
+		glDeleteTextures(1, &texture);
+	}
+
+	void multisampleResolve(GLuint target)
+	{
+		if(!selected("msaa_resolve"))
+		{
+			return;
+		}
+
+		GLuint renderbuffer;
+		glGenRenderbuffers(1, &renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGBA8, targetSize, targetSize);
+
+		GLuint multisampled;
+		glGenFramebuffers(1, &multisampled);
+		glBindFramebuffer(GL_FRAMEBUFFER, multisampled);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+
+		GLuint program = createProgram(complexShader);
+		useProgram(program, 0.9f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		drawQuad();
+		glDeleteProgram(program);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampled);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+
+		double time = measure([]()
+		{
+			glBlitFramebuffer(0, 0, targetSize, targetSize, 0, 0, targetSize, targetSize, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		});
+
+		report("msaa_resolve", megapixels((double)targetSize * targetSize, time), "Mpixels/s");
+
+		glBindFramebuffer(GL_FRAMEBUFFER, target);
+		glDeleteFramebuffers(1, &multisampled);
+		glDeleteRenderbuffers(1, &renderbuffer);
+	}
+
+	void textureUpload()
+	{
+		if(!selected("texture_upload"))
+		{
+			return;
+		}
+
+		std::vector<unsigned int> pixels(uploadSize * uploadSize, 0x80402010);
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, uploadSize, uploadSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		double time = measure([&]()
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, uploadSize, uploadSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		});
+
+		report("texture_upload", megabytes((double)uploadSize * uploadSize * 4, time), "MB/s");
+
+		glDeleteTextures(1, &texture);
+	}
+
+	void readback()
+	{
+		if(!selected("readback"))
+		{
+			return;
+		}
+
+		std::vector<unsigned int> pixels(targetSize * targetSize);
+
+		double time = measure([&]()
+		{
+			glReadPixels(0, 0, targetSize, targetSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		});
+
+		report("readback", megabytes((double)targetSize * targetSize * 4, time), "MB/s");
+	}
+
+	// Every program is new, so its routines are compiled by the first draw. Each
+	// pass injects a different constant into both sources, to miss the cache of
+	// translated shaders. The sources are then compiled again to time cache hits.
+	void shaderCompilation()
+	{
+		if(!selected("shader"))
+		{
+			return;
+		}
+
+		double compileTime = 0.0;
+		double cachedTime = 0.0;
+		double linkTime = 0.0;
+		double drawTime = 0.0;
+
+		glFinish();
+
+		for(int i = 0; i < compiledPrograms; i++)
+		{
+			char vertexSource[1024];
+			snprintf(vertexSource, sizeof(vertexSource),
+			         "attribute vec2 position;\n"
+			         "uniform vec2 offset;\n"
+			         "uniform float scale;\n"
+			         "varying vec2 uv;\n"
+			         "void main()\n"
+			         "{\n"
+			         "	uv = position * 0.5 + 0.5;\n"
+			         "	gl_Position = vec4(position * scale + offset, %d.0 * 0.0, 1.0);\n"
+			         "}\n", i);
+
+			char fragmentSource[1024];
+			snprintf(fragmentSource, sizeof(fragmentSource),
+			         "precision highp float;\n"
+			         "varying vec2 uv;\n"
+			         "void main()\n"
+			         "{\n"
+			         "	vec4 c = vec4(uv, %d.0, 1.0);\n"
+			         "	for(int i = 0; i < 4; i++)\n"
+			         "	{\n"
+			         "		c = fract(c * vec4(1.5, 2.25, 3.125, 0.75) + c.yzwx);\n"
+			         "	}\n"
+			         "	gl_FragColor = c;\n"
+			         "}\n", i);
+
+			double start = now();
+			GLuint vertex = compile(GL_VERTEX_SHADER, vertexSource);
+			GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentSource);
+			double compiled = now();
+			GLuint program = link(vertex, fragment);
+			double linked = now();
+
+			useProgram(program, 0.1f, 0.0f, 0.0f);
+			double used = now();
+			drawQuad();
+			glFinish();
+			double drawn = now();
+
+			GLuint cachedVertex = compile(GL_VERTEX_SHADER, vertexSource);
+			GLuint cachedFragment = compile(GL_FRAGMENT_SHADER, fragmentSource);
+			double recompiled = now();
+
+			compileTime += compiled - start;
+			cachedTime += recompiled - drawn;
+			linkTime += linked - compiled;
+			drawTime += drawn - used;
+
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			glDeleteShader(cachedVertex);
+			glDeleteShader(cachedFragment);
+			glDeleteProgram(program);
+		}
+
+		report("shader_compile", compileTime / compiledPrograms * 1000.0, "ms", false);
+		report("shader_compile_cached", cachedTime / compiledPrograms * 1000.0, "ms", false);
+		report("shader_link", linkTime / compiledPrograms * 1000.0, "ms", false);
+		report("shader_first_draw", drawTime / compiledPrograms * 1000.0, "ms", false);
+	}
+
+	std::string escape(const char *string)
+	{
+		std::string escaped;
+
+		for(const char *c = string; c && *c; c++)
+		{
+			if(*c == '"' || *c == '\\')
+			{
+				escaped += '\\';
+			}
+
+			escaped += *c;
+		}
+
+		return escaped;
+	}
+
+	bool writeJSON(const char *path)
+	{
+		FILE *file = fopen(path, "w");
+
+		if(!file)
+		{
+			return false;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"context\": {\n");
+		fprintf(file, "    \"renderer\": \"%s\",\n", escape((const char*)glGetString(GL_RENDERER)).c_str());
+		fprintf(file, "    \"version\": \"%s\",\n", escape((const char*)glGetString(GL_VERSION)).c_str());
+		fprintf(file, "    \"target_size\": %d,\n", targetSize);
+		fprintf(file, "    \"minimum_time\": %.3f\n", minimumTime);
+		fprintf(file, "  },\n");
+		fprintf(file, "  \"benchmarks\": [\n");
+
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const Result &result = results[i];
+
+			fprintf(file, "    {\"name\": \"%s\", \"value\": %.4f, \"unit\": \"%s\", \"higher_is_better\": %s}%s\n",
+			        result.name.c_str(), result.value, result.unit, result.higherIsBetter ? "true" : "false", (i + 1 < results.size()) ? "," : "");
+		}
+
+		fprintf(file, "  ]\n");
+		fprintf(file, "}\n");
+		fclose(file);
+
+		return true;
+	}
+
+	EGLDisplay getDisplay()
+	{
+		EGLDisplay display = EGL_NO_DISPLAY;
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if(getPlatformDisplay)
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+
+		if(display == EGL_NO_DISPLAY)   // No surfaceless platform
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		return display;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *json = nullptr;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			json = argv[++i];
+		}
+		else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+		{
+			minimumTime = atof(argv[++i]);
+		}
+		else
+		{
+			printf("Usage: %s [--json <file>] [--filter <substring>] [--time <seconds>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	EGLDisplay display = getDisplay();
+
+	if(!eglInitialize(display, nullptr, nullptr))
+	{
+		fprintf(stderr, "eglInitialize failed\n");
+		return 1;
+	}
+
+	const EGLint configAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint configCount = 0;
+
+	if(!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		fprintf(stderr, "No OpenGL ES 3.0 pbuffer config\n");
+		return 1;
+	}
+
+	const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+	const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+	if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+	{
+		fprintf(stderr, "Could not create an OpenGL ES 3.0 context\n");
+		return 1;
+	}
+
+	GLuint colorBuffer;
+	glGenTextures(1, &colorBuffer);
+	glBindTexture(GL_TEXTURE_2D, colorBuffer);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, targetSize, targetSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	GLuint target;
+	glGenFramebuffers(1, &target);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		fprintf(stderr, "Incomplete framebuffer\n");
+		return 1;
+	}
+
+	glViewport(0, 0, targetSize, targetSize);
+
+	const float quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+
+	GLuint vertexBuffer;
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glEnableVertexAttribArray(0);
+
+	printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+	drawCalls();
+	fillRate("fill_simple", colorShader, false);
+	fillRate("fill_complex", complexShader, false);
+	fillRate("blend", colorShader, true);
+	sampling();
+	multisampleResolve(target);
+	textureUpload();
+	readback();
+	shaderCompilation();
+
+	if(json && !writeJSON(json))
+	{
+		fprintf(stderr, "Could not write %s\n", json);
+	}
+
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteFramebuffers(1, &target);
+	glDeleteTextures(1, &colorBuffer);
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglDestroySurface(display, surface);
+	eglTerminate(display);
+
+	return 0;
+}
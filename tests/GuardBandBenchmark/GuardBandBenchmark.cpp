@@ -0,0 +1,312 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures clipping and triangle setup for scenes with much off-screen
+// geometry: a ground plane seen in perspective, triangles a few times the
+// size of the viewport, and huge triangles which leave the guard band. Each
+// scene is set up with viewport clipping and with guard band clipping, which
+// must cover the same pixels up to the rounding of clipped vertices.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Renderer/Clipper.hpp"
+#include "Renderer/Polygon.hpp"
+#include "Renderer/Primitive.hpp"
+#include "Renderer/SetupProcessor.hpp"
+#include "Shader/SetupRoutine.hpp"
+#include "Common/Math.hpp"
+#include "Common/Memory.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+
+namespace
+{
+	const int width = 1024;
+	const int height = 768;
+
+	struct Scene
+	{
+		const char *name;
+		std::vector<Triangle> triangles;
+	};
+
+	struct Result
+	{
+		double time;       // Best per frame
+		int visible;       // Primitives produced by setup
+		int clipped;       // Primitives which were clipped geometrically
+		int64_t pixels;    // Covered by the outlines
+	};
+
+	Vertex vertex(float x, float y, float z, float w)
+	{
+		Vertex v;
+		memset(&v, 0, sizeof(Vertex));
+
+		v.v[Pos] = vector(x, y, z, w);
+
+		Clipper clipper(false);
+		v.clipFlags = clipper.computeClipFlags(v.v[Pos]);
+
+		// As computed by the vertex routine
+		float rhw = (w != 0.0f) ? 1.0f / w : 1.0f;
+		v.X = (int)lrintf((width * 0.5f * 16 - 8) + x * rhw * (width * 0.5f * 16));
+		v.Y = (int)lrintf((height * 0.5f * 16 - 8) + y * rhw * (height * 0.5f * 16));
+
+		return v;
+	}
+
+	void addTriangle(Scene &scene, const float4 &p0, const float4 &p1, const float4 &p2)
+	{
+		Triangle triangle;
+		triangle.v0 = vertex(p0.x, p0.y, p0.z, p0.w);
+		triangle.v1 = vertex(p1.x, p1.y, p1.z, p1.w);
+		triangle.v2 = vertex(p2.x, p2.y, p2.z, p2.w);
+
+		scene.triangles.push_back(triangle);
+	}
+
+	// A tiled floor below the camera, stretching far to the sides and into the distance
+	Scene createGroundPlane()
+	{
+		Scene scene = {"ground plane"};
+
+		const float n = 0.1f;
+		const float f = 1000.0f;
+		const float cotangent = 1.0f / tanf(0.5f * 1.0f);   // About 57 degrees vertical field of view
+		const float aspect = (float)width / height;
+
+		const int tiles = 96;
+		const float size = 4.0f;
+
+		for(int j = 0; j < tiles; j++)
+		{
+			for(int i = 0; i < tiles; i++)
+			{
+				float4 corner[4];
+
+				for(int c = 0; c < 4; c++)
+				{
+					float x = ((i + (c & 1)) - tiles / 2) * size;
+					float y = -2.0f;
+					float z = -1.0f - (j + (c >> 1)) * size;
+
+					// Right-handed perspective projection, to [0, 1] depth
+					corner[c] = vector(x * cotangent / aspect, y * cotangent, z * f / (n - f) + n * f / (n - f), -z);
+				}
+
+				addTriangle(scene, corner[0], corner[1], corner[2]);
+				addTriangle(scene, corner[2], corner[1], corner[3]);
+			}
+		}
+
+		return scene;
+	}
+
+	// Random triangles with vertices up to extent times the viewport's half size from its center
+	Scene createLarge(const char *name, float extent, int count)
+	{
+		Scene scene = {name};
+		unsigned int seed = 1;
+
+		auto random = [&seed](float range)
+		{
+			seed = seed * 1103515245 + 12345;
+			return ((float)((seed >> 8) & 0xFFFF) / 0xFFFF * 2.0f - 1.0f) * range;
+		};
+
+		for(int i = 0; i < count; i++)
+		{
+			float z = 0.1f + 0.8f * (float)i / count;
+			float w = 1.0f + 0.5f * (float)(i % 3);
+
+			float4 p0 = vector(random(extent) * w, random(extent) * w, z * w, w);
+			float4 p1 = vector(random(extent) * w, random(extent) * w, z * w, w);
+			float4 p2 = vector(random(extent) * w, random(extent) * w, z * w, w);
+
+			addTriangle(scene, p0, p1, p2);
+		}
+
+		return scene;
+	}
+
+	Routine *generateSetup()
+	{
+		SetupProcessor::State state;
+
+		state.isDrawTriangle = true;
+		state.isDrawSolidTriangle = true;
+		state.interpolateZ = true;
+		state.interpolateW = true;
+		state.perspective = true;
+		state.positionRegister = Pos;
+		state.pointSizeRegister = Unused;
+		state.cullMode = CULL_NONE;
+		state.multiSample = 1;
+
+		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
+		{
+			for(int component = 0; component < 4; component++)
+			{
+				state.gradient[interpolant][component].attribute = Unused;
+			}
+		}
+
+		state.fog.attribute = Unused;
+
+		SetupRoutine generator(state);
+		generator.generate();
+
+		return generator.getRoutine();
+	}
+
+	void setGuardBand(DrawData *data, bool guardBand)
+	{
+		// As computed by the renderer
+		float W = 0.5f * width;
+		float H = 0.5f * height;
+
+		data->guardBandX = guardBand ? max((Clipper::GUARD_BAND - W) / W, 1.0f) : 1.0f;
+		data->guardBandY = guardBand ? max((Clipper::GUARD_BAND - H) / H, 1.0f) : 1.0f;
+	}
+
+	// Mirrors Renderer::setupSolidTriangles()
+	Result run(Routine *routine, const Scene &scene, const DrawCall &draw, Primitive *primitive)
+	{
+		SetupProcessor::RoutinePointer setup = (SetupProcessor::RoutinePointer)routine->getEntry();
+		Clipper clipper(false);
+		Result result = {0.0, 0, 0, 0};
+
+		result.time = benchmark::bestTime([&]()
+		{
+			int visible = 0;
+			int clipped = 0;
+			int64_t pixels = 0;
+
+			for(const Triangle &triangle : scene.triangles)
+			{
+				const Vertex &v0 = triangle.v0;
+				const Vertex &v1 = triangle.v1;
+				const Vertex &v2 = triangle.v2;
+
+				if((v0.clipFlags & v1.clipFlags & v2.clipFlags) != Clipper::CLIP_FINITE)
+				{
+					continue;
+				}
+
+				Polygon polygon(&v0.v[Pos], &v1.v[Pos], &v2.v[Pos]);
+
+				int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags;
+
+				if(clipFlagsOr != Clipper::CLIP_FINITE)
+				{
+					if(!clipper.clip(polygon, clipFlagsOr, draw))
+					{
+						continue;
+					}
+
+					clipped += (polygon.i != 0) ? 1 : 0;
+				}
+
+				if(setup(primitive, &triangle, &polygon, draw.data))
+				{
+					visible++;
+
+					for(int y = primitive->yMin; y < primitive->yMax; y++)
+					{
+						pixels += primitive->outline[y].right - primitive->outline[y].left;
+					}
+				}
+			}
+
+			result.visible = visible;
+			result.clipped = clipped;
+			result.pixels = pixels;
+		});
+
+		return result;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	DrawCall draw;
+	benchmark::clearDrawData(draw.data);
+	draw.clipFlags = 0;
+
+	DrawData *data = draw.data;
+	data->Wx16 = replicate(width * 0.5f * 16);
+	data->Hx16 = replicate(height * 0.5f * 16);
+	data->X0x16 = replicate(width * 0.5f * 16 - 8);
+	data->Y0x16 = replicate(height * 0.5f * 16 - 8);
+	data->depthRange = 1.0f;
+	data->depthNear = 0.0f;
+	data->scissorX0 = 0;
+	data->scissorX1 = width;
+	data->scissorY0 = 0;
+	data->scissorY1 = height;
+
+	Primitive *primitive = (Primitive*)allocate(sizeof(Primitive));
+	Routine *routine = generateSetup();
+
+	const Scene scenes[] =
+	{
+		createGroundPlane(),
+		createLarge("zoomed in", 6.0f, 4096),
+		createLarge("beyond guard band", 40.0f, 4096),
+	};
+
+	bool mismatch = false;
+
+	printf("%-18s %9s  %-10s %9s %9s %12s %10s\n", "Scene", "Triangles", "Clipping", "Visible", "Clipped", "Pixels", "ns/tri");
+
+	for(const Scene &scene : scenes)
+	{
+		Result results[2];
+
+		for(int guardBand = 0; guardBand < 2; guardBand++)
+		{
+			setGuardBand(data, guardBand != 0);
+			results[guardBand] = run(routine, scene, draw, primitive);
+
+			const Result &result = results[guardBand];
+			printf("%-18s %9d  %-10s %9d %9d %12lld %10.1f\n", guardBand ? "" : scene.name, (int)scene.triangles.size(), guardBand ? "guard band" : "viewport",
+			       result.visible, result.clipped, (long long)result.pixels, result.time * 1.0e9 / scene.triangles.size());
+		}
+
+		// Clipped vertices are rounded to the subpixel grid, so edge pixels can differ
+		int64_t difference = results[1].pixels - results[0].pixels;
+		int64_t tolerance = results[0].pixels / 100;
+
+		if(difference > tolerance || difference < -tolerance)
+		{
+			printf("%-18s coverage differs by %lld pixels\n", "", (long long)difference);
+			mismatch = true;
+		}
+
+		printf("%-18s speedup %.2fx\n", "", results[0].time / results[1].time);
+	}
+
+	delete routine;
+	deallocate(primitive);
+
+	return mismatch ? 1 : 0;
+}
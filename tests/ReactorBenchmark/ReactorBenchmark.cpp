@@ -0,0 +1,208 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiles a few Reactor kernels, with and without optimizations, and reports
+// the time to compile each one and the speed of the generated code. The kernels
+// have loop-invariant computations, common subexpressions and chains of
+// shuffles, which the Subzero optimizer's passes target. This program is built
+// once for each back-end, as ReactorBenchmarkLLVM and ReactorBenchmarkSubzero,
+// and both print the same table, with a checksum of the outputs to confirm the
+// back-ends compute the same results.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include <stdio.h>
+
+#ifndef REACTOR_BACKEND_NAME
+#define REACTOR_BACKEND_NAME "unknown"
+#endif
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	const int elements = 64 * 1024;   // Float4 vectors per run
+
+	typedef void (*KernelFunction)(float *out, const float *in, const float *constants, int count);
+	typedef Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> Kernel;
+
+	// Computes a value from the constants inside the loop, where it could be hoisted
+	void invariant(Kernel &function)
+	{
+		Pointer<Byte> out = function.Arg<0>();
+		Pointer<Byte> in = function.Arg<1>();
+		Pointer<Byte> constants = function.Arg<2>();
+		Int count = function.Arg<3>();
+
+		Float4 c = *Pointer<Float4>(constants);
+
+		For(Int i = 0, i < count, i++)
+		{
+			Float4 k = Swizzle(c, 0x1B) * c + Sqrt(Abs(c));
+			Float4 x = *Pointer<Float4>(in);
+
+			*Pointer<Float4>(out) = x * k + Swizzle(k, 0xB1);
+
+			in += 16;
+			out += 16;
+		}
+
+		Return();
+	}
+
+	// Repeats the same products and sums, which value numbering can share
+	void redundant(Kernel &function)
+	{
+		Pointer<Byte> out = function.Arg<0>();
+		Pointer<Byte> in = function.Arg<1>();
+		Pointer<Byte> constants = function.Arg<2>();
+		Int count = function.Arg<3>();
+
+		Float4 c = *Pointer<Float4>(constants);
+
+		For(Int i = 0, i < count, i++)
+		{
+			Float4 x = *Pointer<Float4>(in);
+
+			for(int j = 0; j < 8; j++)
+			{
+				Float4 a = x * c + x;
+				Float4 b = x * c + x;
+				x = Frac(a * b + x * c);
+			}
+
+			*Pointer<Float4>(out) = x;
+
+			in += 16;
+			out += 16;
+		}
+
+		Return();
+	}
+
+	// Chains of swizzles which combine into a single shuffle, or cancel out
+	void shuffles(Kernel &function)
+	{
+		Pointer<Byte> out = function.Arg<0>();
+		Pointer<Byte> in = function.Arg<1>();
+		Pointer<Byte> constants = function.Arg<2>();
+		Int count = function.Arg<3>();
+
+		Float4 c = *Pointer<Float4>(constants);
+
+		For(Int i = 0, i < count, i++)
+		{
+			Float4 x = *Pointer<Float4>(in);
+
+			for(int j = 0; j < 4; j++)
+			{
+				Float4 y = Swizzle(Swizzle(x, 0x1B), 0x1B);   // Identity
+				Float4 z = Swizzle(Swizzle(Swizzle(x, 0x39), 0x39), 0x4E);   // Rotates twice, then swaps halves
+				x = Max(y * c, ShuffleLowHigh(z, y, 0x44));
+			}
+
+			*Pointer<Float4>(out) = x;
+
+			in += 16;
+			out += 16;
+		}
+
+		Return();
+	}
+
+	struct Test
+	{
+		const char *name;
+		void (*generate)(Kernel &function);
+	};
+
+	const Test tests[] =
+	{
+		{"invariant", invariant},
+		{"redundant", redundant},
+		{"shuffles", shuffles},
+	};
+
+	double checksum(const float *values, int count)
+	{
+		double sum = 0.0;
+
+		for(int i = 0; i < count; i++)
+		{
+			sum += values[i];
+		}
+
+		return sum;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	float *in = (float*)allocate(elements * 4 * sizeof(float));
+	float *out = (float*)allocate(elements * 4 * sizeof(float));
+	float *constants = (float*)allocate(4 * sizeof(float));
+
+	for(int i = 0; i < elements * 4; i++)
+	{
+		in[i] = (float)(i % 1024) / 1024.0f;
+	}
+
+	constants[0] = 0.25f;
+	constants[1] = 0.5f;
+	constants[2] = 0.75f;
+	constants[3] = 1.25f;
+
+	printf("Back-end: %s\n", REACTOR_BACKEND_NAME);
+	printf("%-10s %-12s %12s %12s %12s %10s %14s\n", "kernel", "mode", "instructions", "compile (ms)", "code (bytes)", "ns/vec4", "checksum");
+
+	for(const Test &test : tests)
+	{
+		for(int optimized = 1; optimized >= 0; optimized--)
+		{
+			Routine *routine = nullptr;
+
+			{
+				Kernel function;
+				test.generate(function);
+
+				routine = optimized ? function(L"ReactorBenchmark") : function.unoptimized(L"ReactorBenchmark");
+			}
+
+			const CompileStatistics &statistics = routine->getCompileStatistics();
+			double compileTime = statistics.buildTime + statistics.optimizeTime + statistics.emitTime;
+
+			KernelFunction kernel = (KernelFunction)routine->getEntry();
+
+			double time = bestTime([&]()
+			{
+				kernel(out, in, constants, elements);
+			});
+
+			printf("%-10s %-12s %12d %12.3f %12d %10.3f %14.6e\n", test.name, optimized ? "optimized" : "unoptimized",
+			       statistics.instructions, compileTime * 1.0e3, statistics.codeSize, time / elements * 1.0e9, checksum(out, elements * 4));
+
+			delete routine;
+		}
+	}
+
+	deallocate(constants);
+	deallocate(out);
+	deallocate(in);
+
+	return 0;
+}
@@ -0,0 +1,515 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures SamplerCore texel fetch throughput for linear and tiled texture
+// layouts, with rotated, minified and anisotropic access patterns. Also
+// compares the specialized and generic code for simple compositing
+// patterns, and reports the quality and cost of anisotropic filtering.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Sampler.hpp"
+#include "Renderer/Surface.hpp"
+#include "Shader/SamplerCore.hpp"
+#include "Shader/Constants.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace sw
+{
+	extern bool tiledTextureLayout;
+	extern bool adaptiveAnisotropy;
+	extern bool samplerFastPaths;
+}
+
+using namespace sw;
+
+namespace
+{
+	const int textureSize = 1024;
+	const int targetSize = 512;
+	const int reportSize = 256;
+	const int checkerSize = 4;      // Texels per checkerboard cell
+	const int supersampling = 8;    // Reference samples per pixel, in each direction
+
+	struct Pattern
+	{
+		const char *name;
+		float angle;    // Degrees
+		float scaleX;   // Texels per pixel
+		float scaleY;
+		FilterType filter;
+		MipmapType mipmapFilter;
+		AddressingMode addressingMode;
+	};
+
+	const Pattern patterns[] =
+	{
+		{"rotated",     30.0f, 1.0f, 1.0f, FILTER_LINEAR,      MIPMAP_LINEAR, ADDRESSING_WRAP},
+		{"minified",     0.0f, 4.0f, 4.0f, FILTER_LINEAR,      MIPMAP_LINEAR, ADDRESSING_WRAP},
+		{"anisotropic", 30.0f, 1.0f, 8.0f, FILTER_ANISOTROPIC, MIPMAP_LINEAR, ADDRESSING_WRAP},
+	};
+
+	// Non-mipmapped, clamped sampling, as used for user interfaces and compositing
+	const Pattern compositingPatterns[] =
+	{
+		{"copy",         0.0f, 1.0f,  1.0f,  FILTER_POINT,  MIPMAP_NONE, ADDRESSING_CLAMP},
+		{"scaled",       0.0f, 0.75f, 0.75f, FILTER_LINEAR, MIPMAP_NONE, ADDRESSING_CLAMP},
+		{"rotated",      5.0f, 1.0f,  1.0f,  FILTER_LINEAR, MIPMAP_NONE, ADDRESSING_CLAMP},
+	};
+
+	const float anisotropyLevels[] = {2.0f, 4.0f, 8.0f, 16.0f};
+
+	typedef void (*SampleFunction)(const void *texture, const void *constants, const float *transform, void *output, int size);
+
+	// Samples a size x size target, one quad at a time, at texture coordinates
+	// u = t[0] * x + t[1] * y + t[2] and v = t[3] * x + t[4] * y + t[5].
+	Routine *generate(const Sampler::State &state)
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> texture = function.Arg<0>();
+			Pointer<Byte> constants = function.Arg<1>();
+			Pointer<Byte> transform = function.Arg<2>();
+			Pointer<Byte> output = function.Arg<3>();
+			Int size = function.Arg<4>();
+
+			Float4 ux = Float4(*Pointer<Float>(transform + 0));
+			Float4 uy = Float4(*Pointer<Float>(transform + 4));
+			Float4 u0 = Float4(*Pointer<Float>(transform + 8));
+			Float4 vx = Float4(*Pointer<Float>(transform + 12));
+			Float4 vy = Float4(*Pointer<Float>(transform + 16));
+			Float4 v0 = Float4(*Pointer<Float>(transform + 20));
+
+			SamplerCore sampler(constants, state);
+			Short4 sum = Short4(0x0000);
+
+			Int y = 0;
+
+			For(y = 0, y < size, y += 2)
+			{
+				Float4 py = Float4(Int4(y)) + Float4(0.0f, 0.0f, 1.0f, 1.0f);
+
+				Int x = 0;
+
+				For(x = 0, x < size, x += 2)
+				{
+					Float4 px = Float4(Int4(x)) + Float4(0.0f, 1.0f, 0.0f, 1.0f);
+
+					Float4 u = ux * px + uy * py + u0;
+					Float4 v = vx * px + vy * py + v0;
+					Float4 w = Float4(0.0f);
+					Float4 q = Float4(0.0f);
+					Vector4f dsx;
+					Vector4f dsy;
+					Vector4s c;
+
+					sampler.sampleTexture(texture, c, u, v, w, q, dsx, dsy);
+
+					sum += c.x + c.y + c.z + c.w;
+				}
+			}
+
+			*Pointer<Short4>(output) = sum;
+
+			Return();
+		}
+
+		return function(L"SamplerBenchmark");
+	}
+
+	// Like generate(), but stores the red component of each pixel as a float
+	Routine *generateImage(const Sampler::State &state)
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Int)> function;
+		{
+			Pointer<Byte> texture = function.Arg<0>();
+			Pointer<Byte> constants = function.Arg<1>();
+			Pointer<Byte> transform = function.Arg<2>();
+			Pointer<Byte> output = function.Arg<3>();
+			Int size = function.Arg<4>();
+
+			Float4 ux = Float4(*Pointer<Float>(transform + 0));
+			Float4 uy = Float4(*Pointer<Float>(transform + 4));
+			Float4 u0 = Float4(*Pointer<Float>(transform + 8));
+			Float4 vx = Float4(*Pointer<Float>(transform + 12));
+			Float4 vy = Float4(*Pointer<Float>(transform + 16));
+			Float4 v0 = Float4(*Pointer<Float>(transform + 20));
+
+			SamplerCore sampler(constants, state);
+
+			Int y = 0;
+
+			For(y = 0, y < size, y += 2)
+			{
+				Float4 py = Float4(Int4(y)) + Float4(0.0f, 0.0f, 1.0f, 1.0f);
+
+				Int x = 0;
+
+				For(x = 0, x < size, x += 2)
+				{
+					Float4 px = Float4(Int4(x)) + Float4(0.0f, 1.0f, 0.0f, 1.0f);
+
+					Float4 u = ux * px + uy * py + u0;
+					Float4 v = vx * px + vy * py + v0;
+					Float4 w = Float4(0.0f);
+					Float4 q = Float4(0.0f);
+					Vector4f dsx;
+					Vector4f dsy;
+					Vector4f offset;
+					Vector4f c;
+
+					sampler.sampleTexture(texture, c, u, v, w, q, dsx, dsy, offset, Implicit);
+
+					// Quads are stored in (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1) order
+					*Pointer<Float4>(output + ((y >> 1) * (size >> 1) + (x >> 1)) * 16) = c.x;
+				}
+			}
+
+			Return();
+		}
+
+		return function(L"SamplerBenchmarkImage");
+	}
+
+	void setTexture(Sampler &sampler, Surface *levels[], int levelCount, const Pattern &pattern, float maxAnisotropy)
+	{
+		sampler.setTextureFilter(pattern.filter);
+		sampler.setMipmapFilter(pattern.mipmapFilter);
+		sampler.setAddressingModeU(pattern.addressingMode);
+		sampler.setAddressingModeV(pattern.addressingMode);
+		sampler.setMaxAnisotropy(maxAnisotropy);
+
+		for(int level = 0; level < MIPMAP_LEVELS; level++)
+		{
+			sampler.setTextureLevel(0, level, levels[level < levelCount ? level : levelCount - 1], TEXTURE_2D);
+		}
+	}
+
+	void getTransform(const Pattern &pattern, float transform[6])
+	{
+		float radians = pattern.angle * 3.14159265f / 180.0f;
+		float c = cosf(radians) / textureSize;
+		float s = sinf(radians) / textureSize;
+
+		transform[0] = c * pattern.scaleX;
+		transform[1] = -s * pattern.scaleY;
+		transform[2] = 0.25f;
+		transform[3] = s * pattern.scaleX;
+		transform[4] = c * pattern.scaleY;
+		transform[5] = 0.25f;
+	}
+
+	double run(Surface *levels[], int levelCount, const Pattern &pattern, bool tiled)
+	{
+		tiledTextureLayout = tiled;
+
+		Sampler sampler;
+		setTexture(sampler, levels, levelCount, pattern, 16.0f);
+
+		Sampler::State state = sampler.samplerState();
+
+		if(state.tiledLayout != tiled)
+		{
+			printf("%s: unexpected texture layout\n", pattern.name);
+		}
+
+		Routine *routine = generate(state);
+		SampleFunction sample = (SampleFunction)routine->getEntry();
+
+		Texture *texture = (Texture*)allocate(sizeof(Texture));
+		memcpy(texture, &sampler.getTextureData(), sizeof(Texture));
+
+		float transform[6];
+		getTransform(pattern, transform);
+
+		short output[4];
+
+		double best = benchmark::bestTime([&]()
+		{
+			sample(texture, &constants, transform, output, targetSize);
+		});
+
+		deallocate(texture);
+		delete routine;
+
+		return best;
+	}
+
+	// Renders a reportSize x reportSize image of the red component. Returns the best time.
+	double runImage(Surface *levels[], int levelCount, const Pattern &pattern, float maxAnisotropy, std::vector<float> &image)
+	{
+		Sampler sampler;
+		setTexture(sampler, levels, levelCount, pattern, maxAnisotropy);
+
+		Routine *routine = generateImage(sampler.samplerState());
+		SampleFunction sample = (SampleFunction)routine->getEntry();
+
+		Texture *texture = (Texture*)allocate(sizeof(Texture));
+		memcpy(texture, &sampler.getTextureData(), sizeof(Texture));
+
+		float transform[6];
+		getTransform(pattern, transform);
+
+		image.resize(reportSize * reportSize);
+
+		double best = benchmark::bestTime([&]()
+		{
+			sample(texture, &constants, transform, image.data(), reportSize);
+		});
+
+		deallocate(texture);
+		delete routine;
+
+		return best;
+	}
+
+	int imageIndex(int x, int y)
+	{
+		return ((y >> 1) * (reportSize >> 1) + (x >> 1)) * 4 + (y & 1) * 2 + (x & 1);
+	}
+
+	// Box filters the footprint of each pixel on the base level, with bilinear samples
+	void reference(Surface *level, const Pattern &pattern, std::vector<float> &image)
+	{
+		float transform[6];
+		getTransform(pattern, transform);
+
+		int size = level->getWidth();
+		int pitch = level->getExternalPitchP();
+		const unsigned int *texels = (const unsigned int*)level->lockExternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+
+		image.resize(reportSize * reportSize);
+
+		for(int y = 0; y < reportSize; y++)
+		{
+			for(int x = 0; x < reportSize; x++)
+			{
+				float sum = 0.0f;
+
+				for(int j = 0; j < supersampling; j++)
+				{
+					for(int i = 0; i < supersampling; i++)
+					{
+						float px = x + (i + 0.5f) / supersampling - 0.5f;
+						float py = y + (j + 0.5f) / supersampling - 0.5f;
+						float u = (transform[0] * px + transform[1] * py + transform[2]) * size - 0.5f;
+						float v = (transform[3] * px + transform[4] * py + transform[5]) * size - 0.5f;
+						float fu = u - floorf(u);
+						float fv = v - floorf(v);
+						int u0 = ((int)floorf(u) % size + size) % size;
+						int v0 = ((int)floorf(v) % size + size) % size;
+						int u1 = (u0 + 1) % size;
+						int v1 = (v0 + 1) % size;
+
+						float c00 = (texels[v0 * pitch + u0] & 0xFF) / 255.0f;
+						float c10 = (texels[v0 * pitch + u1] & 0xFF) / 255.0f;
+						float c01 = (texels[v1 * pitch + u0] & 0xFF) / 255.0f;
+						float c11 = (texels[v1 * pitch + u1] & 0xFF) / 255.0f;
+
+						sum += (c00 * (1 - fu) + c10 * fu) * (1 - fv) + (c01 * (1 - fu) + c11 * fu) * fv;
+					}
+				}
+
+				image[imageIndex(x, y)] = sum / (supersampling * supersampling);
+			}
+		}
+
+		level->unlockExternal();
+	}
+
+	// Root mean square difference, in 8-bit units
+	double rmse(const std::vector<float> &image, const std::vector<float> &reference)
+	{
+		double sum = 0.0;
+
+		for(size_t i = 0; i < image.size(); i++)
+		{
+			double difference = (image[i] - reference[i]) * 255.0;
+			sum += difference * difference;
+		}
+
+		return sqrt(sum / image.size());
+	}
+
+	// Checkerboard with a box filtered mipmap chain
+	int createCheckerboard(Surface *levels[])
+	{
+		int levelCount = 0;
+
+		for(int size = textureSize; size > 0; size /= 2)
+		{
+			Surface *surface = new Surface(nullptr, size, size, 1, FORMAT_A8B8G8R8, true, false);
+			unsigned int *texels = (unsigned int*)surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+			int pitch = surface->getExternalPitchP();
+
+			if(levelCount == 0)
+			{
+				for(int y = 0; y < size; y++)
+				{
+					for(int x = 0; x < size; x++)
+					{
+						texels[y * pitch + x] = ((x / checkerSize + y / checkerSize) & 1) ? 0xFFFFFFFF : 0xFF000000;
+					}
+				}
+			}
+			else
+			{
+				Surface *parent = levels[levelCount - 1];
+				const unsigned char *source = (const unsigned char*)parent->lockExternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+				int sourcePitch = parent->getExternalPitchB();
+
+				for(int y = 0; y < size; y++)
+				{
+					for(int x = 0; x < size; x++)
+					{
+						unsigned char *texel = (unsigned char*)&texels[y * pitch + x];
+
+						for(int i = 0; i < 4; i++)
+						{
+							const unsigned char *s0 = source + 2 * y * sourcePitch + 8 * x + i;
+							const unsigned char *s1 = s0 + sourcePitch;
+
+							texel[i] = (s0[0] + s0[4] + s1[0] + s1[4] + 2) / 4;
+						}
+					}
+				}
+
+				parent->unlockExternal();
+			}
+
+			surface->unlockExternal();
+			levels[levelCount++] = surface;
+		}
+
+		return levelCount;
+	}
+
+	void anisotropyReport()
+	{
+		Surface *levels[MIPMAP_LEVELS];
+		int levelCount = createCheckerboard(levels);
+		const Pattern pattern = {"anisotropic", 30.0f, 1.0f, 16.0f, FILTER_ANISOTROPIC, MIPMAP_LINEAR, ADDRESSING_WRAP};
+
+		tiledTextureLayout = true;
+
+		std::vector<float> ideal;
+		reference(levels[0], pattern, ideal);
+
+		printf("\n%-8s %13s %13s %8s %13s %13s\n", "maximum", "rounded (ms)", "adaptive (ms)", "speedup", "rounded RMSE", "adaptive RMSE");
+
+		for(float maxAnisotropy : anisotropyLevels)
+		{
+			std::vector<float> image;
+
+			adaptiveAnisotropy = false;
+			double roundedTime = runImage(levels, levelCount, pattern, maxAnisotropy, image);
+			double roundedError = rmse(image, ideal);
+
+			adaptiveAnisotropy = true;
+			double adaptiveTime = runImage(levels, levelCount, pattern, maxAnisotropy, image);
+			double adaptiveError = rmse(image, ideal);
+
+			printf("%7.0fx %13.3f %13.3f %7.2fx %13.2f %13.2f\n", maxAnisotropy, roundedTime * 1000.0, adaptiveTime * 1000.0, roundedTime / adaptiveTime, roundedError, adaptiveError);
+		}
+
+		adaptiveAnisotropy = false;
+
+		for(int level = 0; level < levelCount; level++)
+		{
+			delete levels[level];
+		}
+	}
+
+	void compositingReport(Surface *levels[])
+	{
+		printf("\n%-12s %12s %16s %8s %11s\n", "compositing", "generic (ms)", "specialized (ms)", "speedup", "difference");
+
+		for(const Pattern &pattern : compositingPatterns)
+		{
+			std::vector<float> generic;
+			std::vector<float> specialized;
+
+			samplerFastPaths = false;
+			double genericTime = run(levels, 1, pattern, true);
+			runImage(levels, 1, pattern, 1.0f, generic);
+
+			samplerFastPaths = true;
+			double specializedTime = run(levels, 1, pattern, true);
+			runImage(levels, 1, pattern, 1.0f, specialized);
+
+			float difference = 0.0f;
+
+			for(size_t i = 0; i < generic.size(); i++)
+			{
+				difference = fmaxf(difference, fabsf(generic[i] - specialized[i]) * 255.0f);
+			}
+
+			printf("%-12s %12.3f %16.3f %7.2fx %11.2f\n", pattern.name, genericTime * 1000.0, specializedTime * 1000.0, genericTime / specializedTime, difference);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	Surface *levels[MIPMAP_LEVELS];
+	int levelCount = 0;
+
+	for(int size = textureSize; size > 0; size /= 2)
+	{
+		Surface *surface = new Surface(nullptr, size, size, 1, FORMAT_A8B8G8R8, true, false);
+		unsigned int *texels = (unsigned int*)surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+		unsigned int seed = size;
+
+		for(int y = 0; y < size; y++)
+		{
+			for(int x = 0; x < size; x++)
+			{
+				seed = seed * 1103515245 + 12345;
+				texels[y * surface->getExternalPitchP() + x] = seed;
+			}
+		}
+
+		surface->unlockExternal();
+		levels[levelCount++] = surface;
+	}
+
+	Sampler::setFilterQuality(FILTER_ANISOTROPIC);
+	Sampler::setMipmapQuality(MIPMAP_LINEAR);
+
+	printf("%-12s %12s %12s %8s\n", "pattern", "linear (ms)", "tiled (ms)", "speedup");
+
+	for(const Pattern &pattern : patterns)
+	{
+		double linear = run(levels, levelCount, pattern, false);
+		double tiled = run(levels, levelCount, pattern, true);
+
+		printf("%-12s %12.3f %12.3f %7.2fx\n", pattern.name, linear * 1000.0, tiled * 1000.0, linear / tiled);
+	}
+
+	compositingReport(levels);
+	anisotropyReport();
+
+	for(int level = 0; level < levelCount; level++)
+	{
+		delete levels[level];
+	}
+
+	return 0;
+}
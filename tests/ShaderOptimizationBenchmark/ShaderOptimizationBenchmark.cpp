@@ -0,0 +1,204 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Reports what the shader instruction optimizations gain: the instruction
+// count, the time to JIT compile the pixel routine, and the cycles spent per
+// pixel, with shaderOptimizations off and on. The shaders mimic translated
+// GLSL, with chains of copies, constant expressions, a repeated subexpression
+// and a dead result, ahead of the arithmetic chain of the other benchmarks.
+// Both versions must write the same pixels.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/Primitive.hpp"
+#include "Shader/PixelProgram.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+#include "Common/Timer.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace sw
+{
+	extern bool shaderOptimizations;
+}
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	const int targetSize = 512;
+
+	typedef void (*PixelFunction)(const Primitive *primitive, int count, int cluster, DrawData *data);
+
+	struct Result
+	{
+		size_t instructions;
+		double compileTime;      // Seconds
+		double cyclesPerPixel;   // Of the fastest frame
+	};
+
+	void buildShader(PixelShader &shader, int operations)
+	{
+		const Shader::SourceParameter v0 = source(Shader::PARAMETER_INPUT, 0);
+		const Shader::SourceParameter c0 = source(Shader::PARAMETER_CONST, 0);
+
+		shader.setInput(0, 4, Shader::Semantic(Shader::USAGE_TEXCOORD, 0));
+
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_TEMP, 1), v0));
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_TEMP, 2), source(Shader::PARAMETER_TEMP, 1)));
+		shader.append(instruction(Shader::OPCODE_MUL, destination(Shader::PARAMETER_TEMP, 3), literal(2.0f, 2.0f, 2.0f, 2.0f), literal(0.5f, 0.25f, 0.5f, 1.0f)));
+		shader.append(instruction(Shader::OPCODE_MUL, destination(Shader::PARAMETER_TEMP, 0), source(Shader::PARAMETER_TEMP, 2), source(Shader::PARAMETER_TEMP, 3)));
+		shader.append(instruction(Shader::OPCODE_ADD, destination(Shader::PARAMETER_TEMP, 4), source(Shader::PARAMETER_TEMP, 0), c0));
+		shader.append(instruction(Shader::OPCODE_ADD, destination(Shader::PARAMETER_TEMP, 5), source(Shader::PARAMETER_TEMP, 0), c0));
+		shader.append(instruction(Shader::OPCODE_MAD, destination(Shader::PARAMETER_TEMP, 6), source(Shader::PARAMETER_TEMP, 2), source(Shader::PARAMETER_TEMP, 2), c0));
+		shader.append(instruction(Shader::OPCODE_MUL, destination(Shader::PARAMETER_TEMP, 0), source(Shader::PARAMETER_TEMP, 4), source(Shader::PARAMETER_TEMP, 5)));
+		appendArithmetic(shader, operations);
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_COLOROUT, 0), source(Shader::PARAMETER_TEMP, 0)));
+	}
+
+	Primitive *createRectangle()
+	{
+		Primitive *primitive = (Primitive*)allocate(sizeof(Primitive));
+		memset(primitive, 0, sizeof(Primitive));
+
+		primitive->yMin = 0;
+		primitive->yMax = targetSize;
+
+		for(int y = 0; y < targetSize; y++)
+		{
+			primitive->outline[y].left = 0;
+			primitive->outline[y].right = targetSize;
+		}
+
+		// v0 holds the normalized pixel position, and constant blue and alpha
+		primitive->xQuad = vector(0.0f, 1.0f, 0.0f, 1.0f);
+		primitive->yQuad = vector(0.0f, 0.0f, 1.0f, 1.0f);
+
+		for(int component = 0; component < 4; component++)
+		{
+			PlaneEquation &plane = primitive->V[0][component];
+
+			plane.A = replicate(component == 0 ? 1.0f / targetSize : 0.0f);
+			plane.B = replicate(component == 1 ? 1.0f / targetSize : 0.0f);
+			plane.C = replicate(component == 2 ? 0.5f : (component == 3 ? 1.0f : 0.0f));
+		}
+
+		return primitive;
+	}
+
+	Result run(const PixelShader &source, bool optimize, const Primitive *primitive, DrawData *data)
+	{
+		shaderOptimizations = optimize;
+		PixelShader shader(&source);   // The copy is optimized and analyzed
+		shaderOptimizations = true;
+
+		PixelProcessor::State state;
+
+		state.shaderID = shader.getSerialID();
+		state.alphaCompareMode = ALPHA_ALWAYS;
+		state.logicalOperation = LOGICALOP_COPY;
+		state.colorWriteMask = 0xF;
+		state.targetFormat[0] = FORMAT_A8R8G8B8;
+		state.multiSample = 1;
+		state.multiSampleMask = 1;
+		state.interpolant[0].component = 0xF;
+
+		Routine *routine = nullptr;
+
+		{
+			PixelProgram program(state, &shader);
+			program.generate();
+			routine = program(L"ShaderOptimizationBenchmark");
+		}
+
+		const CompileStatistics &statistics = routine->getCompileStatistics();
+		PixelFunction shade = (PixelFunction)routine->getEntry();
+		int64_t cycles = INT64_MAX;
+
+		for(int frame = 0; frame < frames; frame++)
+		{
+			int64_t start = Timer::ticks();
+			shade(primitive, 1, 0, data);
+			int64_t time = Timer::ticks() - start;
+
+			cycles = time < cycles ? time : cycles;
+		}
+
+		Result result;
+		result.instructions = shader.getLength();
+		result.compileTime = statistics.buildTime + statistics.optimizeTime + statistics.emitTime;
+		result.cyclesPerPixel = (double)cycles / (targetSize * targetSize);
+
+		delete routine;
+
+		return result;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t targetBytes = targetSize * targetSize * 4;
+	unsigned int *target = (unsigned int*)allocate(targetBytes);
+	unsigned int *reference = new unsigned int[targetSize * targetSize];
+
+	DrawData *data = createDrawData();
+	data->colorBuffer[0] = target;
+	data->colorPitchB[0] = targetSize * 4;
+	data->colorSliceB[0] = targetBytes;
+	data->ps.c[0] = vector(0.125f, 0.25f, 0.375f, 0.5f);
+
+	Primitive *primitive = createRectangle();
+
+	const struct
+	{
+		const char *name;
+		int operations;
+	}
+	programs[] =
+	{
+		{"simple", 0},
+		{"complex", complexOperations},
+	};
+
+	printf("%-8s %-4s %13s %13s %13s %10s\n", "shader", "opt", "instructions", "compile (ms)", "cycles/pixel", "identical");
+
+	for(const auto &program : programs)
+	{
+		PixelShader source;
+		buildShader(source, program.operations);
+
+		Result unoptimized = run(source, false, primitive, data);
+		memcpy(reference, target, targetBytes);
+
+		Result optimized = run(source, true, primitive, data);
+		bool identical = memcmp(reference, target, targetBytes) == 0;
+
+		printf("%-8s %-4s %13d %13.3f %13.2f %10s\n", program.name, "off", (int)unoptimized.instructions, unoptimized.compileTime * 1.0e3, unoptimized.cyclesPerPixel, "");
+		printf("%-8s %-4s %13d %13.3f %13.2f %10s\n", program.name, "on", (int)optimized.instructions, optimized.compileTime * 1.0e3, optimized.cyclesPerPixel, match(identical));
+	}
+
+	deallocate(primitive);
+	destroyDrawData(data);
+	deallocate(target);
+	delete[] reference;
+
+	return 0;
+}
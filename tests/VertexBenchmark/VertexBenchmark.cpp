@@ -0,0 +1,234 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures vertex routine throughput for a position-only and an arithmetic
+// heavy vertex shader, on a non-indexed triangle list and an indexed grid.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Renderer/VertexProcessor.hpp"
+#include "Renderer/Primitive.hpp"
+#include "Shader/VertexProgram.hpp"
+#include "Shader/VertexShader.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	const int gridSize = 128;   // Vertices per side
+	const int batchTriangles = 128;
+
+	struct Mesh
+	{
+		const char *name;
+		const float4 *positions;
+		const float4 *colors;
+		std::vector<unsigned int> indices;   // Three per triangle
+	};
+
+	// Transforms v0 by the matrix in c0 to c3, and passes v1 through a chain of dependent arithmetic
+	VertexShader *createShader(int operations)
+	{
+		VertexShader shader;
+		shader.setInput(0, Shader::Semantic(Shader::USAGE_POSITION, 0));
+		shader.setInput(1, Shader::Semantic(Shader::USAGE_COLOR, 0));
+		shader.setOutput(Pos, 4, Shader::Semantic(Shader::USAGE_POSITION, 0));
+		shader.setOutput(C0, 4, Shader::Semantic(Shader::USAGE_COLOR, 0));
+		shader.setPositionRegister(Pos);
+
+		for(int component = 0; component < 4; component++)
+		{
+			shader.append(instruction(Shader::OPCODE_DP4, destination(Shader::PARAMETER_OUTPUT, Pos, 1 << component),
+			                          source(Shader::PARAMETER_INPUT, 0), source(Shader::PARAMETER_CONST, component)));
+		}
+
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_TEMP, 0), source(Shader::PARAMETER_INPUT, 1)));
+		appendArithmetic(shader, operations);
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_OUTPUT, C0), source(Shader::PARAMETER_TEMP, 0)));
+
+		return new VertexShader(&shader);   // The copy is optimized and analyzed
+	}
+
+	Routine *generate(const VertexShader *shader)
+	{
+		VertexProcessor::State state;
+
+		state.shaderID = shader->getSerialID();
+		state.positionRegister = Pos;
+		state.pointSizeRegister = Unused;
+		state.verticesPerPrimitive = 3;
+
+		for(int i = 0; i < 2; i++)
+		{
+			state.input[i].type = STREAMTYPE_FLOAT;
+			state.input[i].count = 4;
+			state.input[i].normalized = false;
+			state.input[i].attribType = VertexShader::ATTRIBTYPE_FLOAT;
+		}
+
+		state.output[Pos].write = 0xF;
+		state.output[C0].write = 0xF;
+
+		VertexProgram program(state, shader);
+		program.generate();
+
+		return program(L"VertexBenchmark");
+	}
+
+	// A grid of vertices in [-1, 1], drawn as an indexed list with two triangles per cell
+	Mesh createGrid(float4 *positions, float4 *colors)
+	{
+		for(int y = 0; y < gridSize; y++)
+		{
+			for(int x = 0; x < gridSize; x++)
+			{
+				float u = (float)x / (gridSize - 1);
+				float v = (float)y / (gridSize - 1);
+
+				positions[y * gridSize + x] = vector(u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.5f, 1.0f);
+				colors[y * gridSize + x] = vector(u, v, 0.5f, 1.0f);
+			}
+		}
+
+		Mesh mesh = {"indexed", positions, colors};
+
+		for(int y = 0; y < gridSize - 1; y++)
+		{
+			for(int x = 0; x < gridSize - 1; x++)
+			{
+				unsigned int i = y * gridSize + x;
+				unsigned int quad[6] = {i, i + 1, i + gridSize, i + gridSize, i + 1, i + gridSize + 1};
+
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+
+		return mesh;
+	}
+
+	// The same triangles with their vertices expanded, drawn as a non-indexed list
+	Mesh expand(const Mesh &grid, float4 *positions, float4 *colors)
+	{
+		Mesh mesh = {"list", positions, colors};
+
+		for(size_t i = 0; i < grid.indices.size(); i++)
+		{
+			positions[i] = grid.positions[grid.indices[i]];
+			colors[i] = grid.colors[grid.indices[i]];
+			mesh.indices.push_back((unsigned int)i);
+		}
+
+		return mesh;
+	}
+
+	// Returns the best time per frame
+	double run(Routine *routine, const Mesh &mesh, DrawData *data, VertexTask *task, Triangle *output)
+	{
+		VertexProcessor::RoutinePointer shade = (VertexProcessor::RoutinePointer)routine->getEntry();
+		int triangleCount = (int)mesh.indices.size() / 3;
+		unsigned int batch[batchTriangles][3];
+
+		data->input[0] = mesh.positions;
+		data->input[1] = mesh.colors;
+
+		return bestTime([&]()
+		{
+			task->vertexCache.clear();
+
+			for(int first = 0; first < triangleCount; first += batchTriangles)
+			{
+				int count = triangleCount - first < batchTriangles ? triangleCount - first : batchTriangles;
+
+				memcpy(batch, &mesh.indices[first * 3], count * 3 * sizeof(unsigned int));
+
+				task->primitiveStart = first;
+				task->vertexCount = count * 3;
+				shade(&output[first].v0, &batch[0][0], task, data);
+			}
+		});
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const int vertexCount = gridSize * gridSize;
+	const int indexCount = (gridSize - 1) * (gridSize - 1) * 6;
+
+	float4 *gridPositions = new float4[vertexCount];
+	float4 *gridColors = new float4[vertexCount];
+	float4 *listPositions = new float4[indexCount + 3];   // Cache lines of four vertices can extend past the last index
+	float4 *listColors = new float4[indexCount + 3];
+
+	Mesh grid = createGrid(gridPositions, gridColors);
+	const Mesh meshes[] = {expand(grid, listPositions, listColors), grid};
+
+	DrawData *data = createDrawData();
+	data->stride[0] = sizeof(float4);
+	data->stride[1] = sizeof(float4);
+
+	// Rotation about the z axis, and a 1024x1024 viewport
+	data->vs.c[0] = vector(0.8f, -0.6f, 0.0f, 0.0f);
+	data->vs.c[1] = vector(0.6f, 0.8f, 0.0f, 0.0f);
+	data->vs.c[2] = vector(0.0f, 0.0f, 1.0f, 0.0f);
+	data->vs.c[3] = vector(0.0f, 0.0f, 0.0f, 1.0f);
+	data->Wx16 = replicate(512.0f * 16);
+	data->Hx16 = replicate(-512.0f * 16);
+	data->X0x16 = replicate(512.0f * 16);
+	data->Y0x16 = replicate(512.0f * 16);
+	data->halfPixelX = replicate(0.5f / 512.0f);
+	data->halfPixelY = replicate(0.5f / 512.0f);
+
+	VertexTask *task = (VertexTask*)allocate(sizeof(VertexTask));
+	Triangle *output = (Triangle*)allocate(indexCount / 3 * sizeof(Triangle));
+
+	std::vector<Program<VertexShader>> programs = createPrograms(createShader);
+
+	printf("%-8s %-8s %10s\n", "shader", "mesh", "Mvtx/s");
+
+	for(const Program<VertexShader> &program : programs)
+	{
+		for(const Mesh &mesh : meshes)
+		{
+			Routine *routine = generate(program.shader);
+
+			double time = run(routine, mesh, data, task, output);
+			double vertices = (double)mesh.indices.size() * 1.0e-6;
+
+			printf("%-8s %-8s %10.1f\n", program.name, mesh.name, vertices / time);
+
+			delete routine;
+		}
+	}
+
+	deletePrograms(programs);
+
+	deallocate(output);
+	deallocate(task);
+	destroyDrawData(data);
+
+	delete[] gridPositions;
+	delete[] gridColors;
+	delete[] listPositions;
+	delete[] listColors;
+
+	return 0;
+}
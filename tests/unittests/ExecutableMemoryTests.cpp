@@ -0,0 +1,77 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests the executable memory arena. Routines are packed at cache line
+// granularity, written through one view of a slab and run from another.
+
+#include "Common/Memory.hpp"
+
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <string.h>
+
+using namespace sw;
+
+TEST(ExecutableMemory, PacksRoutinesAtCacheLineGranularity)
+{
+	ExecutableMemoryStatistics before = executableMemoryStatistics();
+
+	void *first = allocateExecutable(10);
+	void *second = allocateExecutable(70);
+	void *third = allocateExecutable(1);
+
+	EXPECT_EQ(0u, (uintptr_t)first % 64);
+	EXPECT_EQ(0u, (uintptr_t)second % 64);
+	EXPECT_EQ(0u, (uintptr_t)third % 64);
+
+	ExecutableMemoryStatistics during = executableMemoryStatistics();
+	EXPECT_EQ(before.liveBytes + 64 + 128 + 64, during.liveBytes);
+	EXPECT_EQ(before.liveAllocations + 3, during.liveAllocations);
+
+	deallocateExecutable(third);
+	deallocateExecutable(second);
+	deallocateExecutable(first);
+
+	ExecutableMemoryStatistics after = executableMemoryStatistics();
+	EXPECT_EQ(before.liveBytes, after.liveBytes);
+	EXPECT_EQ(before.liveAllocations, after.liveAllocations);
+}
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+TEST(ExecutableMemory, RunsFromExecutableAddress)
+{
+	const unsigned char returns42[] = {0xB8, 42, 0, 0, 0, 0xC3};   // mov eax, 42; ret
+	const unsigned char returns7[] = {0xB8, 7, 0, 0, 0, 0xC3};     // mov eax, 7; ret
+
+	void *first = allocateExecutable(sizeof(returns42));
+	memcpy(first, returns42, sizeof(returns42));
+	markExecutable(first);
+
+	// A routine written next to one which already runs
+	void *second = allocateExecutable(sizeof(returns7));
+	memcpy(second, returns7, sizeof(returns7));
+	markExecutable(second);
+
+	int (*function42)() = (int(*)())executableAddress(first);
+	int (*function7)() = (int(*)())executableAddress(second);
+
+	EXPECT_NE((void*)function42, first);
+	EXPECT_EQ(42, function42());
+	EXPECT_EQ(7, function7());
+
+	deallocateExecutable(second);
+	deallocateExecutable(first);
+}
+#endif
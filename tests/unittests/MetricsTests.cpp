@@ -0,0 +1,224 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests the metrics exporter by scraping it over HTTP on the loopback
+// interface, and checks that the page is in the Prometheus text format.
+
+#include "Common/Metrics.hpp"
+#include "Common/Socket.hpp"
+#include "Common/Thread.hpp"
+#include "Common/Timer.hpp"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+
+using namespace sw;
+
+namespace
+{
+	const char *port = "48731";
+	const double connectTimeout = 10;   // Seconds, for the exporter thread to start listening
+
+	// Returns the whole response, or an empty string when the exporter can't be reached
+	std::string get(const char *path, const char *service = port)
+	{
+		Socket::startup();
+
+		Socket *socket = nullptr;
+		double start = Timer::seconds();
+
+		for(;;)
+		{
+			socket = Socket::connect("127.0.0.1", service);
+
+			if(socket->isValid() || Timer::seconds() - start > connectTimeout)
+			{
+				break;
+			}
+
+			delete socket;
+			Thread::sleep(10);
+		}
+
+		std::string response;
+
+		if(socket->isValid())
+		{
+			std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+			socket->send(request.c_str(), (int)request.size());
+
+			// The exporter closes the connection after responding
+			char buffer[4096];
+
+			while(socket->select(1000000))
+			{
+				int length = socket->receive(buffer, sizeof(buffer));
+
+				if(length <= 0)
+				{
+					break;
+				}
+
+				response.append(buffer, length);
+			}
+		}
+
+		delete socket;
+		Socket::cleanup();
+
+		return response;
+	}
+
+	bool isName(const std::string &name)
+	{
+		if(name.empty())
+		{
+			return false;
+		}
+
+		for(char c : name)
+		{
+			if(!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_'))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Checks one line of the exposition format: comments with HELP or TYPE, or a sample
+	::testing::AssertionResult isMetricLine(const std::string &line)
+	{
+		std::istringstream stream(line);
+		std::string first;
+		stream >> first;
+
+		if(first == "#")
+		{
+			std::string keyword, name, type;
+			stream >> keyword >> name;
+
+			if(keyword == "HELP" && isName(name))
+			{
+				return ::testing::AssertionSuccess();
+			}
+
+			if(keyword == "TYPE" && isName(name) && (stream >> type) && (type == "counter" || type == "gauge"))
+			{
+				return ::testing::AssertionSuccess();
+			}
+
+			return ::testing::AssertionFailure() << "Bad comment: " << line;
+		}
+
+		size_t labels = first.find('{');
+		std::string name = first.substr(0, labels);
+
+		if(!isName(name) || (labels != std::string::npos && first.back() != '}'))
+		{
+			return ::testing::AssertionFailure() << "Bad metric name: " << line;
+		}
+
+		double value;
+		std::string rest;
+
+		if(!(stream >> value) || (stream >> rest))
+		{
+			return ::testing::AssertionFailure() << "Bad value: " << line;
+		}
+
+		return ::testing::AssertionSuccess();
+	}
+}
+
+TEST(Metrics, ServesTextFormatOnLocalhost)
+{
+	Metrics::start(port);
+	Metrics::add(Metrics::DRAWS, 3);
+	Metrics::add(Metrics::FRAMES);
+
+	std::string response = get("/metrics");
+	ASSERT_FALSE(response.empty()) << "Cannot connect to 127.0.0.1:" << port;
+
+	size_t headerEnd = response.find("\r\n\r\n");
+	ASSERT_NE(std::string::npos, headerEnd);
+
+	std::string header = response.substr(0, headerEnd);
+	std::string body = response.substr(headerEnd + 4);
+
+	EXPECT_EQ(0u, header.find("HTTP/1.1 200 OK\r\n"));
+	EXPECT_NE(std::string::npos, header.find("Content-Type: text/plain; version=0.0.4\r\n"));
+	EXPECT_NE(std::string::npos, header.find("Content-Length: " + std::to_string(body.size()) + "\r\n"));
+
+	// Every line is terminated, including the last one
+	ASSERT_FALSE(body.empty());
+	EXPECT_EQ('\n', body.back());
+
+	std::istringstream lines(body);
+	std::string line;
+
+	while(std::getline(lines, line))
+	{
+		EXPECT_TRUE(isMetricLine(line));
+	}
+
+	EXPECT_NE(std::string::npos, body.find("# TYPE swiftshader_draws_total counter\n"));
+	EXPECT_NE(std::string::npos, body.find("# TYPE swiftshader_frames_total counter\n"));
+	EXPECT_NE(std::string::npos, body.find("# TYPE swiftshader_routine_cache_hits_total counter\n"));
+	EXPECT_NE(std::string::npos, body.find("swiftshader_routine_cache_hits_total{cache=\"pixel\"} "));
+	EXPECT_NE(std::string::npos, body.find("# TYPE swiftshader_jit_memory_bytes gauge\n"));
+	EXPECT_NE(std::string::npos, body.find("# TYPE swiftshader_uptime_seconds gauge\n"));
+
+	// Other tests in the process may draw too, so the counters are at least what was added
+	size_t draws = body.find("\nswiftshader_draws_total ");
+	ASSERT_NE(std::string::npos, draws);
+	EXPECT_GE(std::stoll(body.substr(draws + 25)), 3);
+
+	Metrics::stop();
+}
+
+TEST(Metrics, RejectsOtherPaths)
+{
+	Metrics::start(port);
+
+	std::string response = get("/");
+	ASSERT_FALSE(response.empty()) << "Cannot connect to 127.0.0.1:" << port;
+
+	EXPECT_EQ(0u, response.find("HTTP/1.1 404 Not Found\r\n"));
+
+	Metrics::stop();
+}
+
+TEST(Metrics, ServesOnConfiguredAddress)
+{
+	const char *otherPort = "48732";
+
+	Metrics::start("127.0.0.1:48732");
+
+	std::string response = get("/metrics", otherPort);
+	ASSERT_FALSE(response.empty()) << "Cannot connect to 127.0.0.1:" << otherPort;
+	EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+
+	// The last stop joins the exporter, which closes the port
+	Metrics::stop();
+
+	Socket::startup();
+	Socket *socket = Socket::connect("127.0.0.1", otherPort);
+	EXPECT_FALSE(socket->isValid());
+	delete socket;
+	Socket::cleanup();
+}
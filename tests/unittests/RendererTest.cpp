@@ -0,0 +1,149 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RendererTest.hpp"
+
+#include "Renderer/Context.hpp"
+#include "Renderer/Surface.hpp"
+#include "Renderer/Stream.hpp"
+#include "Shader/VertexShader.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Common/Resource.hpp"
+
+#include <string.h>
+
+using namespace sw;
+
+namespace
+{
+	Shader::Instruction *move(Shader::ParameterType dstType, Shader::ParameterType srcType)
+	{
+		Shader::Instruction *mov = new Shader::Instruction(Shader::OPCODE_MOV);
+		mov->dst.type = dstType;
+		mov->dst.index = 0;
+		mov->dst.mask = 0xF;
+		mov->src[0].type = srcType;
+		mov->src[0].index = 0;
+		mov->src[0].swizzle = 0xE4;
+
+		return mov;
+	}
+}
+
+void RendererTest::SetUp()
+{
+	context = new Context();
+	renderer = new Renderer(context, OpenGL, true);
+
+	target = new Surface(nullptr, WIDTH, HEIGHT, 1, FORMAT_A8R8G8B8, true, true);
+	renderer->setRenderTarget(0, target);
+	clearPixels();
+
+	Viewport viewport = {0, 0, WIDTH, HEIGHT, 0, 1};
+	renderer->setViewport(viewport);
+	renderer->setScissor(Rect(0, 0, WIDTH, HEIGHT));
+
+	renderer->setDepthBufferEnable(false);
+	renderer->setCullMode(CULL_NONE);
+	renderer->setAlphaBlendEnable(true);
+	renderer->setSourceBlendFactor(BLEND_ONE);
+	renderer->setDestBlendFactor(BLEND_ONE);
+
+	// Passes the position through, and writes c0
+	VertexShader vertex;
+	vertex.setInput(0, Shader::Semantic(Shader::USAGE_POSITION, 0));
+	vertex.setOutput(0, 4, Shader::Semantic(Shader::USAGE_POSITION, 0));
+	vertex.setPositionRegister(0);
+	vertex.append(move(Shader::PARAMETER_OUTPUT, Shader::PARAMETER_INPUT));
+	vertexShader = new VertexShader(&vertex);
+
+	PixelShader pixel;
+	pixel.append(move(Shader::PARAMETER_COLOROUT, Shader::PARAMETER_CONST));
+	pixelShader = new PixelShader(&pixel);
+
+	renderer->setVertexShader(vertexShader);
+	renderer->setPixelShader(pixelShader);
+
+	setColor(1.0f / 255, 1.0f / 255, 1.0f / 255, 1.0f / 255);
+}
+
+void RendererTest::TearDown()
+{
+	finish();
+
+	delete renderer;
+	delete context;
+	delete target;
+	delete vertexShader;
+	delete pixelShader;
+}
+
+void RendererTest::setColor(float r, float g, float b, float a)
+{
+	const float color[4] = {r, g, b, a};
+	renderer->setPixelShaderConstantF(0, color);
+}
+
+void RendererTest::draw(const std::vector<float4> &positions)
+{
+	Resource *buffer = new Resource(positions.size() * sizeof(float4));
+	memcpy(const_cast<void*>(buffer->data()), positions.data(), positions.size() * sizeof(float4));
+	vertexBuffers.push_back(buffer);
+
+	renderer->setInputStream(0, Stream(buffer, buffer->data(), sizeof(float4)).define(STREAMTYPE_FLOAT, 4));
+	renderer->draw(DRAW_TRIANGLELIST, 0, (unsigned int)positions.size() / 3);
+}
+
+void RendererTest::finish()
+{
+	renderer->synchronize();
+
+	for(Resource *buffer : vertexBuffers)
+	{
+		buffer->destruct();
+	}
+
+	vertexBuffers.clear();
+}
+
+std::vector<unsigned int> RendererTest::readPixels()
+{
+	finish();
+
+	std::vector<unsigned int> pixels(WIDTH * HEIGHT);
+	const unsigned char *buffer = (const unsigned char*)target->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+
+	for(int y = 0; y < HEIGHT; y++)
+	{
+		memcpy(&pixels[y * WIDTH], buffer + y * target->getInternalPitchB(), WIDTH * sizeof(unsigned int));
+	}
+
+	target->unlockInternal();
+
+	return pixels;
+}
+
+void RendererTest::clearPixels()
+{
+	finish();
+
+	unsigned char *buffer = (unsigned char*)target->lockInternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+	for(int y = 0; y < HEIGHT; y++)
+	{
+		memset(buffer + y * target->getInternalPitchB(), 0, WIDTH * sizeof(unsigned int));
+	}
+
+	target->unlockInternal();
+}
@@ -0,0 +1,54 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RendererTest_hpp
+#define RendererTest_hpp
+
+#include "Renderer/Renderer.hpp"
+#include "Common/Types.hpp"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+// Draws triangles with a sw::Renderer into a color target. Vertices are clip space
+// positions, and each pixel a triangle covers adds the constant color to the target,
+// so the red channel counts how often it was drawn.
+class RendererTest : public testing::Test
+{
+protected:
+	enum {WIDTH = 64, HEIGHT = 64};
+
+	void SetUp() override;
+	void TearDown() override;
+
+	void setColor(float r, float g, float b, float a);   // Default is 1/255 in each channel
+	void draw(const std::vector<sw::float4> &positions);   // A triangle list
+	void finish();   // Waits for the draws to complete
+
+	// Colors of the target, rows bottom first
+	std::vector<unsigned int> readPixels();
+	void clearPixels();
+
+	sw::Context *context;
+	sw::Renderer *renderer;
+	sw::Surface *target;
+	sw::VertexShader *vertexShader;
+	sw::PixelShader *pixelShader;
+
+private:
+	std::vector<sw::Resource*> vertexBuffers;   // Of the draws since the last finish
+};
+
+#endif   // RendererTest_hpp
@@ -0,0 +1,247 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that the texture size constants, which Sampler sets up for every
+// format since seamless cube maps need them, leave non-float formats filtered
+// as before outside the seamless cube map path.
+
+#include "Renderer/Sampler.hpp"
+#include "Renderer/Surface.hpp"
+#include "Shader/SamplerCore.hpp"
+#include "Shader/Constants.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include "gtest/gtest.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+
+namespace sw
+{
+	extern bool adaptiveAnisotropy;
+}
+
+namespace
+{
+	typedef void (*SampleFunction)(const void *texture, const void *constants, const float *coordinates, float *output);
+
+	// Samples a quad of u, v coordinates, stored as rows of four, and writes r, g, b and a rows of four
+	Routine *generate(const Sampler::State &state)
+	{
+		Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
+		{
+			Pointer<Byte> texture = function.Arg<0>();
+			Pointer<Byte> constants = function.Arg<1>();
+			Pointer<Byte> coordinates = function.Arg<2>();
+			Pointer<Byte> output = function.Arg<3>();
+
+			SamplerCore sampler(constants, state);
+
+			Float4 u = *Pointer<Float4>(coordinates + 0);
+			Float4 v = *Pointer<Float4>(coordinates + 16);
+			Float4 w = Float4(0.0f);
+			Float4 q = Float4(0.0f);
+			Vector4f dsx;
+			Vector4f dsy;
+			Vector4f offset;
+			Vector4f c;
+
+			dsx.x = dsx.y = dsx.z = Float4(0.0f);
+			dsy.x = dsy.y = dsy.z = Float4(0.0f);
+
+			sampler.sampleTexture(texture, c, u, v, w, q, dsx, dsy, offset, Implicit);
+
+			*Pointer<Float4>(output + 0) = c.x;
+			*Pointer<Float4>(output + 16) = c.y;
+			*Pointer<Float4>(output + 32) = c.z;
+			*Pointer<Float4>(output + 48) = c.w;
+
+			Return();
+		}
+
+		return function(L"SamplerTest");
+	}
+
+	// Red ramps along x and green along y, in steps of 64
+	unsigned char texelRed(int x) { return (unsigned char)(x * 64); }
+	unsigned char texelGreen(int y) { return (unsigned char)(y * 64); }
+
+	Surface *createRamp(int size)
+	{
+		Surface *surface = new Surface(nullptr, size, size, 1, FORMAT_A8B8G8R8, true, false);
+		unsigned char *buffer = (unsigned char*)surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+		for(int y = 0; y < size; y++)
+		{
+			for(int x = 0; x < size; x++)
+			{
+				unsigned char *texel = buffer + y * surface->getExternalPitchB() + x * 4;
+				texel[0] = texelRed(x);
+				texel[1] = texelGreen(y);
+				texel[2] = 0;
+				texel[3] = 0xFF;
+			}
+		}
+
+		surface->unlockExternal();
+
+		return surface;
+	}
+
+	Surface *createConstant(int size, unsigned char value)
+	{
+		Surface *surface = new Surface(nullptr, size, size, 1, FORMAT_A8B8G8R8, true, false);
+		unsigned char *buffer = (unsigned char*)surface->lockExternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+		for(int y = 0; y < size; y++)
+		{
+			memset(buffer + y * surface->getExternalPitchB(), value, size * 4);
+		}
+
+		surface->unlockExternal();
+
+		return surface;
+	}
+}
+
+TEST(Sampler, SeamlessOnlyAppliesToFilteredCubeMaps)
+{
+	Surface *surface = createRamp(4);
+
+	Sampler sampler;
+	sampler.setTextureFilter(FILTER_LINEAR);
+	sampler.setSeamlessCubeMap(true);
+	sampler.setTextureLevel(0, 0, surface, TEXTURE_2D);
+
+	EXPECT_FALSE(sampler.samplerState().seamlessCube);
+
+	for(int face = 0; face < 6; face++)
+	{
+		sampler.setTextureLevel(face, 0, surface, TEXTURE_CUBE);
+	}
+
+	EXPECT_TRUE(sampler.samplerState().seamlessCube);
+
+	sampler.setTextureFilter(FILTER_POINT);
+	EXPECT_FALSE(sampler.samplerState().seamlessCube);
+
+	delete surface;
+}
+
+TEST(Sampler, FiltersNonFloatTexturesAsBefore)
+{
+	const int size = 4;
+	Surface *surface = createRamp(size);
+
+	Sampler sampler;
+	sampler.setTextureFilter(FILTER_LINEAR);
+	sampler.setMipmapFilter(MIPMAP_NONE);
+	sampler.setAddressingModeU(ADDRESSING_CLAMP);
+	sampler.setAddressingModeV(ADDRESSING_CLAMP);
+	sampler.setSeamlessCubeMap(true);   // Ignored by 2D textures
+	sampler.setTextureLevel(0, 0, surface, TEXTURE_2D);
+
+	Sampler::State state = sampler.samplerState();
+	ASSERT_FALSE(state.seamlessCube);
+
+	Routine *routine = generate(state);
+	SampleFunction sample = (SampleFunction)routine->getEntry();
+
+	Texture *texture = (Texture*)allocate(sizeof(Texture));
+	memcpy(texture, &sampler.getTextureData(), sizeof(Texture));
+
+	// A texel center, halfway between two texels in x, in y, and in both
+	const float texelX[4] = {1.0f, 1.5f, 2.0f, 2.5f};
+	const float texelY[4] = {1.0f, 2.0f, 2.5f, 1.5f};
+
+	float coordinates[8];
+	for(int i = 0; i < 4; i++)
+	{
+		coordinates[0 + i] = (texelX[i] + 0.5f) / size;
+		coordinates[4 + i] = (texelY[i] + 0.5f) / size;
+	}
+
+	float output[16];
+	sample(texture, &constants, coordinates, output);
+
+	for(int i = 0; i < 4; i++)
+	{
+		int x0 = (int)texelX[i];
+		int y0 = (int)texelY[i];
+		float fx = texelX[i] - x0;
+		float fy = texelY[i] - y0;
+
+		float red = ((1 - fx) * texelRed(x0) + fx * texelRed(x0 + 1)) / 255.0f;
+		float green = ((1 - fy) * texelGreen(y0) + fy * texelGreen(y0 + 1)) / 255.0f;
+
+		EXPECT_NEAR(red, output[0 + i], 2.0f / 255.0f);
+		EXPECT_NEAR(green, output[4 + i], 2.0f / 255.0f);
+		EXPECT_NEAR(0.0f, output[8 + i], 1.0f / 255.0f);
+		EXPECT_NEAR(1.0f, output[12 + i], 1.0f / 255.0f);
+	}
+
+	deallocate(texture);
+	delete routine;
+	delete surface;
+}
+
+TEST(Sampler, AdaptiveAnisotropyWeightsEachPixel)
+{
+	const unsigned char value = 0x80;
+	Surface *levels[2] = {createConstant(16, value), createConstant(8, value)};
+
+	Sampler::setFilterQuality(FILTER_ANISOTROPIC);
+	adaptiveAnisotropy = true;
+
+	Sampler sampler;
+	sampler.setTextureFilter(FILTER_ANISOTROPIC);
+	sampler.setMipmapFilter(MIPMAP_LINEAR);
+	sampler.setMaxAnisotropy(16.0f);
+	sampler.setTextureLevel(0, 0, levels[0], TEXTURE_2D);
+	sampler.setTextureLevel(0, 1, levels[1], TEXTURE_2D);
+
+	Sampler::State state = sampler.samplerState();
+	ASSERT_TRUE(state.adaptiveAnisotropy);
+
+	Routine *routine = generate(state);
+	SampleFunction sample = (SampleFunction)routine->getEntry();
+
+	Texture *texture = (Texture*)allocate(sizeof(Texture));
+	memcpy(texture, &sampler.getTextureData(), sizeof(Texture));
+
+	// The top row of the quad is stretched twice as much as the bottom row,
+	// so its pixels take more taps. Each pixel's weights must still add up to one.
+	const float coordinates[8] = {0.25f, 0.75f, 0.25f, 0.5f,
+	                              0.5f, 0.52f, 0.51f, 0.53f};
+
+	float output[16];
+	sample(texture, &constants, coordinates, output);
+
+	for(int i = 0; i < 16; i++)
+	{
+		EXPECT_NEAR(value / 255.0f, output[i], 2.0f / 255.0f);
+	}
+
+	adaptiveAnisotropy = false;
+	Sampler::setFilterQuality(FILTER_LINEAR);
+
+	deallocate(texture);
+	delete routine;
+	delete levels[0];
+	delete levels[1];
+}
@@ -0,0 +1,79 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that shader copies, which routines are compiled from in the background
+// and which replayed captures are built with, keep the version and type of the
+// shader they copy. The pixel pipeline and the shader analysis both depend on
+// the version, so a ps_1_x copy must not be treated as ps_3_0.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Shader/PixelShader.hpp"
+#include "Shader/VertexShader.hpp"
+#include "Renderer/Vertex.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	template<class ShaderType>
+	class VersionedShader : public ShaderType
+	{
+	public:
+		explicit VersionedShader(unsigned short shaderVersion)
+		{
+			this->version = shaderVersion;
+		}
+	};
+}
+
+TEST(ShaderCopy, PixelShaderKeepsVersion)
+{
+	const unsigned short versions[] = {0x0101, 0x0104, 0x0200, 0x0300};
+
+	for(unsigned short version : versions)
+	{
+		VersionedShader<PixelShader> shader(version);
+		shader.setInput(0, 4, Shader::Semantic(Shader::USAGE_COLOR, 0));
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_TEMP, 0), source(Shader::PARAMETER_INPUT, 0)));
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_COLOROUT, 0), source(Shader::PARAMETER_TEMP, 0)));
+
+		PixelShader copy(&shader);
+
+		EXPECT_EQ(version, copy.getVersion());
+		EXPECT_EQ(Shader::SHADER_PIXEL, copy.getShaderType());
+	}
+}
+
+TEST(ShaderCopy, VertexShaderKeepsVersion)
+{
+	const unsigned short versions[] = {0x0101, 0x0200, 0x0300};
+
+	for(unsigned short version : versions)
+	{
+		VersionedShader<VertexShader> shader(version);
+		shader.setInput(0, Shader::Semantic(Shader::USAGE_POSITION, 0));
+		shader.setOutput(Pos, 4, Shader::Semantic(Shader::USAGE_POSITION, 0));
+		shader.setPositionRegister(Pos);
+		shader.append(instruction(Shader::OPCODE_MOV, destination(Shader::PARAMETER_OUTPUT, Pos), source(Shader::PARAMETER_INPUT, 0)));
+
+		VertexShader copy(&shader);
+
+		EXPECT_EQ(version, copy.getVersion());
+		EXPECT_EQ(Shader::SHADER_VERTEX, copy.getShaderType());
+	}
+}
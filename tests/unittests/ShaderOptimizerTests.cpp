@@ -0,0 +1,590 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests of the shader instruction optimizations. Each pass is checked on small
+// instruction sequences, and a corpus of pixel shaders using control flow,
+// subroutines and dynamic indexing is rendered with and without optimizations
+// to check that they produce the same colors.
+
+#include "Benchmark/Benchmark.hpp"
+
+#include "Renderer/Renderer.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/Primitive.hpp"
+#include "Shader/PixelProgram.hpp"
+#include "Shader/PixelShader.hpp"
+#include "Reactor/Reactor.hpp"
+#include "Common/Memory.hpp"
+
+#include "gtest/gtest.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace sw
+{
+	extern bool shaderOptimizations;
+}
+
+using namespace sw;
+using namespace benchmark;
+
+namespace
+{
+	// Exposes the individual passes, which optimize() otherwise runs to a fixed point
+	class TestShader : public PixelShader
+	{
+	public:
+		TestShader()
+		{
+			setInput(0, 4, Shader::Semantic(Shader::USAGE_TEXCOORD, 0));
+		}
+
+		void setVersion(unsigned short shaderVersion)
+		{
+			version = shaderVersion;
+		}
+
+		using Shader::optimizeConstants;
+		using Shader::optimizeCopies;
+		using Shader::optimizeRedundancy;
+		using Shader::optimizeDeadCode;
+		using Shader::removeNull;
+	};
+
+	Shader::DestinationParameter r(int index, int mask = 0xF)
+	{
+		return destination(Shader::PARAMETER_TEMP, index, mask);
+	}
+
+	const Shader::DestinationParameter oC0 = destination(Shader::PARAMETER_COLOROUT, 0);
+
+	Shader::SourceParameter negate(Shader::SourceParameter src)
+	{
+		src.modifier = Shader::MODIFIER_NEGATE;
+
+		return src;
+	}
+
+	Shader::SourceParameter swizzle(Shader::SourceParameter src, int swizzle)
+	{
+		src.swizzle = swizzle;
+
+		return src;
+	}
+
+	const Shader::SourceParameter v0 = source(Shader::PARAMETER_INPUT, 0);
+	const Shader::SourceParameter c0 = source(Shader::PARAMETER_CONST, 0);
+	const Shader::SourceParameter c1 = source(Shader::PARAMETER_CONST, 1);
+	const Shader::SourceParameter s0 = source(Shader::PARAMETER_SAMPLER, 0);
+
+	Shader::SourceParameter t(int index, int swizzle = 0xE4)
+	{
+		return source(Shader::PARAMETER_TEMP, index, swizzle);
+	}
+
+	Shader::Instruction *label(Shader::Opcode opcode, int index)
+	{
+		Shader::DestinationParameter dst;
+		dst.type = Shader::PARAMETER_LABEL;
+		dst.index = index;
+
+		return instruction(opcode, dst);
+	}
+
+	// Writes r[c1.x + index], with c1.x holding an integer
+	Shader::DestinationParameter indexed(int index)
+	{
+		Shader::DestinationParameter dst = r(index);
+		dst.rel.type = Shader::PARAMETER_CONST;
+		dst.rel.index = 1;
+		dst.rel.scale = 1;
+		dst.rel.deterministic = true;
+
+		return dst;
+	}
+
+	Shader::Instruction *compare(Shader::Control control, const Shader::DestinationParameter &dst, const Shader::SourceParameter &src0, const Shader::SourceParameter &src1)
+	{
+		Shader::Instruction *cmp = instruction(Shader::OPCODE_CMP, dst, src0, src1);
+		cmp->control = control;
+
+		return cmp;
+	}
+}
+
+TEST(ShaderOptimizer, FoldsConstants)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MAD, r(0), literal(1, 2, 3, 4), literal(2, 2, 2, 2), negate(literal(1, 1, 1, 1))));
+	shader.append(instruction(Shader::OPCODE_ADD, r(1), swizzle(literal(1, 2, 3, 4), 0x1B), literal(0.5f, 0.5f, 0.5f, 0.5f)));   // wzyx
+
+	EXPECT_TRUE(shader.optimizeConstants());
+
+	const Shader::Instruction *mad = shader.getInstruction(0);
+	EXPECT_EQ(Shader::OPCODE_MOV, mad->opcode);
+	EXPECT_EQ(Shader::PARAMETER_FLOAT4LITERAL, mad->src[0].type);
+	EXPECT_EQ(Shader::PARAMETER_VOID, mad->src[1].type);
+	EXPECT_EQ(Shader::PARAMETER_VOID, mad->src[2].type);
+	EXPECT_EQ(1.0f, mad->src[0].value[0]);
+	EXPECT_EQ(3.0f, mad->src[0].value[1]);
+	EXPECT_EQ(5.0f, mad->src[0].value[2]);
+	EXPECT_EQ(7.0f, mad->src[0].value[3]);
+
+	const Shader::Instruction *add = shader.getInstruction(1);
+	EXPECT_EQ(Shader::OPCODE_MOV, add->opcode);
+	EXPECT_EQ(4.5f, add->src[0].value[0]);
+	EXPECT_EQ(3.5f, add->src[0].value[1]);
+	EXPECT_EQ(2.5f, add->src[0].value[2]);
+	EXPECT_EQ(1.5f, add->src[0].value[3]);
+}
+
+TEST(ShaderOptimizer, KeepsNonLiteralAndModifiedArithmetic)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_ADD, r(0), v0, literal(1, 1, 1, 1)));
+
+	Shader::Instruction *saturated = instruction(Shader::OPCODE_MUL, r(1), literal(2, 2, 2, 2), literal(1, 1, 1, 1));
+	saturated->dst.saturate = true;
+	shader.append(saturated);
+
+	Shader::Instruction *predicated = instruction(Shader::OPCODE_ADD, r(2), literal(2, 2, 2, 2), literal(1, 1, 1, 1));
+	predicated->predicate = true;
+	shader.append(predicated);
+
+	EXPECT_FALSE(shader.optimizeConstants());
+	EXPECT_EQ(Shader::OPCODE_ADD, shader.getInstruction(0)->opcode);
+	EXPECT_EQ(Shader::OPCODE_MUL, shader.getInstruction(1)->opcode);
+	EXPECT_EQ(Shader::OPCODE_ADD, shader.getInstruction(2)->opcode);
+}
+
+TEST(ShaderOptimizer, PropagatesCopies)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MOV, r(1), swizzle(v0, 0x1B)));   // wzyx
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), t(1, 0x00), c0));        // xxxx
+	shader.append(instruction(Shader::OPCODE_MOV, r(3), negate(c0)));
+	shader.append(instruction(Shader::OPCODE_MUL, r(4), t(3), t(1)));
+
+	EXPECT_TRUE(shader.optimizeCopies());
+
+	const Shader::Instruction *add = shader.getInstruction(1);
+	EXPECT_EQ(Shader::PARAMETER_INPUT, add->src[0].type);
+	EXPECT_EQ(0u, add->src[0].index);
+	EXPECT_EQ(0xFFu, add->src[0].swizzle);   // wwww
+
+	const Shader::Instruction *mul = shader.getInstruction(3);
+	EXPECT_EQ(Shader::PARAMETER_CONST, mul->src[0].type);
+	EXPECT_EQ(Shader::MODIFIER_NEGATE, mul->src[0].modifier);
+	EXPECT_EQ(Shader::PARAMETER_INPUT, mul->src[1].type);
+	EXPECT_EQ(0x1Bu, mul->src[1].swizzle);
+}
+
+TEST(ShaderOptimizer, CopiesStopAtOverwrites)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MOV, r(1), t(3)));
+	shader.append(instruction(Shader::OPCODE_ADD, r(3), t(3), c0));   // Overwrites the copy's source
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), t(1), c0));
+	shader.append(instruction(Shader::OPCODE_MOV, r(4), v0));
+	shader.append(instruction(Shader::OPCODE_MOV, r(4, 0x1), c1));   // Overwrites part of the copy
+	shader.append(instruction(Shader::OPCODE_ADD, r(5), t(4), c0));
+
+	EXPECT_FALSE(shader.optimizeCopies());
+	EXPECT_EQ(Shader::PARAMETER_TEMP, shader.getInstruction(2)->src[0].type);
+	EXPECT_EQ(1u, shader.getInstruction(2)->src[0].index);
+	EXPECT_EQ(Shader::PARAMETER_TEMP, shader.getInstruction(5)->src[0].type);
+	EXPECT_EQ(4u, shader.getInstruction(5)->src[0].index);
+}
+
+TEST(ShaderOptimizer, CopiesDoNotCrossControlFlow)
+{
+	TestShader shader;
+	shader.append(compare(Shader::CONTROL_LT, r(0, 0x1), v0, c0));
+	shader.append(instruction(Shader::OPCODE_MOV, r(1), v0));
+	shader.append(instruction(Shader::OPCODE_IF, Shader::DestinationParameter(), t(0, 0x00)));
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), t(1), c0));
+	shader.append(instruction(Shader::OPCODE_ENDIF, Shader::DestinationParameter()));
+	shader.append(instruction(Shader::OPCODE_MOV, r(3), v0));
+	shader.append(label(Shader::OPCODE_CALL, 1));   // The subroutine may write r3
+	shader.append(instruction(Shader::OPCODE_ADD, r(4), t(3), c0));
+
+	EXPECT_FALSE(shader.optimizeCopies());
+	EXPECT_EQ(Shader::PARAMETER_TEMP, shader.getInstruction(3)->src[0].type);
+	EXPECT_EQ(Shader::PARAMETER_TEMP, shader.getInstruction(7)->src[0].type);
+}
+
+TEST(ShaderOptimizer, RemovesRedundantInstructions)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), v0, c0));
+	shader.append(instruction(Shader::OPCODE_MUL, r(2, 0x3), v0, c0));   // Subset of the components
+	shader.append(instruction(Shader::OPCODE_TEX, r(3), v0, s0));
+	shader.append(instruction(Shader::OPCODE_TEX, r(4), v0, s0));
+
+	EXPECT_TRUE(shader.optimizeRedundancy());
+
+	const Shader::Instruction *mul = shader.getInstruction(1);
+	EXPECT_EQ(Shader::OPCODE_MOV, mul->opcode);
+	EXPECT_EQ(Shader::PARAMETER_TEMP, mul->src[0].type);
+	EXPECT_EQ(1u, mul->src[0].index);
+	EXPECT_EQ(0x3, mul->dst.mask);
+
+	const Shader::Instruction *tex = shader.getInstruction(3);
+	EXPECT_EQ(Shader::OPCODE_MOV, tex->opcode);
+	EXPECT_EQ(Shader::PARAMETER_TEMP, tex->src[0].type);
+	EXPECT_EQ(3u, tex->src[0].index);
+	EXPECT_EQ(Shader::PARAMETER_VOID, tex->src[1].type);
+}
+
+TEST(ShaderOptimizer, KeepsRecomputationsOfChangedValues)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), t(3), c0));
+	shader.append(instruction(Shader::OPCODE_ADD, r(3), t(3), c1));   // Changes an operand
+	shader.append(instruction(Shader::OPCODE_MUL, r(2), t(3), c0));
+	shader.append(instruction(Shader::OPCODE_MUL, r(4), v0, c0));
+	shader.append(instruction(Shader::OPCODE_ADD, r(4), t(4), c1));   // Changes the result
+	shader.append(instruction(Shader::OPCODE_MUL, r(5), v0, c0));
+	shader.append(instruction(Shader::OPCODE_MUL, r(6, 0x1), v0, c1));
+	shader.append(instruction(Shader::OPCODE_MUL, r(7), v0, c1));     // More components than r6 holds
+
+	EXPECT_FALSE(shader.optimizeRedundancy());
+	EXPECT_EQ(Shader::OPCODE_MUL, shader.getInstruction(2)->opcode);
+	EXPECT_EQ(Shader::OPCODE_MUL, shader.getInstruction(5)->opcode);
+	EXPECT_EQ(Shader::OPCODE_MUL, shader.getInstruction(7)->opcode);
+}
+
+TEST(ShaderOptimizer, RedundancyDoesNotCrossControlFlow)
+{
+	TestShader shader;
+	shader.append(compare(Shader::CONTROL_LT, r(0, 0x1), v0, c0));
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), v0, c0));
+	shader.append(instruction(Shader::OPCODE_WHILE, Shader::DestinationParameter(), t(0, 0x00)));
+	shader.append(instruction(Shader::OPCODE_MUL, r(2), v0, c0));
+	shader.append(instruction(Shader::OPCODE_TEST, Shader::DestinationParameter()));
+	shader.append(instruction(Shader::OPCODE_MOV, r(0, 0x1), c1));
+	shader.append(instruction(Shader::OPCODE_ENDWHILE, Shader::DestinationParameter()));
+
+	EXPECT_FALSE(shader.optimizeRedundancy());
+	EXPECT_EQ(Shader::OPCODE_MUL, shader.getInstruction(3)->opcode);
+}
+
+TEST(ShaderOptimizer, RemovesDeadCode)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), v0, c0));        // Never read
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), v0, c1));
+	shader.append(instruction(Shader::OPCODE_DP4, r(3), v0, c0));        // Not componentwise
+	shader.append(instruction(Shader::OPCODE_MAD, oC0, t(2, 0x04), t(3, 0x00), v0));   // r2.xyxx, r3.xxxx
+
+	EXPECT_TRUE(shader.optimizeDeadCode());
+	shader.removeNull();
+
+	ASSERT_EQ(3u, shader.getLength());
+	EXPECT_EQ(Shader::OPCODE_ADD, shader.getInstruction(0)->opcode);
+	EXPECT_EQ(0x3, shader.getInstruction(0)->dst.mask);   // Narrowed to the components read
+	EXPECT_EQ(Shader::OPCODE_DP4, shader.getInstruction(1)->opcode);
+	EXPECT_EQ(0xF, shader.getInstruction(1)->dst.mask);
+
+	EXPECT_FALSE(shader.optimizeDeadCode());
+}
+
+TEST(ShaderOptimizer, KeepsValuesUsedAcrossSubroutines)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MUL, r(4), v0, c0));   // Read by the subroutine
+	shader.append(label(Shader::OPCODE_CALL, 1));
+	shader.append(instruction(Shader::OPCODE_MOV, oC0, t(2)));
+	shader.append(instruction(Shader::OPCODE_RET, Shader::DestinationParameter()));
+	shader.append(label(Shader::OPCODE_LABEL, 1));
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), t(4), c1));   // Read after the call
+	shader.append(instruction(Shader::OPCODE_RET, Shader::DestinationParameter()));
+
+	EXPECT_FALSE(shader.optimizeDeadCode());
+
+	PixelShader optimized(&shader);
+
+	ASSERT_EQ(shader.getLength(), optimized.getLength());
+	EXPECT_EQ(Shader::OPCODE_MUL, optimized.getInstruction(0)->opcode);
+	EXPECT_EQ(Shader::OPCODE_ADD, optimized.getInstruction(5)->opcode);
+}
+
+TEST(ShaderOptimizer, ReachesFixedPoint)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MOV, r(1), literal(1, 2, 3, 4)));
+	shader.append(instruction(Shader::OPCODE_ADD, r(2), t(1), literal(1, 1, 1, 1)));
+	shader.append(instruction(Shader::OPCODE_MUL, r(3), t(2), v0));
+	shader.append(instruction(Shader::OPCODE_MUL, r(4), t(2), v0));
+	shader.append(instruction(Shader::OPCODE_ADD, oC0, t(3), t(4)));
+
+	PixelShader optimized(&shader);
+
+	// The literal is folded into the first multiplication, which both operands of the sum then read
+	ASSERT_EQ(2u, optimized.getLength());
+	EXPECT_EQ(Shader::OPCODE_MUL, optimized.getInstruction(0)->opcode);
+	EXPECT_EQ(Shader::PARAMETER_FLOAT4LITERAL, optimized.getInstruction(0)->src[0].type);
+	EXPECT_EQ(2.0f, optimized.getInstruction(0)->src[0].value[0]);
+	EXPECT_EQ(5.0f, optimized.getInstruction(0)->src[0].value[3]);
+	EXPECT_EQ(Shader::OPCODE_ADD, optimized.getInstruction(1)->opcode);
+	EXPECT_EQ(optimized.getInstruction(0)->dst.index, optimized.getInstruction(1)->src[0].index);
+	EXPECT_EQ(optimized.getInstruction(0)->dst.index, optimized.getInstruction(1)->src[1].index);
+}
+
+TEST(ShaderOptimizer, SkipsDynamicallyIndexedTemporaries)
+{
+	TestShader shader;
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), v0, c0));   // Might be read through r[c1.x]
+	shader.append(instruction(Shader::OPCODE_MOV, indexed(2), v0));
+	shader.append(instruction(Shader::OPCODE_MOV, oC0, t(3)));
+
+	PixelShader optimized(&shader);
+
+	EXPECT_EQ(shader.getLength(), optimized.getLength());
+}
+
+TEST(ShaderOptimizer, SkipsPixelShader1x)
+{
+	TestShader shader;
+	shader.setVersion(0x0104);
+	shader.append(instruction(Shader::OPCODE_MUL, r(1), v0, c0));   // r0 is the output color, other registers unread
+
+	PixelShader optimized(&shader);
+
+	EXPECT_EQ(0x0104, optimized.getVersion());
+	EXPECT_EQ(1u, optimized.getLength());
+}
+
+namespace
+{
+	const int targetSize = 32;
+
+	typedef void (*PixelFunction)(const Primitive *primitive, int count, int cluster, DrawData *data);
+
+	struct CorpusShader
+	{
+		const char *name;
+		void (*build)(TestShader &shader);
+		bool optimizable;
+	};
+
+	// Arithmetic with foldable literals, copies, a recomputed product and dead values
+	void buildArithmetic(TestShader &shader)
+	{
+		shader.append(instruction(Shader::OPCODE_MOV, r(0), v0));
+		shader.append(instruction(Shader::OPCODE_MOV, r(1), literal(0.25f, 0.5f, 0.75f, 1.0f)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(2), t(1), literal(0.5f, 0.25f, 0.125f, 0.0f)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(3), t(0), t(2)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(4), t(0), t(2)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(7), t(0), literal(3, 3, 3, 3)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(5), t(3), negate(t(4, 0x1B))));
+		shader.append(instruction(Shader::OPCODE_MAD, oC0, t(5), c0, t(0, 0x1B)));
+	}
+
+	// A data dependent branch, with a product recomputed on one side
+	void buildBranch(TestShader &shader)
+	{
+		shader.append(instruction(Shader::OPCODE_MOV, r(0), v0));
+		shader.append(compare(Shader::CONTROL_LT, r(1, 0x1), t(0), literal(0.5f, 0.5f, 0.5f, 0.5f)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(2), t(0), c0));
+		shader.append(instruction(Shader::OPCODE_MOV, r(4), t(2, 0x1B)));
+		shader.append(instruction(Shader::OPCODE_IF, Shader::DestinationParameter(), t(1, 0x00)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(3), t(0), c0));
+		shader.append(instruction(Shader::OPCODE_MUL, r(6), t(0), c0));
+		shader.append(instruction(Shader::OPCODE_ADD, r(4), t(3), t(6)));
+		shader.append(instruction(Shader::OPCODE_ELSE, Shader::DestinationParameter()));
+		shader.append(instruction(Shader::OPCODE_MOV, r(5), t(0, 0xE1)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(4, 0x3), t(5), t(2)));
+		shader.append(instruction(Shader::OPCODE_ENDIF, Shader::DestinationParameter()));
+		shader.append(instruction(Shader::OPCODE_MOV, oC0, t(4)));
+	}
+
+	// A loop accumulating recomputed products, with the condition updated after the test
+	void buildLoop(TestShader &shader)
+	{
+		shader.append(instruction(Shader::OPCODE_MOV, r(0), v0));
+		shader.append(instruction(Shader::OPCODE_MOV, r(2), literal(0, 0, 0, 0)));
+		shader.append(instruction(Shader::OPCODE_MOV, r(4), literal(0, 0, 0, 0)));
+		shader.append(compare(Shader::CONTROL_LT, r(3, 0x1), t(2), literal(3, 3, 3, 3)));
+		shader.append(instruction(Shader::OPCODE_WHILE, Shader::DestinationParameter(), t(3, 0x00)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(5), t(0), literal(0.25f, 0.25f, 0.25f, 0.25f)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(6), t(0), literal(0.25f, 0.25f, 0.25f, 0.25f)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(4), t(4), t(5)));
+		shader.append(instruction(Shader::OPCODE_MAD, r(4), t(6), t(2, 0x00), t(4)));
+		shader.append(instruction(Shader::OPCODE_TEST, Shader::DestinationParameter()));
+		shader.append(instruction(Shader::OPCODE_ADD, r(2), t(2), literal(1, 1, 1, 1)));
+		shader.append(compare(Shader::CONTROL_LT, r(3, 0x1), t(2), literal(3, 3, 3, 3)));
+		shader.append(instruction(Shader::OPCODE_ENDWHILE, Shader::DestinationParameter()));
+		shader.append(instruction(Shader::OPCODE_MUL, oC0, t(4), literal(0.5f, 0.5f, 0.5f, 0.5f)));
+	}
+
+	// Calls which read and overwrite the caller's temporaries, including the source of a copy
+	void buildSubroutines(TestShader &shader)
+	{
+		shader.append(label(Shader::OPCODE_CALL, 0));
+		shader.append(instruction(Shader::OPCODE_RET, Shader::DestinationParameter()));
+
+		shader.append(label(Shader::OPCODE_LABEL, 0));
+		shader.append(instruction(Shader::OPCODE_ADD, r(0), v0, literal(0.25f, 0.25f, 0.25f, 0.25f)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(4), t(0), c0));
+		shader.append(instruction(Shader::OPCODE_MOV, r(1), t(0, 0x1B)));
+		shader.append(label(Shader::OPCODE_CALL, 1));
+		shader.append(instruction(Shader::OPCODE_ADD, r(2), t(2), t(1)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(3), t(0), c0));
+		shader.append(instruction(Shader::OPCODE_MAD, oC0, t(3), t(4), t(2)));
+		shader.append(instruction(Shader::OPCODE_RET, Shader::DestinationParameter()));
+
+		shader.append(label(Shader::OPCODE_LABEL, 1));
+		shader.append(instruction(Shader::OPCODE_MUL, r(2), t(4), t(4)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(5), t(4), t(4)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(2), t(2), t(5)));
+		shader.append(instruction(Shader::OPCODE_MOV, r(1), literal(0.5f, 0.25f, 0.125f, 1.0f)));
+		shader.append(instruction(Shader::OPCODE_MOV, r(0), c1));
+		shader.append(instruction(Shader::OPCODE_RET, Shader::DestinationParameter()));
+	}
+
+	// Writes to a temporary selected by a constant, which disables the data flow optimizations
+	void buildDynamicIndexing(TestShader &shader)
+	{
+		shader.append(instruction(Shader::OPCODE_MOV, r(1), literal(0.1f, 0.2f, 0.3f, 0.4f)));
+		shader.append(instruction(Shader::OPCODE_MOV, r(2), literal(0.5f, 0.6f, 0.7f, 0.8f)));
+		shader.append(instruction(Shader::OPCODE_MOV, r(3), literal(0.9f, 1.0f, 1.1f, 1.2f)));
+		shader.append(instruction(Shader::OPCODE_MUL, r(5), v0, c0));
+		shader.append(instruction(Shader::OPCODE_MOV, indexed(1), t(5)));
+		shader.append(instruction(Shader::OPCODE_ADD, r(4), t(2), t(3)));
+		shader.append(instruction(Shader::OPCODE_ADD, oC0, t(4), t(1)));
+	}
+
+	const CorpusShader corpus[] =
+	{
+		{"arithmetic", buildArithmetic, true},
+		{"branch", buildBranch, true},
+		{"loop", buildLoop, true},
+		{"subroutines", buildSubroutines, true},
+		{"dynamic indexing", buildDynamicIndexing, false},
+	};
+
+	// Shades a square covering the target, with v0 holding the normalized pixel position
+	void render(const PixelShader *shader, DrawData *data, float *target)
+	{
+		PixelProcessor::State state;
+
+		state.shaderID = shader->getSerialID();
+		state.alphaCompareMode = ALPHA_ALWAYS;
+		state.logicalOperation = LOGICALOP_COPY;
+		state.colorWriteMask = 0xF;
+		state.targetFormat[0] = FORMAT_A32B32G32R32F;
+		state.multiSample = 1;
+		state.multiSampleMask = 1;
+		state.interpolant[0].component = 0xF;
+
+		PixelProgram program(state, shader);
+		program.generate();
+		Routine *routine = program(L"ShaderOptimizerTests");
+
+		Primitive *primitive = (Primitive*)allocate(sizeof(Primitive));
+		memset(primitive, 0, sizeof(Primitive));
+
+		primitive->yMin = 0;
+		primitive->yMax = targetSize;
+
+		for(int y = 0; y < targetSize; y++)
+		{
+			primitive->outline[y].left = 0;
+			primitive->outline[y].right = targetSize;
+		}
+
+		primitive->xQuad = vector(0.0f, 1.0f, 0.0f, 1.0f);
+		primitive->yQuad = vector(0.0f, 0.0f, 1.0f, 1.0f);
+
+		for(int component = 0; component < 4; component++)
+		{
+			PlaneEquation &plane = primitive->V[0][component];
+
+			plane.A = replicate(component == 0 ? 1.0f / targetSize : 0.0f);
+			plane.B = replicate(component == 1 ? 1.0f / targetSize : 0.0f);
+			plane.C = replicate(component == 2 ? 0.5f : (component == 3 ? 1.0f : 0.0f));
+		}
+
+		memset(target, 0, targetSize * targetSize * 16);
+
+		data->colorBuffer[0] = (unsigned int*)target;
+		data->colorPitchB[0] = targetSize * 16;
+		data->colorSliceB[0] = targetSize * targetSize * 16;
+
+		PixelFunction shade = (PixelFunction)routine->getEntry();
+		shade(primitive, 1, 0, data);
+
+		deallocate(primitive);
+		delete routine;
+	}
+}
+
+TEST(ShaderOptimizerCorpus, RendersIdentically)
+{
+	DrawData *data = createDrawData();
+
+	const float constants[2][4] = {{0.75f, 1.5f, 0.5f, 2.0f}, {0.125f, 0.25f, 0.375f, 0.5f}};
+	memcpy(data->ps.c, constants, sizeof(constants));
+
+	const int index = 2;   // Read as an integer for r[c1.x + 1]
+	memcpy(&data->ps.c[1][0], &index, sizeof(index));
+
+	std::vector<float> reference(targetSize * targetSize * 4);
+	std::vector<float> result(targetSize * targetSize * 4);
+
+	for(const CorpusShader &entry : corpus)
+	{
+		SCOPED_TRACE(entry.name);
+
+		TestShader source;
+		entry.build(source);
+
+		shaderOptimizations = false;
+		PixelShader unoptimized(&source);
+		shaderOptimizations = true;
+		PixelShader optimized(&source);
+
+		if(entry.optimizable)
+		{
+			EXPECT_LT(optimized.getLength(), unoptimized.getLength());
+		}
+		else
+		{
+			EXPECT_EQ(optimized.getLength(), unoptimized.getLength());
+		}
+
+		render(&unoptimized, data, reference.data());
+		render(&optimized, data, result.data());
+
+		int mismatches = 0;
+
+		for(size_t i = 0; i < reference.size(); i++)
+		{
+			if(fabsf(reference[i] - result[i]) > 1.0e-6f * fmaxf(1.0f, fabsf(reference[i])))
+			{
+				if(mismatches++ == 0)
+				{
+					ADD_FAILURE() << "first differing component " << i << ": " << reference[i] << " unoptimized, " << result[i] << " optimized";
+				}
+			}
+		}
+
+		EXPECT_EQ(0, mismatches);
+	}
+
+	destroyDrawData(data);
+}
@@ -0,0 +1,91 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that Surface buffers track their dirty texels as a list of regions,
+// so that separate writes don't convert everything in between.
+
+#include "Renderer/Surface.hpp"
+
+#include "gtest/gtest.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace sw;
+
+TEST(RegionList, SkipsContainedRegions)
+{
+	RegionList list;
+	list.add(Region(0, 0, 0, 8, 8, 1));
+	list.add(Region(2, 2, 0, 4, 4, 1));
+
+	EXPECT_EQ(1, list.count);
+
+	list.add(Region(0, 0, 0, 16, 16, 1));
+
+	ASSERT_EQ(1, list.count);
+	EXPECT_EQ(16, list.region[0].x1);
+}
+
+TEST(RegionList, MergesNearestRegionWhenFull)
+{
+	RegionList list;
+
+	for(int i = 0; i < RegionList::MAX_REGIONS; i++)
+	{
+		list.add(Region(i * 100, 0, 0, i * 100 + 4, 4, 1));
+	}
+
+	list.add(Region(4, 0, 0, 8, 4, 1));
+
+	ASSERT_EQ(RegionList::MAX_REGIONS, list.count);
+	EXPECT_EQ(0, list.region[0].x0);
+	EXPECT_EQ(8, list.region[0].x1);
+	EXPECT_EQ(100, list.region[1].x0);
+}
+
+TEST(SurfaceRegion, UpdatesOnlyDirtyRegions)
+{
+	const int size = 64;
+	const int pitch = size * 3;
+	std::vector<unsigned char> pixels(pitch * size, 0);
+
+	Surface *surface = new Surface(size, size, 1, FORMAT_R8G8B8, &pixels[0], pitch, pitch * size);
+
+	// Converts the whole external buffer once
+	surface->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+	surface->unlockInternal();
+
+	// Two writes at opposite corners. The texel in between is written too, but
+	// isn't part of either write region, so it must not be converted.
+	unsigned char *external = (unsigned char*)surface->lockExternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC, Region(0, 0, 0, 4, 4, 1));
+	memset(external + 2 * pitch + 2 * 3, 0xFF, 3);
+	memset(external + 30 * pitch + 30 * 3, 0xFF, 3);
+	surface->unlockExternal();
+
+	external = (unsigned char*)surface->lockExternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC, Region(58, 58, 0, 62, 62, 1));
+	memset(external + 60 * pitch + 60 * 3, 0xFF, 3);
+	surface->unlockExternal();
+
+	const unsigned char *internal = (const unsigned char*)surface->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+	int internalPitch = surface->getInternalPitchB();
+
+	EXPECT_EQ(0xFFFFFFu, *(const unsigned int*)(internal + 2 * internalPitch + 2 * 4) & 0xFFFFFF);
+	EXPECT_EQ(0xFFFFFFu, *(const unsigned int*)(internal + 60 * internalPitch + 60 * 4) & 0xFFFFFF);
+	EXPECT_EQ(0u, *(const unsigned int*)(internal + 30 * internalPitch + 30 * 4) & 0xFFFFFF);
+
+	surface->unlockInternal();
+
+	delete surface;
+}
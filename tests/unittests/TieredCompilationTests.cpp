@@ -0,0 +1,168 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that routines first compiled without optimizations are replaced by
+// optimized ones once they are used often enough, for draws which keep their
+// state as well as for draws which change it. Both tiers use the back-end the
+// library was built with, at two optimization levels.
+
+#include "RendererTest.hpp"
+
+#include "Shader/PixelShader.hpp"
+#include "Common/Thread.hpp"
+#include "Common/Timer.hpp"
+
+using namespace sw;
+
+namespace
+{
+	const int promotionDraws = 64;        // Well over the routine caches' promotion threshold
+	const double promotionTimeout = 60;   // Seconds, for slow builds
+
+	const std::vector<float4> triangle =
+	{
+		{-1.0f, -1.0f, 0.0f, 1.0f},
+		{ 3.0f, -1.0f, 0.0f, 1.0f},
+		{-1.0f,  3.0f, 0.0f, 1.0f},
+	};
+
+	class PixelShader14 : public PixelShader
+	{
+	public:
+		PixelShader14()
+		{
+			version = 0x0104;
+		}
+	};
+
+	bool anyDrawn(const std::vector<unsigned int> &pixels)
+	{
+		for(unsigned int pixel : pixels)
+		{
+			if(pixel != 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+class TieredCompilation : public RendererTest
+{
+protected:
+	// Keeps drawing until the routines were replaced, as the optimized ones are compiled in the background
+	bool waitForOptimizedRoutines()
+	{
+		double start = Timer::seconds();
+
+		while(Timer::seconds() - start < promotionTimeout)
+		{
+			draw(triangle);
+			finish();
+
+			if(renderer->hasOptimizedRoutines())
+			{
+				return true;
+			}
+
+			Thread::sleep(1);
+		}
+
+		return false;
+	}
+};
+
+TEST_F(TieredCompilation, PromotesRoutinesOfUnchangedState)
+{
+	draw(triangle);
+	finish();
+	EXPECT_FALSE(renderer->hasOptimizedRoutines());
+
+	for(int i = 0; i < promotionDraws; i++)
+	{
+		draw(triangle);
+	}
+
+	EXPECT_TRUE(waitForOptimizedRoutines());
+
+	// Both tiers draw the same pixels
+	clearPixels();
+	draw(triangle);
+	std::vector<unsigned int> pixels = readPixels();
+
+	for(unsigned int pixel : pixels)
+	{
+		ASSERT_EQ(0x01010101u, pixel);
+	}
+}
+
+TEST_F(TieredCompilation, PromotesRoutinesOfChangingState)
+{
+	for(int i = 0; i < promotionDraws; i++)
+	{
+		renderer->setCullMode((i & 1) ? CULL_CLOCKWISE : CULL_NONE);
+		draw(triangle);
+	}
+
+	renderer->setCullMode(CULL_NONE);
+
+	EXPECT_TRUE(waitForOptimizedRoutines());
+}
+
+// Optimized routines are compiled from a copy of the shader, which has to keep
+// its version. Here r0 holds c0, and the ps_1_4 texkill discards the pixels
+// where it is negative. A copy treated as ps_3_0 would not discard any.
+TEST_F(TieredCompilation, PromotesRoutinesOfPixelShader14)
+{
+	PixelShader14 pixel;
+
+	Shader::Instruction *mov = new Shader::Instruction(Shader::OPCODE_MOV);
+	mov->dst.type = Shader::PARAMETER_TEMP;
+	mov->dst.index = 0;
+	mov->dst.mask = 0xF;
+	mov->src[0].type = Shader::PARAMETER_CONST;
+	mov->src[0].index = 0;
+	mov->src[0].swizzle = 0xE4;
+	pixel.append(mov);
+
+	Shader::Instruction *texkill = new Shader::Instruction(Shader::OPCODE_TEXKILL);
+	texkill->dst.type = Shader::PARAMETER_TEMP;
+	texkill->dst.index = 0;
+	texkill->dst.mask = 0xF;
+	pixel.append(texkill);
+
+	PixelShader *shader = new PixelShader(&pixel);
+	renderer->setPixelShader(shader);
+	delete pixelShader;
+	pixelShader = shader;
+
+	for(int i = 0; i < promotionDraws; i++)
+	{
+		draw(triangle);
+	}
+
+	ASSERT_TRUE(waitForOptimizedRoutines());
+
+	clearPixels();
+	setColor(0.5f, 0.5f, 0.5f, 0.5f);
+	draw(triangle);
+	EXPECT_TRUE(anyDrawn(readPixels()));
+
+	clearPixels();
+	setColor(0.5f, -0.5f, 0.5f, 0.5f);
+	draw(triangle);
+	EXPECT_FALSE(anyDrawn(readPixels()));
+}
@@ -0,0 +1,115 @@
+// Copyright 2017 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that culling triangles on their positions before full vertex shading
+// draws the same pixels as leaving all culling to triangle setup.
+
+#include "RendererTest.hpp"
+
+namespace sw
+{
+	extern bool vertexPrepass;
+}
+
+using namespace sw;
+
+namespace
+{
+	const int cells = 8;   // Per side of the grid
+
+	// Two triangles per grid cell, the second one wound the other way. Cells of the
+	// last row are degenerate, and those of the last column are off-screen.
+	std::vector<float4> createTriangles()
+	{
+		std::vector<float4> triangles;
+
+		for(int y = 0; y < cells; y++)
+		{
+			for(int x = 0; x < cells; x++)
+			{
+				float x0 = -1.0f + 2.0f * x / cells;
+				float y0 = -1.0f + 2.0f * y / cells;
+				float x1 = x0 + 2.0f / cells;
+				float y1 = (y == cells - 1) ? y0 : y0 + 2.0f / cells;
+
+				if(x == cells - 1)
+				{
+					x0 += 4.0f;
+					x1 += 4.0f;
+				}
+
+				const float4 cell[6] =
+				{
+					{x0, y0, 0.0f, 1.0f}, {x1, y0, 0.0f, 1.0f}, {x0, y1, 0.0f, 1.0f},
+					{x1, y0, 0.0f, 1.0f}, {x0, y1, 0.0f, 1.0f}, {x1, y1, 0.0f, 1.0f},
+				};
+
+				triangles.insert(triangles.end(), cell, cell + 6);
+			}
+		}
+
+		return triangles;
+	}
+}
+
+class VertexPrepass : public RendererTest
+{
+protected:
+	void TearDown() override
+	{
+		RendererTest::TearDown();
+
+		vertexPrepass = false;
+	}
+
+	std::vector<unsigned int> render(CullMode cullMode, bool prepass)
+	{
+		vertexPrepass = prepass;
+		renderer->setCullMode(cullMode);
+
+		clearPixels();
+		draw(createTriangles());
+
+		return readPixels();
+	}
+};
+
+TEST_F(VertexPrepass, DrawsTheSamePixels)
+{
+	const CullMode cullModes[] = {CULL_NONE, CULL_CLOCKWISE, CULL_COUNTERCLOCKWISE};
+
+	for(CullMode cullMode : cullModes)
+	{
+		std::vector<unsigned int> reference = render(cullMode, false);
+		std::vector<unsigned int> culled = render(cullMode, true);
+
+		EXPECT_EQ(reference, culled) << "Cull mode " << cullMode;
+	}
+}
+
+TEST_F(VertexPrepass, CullsBackFaces)
+{
+	std::vector<unsigned int> none = render(CULL_NONE, true);
+	std::vector<unsigned int> clockwise = render(CULL_CLOCKWISE, true);
+	std::vector<unsigned int> counterClockwise = render(CULL_COUNTERCLOCKWISE, true);
+
+	// Every triangle which isn't culled either way faces one way or the other
+	for(int i = 0; i < WIDTH * HEIGHT; i++)
+	{
+		EXPECT_EQ(none[i], clockwise[i] + counterClockwise[i]);
+	}
+
+	EXPECT_NE(none, clockwise);
+	EXPECT_NE(none, counterClockwise);
+}